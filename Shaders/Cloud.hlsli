@@ -0,0 +1,542 @@
+// --- Volumetric Cloud Model ---
+// Density, lighting and ray parameterization shared by the per-pixel march (CloudPS) and the froxel passes.
+
+#include "Common.hlsli"
+#include "SDF.hlsli"
+#include "Intersect.hlsli"
+
+#define STEPS_LIGHT 6
+#define STEPS_LIGHT_MIN 2
+
+#define LAYER_BOX 0
+#define LAYER_SLAB 1
+#define LAYER_SHELL 2
+
+#define MARCH_UNIFORM 0
+#define MARCH_IMPORTANCE 1
+#define MAX_COARSE_STEPS 16
+
+#define MAX_NOISE_MIP 1.0        // Mip 2 texels straddle two atlas tiles (34-texel stride); see getPerlinWorleyNoise
+#define LOD_FOOTPRINT_TEXELS 4.0 // Detail texels that must fit in one pixel before the footprint drives the LOD
+
+static const float3 CloudExtent = float3(100.0, 40.0, 100.0);
+static const float3 SigmaS = float3(1.0, 1.0, 1.0);
+static const float3 SigmaA = float3(0.0, 0.0, 0.0);
+static const float3 PhaseParams = float3(-0.1, 0.3, 0.7); // g1, g2, weight
+static const float GoldenRatio = 1.61803398875;
+
+static const float3 SigmaE = max(SigmaS + SigmaA, float3(1e-6, 1e-6, 1e-6));
+
+Texture2D NoiseAtlas : register(t0);
+Texture2D BlueNoiseTex : register(t1);
+SamplerState LinearSampler : register(s0);
+SamplerState PointSampler : register(s1);
+SamplerState LinearClampSampler : register(s2);
+
+// Opaque SDF scene drawn before the clouds in the combined mode (Distance3DPS with SCENE_DEPTH)
+Texture2D<float4> SceneColorTex : register(t6);
+Texture2D<float> SceneDepthTex : register(t7);
+
+#include "Weather.hlsli"
+#include "Stats.hlsli"
+#include "CloudShadow.hlsli"
+
+// =================================================================================
+// Helper Functions
+// =================================================================================
+
+float getGlow(float dist, float radius, float intensity)
+{
+    dist = max(dist, 1e-6);
+    return pow(radius / dist, intensity);
+}
+
+float3 getSky(float3 rd)
+{
+    float3 zenithColor = float3(0.09, 0.33, 0.81) * 0.7;
+    float3 horizonColor = float3(0.6, 0.7, 0.8);
+    
+    float horizonMix = pow(1.0 - max(rd.y, 0.0), 4.0);
+    float3 sky = lerp(zenithColor, horizonColor, horizonMix);
+
+    float mu = 0.5 + 0.5 * dot(rd, SunDir);
+    float sunDisk = getGlow(1.0 - mu, 0.00015, 0.9);
+
+    float3 sunColor = float3(1.0, 1.0, 1.0);
+    float3 sunGlow = sunColor * sunDisk;
+
+    return sky + sunGlow;
+}
+
+float circularOut(float t)
+{
+    return sqrt((2.0 - t) * t);
+}
+
+float remap(float x, float low1, float high1, float low2, float high2)
+{
+    return low2 + (x - low1) * (high2 - low2) / (high1 - low1);
+}
+
+float getPerlinWorleyNoise(float3 pos, float mip)
+{
+    const float atlasSize = 204.0;
+    const float tileSize = 32.0;
+    const float tileRows = 6.0;
+    
+    float3 p = pos.xzy;
+    float3 coord = fmod(abs(p), float3(tileSize, tileSize, 36.0));
+    
+    float level = floor(coord.z);
+    float f = frac(coord.z);
+
+    float tileY = floor(level / tileRows);
+    float tileX = fmod(level, tileRows);
+
+    float2 offset = float2(tileX, tileY) * (tileSize + 2.0) + 1.0;
+    float2 pixel = coord.xy + offset + 0.5;
+    
+    // A bilinear tap at mip m reaches 0.5 * 2^m texels either side of pixel. Near the tile edge that runs past
+    // the one-texel border into the next tile (25% of it at mip 1), so the tap is kept inside the tile and its
+    // border. The even stride keeps mip 1 texels within a tile; getCloudLod stops at MAX_NOISE_MIP.
+    float reach = 0.5 * exp2(ceil(mip));
+    pixel = clamp(pixel, offset - 1.0 + reach, offset + tileSize + 1.0 - reach);
+    float2 data = NoiseAtlas.SampleLevel(LinearSampler, pixel / atlasSize, mip).xy;
+    return lerp(data.x, data.y, f);
+}
+
+float getPerlinWorleyNoise(float3 pos)
+{
+    return getPerlinWorleyNoise(pos, 0.0);
+}
+
+float getCloudMap(float3 p)
+{
+    float2 uv = p.xz / (1.8 * CloudExtent.x);
+    float dist = circularOut(saturate(1.0 - length(uv * 5.0)));
+    dist = max(dist, 0.8 * circularOut(saturate(1.0 - length(uv * 6.0 + 0.65))));
+    dist = max(dist, 0.75 * circularOut(saturate(1.0 - length(uv * 7.8 - 0.75))));
+    return dist;
+}
+
+// =================================================================================
+// Cloud Layer Geometry
+// =================================================================================
+
+float3 getPlanetCenter()
+{
+    return float3(0.0, -PlanetRadius, 0.0);
+}
+
+float getLayerThickness()
+{
+    if (WeatherEnabled)
+        return LayerTop - LayerBottom;
+    return (LayerMode == LAYER_BOX) ? CloudExtent.y : (ShellTop - ShellBottom);
+}
+
+// Normalized height inside the cloud layer (0 = bottom, 1 = top)
+float getHeightFraction(float3 p)
+{
+    if (WeatherEnabled)
+        return (p.y - LayerBottom) / (LayerTop - LayerBottom);
+    if (LayerMode == LAYER_SHELL)
+        return (length(p - getPlanetCenter()) - PlanetRadius - ShellBottom) / (ShellTop - ShellBottom);
+    if (LayerMode == LAYER_SLAB)
+        return (p.y - ShellBottom) / (ShellTop - ShellBottom);
+    return p.y / CloudExtent.y;
+}
+
+// Returns the [tStart, tEnd] ray interval that may contain clouds
+bool getCloudSegment(float3 ro, float3 rd, out float2 segment)
+{
+    segment = float2(0.0, -1.0);
+
+    if (WeatherEnabled)
+    {
+        // Streamed tiles: march the layer slab around the camera up to the loaded radius
+        float3 minCorner = float3(ro.x - MaxDistance, LayerBottom, ro.z - MaxDistance);
+        float3 maxCorner = float3(ro.x + MaxDistance, LayerTop, ro.z + MaxDistance);
+        segment = intersectAABB(ro, rd, minCorner, maxCorner);
+        segment.y = min(segment.y, MaxDistance);
+    }
+    else if (LayerMode == LAYER_SLAB)
+    {
+        if (!intersectCloudLayer(ro, rd, ShellBottom, ShellTop, LayerMaxDistance, segment.x, segment.y))
+            return false;
+    }
+    else if (LayerMode == LAYER_SHELL)
+    {
+        float3 oc = ro - getPlanetCenter();
+        float outerMin, outerMax;
+        if (!intersectSphere(oc, rd, PlanetRadius + ShellTop, outerMin, outerMax) || outerMax < 0.0)
+            return false;
+
+        segment = float2(max(outerMin, 0.0), outerMax);
+
+        float innerMin, innerMax;
+        if (intersectSphere(oc, rd, PlanetRadius + ShellBottom, innerMin, innerMax) && innerMax > 0.0)
+        {
+            if (innerMin < 0.0)
+                segment.x = max(segment.x, innerMax); // Below the layer: start where the ray leaves the inner sphere
+            else
+                segment.y = min(segment.y, innerMin); // Above or inside: stop where the ray dives under the layer
+        }
+        segment.y = min(segment.y, segment.x + LayerMaxDistance);
+    }
+    else
+    {
+        float3 minCorner = float3(-CloudExtent.x, 0.0, -CloudExtent.z);
+        float3 maxCorner = float3(CloudExtent.x, CloudExtent.y, CloudExtent.z);
+        segment = intersectAABB(ro, rd, minCorner, maxCorner);
+    }
+
+    segment.x = max(segment.x, 0.0);
+    return segment.x <= segment.y;
+}
+
+// =================================================================================
+// Level of Detail
+// =================================================================================
+
+// The LOD level is continuous in [0, 3] and each integer step removes one more piece of work:
+//   0 -> 1 : detail erosion fades out
+//   1 -> 2 : light march drops from STEPS_LIGHT to STEPS_LIGHT_MIN samples, noise moves to coarser mips
+//   2 -> 3 : shape noise erosion fades out (only the coverage/height profile is left)
+struct CloudLod
+{
+    float Level;
+    float NoiseMip;     // Mip used for the noise fetches
+    float Detail;       // Weight of the detail erosion (0 = skipped)
+    float Shape;        // Weight of the shape erosion (0 = skipped)
+    float LightSteps;   // Light march sample count (a fractional count weights the last sample by its fraction)
+};
+
+CloudLod getFullLod()
+{
+    CloudLod lod;
+    lod.Level = 0.0;
+    lod.NoiseMip = 0.0;
+    lod.Detail = 1.0;
+    lod.Shape = 1.0;
+    lod.LightSteps = clamp(float(STEPS_LIGHT) * LightStepScale, 1.0, float(STEPS_LIGHT));
+    return lod;
+}
+
+// Level 1 is reached at LodDistance or once LOD_FOOTPRINT_TEXELS detail texels fall into one pixel,
+// whichever comes first; every doubling of either quantity adds one level.
+CloudLod getCloudLod(float t, float stepS)
+{
+    float pixelFootprint = max(t, 1e-3) * 2.0 / Resolution.y; // Focal length 1, screen spans [-1, 1] vertically
+    float distanceLevel = log2(max(t, 1e-3) / LodDistance) + 1.0;
+    float footprintLevel = log2(pixelFootprint * CloudScale * 0.8 / LOD_FOOTPRINT_TEXELS) + 1.0;
+    float level = clamp(max(distanceLevel, footprintLevel), 0.0, 3.0);
+
+    float footprintMip = log2(max(stepS * CloudScale * 0.4, 1.0));
+
+    CloudLod lod;
+    lod.Level = level;
+    lod.NoiseMip = min(saturate(level - 1.0) * footprintMip, MAX_NOISE_MIP);
+    lod.Detail = 1.0 - saturate(level);
+    lod.Shape = 1.0 - saturate(level - 2.0);
+    lod.LightSteps = lerp(float(STEPS_LIGHT), float(STEPS_LIGHT_MIN), saturate(level - 1.0));
+    lod.LightSteps = clamp(lod.LightSteps * LightStepScale, 1.0, float(STEPS_LIGHT));
+    return lod;
+}
+
+float getBaseDensity(float3 p, float mip)
+{
+    if (WeatherEnabled)
+        return getWeatherBaseDensity(p);
+
+    if (LayerMode != LAYER_BOX)
+    {
+        float height = getHeightFraction(p);
+        if (height < 0.0 || height > 1.0)
+            return 0.0;
+
+        float coverageNoise = getPerlinWorleyNoise(float3(p.x, 0.0, p.z) * CoverageScale, mip);
+        float coverage = saturate(remap(coverageNoise, 0.45, 0.8, 0.0, 1.0));
+        if (coverage <= 0.0)
+            return 0.0;
+
+        float top = pow(coverage, 0.75);
+        return coverage * saturate(remap(height, 0.0, max(0.25 * (1.0 - coverage), 1e-4), 0.0, 1.0))
+                        * saturate(remap(height, 0.75 * top, top, 1.0, 0.0));
+    }
+
+    if (abs(p.x) > CloudExtent.x || abs(p.z) > CloudExtent.z || p.y < 0.0 || p.y > CloudExtent.y)
+        return 0.0;
+
+    float cloudHeight = saturate(p.y / CloudExtent.y);
+    float cloudMap = getCloudMap(p);
+    if (cloudMap <= 0.0)
+        return 0.0;
+
+    float hLimit = pow(cloudMap, 0.75);
+    float verticalShaping = saturate(remap(cloudHeight, 0.0, 0.25 * (1.0 - cloudMap), 0.0, 1.0))
+                          * saturate(remap(cloudHeight, 0.75 * hLimit, hLimit, 1.0, 0.0));
+    
+    return cloudMap * verticalShaping;
+}
+
+float getDensity(float3 p, CloudLod lod)
+{
+    float baseDensity = getBaseDensity(p, lod.NoiseMip);
+    if (baseDensity <= 0.0)
+        return 0.0;
+
+    float density = baseDensity;
+    if (lod.Shape > 0.0)
+    {
+        float3 shapePos = p * CloudScale * 0.4 + float3(Time * 2.0, 0.0, Time);
+        float shapeNoise = getPerlinWorleyNoise(shapePos, lod.NoiseMip);
+        density = saturate(remap(baseDensity, ShapeStrength * lod.Shape * shapeNoise, 1.0, 0.0, 1.0));
+    }
+
+    if (density <= 0.01)
+        return 0.0;
+
+    if (lod.Detail > 0.0)
+    {
+        float3 detailPos = p * CloudScale * 0.8 + float3(Time * 3.0, -Time * 3.0, Time);
+        float detailNoise = getPerlinWorleyNoise(detailPos, lod.NoiseMip);
+        density = saturate(remap(density, DetailStrength * lod.Detail * detailNoise, 1.0, 0.0, 1.0));
+    }
+
+    return density * DensityMult;
+}
+
+float getDensity(float3 p)
+{
+    return getDensity(p, getFullLod());
+}
+
+float HenyeyGreenstein(float g, float costh)
+{
+    return (1.0 / (4.0 * 3.14159)) * ((1.0 - g * g) / pow(1.0 + g * g - 2.0 * g * costh, 1.5));
+}
+
+float3 multipleOctaves(float density, float mu, float stepL)
+{
+    float3 luminance = float3(0, 0, 0);
+    float a = 1.0, b = 1.0, c = 1.0;
+    
+    float3 sigmaE = SigmaE;
+
+    for (int i = 0; i < 4; i++)
+    {
+        float phase = lerp(HenyeyGreenstein(PhaseParams.x * c, mu),
+                           HenyeyGreenstein(PhaseParams.y * c, mu),
+                           PhaseParams.z);
+                           
+        luminance += b * phase * exp(-stepL * density * sigmaE * a);
+        a *= 0.2;
+        b *= 0.5;
+        c *= 0.5;
+    }
+    return luminance;
+}
+
+float3 getLightLuminance(float densityAcc, float mu, float stepL)
+{
+    float3 beersLaw = multipleOctaves(densityAcc, mu, stepL);
+    
+    float3 sigmaE = SigmaE;
+    float3 powder = 2.0 * (1.0 - exp(-stepL * densityAcc * 2.0 * sigmaE));
+    
+    return lerp(beersLaw * powder, beersLaw, 0.5 + 0.5 * mu);
+}
+
+// Samples sit every stepL from p over the marched length, the first at p itself, so the primary density is
+// reused for it. With a fractional LightSteps the last sample covers only the remaining fraction of a step.
+float getLightSampleWeight(CloudLod lod, int j)
+{
+    return min(lod.LightSteps - float(j), 1.0);
+}
+
+float3 lightRay(float3 p, float mu, CloudLod lod, float density)
+{
+    float stepL = (getLayerThickness() * 0.75) / lod.LightSteps;
+    float densityAcc = density;
+
+    for (int j = 1; j < STEPS_LIGHT; j++)
+    {
+        if (float(j) >= lod.LightSteps)
+            break;
+
+        densityAcc += getDensity(p + SunDir * (float(j) * stepL), lod) * getLightSampleWeight(lod, j);
+        STAT_INC(STAT_LIGHT_DENSITY);
+    }
+
+    return getLightLuminance(densityAcc, mu, stepL);
+}
+
+// Cheaper lighting from the cloud shadow map: the baked density toward the sun replaces the light march,
+// and its attenuation stands in for the height gradient of the ambient term (open sky above = 0.8)
+void getShadowMapLighting(float3 p, float mu, out float3 lightLuminance, out float ambientLevel)
+{
+    float densityAcc = getCloudShadowDensity(p);
+    lightLuminance = getLightLuminance(densityAcc, mu, 1.0);
+    ambientLevel = lerp(0.2, 0.8, exp(-0.25 * densityAcc));
+}
+
+// --- Light March Cache ---
+// Consecutive primary samples on one view ray send parallel sun rays through nearly the same density.
+// Slot j keeps the density found j light steps toward the sun from a recent primary sample; each call
+// refreshes LightRefreshPerStep slots round-robin and reuses the rest. A slot is also refreshed once the
+// view ray has moved more than LightCacheMaxLag light steps since it was sampled, or when the light step
+// length changes with the LOD.
+struct LightCache
+{
+    float Density[STEPS_LIGHT];
+    float Age[STEPS_LIGHT];     // Distance moved along the view ray since the slot was sampled
+    float LightSteps;
+    float LastT;
+    uint  Counter;
+    bool  bValid;
+};
+
+LightCache initLightCache()
+{
+    LightCache cache = (LightCache)0;
+    cache.bValid = false;
+    return cache;
+}
+
+float3 lightRayCached(float3 p, float t, float mu, CloudLod lod, float density, inout LightCache cache)
+{
+    float stepL = (getLayerThickness() * 0.75) / lod.LightSteps;
+    float maxAge = LightCacheMaxLag * stepL;
+
+    bool bStale = !cache.bValid || abs(lod.LightSteps - cache.LightSteps) > 0.5;
+    float moved = cache.bValid ? abs(t - cache.LastT) : 0.0;
+
+    uint slotCount = (uint)ceil(lod.LightSteps) - 1;
+    float densityAcc = density;
+
+    for (int j = 1; j < STEPS_LIGHT; j++)
+    {
+        if (float(j) >= lod.LightSteps)
+            break;
+
+        cache.Age[j] += moved;
+
+        bool bRoundRobin = ((uint(j) - 1 + cache.Counter) % slotCount) < LightRefreshPerStep;
+        if (bStale || bRoundRobin || cache.Age[j] > maxAge)
+        {
+            cache.Density[j] = getDensity(p + SunDir * (float(j) * stepL), lod);
+            cache.Age[j] = 0.0;
+            STAT_INC(STAT_LIGHT_DENSITY);
+        }
+
+        densityAcc += cache.Density[j] * getLightSampleWeight(lod, j);
+    }
+
+    cache.Counter += LightRefreshPerStep;
+    cache.LightSteps = lod.LightSteps;
+    cache.LastT = t;
+    cache.bValid = true;
+
+    return getLightLuminance(densityAcc, mu, stepL);
+}
+
+// =================================================================================
+// Ray Parameterization
+// =================================================================================
+
+// Maps u in [0, 1] onto [tStart, tEnd], either linearly or geometrically around LodDistance
+struct RayMapping
+{
+    float Start;
+    float Length;
+    float LogRatio;
+    bool  bGeometric;
+};
+
+RayMapping getRayMapping(float tStart, float tEnd, bool bGeometric)
+{
+    RayMapping mapping;
+    mapping.Start = tStart;
+    mapping.Length = tEnd - tStart;
+    mapping.LogRatio = log((tEnd + LodDistance) / (tStart + LodDistance));
+    mapping.bGeometric = bGeometric;
+    return mapping;
+}
+
+// Box and tiles march uniformly. The open layers can span thousands of units, so their samples are
+// spaced geometrically: t(u) = (tStart + c) * r^u - c keeps the step roughly proportional to distance
+// past c = LodDistance while the sample count stays fixed.
+RayMapping getCloudRayMapping(float2 segment)
+{
+    return getRayMapping(segment.x, segment.y, !WeatherEnabled && LayerMode != LAYER_BOX);
+}
+
+float getRayT(RayMapping mapping, float u)
+{
+    if (mapping.bGeometric)
+        return (mapping.Start + LodDistance) * exp(mapping.LogRatio * u) - LodDistance;
+    return mapping.Start + mapping.Length * u;
+}
+
+// Inverse of getRayT
+float getRayU(RayMapping mapping, float t)
+{
+    if (mapping.bGeometric)
+        return log((t + LodDistance) / (mapping.Start + LodDistance)) / mapping.LogRatio;
+    return (t - mapping.Start) / max(mapping.Length, 1e-6);
+}
+
+float getRayDtDu(RayMapping mapping, float t)
+{
+    return mapping.bGeometric ? (t + LodDistance) * mapping.LogRatio : mapping.Length;
+}
+
+// =================================================================================
+// Scene Depth
+// =================================================================================
+
+struct SceneSample
+{
+    bool   bHit;
+    float  Depth;   // Distance along the view ray; SCENE_NO_HIT without a surface
+    float3 Color;
+};
+
+// Surface behind (or in front of) the clouds at this pixel; both passes render at the same resolution
+SceneSample getSceneSample(float2 pixel)
+{
+    SceneSample scene;
+    scene.bHit = false;
+    scene.Depth = 1e30;
+    scene.Color = float3(0.0, 0.0, 0.0);
+
+    if (SceneDepthEnabled)
+    {
+        int3 coord = int3(pixel, 0);
+        float4 color = SceneColorTex.Load(coord);
+        scene.bHit = color.a > 0.5;
+        scene.Depth = SceneDepthTex.Load(coord);
+        scene.Color = color.rgb;
+    }
+    return scene;
+}
+
+// =================================================================================
+// Output
+// =================================================================================
+
+// The cloud passes write HDR radiance; CompositePS tonemaps after the denoiser
+struct CloudOutput
+{
+    float4 Color : SV_Target0;  // rgb = radiance, a = cloud transmittance
+    float2 Guide : SV_Target1;  // x = share of the primary steps taken, y = opacity-weighted cloud depth (0 = none)
+};
+
+CloudOutput makeCloudOutput(float3 color, float transmittance, float stepShare, float depth)
+{
+    CloudOutput output;
+    output.Color = float4(color, transmittance);
+    output.Guide = float2(stepShare, depth);
+    return output;
+}
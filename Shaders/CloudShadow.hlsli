@@ -0,0 +1,105 @@
+// --- Cloud Shadow Map ---
+// Density integrated toward the sun, baked by CloudShadowCS from the sun's view over the cloud layer.
+// Texel (x, z) is a point on the layer base; its channels hold the density still ahead of a ray that
+// left that point along the sun direction, measured at height fractions 0, 0.25, 0.5 and 0.75 of the
+// layer (the top has none left). Any point inside or below the layer is projected along the sun onto
+// the base and interpolated between those heights, so one fetch replaces a light march.
+// [Important] Layout must match CloudShadowConstants in Source/Core/Renderer.h
+
+#define SHADOW_STEPS 32          // Bake samples through the layer, a multiple of 4
+#define SHADOW_MIN_SUN_HEIGHT 0.1 // Lower suns are raised to this, so the path through the layer stays bounded
+#define SHADOW_BOX_MAX_SLOPE 2.0  // Horizontal run per unit of height the box footprint is widened for
+
+cbuffer cbCloudShadow : register(b4)
+{
+    float2 ShadowOrigin;     // World xz of the map corner in the open layers (camera centred)
+    float ShadowSize;        // World size covered in the open layers
+    uint ShadowEnabled;
+
+    uint ShadowInMarch;      // Light the cloud march from the map instead of the light ray
+    uint ShadowResolution;
+    uint ShadowRowOffset;    // First row baked by the current CloudShadowCS dispatch
+    uint ShadowRowCount;
+};
+
+Texture2D<float4> CloudShadowMap : register(t8);
+
+float3 getShadowSunDir()
+{
+    return normalize(float3(SunDir.x, max(SunDir.y, SHADOW_MIN_SUN_HEIGHT), SunDir.z));
+}
+
+// Flat layer the map is baked for; the shell is treated as flat around the camera
+void getShadowLayer(out float base, out float top)
+{
+    if (WeatherEnabled)
+    {
+        base = LayerBottom;
+        top = LayerTop;
+    }
+    else if (LayerMode == LAYER_BOX)
+    {
+        base = 0.0;
+        top = CloudExtent.y;
+    }
+    else
+    {
+        base = ShellBottom;
+        top = ShellTop;
+    }
+}
+
+// The box is covered whole, widened by the run of a sun ray through its height; the open layers use the
+// camera-centred window set by the renderer
+void getShadowRegion(out float2 origin, out float size)
+{
+    if (!WeatherEnabled && LayerMode == LAYER_BOX)
+    {
+        float3 sun = getShadowSunDir();
+        float slope = min(length(sun.xz) / sun.y, SHADOW_BOX_MAX_SLOPE);
+        size = 2.0 * (CloudExtent.x + CloudExtent.y * slope);
+        origin = -0.5 * float2(size, size);
+    }
+    else
+    {
+        origin = ShadowOrigin;
+        size = ShadowSize;
+    }
+}
+
+// Density integral from p to the top of the layer along the sun; 0 outside the map or above the layer
+float getCloudShadowDensity(float3 p)
+{
+    if (!ShadowEnabled)
+        return 0.0;
+
+    float base, top;
+    getShadowLayer(base, top);
+    float height = (p.y - base) / (top - base);
+    if (height >= 1.0)
+        return 0.0;
+
+    float3 sun = getShadowSunDir();
+    float2 xz = p.xz - sun.xz * ((p.y - base) / sun.y);
+
+    float2 origin;
+    float size;
+    getShadowRegion(origin, size);
+    float2 uv = (xz - origin) / size;
+    if (any(uv < 0.0) || any(uv > 1.0))
+        return 0.0;
+
+    float4 lower = CloudShadowMap.SampleLevel(LinearClampSampler, uv, 0.0);
+    float4 upper = float4(lower.yzw, 0.0);
+
+    float x = saturate(height) * 4.0;
+    float i = min(floor(x), 3.0);
+    float4 select = float4(i == 0.0, i == 1.0, i == 2.0, i == 3.0);
+    return lerp(dot(lower, select), dot(upper, select), x - i);
+}
+
+// Sun visibility for surfaces under or inside the clouds
+float3 getCloudShadow(float3 p)
+{
+    return exp(-SigmaE * getCloudShadowDensity(p));
+}
@@ -0,0 +1,48 @@
+// Bakes the cloud shadow map (CloudShadow.hlsli): one thread per texel marches from the layer base to its
+// top along the sun and keeps the density left ahead at each quarter of the layer height.
+// Dispatched for ShadowRowCount rows starting at ShadowRowOffset, so the map can be refreshed in bands.
+
+#include "Cloud.hlsli"
+
+RWTexture2D<float4> ShadowOut : register(u0);
+
+[numthreads(8, 8, 1)]
+void main(uint3 id : SV_DispatchThreadID)
+{
+    uint2 texel = uint2(id.x, id.y + ShadowRowOffset);
+    if (texel.x >= ShadowResolution || id.y >= ShadowRowCount || texel.y >= ShadowResolution)
+        return;
+
+    float2 origin;
+    float size;
+    getShadowRegion(origin, size);
+
+    float base, top;
+    getShadowLayer(base, top);
+
+    float2 xz = origin + (float2(texel) + 0.5) / float(ShadowResolution) * size;
+    float3 sun = getShadowSunDir();
+    float stepL = (top - base) / sun.y / float(SHADOW_STEPS);
+
+    // A texel spans a few units: the detail erosion and the finest mip would only alias
+    CloudLod lod = getFullLod();
+    lod.NoiseMip = 1.0;
+    lod.Detail = 0.0;
+
+    // Density integrated from the base up to each quarter, midpoint rule in equal height steps
+    float3 p = float3(xz.x, base, xz.y) + sun * (0.5 * stepL);
+    float quarters[4] = { 0.0, 0.0, 0.0, 0.0 };
+    float densityAcc = 0.0;
+
+    [loop]
+    for (uint i = 0; i < SHADOW_STEPS; i++)
+    {
+        if (i % (SHADOW_STEPS / 4) == 0)
+            quarters[i / (SHADOW_STEPS / 4)] = densityAcc;
+
+        densityAcc += getDensity(p, lod) * stepL;
+        p += sun * stepL;
+    }
+
+    ShadowOut[texel] = densityAcc - float4(quarters[0], quarters[1], quarters[2], quarters[3]);
+}
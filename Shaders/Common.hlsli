@@ -4,13 +4,21 @@ cbuffer cbGlobal : register(b0)
     float3 CameraPos;
     float Time;
     float3 CameraDir;
-    float pad0;
+    uint FrameIndex;        // Frames rendered, drives the per-frame dither
     float3 CameraRight;
     float pad1;
     float3 CameraUp;
     float pad2;
     float2 Resolution;
-    float2 pad3;
+    float2 Jitter;          // Sub-pixel ray offset in pixels (progressive accumulation)
+    float3 PrevCameraPos;   // Camera of the previous frame, for temporal reprojection
+    float pad4;
+    float3 PrevCameraDir;
+    float pad5;
+    float3 PrevCameraRight;
+    float pad6;
+    float3 PrevCameraUp;
+    float pad7;
 };
 
 cbuffer cbCloudParams : register(b1)
@@ -22,4 +30,58 @@ cbuffer cbCloudParams : register(b1)
     float ShapeStrength;
     float DetailStrength;
     float DensityMult;
-};
\ No newline at end of file
+
+    uint LayerMode;         // 0 = box, 1 = infinite slab, 2 = spherical shell
+    float PlanetRadius;
+    float ShellBottom;      // Layer altitude range (above y = 0 for the slab, above the surface for the shell)
+    float ShellTop;
+
+    float LodDistance;      // Distance where the far-field LOD starts
+    float LayerMaxDistance; // Longest segment marched through the open layers
+    float CoverageScale;    // Frequency of the procedural coverage used by the open layers
+    uint PrimarySteps;      // Per-pixel sample budget of the primary march
+
+    uint MarchMode;         // 0 = uniform, 1 = importance sampled
+    uint CoarseSteps;       // Segments of the coarse density estimate (importance mode)
+    float ImportanceFloor;  // Relative weight every segment keeps, so thin clouds missed by the coarse pass still get samples
+    float LightStepScale;   // Multiplies the light march sample count (dynamic resolution governor)
+
+    uint LightCacheEnabled;   // Reuse light-march densities between consecutive primary samples
+    uint LightRefreshPerStep; // Cached light samples re-evaluated per primary sample
+    float LightCacheMaxLag;   // Oldest reusable light sample, in light steps moved along the view ray
+    uint SceneDepthEnabled;   // An opaque SDF scene was rendered first (t6/t7): it replaces the sky and clips the march
+};
+
+// View ray through a screen uv (0..1, y down) with focal length 1
+float3 getCameraRay(float2 uv)
+{
+    uv += Jitter / Resolution;
+
+    float2 screenP = (uv - 0.5) * 2.0;
+    screenP.x *= Resolution.x / Resolution.y;
+    screenP.y = -screenP.y;
+
+    return normalize(screenP.x * CameraRight + screenP.y * CameraUp + 1.0 * CameraDir);
+}
+
+// Screen uv of a world position as seen by the previous frame's camera; false if behind it
+bool getPrevScreenUV(float3 worldPos, out float2 uv)
+{
+    float3 d = worldPos - PrevCameraPos;
+    float z = dot(d, PrevCameraDir);
+
+    float2 screenP = float2(dot(d, PrevCameraRight), dot(d, PrevCameraUp)) / max(z, 1e-4);
+    screenP.x /= Resolution.x / Resolution.y;
+
+    uv = float2(screenP.x, -screenP.y) * 0.5 + 0.5;
+    return z > 1e-4;
+}
+
+// ACES fit and gamma, applied once to the composited HDR color
+float4 toDisplay(float3 color)
+{
+    color *= 0.5;
+    color = saturate((color * (2.51 * color + 0.03)) / (color * (2.43 * color + 0.59) + 0.14));
+    
+    return float4(pow(color, 0.4545), 1.0);
+}
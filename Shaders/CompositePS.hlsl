@@ -0,0 +1,21 @@
+// Tonemaps the (denoised) HDR cloud image into the back buffer, upsampling it when the cloud renders at reduced resolution.
+// Light shafts (LightShaftCS) are added in HDR first; their slot reads 0 while the pass is off.
+
+#include "Common.hlsli"
+
+Texture2D<float4> SceneColor : register(t0);
+Texture2D<float4> LightShafts : register(t1);
+SamplerState LinearClampSampler : register(s2);
+
+struct VS_OUTPUT
+{
+    float4 pos : SV_POSITION;
+    float2 uv : TEXCOORD0;
+};
+
+float4 main(VS_OUTPUT input) : SV_Target
+{
+    float3 color = SceneColor.SampleLevel(LinearClampSampler, input.uv, 0).rgb;
+    color += LightShafts.SampleLevel(LinearClampSampler, input.uv, 0).rgb;
+    return toDisplay(color);
+}
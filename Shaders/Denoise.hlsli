@@ -0,0 +1,37 @@
+// --- Cloud Denoiser and Accumulation ---
+// [Important] Layout must match Renderer::DenoiseConstants
+
+#include "Common.hlsli"
+
+cbuffer cbDenoise : register(b3)
+{
+    float HistoryWeight;        // Blend toward the reprojected history (0 = off)
+    float ClipGamma;            // Neighbourhood clip box size in standard deviations
+    float TransmittanceReject;  // History weight lost per unit of transmittance change
+    uint HistoryValid;
+
+    float ColorSigma;           // A-trous luminance edge stop, relative to the local luminance
+    float TransmittanceSigma;   // A-trous transmittance edge stop
+    float StepSigma;            // A-trous step-share edge stop
+    uint StepWidth;             // A-trous tap spacing of this iteration
+
+    uint AccumulationIndex;     // Progressive mode: frames already in the running average
+    float3 denoisePad;
+};
+
+SamplerState LinearClampSampler : register(s2);
+
+float getLuminance(float3 color)
+{
+    return dot(color, float3(0.2126, 0.7152, 0.0722));
+}
+
+float3 RGBToYCoCg(float3 c)
+{
+    return float3(dot(c, float3(0.25, 0.5, 0.25)), dot(c, float3(0.5, 0.0, -0.5)), dot(c, float3(-0.25, 0.5, -0.25)));
+}
+
+float3 YCoCgToRGB(float3 c)
+{
+    return float3(c.x + c.y - c.z, c.x + c.z, c.x - c.y - c.z);
+}
@@ -0,0 +1,48 @@
+// One iteration of the edge-avoiding a-trous wavelet filter (5x5 B3 spline, taps StepWidth apart).
+// Edges are found in luminance, cloud transmittance and the share of primary steps taken.
+
+#include "Denoise.hlsli"
+
+Texture2D<float4> InputColor : register(t0);
+Texture2D<float2> InputGuide : register(t1);
+RWTexture2D<float4> OutputColor : register(u0);
+
+static const float Kernel[3] = { 3.0 / 8.0, 1.0 / 4.0, 1.0 / 16.0 };
+
+[numthreads(8, 8, 1)]
+void main(uint3 id : SV_DispatchThreadID)
+{
+    uint width, height;
+    InputColor.GetDimensions(width, height);
+    if (id.x >= width || id.y >= height)
+        return;
+
+    float4 center = InputColor[id.xy];
+    float2 centerGuide = InputGuide[id.xy];
+    float centerLum = getLuminance(center.rgb);
+
+    float4 sum = float4(0.0, 0.0, 0.0, 0.0);
+    float weightSum = 0.0;
+
+    [unroll]
+    for (int y = -2; y <= 2; y++)
+    {
+        [unroll]
+        for (int x = -2; x <= 2; x++)
+        {
+            int2 coord = clamp(int2(id.xy) + int2(x, y) * int(StepWidth), int2(0, 0), int2(width - 1, height - 1));
+            float4 tap = InputColor[coord];
+            float2 tapGuide = InputGuide[coord];
+
+            float lumWeight = abs(getLuminance(tap.rgb) - centerLum) / (ColorSigma * max(centerLum, 1e-3));
+            float transmittanceWeight = abs(tap.a - center.a) / TransmittanceSigma;
+            float stepWeight = abs(tapGuide.x - centerGuide.x) / StepSigma;
+
+            float weight = Kernel[abs(x)] * Kernel[abs(y)] * exp(-(lumWeight + transmittanceWeight + stepWeight));
+            sum += tap * weight;
+            weightSum += weight;
+        }
+    }
+
+    OutputColor[id.xy] = sum / max(weightSum, 1e-6);
+}
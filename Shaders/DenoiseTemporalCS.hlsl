@@ -0,0 +1,64 @@
+// Temporal accumulation with variance clipping.
+// The history is reprojected through the opacity-weighted cloud depth and clipped to the current 3x3 neighbourhood.
+
+#include "Denoise.hlsli"
+
+Texture2D<float4> CurrentColor : register(t0);
+Texture2D<float2> CurrentGuide : register(t1);
+Texture2D<float4> HistoryColor : register(t2);
+RWTexture2D<float4> OutputColor : register(u0);
+
+[numthreads(8, 8, 1)]
+void main(uint3 id : SV_DispatchThreadID)
+{
+    uint width, height;
+    CurrentColor.GetDimensions(width, height);
+    if (id.x >= width || id.y >= height)
+        return;
+
+    float4 current = CurrentColor[id.xy];
+    float2 guide = CurrentGuide[id.xy];
+
+    // Neighbourhood statistics in YCoCg
+    float3 m1 = float3(0.0, 0.0, 0.0);
+    float3 m2 = float3(0.0, 0.0, 0.0);
+
+    [unroll]
+    for (int y = -1; y <= 1; y++)
+    {
+        [unroll]
+        for (int x = -1; x <= 1; x++)
+        {
+            int2 coord = clamp(int2(id.xy) + int2(x, y), int2(0, 0), int2(width - 1, height - 1));
+            float3 c = RGBToYCoCg(CurrentColor[coord].rgb);
+            m1 += c;
+            m2 += c * c;
+        }
+    }
+
+    float3 mean = m1 / 9.0;
+    float3 sigma = sqrt(max(m2 / 9.0 - mean * mean, 0.0));
+
+    // Pixels without cloud reproject as distant, which only follows the camera rotation
+    float2 uv = (float2(id.xy) + 0.5) / float2(width, height);
+    float3 rd = getCameraRay(uv);
+    float depth = (guide.y > 0.0) ? guide.y : 1e5;
+
+    float2 prevUV;
+    bool bOnScreen = getPrevScreenUV(CameraPos + rd * depth, prevUV) && all(prevUV >= 0.0) && all(prevUV <= 1.0);
+
+    float4 result = current;
+    if (HistoryValid && bOnScreen)
+    {
+        float4 history = HistoryColor.SampleLevel(LinearClampSampler, prevUV, 0);
+
+        float3 clipped = clamp(RGBToYCoCg(history.rgb), mean - ClipGamma * sigma, mean + ClipGamma * sigma);
+        history.rgb = YCoCgToRGB(clipped);
+
+        // A large transmittance change means a cloud edge moved through the pixel
+        float weight = HistoryWeight * saturate(1.0 - abs(history.a - current.a) * TransmittanceReject);
+        result = lerp(current, history, weight);
+    }
+
+    OutputColor[id.xy] = result;
+}
@@ -0,0 +1,28 @@
+// Samples the cloud density on a regular grid for the CPU mesh extractor (Source/Tools/MeshExtractor.h):
+// one thread per grid point, written negated so that the inside of a cloud reads below the iso level.
+// Dispatched in slabs of z slices starting at GridSliceOffset, so a large grid never stalls the GPU for long.
+
+#include "Cloud.hlsli"
+
+// [Important] Layout must match Renderer::DensityGridConstants
+cbuffer cbDensityGrid : register(b7)
+{
+    float3 GridMin;
+    float GridSpacing;
+    uint3 GridSize;
+    uint GridSliceOffset;
+};
+
+RWStructuredBuffer<float> GridOut : register(u0);
+
+[numthreads(4, 4, 4)]
+void main(uint3 id : SV_DispatchThreadID)
+{
+    uint3 index = uint3(id.xy, id.z + GridSliceOffset);
+    if (any(index >= GridSize))
+        return;
+
+    // The full-detail model the primary march sees up close
+    float3 p = GridMin + float3(index) * GridSpacing;
+    GridOut[(index.z * GridSize.y + index.y) * GridSize.x + index.x] = -getDensity(p, getFullLod());
+}
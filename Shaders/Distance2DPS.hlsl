@@ -13,6 +13,12 @@ struct VS_OUTPUT
     float2 uv : TEXCOORD0;
 };
 
+#ifdef SDF_TEXTURE
+// Signed distance in texels from Source/Tools/DistanceTransform.h (Float encoding), stretched over the screen
+Texture2D<float> SdfTexture : register(t17);
+SamplerState LinearClampSampler : register(s2);
+#endif
+
 float3 sdCircle(float2 p, float s)
 {
     return length(p) - s;
@@ -30,8 +36,15 @@ float4 main(VS_OUTPUT input) : SV_Target
     p.x *= Resolution.x / Resolution.y;
     p.y = -p.y;
     
+#ifdef SDF_TEXTURE
+    // Texels to the units of p, where half the texture height is 1
+    float width, height;
+    SdfTexture.GetDimensions(width, height);
+    float d = SdfTexture.SampleLevel(LinearClampSampler, input.uv, 0) * 2.0 / height;
+#else
     //float d = sdCircle(p, 0.5);
     float d = sdBox(p, float2(0.5, 0.2));
+#endif
     
     float3 col = (d > 0.0) ? float3(1.0, 0.45, 0.26) : float3(1.0, 0.97, 0.87);
     col *= 1.0 - exp(-5.0 * abs(d));
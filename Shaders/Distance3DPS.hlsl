@@ -5,7 +5,12 @@
  * * Ported from GLSL to HLSL by [SeungMin Lee]
  */
 
+#ifdef SCENE_DEPTH
+#include "Cloud.hlsli" // Cloud shadow map lookup for the surfaces under the layer
+#else
 #include "Common.hlsli"
+#endif
+#include "Scene3D.hlsli"
 
 struct VS_OUTPUT
 {
@@ -13,46 +18,50 @@ struct VS_OUTPUT
     float2 uv : TEXCOORD0;
 };
 
-float3 sdSphere(float3 p, float s)
+#ifdef SCENE_DEPTH
+
+// Combined mode: HDR surface radiance (a = 1 on a hit) and the hit distance the cloud march is clipped to
+struct SceneOutput
 {
-    return length(p) - s;
-}
+    float4 Color : SV_Target0;
+    float  Depth : SV_Target1;
+};
 
-float rayMarch(float3 ro, float3 rd)
+SceneOutput main(VS_OUTPUT input)
 {
-    float dO = 0.0; // Distance from Origin
-    for (int i = 0; i < 100; i++)
+    float3 ro = CameraPos;
+    float3 rd = getCameraRay(input.uv);
+
+    uint steps;
+    float t = traceScene(ro, rd, input.pos.xy, steps);
+    recordSceneTrace(steps, t >= 0.0);
+
+    SceneOutput output;
+    output.Color = float4(0.0, 0.0, 0.0, 0.0);
+    if (t >= 0.0)
     {
-        float3 p = ro + rd * dO;
-        float dS = sdSphere(p, 1.0); // Distance to Scene
-        dO += dS;
-        if (dO > 100.0 || dS < 0.001)
-            break; // Hit or Miss
+        float3 p = ro + rd * t;
+        output.Color = float4(shadeScene(p, t, getCloudShadow(p)), 1.0);
     }
-    return dO;
+    output.Depth = (t >= 0.0) ? t : SCENE_NO_HIT;
+    return output;
 }
 
+#else
+
 float4 main(VS_OUTPUT input) : SV_Target
 {
-    float2 p = (input.uv - 0.5) * 2.0;
-    p.x *= Resolution.x / Resolution.y;
-    p.y = -p.y;
-    
+    // Same ray setup as the cloud passes, so both scenes line up in the combined mode
     float3 ro = CameraPos;
-    float3 fwd = CameraDir;
-    float3 right = CameraRight;
-    float3 up = CameraUp;
-    
-    const float fl = 2.5;
-    float3 rd = normalize(p.x * right + p.y * up + fl * fwd);
-    
-    float d = rayMarch(ro, rd);
-
-    float3 col = float3(0, 0, 0);
-    if (d < 100.0)
-    {
-        col = float3(1, 1, 1) * (1.0 - d / 20.0);
-    }
+    float3 rd = getCameraRay(input.uv);
+
+    uint steps;
+    float t = traceScene(ro, rd, input.pos.xy, steps);
+    recordSceneTrace(steps, t >= 0.0);
+    if (t < 0.0)
+        return float4(0, 0, 0, 1);
+
+    return toDisplay(shadeScene(ro + rd * t, t, 1.0));
+}
 
-    return float4(col, 1.0);
-}
\ No newline at end of file
+#endif
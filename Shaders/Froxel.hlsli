@@ -0,0 +1,17 @@
+// --- Froxel Grid ---
+// Camera-aligned grid: x/y follow the screen, z slices each column's cloud segment with the same
+// u -> t mapping the per-pixel march uses, so no slices are spent outside the layer.
+
+#include "Cloud.hlsli"
+
+// View ray and cloud segment of the froxel column through the center of cell xy
+bool getFroxelColumn(uint2 xy, uint2 gridSize, out float3 rd, out RayMapping mapping)
+{
+    float2 uv = (float2(xy) + 0.5) / float2(gridSize);
+    rd = getCameraRay(uv);
+
+    float2 segment;
+    bool bHit = getCloudSegment(CameraPos, rd, segment);
+    mapping = getCloudRayMapping(bHit ? segment : float2(0.0, 0.0));
+    return bHit;
+}
@@ -0,0 +1,64 @@
+// Evaluates density and in-scattered light once per froxel.
+// rgb = scattered radiance per unit length, a = density (extinction is SigmaE * density)
+
+#include "Froxel.hlsli"
+
+RWTexture3D<float4> FroxelScatter : register(u0);
+
+[numthreads(8, 8, 1)]
+void main(uint3 id : SV_DispatchThreadID)
+{
+    uint3 gridSize;
+    FroxelScatter.GetDimensions(gridSize.x, gridSize.y, gridSize.z);
+    if (any(id >= gridSize))
+        return;
+
+    float3 rd;
+    RayMapping mapping;
+    if (!getFroxelColumn(id.xy, gridSize.xy, rd, mapping))
+    {
+        FroxelScatter[id] = float4(0.0, 0.0, 0.0, 0.0);
+        return;
+    }
+
+    // Jitter within the slice; the blue noise tile is addressed by the froxel column
+    float blueNoise = BlueNoiseTex.Load(int3(id.xy % 64, 0)).r;
+    float jitter = frac(blueNoise + float(id.z + FrameIndex) * GoldenRatio);
+
+    float sliceU = 1.0 / float(gridSize.z);
+    float t = getRayT(mapping, (float(id.z) + jitter) * sliceU);
+    float stepS = getRayDtDu(mapping, t) * sliceU;
+
+    float3 p = CameraPos + rd * t;
+    CloudLod lod = getCloudLod(t, stepS);
+
+    float density = getDensity(p, lod);
+    float3 scatter = float3(0.0, 0.0, 0.0);
+
+    if (density > 0.01)
+    {
+        float mu = dot(rd, SunDir);
+        float phaseFunction = lerp(HenyeyGreenstein(PhaseParams.x, mu),
+                                   HenyeyGreenstein(PhaseParams.y, mu),
+                                   PhaseParams.z);
+
+        float3 baseSunColor = float3(1.0, 1.0, 1.0);
+        float ambientLevel = lerp(0.2, 0.8, saturate(getHeightFraction(p)));
+        float3 lightLuminance;
+        if (ShadowInMarch)
+            getShadowMapLighting(p, mu, lightLuminance, ambientLevel);
+        else
+            lightLuminance = lightRay(p, mu, lod, density);
+
+        float3 ambient = baseSunColor * ambientLevel;
+        float3 sunLight = baseSunColor * SunIntensity * phaseFunction * lightLuminance;
+
+        scatter = (0.1 * ambient + sunLight) * SigmaS * density;
+    }
+    else
+    {
+        density = 0.0;
+    }
+
+    FroxelScatter[id] = float4(scatter, density);
+}
@@ -0,0 +1,48 @@
+// Integrates each froxel column front to back.
+// rgb = in-scattered light up to the far side of the slice, a = transmittance to it
+
+#include "Froxel.hlsli"
+
+Texture3D<float4> FroxelScatter : register(t5);
+RWTexture3D<float4> FroxelIntegrated : register(u0);
+
+[numthreads(8, 8, 1)]
+void main(uint3 id : SV_DispatchThreadID)
+{
+    uint3 gridSize;
+    FroxelIntegrated.GetDimensions(gridSize.x, gridSize.y, gridSize.z);
+    if (any(id.xy >= gridSize.xy))
+        return;
+
+    float3 rd;
+    RayMapping mapping;
+    bool bHit = getFroxelColumn(id.xy, gridSize.xy, rd, mapping);
+
+    float3 sigmaE = SigmaE;
+    float3 cloudColor = float3(0.0, 0.0, 0.0);
+    float3 transmittance = float3(1.0, 1.0, 1.0);
+
+    float sliceU = 1.0 / float(gridSize.z);
+    float tPrev = getRayT(mapping, 0.0);
+
+    [loop]
+    for (uint z = 0; z < gridSize.z; z++)
+    {
+        float tNext = getRayT(mapping, float(z + 1) * sliceU);
+        float stepS = tNext - tPrev;
+        tPrev = tNext;
+
+        float4 froxel = bHit ? FroxelScatter[uint3(id.xy, z)] : float4(0.0, 0.0, 0.0, 0.0);
+        float density = froxel.a;
+
+        if (density > 0.0)
+        {
+            // Same energy-conserving step as the per-pixel march
+            float3 stepTransmittance = exp(-sigmaE * density * stepS);
+            cloudColor += transmittance * (froxel.rgb - froxel.rgb * stepTransmittance) / (sigmaE * density);
+            transmittance *= stepTransmittance;
+        }
+
+        FroxelIntegrated[uint3(id.xy, z)] = float4(cloudColor, dot(transmittance, 1.0 / 3.0));
+    }
+}
@@ -0,0 +1,42 @@
+// Resolves the integrated froxel grid with one filtered lookup per pixel
+
+#include "Cloud.hlsli"
+
+Texture3D<float4> FroxelIntegrated : register(t5);
+
+struct VS_OUTPUT
+{
+    float4 pos : SV_POSITION;
+    float2 uv : TEXCOORD0;
+};
+
+CloudOutput main(VS_OUTPUT input)
+{
+    float3 rd = getCameraRay(input.uv);
+
+    SceneSample scene = getSceneSample(input.pos.xy);
+    float3 skyColor = scene.bHit ? scene.Color : getSky(rd);
+
+    uint3 gridSize;
+    FroxelIntegrated.GetDimensions(gridSize.x, gridSize.y, gridSize.z);
+
+    // The last slice holds the whole column. Slice k is integrated up to u = (k + 1) / N, so a surface
+    // inside the layer reads the slice that ends at its depth.
+    float halfSlice = 0.5 / float(gridSize.z);
+    float w = 1.0 - halfSlice;
+
+    float2 segment;
+    if (scene.bHit && getCloudSegment(CameraPos, rd, segment))
+    {
+        if (scene.Depth <= segment.x)
+            return makeCloudOutput(skyColor, 1.0, 0.0, scene.Depth);
+
+        float u = getRayU(getCloudRayMapping(segment), min(scene.Depth, segment.y));
+        w = clamp(u - halfSlice, halfSlice, 1.0 - halfSlice);
+    }
+
+    float4 froxel = FroxelIntegrated.SampleLevel(LinearClampSampler, float3(input.uv, w), 0);
+
+    // Every column runs all slices; depth 0 makes the denoiser reproject it as distant
+    return makeCloudOutput(froxel.rgb + skyColor * froxel.a, froxel.a, 1.0, scene.bHit ? scene.Depth : 0.0);
+}
@@ -1,3 +1,7 @@
+// Guarded: Scene3D.hlsli and Cloud.hlsli both use it
+#ifndef INTERSECT_HLSLI
+#define INTERSECT_HLSLI
+
 
 // Determines if a ray hits a bounding sphere for optimization
 bool intersectSphere(float3 ro, float3 rd, float rad, out float tMin, out float tMax)
@@ -17,19 +21,24 @@ bool intersectSphere(float3 ro, float3 rd, float rad, out float tMin, out float
     return true;
 }
 
-// Determines if a ray hits a horizontal cloud layer slab
-bool intersectCloudLayer(float3 ro, float3 rd, float minH, float maxH, out float tMin, out float tMax)
+// Determines if a ray hits a horizontal cloud layer slab, clipped to maxDist
+bool intersectCloudLayer(float3 ro, float3 rd, float minH, float maxH, float maxDist, out float tMin, out float tMax)
 {
     if (abs(rd.y) < 0.0001)
-        return false;
+    {
+        // Horizontal ray: only sees the layer from inside it
+        tMin = 0.0;
+        tMax = maxDist;
+        return ro.y >= minH && ro.y <= maxH;
+    }
 
     float t1 = (minH - ro.y) / rd.y;
     float t2 = (maxH - ro.y) / rd.y;
 
     tMin = max(0.0, min(t1, t2));
-    tMax = max(t1, t2);
+    tMax = min(max(t1, t2), maxDist);
 
-    return tMax > 0.0 && tMin < 100.0;
+    return tMax > tMin;
 }
 
 float2 intersectAABB(float3 ro, float3 rd, float3 bMin, float3 bMax)
@@ -44,4 +53,6 @@ float2 intersectAABB(float3 ro, float3 rd, float3 bMin, float3 bMax)
     float tFar = min(min(t2.x, t2.y), t2.z);
     
     return float2(tNear, tFar);
-}
\ No newline at end of file
+}
+
+#endif // INTERSECT_HLSLI
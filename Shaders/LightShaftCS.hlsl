@@ -0,0 +1,74 @@
+// Screen-space light shafts: radial blur of the sky visible through the clouds toward the projected sun.
+// The source is the cloud transmittance (and, in the combined mode, the SDF scene coverage) masked around the
+// sun, so gaps near the sun streak outward while the march itself takes no extra samples.
+// rgb = radiance added by CompositePS before the tonemap
+
+#include "Common.hlsli"
+
+// [Important] Layout must match LightShaftConstants in Source/Core/Renderer.h
+cbuffer cbLightShaft : register(b5)
+{
+    float2 SunUV;           // Projected sun in screen uv (may lie off screen)
+    float Density;          // Share of the way to the sun covered by the samples
+    float Decay;            // Per-sample falloff along the blur
+    float3 ShaftColor;      // Sun color times exposure, faded out as the sun leaves the view
+    float SourceRadius;     // Screen radius (in view heights) of the sky region that emits shafts
+    uint SampleCount;
+    float3 shaftPad;
+};
+
+Texture2D<float4> CloudColor : register(t0);    // a = cloud transmittance
+Texture2D BlueNoiseTex : register(t1);
+Texture2D<float4> SceneColor : register(t6);    // a = SDF surface hit; unbound (0) outside the combined mode
+SamplerState LinearClampSampler : register(s2);
+
+RWTexture2D<float4> ShaftOut : register(u0);
+
+#define MAX_SHAFT_SAMPLES 128
+
+float getShaftSource(float2 uv, float aspect)
+{
+    float openness = CloudColor.SampleLevel(LinearClampSampler, uv, 0).a * (1.0 - SceneColor.SampleLevel(LinearClampSampler, uv, 0).a);
+
+    float2 offset = (uv - SunUV) * float2(aspect, 1.0);
+    float mask = saturate(1.0 - length(offset) / SourceRadius);
+    return openness * mask * mask;
+}
+
+[numthreads(8, 8, 1)]
+void main(uint3 id : SV_DispatchThreadID)
+{
+    uint width, height;
+    ShaftOut.GetDimensions(width, height);
+    if (id.x >= width || id.y >= height)
+        return;
+
+    if (all(ShaftColor <= 0.0))
+    {
+        ShaftOut[id.xy] = float4(0.0, 0.0, 0.0, 0.0);
+        return;
+    }
+
+    float aspect = float(width) / float(height);
+    float2 uv = (float2(id.xy) + 0.5) / float2(width, height);
+
+    uint sampleCount = clamp(SampleCount, 1, MAX_SHAFT_SAMPLES);
+    float2 delta = (uv - SunUV) * (Density / float(sampleCount));
+
+    // Per-pixel offset along the blur trades the banding of the fixed sample count for noise the denoiser never sees
+    float dither = BlueNoiseTex.Load(int3(id.xy % 64, 0)).r;
+    float2 sampleUV = uv - delta * dither;
+
+    float illumination = 1.0;
+    float sum = 0.0;
+
+    [loop]
+    for (uint i = 0; i < sampleCount; i++)
+    {
+        sum += getShaftSource(sampleUV, aspect) * illumination;
+        illumination *= Decay;
+        sampleUV -= delta;
+    }
+
+    ShaftOut[id.xy] = float4(ShaftColor * (sum / float(sampleCount)), 0.0);
+}
@@ -0,0 +1,41 @@
+// Sum of squared differences between a test image and a reference, one partial sum per 16x16 group.
+// The CPU adds the partial sums in double precision to get the RMSE.
+
+Texture2D<float4> TestImage : register(t0);
+Texture2D<float4> ReferenceImage : register(t1);
+RWStructuredBuffer<float> PartialSums : register(u0);
+
+#define GROUP_SIZE 16
+
+groupshared float g_Sum[GROUP_SIZE * GROUP_SIZE];
+
+[numthreads(GROUP_SIZE, GROUP_SIZE, 1)]
+void main(uint3 id : SV_DispatchThreadID, uint3 groupId : SV_GroupID, uint groupIndex : SV_GroupIndex)
+{
+    uint width, height;
+    TestImage.GetDimensions(width, height);
+
+    float error = 0.0;
+    if (id.x < width && id.y < height)
+    {
+        float3 diff = TestImage[id.xy].rgb - ReferenceImage[id.xy].rgb;
+        error = dot(diff, diff);
+    }
+
+    g_Sum[groupIndex] = error;
+    GroupMemoryBarrierWithGroupSync();
+
+    [unroll]
+    for (uint stride = GROUP_SIZE * GROUP_SIZE / 2; stride > 0; stride >>= 1)
+    {
+        if (groupIndex < stride)
+            g_Sum[groupIndex] += g_Sum[groupIndex + stride];
+        GroupMemoryBarrierWithGroupSync();
+    }
+
+    if (groupIndex == 0)
+    {
+        uint groupsX = (width + GROUP_SIZE - 1) / GROUP_SIZE;
+        PartialSums[groupId.y * groupsX + groupId.x] = g_Sum[0];
+    }
+}
@@ -0,0 +1,24 @@
+// Running average of jittered frames while the view is static
+
+#include "Denoise.hlsli"
+
+Texture2D<float4> CurrentColor : register(t0);
+RWTexture2D<float4> Accumulated : register(u0);
+
+[numthreads(8, 8, 1)]
+void main(uint3 id : SV_DispatchThreadID)
+{
+    uint width, height;
+    CurrentColor.GetDimensions(width, height);
+    if (id.x >= width || id.y >= height)
+        return;
+
+    float4 current = CurrentColor[id.xy];
+    if (AccumulationIndex == 0)
+    {
+        Accumulated[id.xy] = current;
+        return;
+    }
+
+    Accumulated[id.xy] = lerp(Accumulated[id.xy], current, 1.0 / float(AccumulationIndex + 1));
+}
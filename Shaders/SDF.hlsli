@@ -1,5 +1,8 @@
 
 // --- Signed Distance Functions (SDF) ---
+// Guarded: Distance3DPS pulls it in through both Scene3D.hlsli and Cloud.hlsli
+#ifndef SDF_HLSLI
+#define SDF_HLSLI
 
 // Sphere Distance Function
 float sdSphere(float3 p, float s)
@@ -36,4 +39,6 @@ float sdBox(float3 p, float3 b)
 {
     float3 d = abs(p) - b;
     return min(max(d.x, max(d.y, d.z)), 0.0f) + length(max(d, 0.0f));
-}
\ No newline at end of file
+}
+
+#endif // SDF_HLSLI
@@ -0,0 +1,686 @@
+// --- Opaque SDF Scene ---
+// Sphere-traced by Distance3DPS, either on its own or as the depth/background layer under the clouds.
+// The scene is a list of smooth-union groups of primitives (SdfScene on the CPU), found through a BVH over the
+// group bounds: a distance query only opens nodes closer than the best distance found so far.
+// With tile lists, the CPU has already pruned the scene per screen tile and depth segment by interval
+// arithmetic; the tracer then only evaluates the groups (and group members) listed for its segment.
+// The march itself is over-relaxed with a fallback, stops within a pixel footprint, and can start from the
+// distance a low-resolution cone pre-pass (SceneConeCS) proved empty for the pixel's whole block.
+// Hits are shaded with a normal, a soft sun shadow and ambient occlusion whose taps share one BVH gather.
+// [Important] Layouts and type ids must match Source/Core/SdfScene.h
+
+#include "SDF.hlsli"
+#include "Intersect.hlsli"
+
+#define SCENE_MAX_STEPS 128
+#define SCENE_MAX_DISTANCE 2000.0
+#define SCENE_EPSILON 0.0005 // Relative to the distance travelled, without a pixel footprint
+#define SCENE_MIN_EPSILON 1e-4
+#define SCENE_NO_HIT 1e30    // Depth written where the ray leaves the scene
+
+#define SDF_SPHERE 0
+#define SDF_BOX 1
+#define SDF_CYLINDER 2
+#define SDF_CUT_SPHERE 3
+
+#define SDF_MAX_STACK 32     // SdfScene::MaxDepth + 1
+#define SDF_SEGMENT_EMPTY 0x80000000 // Tile segment without a surface: the ray skips to its end
+#define SDF_BRICK_SAMPLES 8          // SdfBrickMap::BrickSamples
+#define SDF_BRICK_ATLAS 32           // SdfBrickMap::AtlasBricks
+#define SDF_BRICK_EMPTY 0x80000000   // SdfBrickMap::EmptyCell; the low bits hold a distance bound in voxels
+
+// Interior nodes have GroupCount 0: the left child follows the node, Next is the right child.
+// Leaves hold GroupCount groups starting at Next.
+struct SdfNode
+{
+    float3 Min;
+    uint Next;
+    float3 Max;
+    uint GroupCount;
+};
+
+struct SdfGroup
+{
+    uint FirstPrimitive;
+    uint PrimitiveCount;
+    float Smoothness;        // opSmoothUnion k between the members; 0 = plain union
+    float Padding;
+};
+
+struct SdfPrimitive
+{
+    float4 WorldToLocal[3];  // Rigid part of the inverse transform, rows of a 3x4 matrix
+    float4 Params;           // Type-specific sizes in local units
+    uint Type;
+    float Scale;             // Uniform scale, divided out before and multiplied back after the distance
+    float2 Padding;
+};
+
+cbuffer cbSdfScene : register(b6)
+{
+    uint SdfNodeCount;
+    uint SdfGroupCount;
+    uint SdfBvhEnabled;      // 0 = every group per query (the brute-force baseline of the benchmark)
+    uint SdfGroundEnabled;   // Unbounded plane at y = 0, outside the BVH
+
+    uint SdfTileEnabled;     // Trace through the per-tile lists below
+    uint SdfTileSize;        // Pixels per tile edge
+    uint SdfTilesX;
+    uint SdfSegmentCount;    // Depth segments per tile
+
+    float SdfSegmentScale;   // Segment s ends at SdfSegmentScale * (2^(s + 1) - 1)
+    float SdfRelaxation;     // Over-relaxation factor of the march; 1 = plain sphere tracing
+    float SdfPixelFootprint; // Hit epsilon in pixel radii at the hit distance; 0 = SCENE_EPSILON
+    uint SdfConeTileSize;    // Pixels per SceneConeStart texel; 0 without the cone pre-pass
+
+    float2 SdfPassSize;      // Pixels of the pass being traced
+    uint SdfShadingMode;     // SDF_SHADING_*
+    float SdfShadowSharpness; // Penumbra scale of the soft shadow; higher is harder
+
+    float3 SdfBrickOrigin;   // World position of brick cell (0, 0, 0)
+    float SdfBrickVoxel;     // 0 without a baked field
+    uint3 SdfBrickGrid;      // Cells per axis
+    float SdfBrickTrust;     // Baked distances below this are refined with the groups
+    float3 SdfBrickAtlasScale;
+    float SdfBrickPadding;   // Margin between the grid bounds and the groups
+};
+
+StructuredBuffer<SdfNode> SdfNodes : register(t9);
+StructuredBuffer<SdfGroup> SdfGroups : register(t10);
+StructuredBuffer<SdfPrimitive> SdfPrimitives : register(t11);
+StructuredBuffer<uint2> SdfTileSegments : register(t12);  // Per tile and segment: first entry, entry count | SDF_SEGMENT_EMPTY
+StructuredBuffer<uint2> SdfTileEntries : register(t13);   // Group index, mask of the members left after pruning
+Texture2D<float> SceneConeStart : register(t14);          // Distance free of surfaces for a whole block of pixels
+Texture3D<float> SdfBrickAtlas : register(t15);           // 8^3 samples per brick, sharing their border samples
+Texture3D<uint> SdfBrickCells : register(t16);            // Brick index, or SDF_BRICK_EMPTY | bound
+SamplerState SdfBrickSampler : register(s3);
+
+// --- Iteration counters ---
+// Compiled in only when SCENE_STATS is defined: one bin per distance evaluation count, then the hits, then
+// the group evaluations of the shading
+// [Important] Slot count must match SdfScene::TraceStatSlots
+
+#define SCENE_STAT_HITS (SCENE_MAX_STEPS + 1)
+#define SCENE_STAT_SHADE_GROUPS (SCENE_MAX_STEPS + 2) // Group evaluations spent shading the hits
+#define SCENE_STAT_COUNT (SCENE_MAX_STEPS + 3)
+
+#ifdef SCENE_STATS
+
+// u0 and u1 may be taken by the scene color and depth targets
+RWByteAddressBuffer SceneStatsBuffer : register(u2);
+
+static uint g_GroupEvaluations = 0;
+
+void recordSceneTrace(uint steps, bool bHit)
+{
+    SceneStatsBuffer.InterlockedAdd(min(steps, SCENE_MAX_STEPS) * 4, 1);
+    if (bHit)
+        SceneStatsBuffer.InterlockedAdd(SCENE_STAT_HITS * 4, 1);
+}
+
+void countGroupEvaluation()
+{
+    g_GroupEvaluations++;
+}
+
+uint getGroupEvaluations()
+{
+    return g_GroupEvaluations;
+}
+
+void recordSceneShading(uint groupEvaluations)
+{
+    SceneStatsBuffer.InterlockedAdd(SCENE_STAT_SHADE_GROUPS * 4, groupEvaluations);
+}
+
+#else
+
+void recordSceneTrace(uint steps, bool bHit)
+{
+}
+
+void countGroupEvaluation()
+{
+}
+
+uint getGroupEvaluations()
+{
+    return 0;
+}
+
+void recordSceneShading(uint groupEvaluations)
+{
+}
+
+#endif
+
+float getPrimitiveDistance(SdfPrimitive prim, float3 p)
+{
+    float4 wp = float4(p, 1.0);
+    float3 q = float3(dot(prim.WorldToLocal[0], wp), dot(prim.WorldToLocal[1], wp), dot(prim.WorldToLocal[2], wp)) / prim.Scale;
+
+    float d;
+    if (prim.Type == SDF_BOX)
+        d = sdBox(q, prim.Params.xyz);
+    else if (prim.Type == SDF_CYLINDER)
+        d = sdCylinder(q, prim.Params.xy);
+    else if (prim.Type == SDF_CUT_SPHERE)
+        d = sdCutSphere(q, prim.Params.x, prim.Params.y);
+    else
+        d = sdSphere(q, prim.Params.x);
+
+    return d * prim.Scale;
+}
+
+// Members outside memberMask are left out; the pruning only drops members that cannot change the blend
+float getGroupDistance(uint groupIndex, float3 p, uint memberMask)
+{
+    countGroupEvaluation();
+    SdfGroup group = SdfGroups[groupIndex];
+
+    float d = SCENE_MAX_DISTANCE;
+    for (uint i = 0; i < group.PrimitiveCount; i++)
+    {
+        if (i < 32 && !(memberMask & (1u << i)))
+            continue;
+
+        float di = getPrimitiveDistance(SdfPrimitives[group.FirstPrimitive + i], p);
+        d = (i == 0 || group.Smoothness <= 0.0) ? min(d, di) : opSmoothUnion(d, di, group.Smoothness);
+    }
+    return d;
+}
+
+float getGroupDistance(uint groupIndex, float3 p)
+{
+    return getGroupDistance(groupIndex, p, 0xffffffff);
+}
+
+// Lower bound of the distance to anything inside the box (0 inside)
+float getBoxDistance(float3 p, float3 bMin, float3 bMax)
+{
+    return length(max(max(bMin - p, p - bMax), 0.0));
+}
+
+// Lower bound of the distance to the groups from the baked brick field
+float getBakedDistance(float3 p)
+{
+    float cellSize = SdfBrickVoxel * (SDF_BRICK_SAMPLES - 1);
+    float3 local = (p - SdfBrickOrigin) / cellSize;
+
+    // Outside the grid: the groups are at least the margin farther than its bounds
+    float3 gridMax = float3(SdfBrickGrid);
+    float3 outside = max(max(-local, local - gridMax), 0.0);
+    if (any(outside > 0.0))
+        return length(outside) * cellSize + SdfBrickPadding;
+
+    uint3 cell = min(uint3(local), SdfBrickGrid - 1);
+    uint value = SdfBrickCells.Load(int4(cell, 0));
+    if (value & SDF_BRICK_EMPTY)
+        return float(value & ~SDF_BRICK_EMPTY) * SdfBrickVoxel;
+
+    uint3 brick = uint3(value % SDF_BRICK_ATLAS, (value / SDF_BRICK_ATLAS) % SDF_BRICK_ATLAS, value / (SDF_BRICK_ATLAS * SDF_BRICK_ATLAS));
+    float3 texel = brick * SDF_BRICK_SAMPLES + 0.5 + saturate(local - cell) * (SDF_BRICK_SAMPLES - 1);
+    float d = SdfBrickAtlas.SampleLevel(SdfBrickSampler, texel * SdfBrickAtlasScale, 0);
+
+    // Each corner sample is within its distance to p of the true value, so the blend stays within half a
+    // voxel diagonal
+    return d - SdfBrickVoxel * 0.8660254;
+}
+
+// Baked distance when it is far enough from the surface to trust, a negative value when the groups have
+// to be evaluated instead
+float getTrustedBakedDistance(float3 p)
+{
+    if (SdfBrickVoxel <= 0.0)
+        return -1.0;
+
+    float d = getBakedDistance(p);
+    return d > SdfBrickTrust ? d : -1.0;
+}
+
+float getSceneDistance(float3 p)
+{
+    float best = SCENE_MAX_DISTANCE;
+    if (SdfGroundEnabled)
+        best = p.y;
+
+    // Far from the surface the baked field replaces the groups; hits and normals always use them
+    float baked = getTrustedBakedDistance(p);
+    if (baked >= 0.0)
+        return min(best, baked);
+
+    if (!SdfBvhEnabled)
+    {
+        for (uint g = 0; g < SdfGroupCount; g++)
+            best = min(best, getGroupDistance(g, p));
+        return best;
+    }
+
+    if (SdfNodeCount == 0)
+        return best;
+
+    // Nearest child first, so the best distance shrinks early and prunes the rest of the tree
+    uint stack[SDF_MAX_STACK];
+    float stackDistance[SDF_MAX_STACK];
+    uint stackSize = 1;
+    stack[0] = 0;
+    stackDistance[0] = 0.0;
+
+    [loop]
+    while (stackSize > 0)
+    {
+        stackSize--;
+        if (stackDistance[stackSize] >= best)
+            continue;
+
+        uint nodeIndex = stack[stackSize];
+        SdfNode node = SdfNodes[nodeIndex];
+        if (node.GroupCount > 0)
+        {
+            for (uint g = 0; g < node.GroupCount; g++)
+                best = min(best, getGroupDistance(node.Next + g, p));
+            continue;
+        }
+
+        uint left = nodeIndex + 1;
+        uint right = node.Next;
+        SdfNode leftNode = SdfNodes[left];
+        SdfNode rightNode = SdfNodes[right];
+        float leftDistance = getBoxDistance(p, leftNode.Min, leftNode.Max);
+        float rightDistance = getBoxDistance(p, rightNode.Min, rightNode.Max);
+
+        bool bLeftFirst = leftDistance <= rightDistance;
+        float nearDistance = min(leftDistance, rightDistance);
+        float farDistance = max(leftDistance, rightDistance);
+
+        if (farDistance < best)
+        {
+            stack[stackSize] = bLeftFirst ? right : left;
+            stackDistance[stackSize] = farDistance;
+            stackSize++;
+        }
+        if (nearDistance < best)
+        {
+            stack[stackSize] = bLeftFirst ? left : right;
+            stackDistance[stackSize] = nearDistance;
+            stackSize++;
+        }
+    }
+    return best;
+}
+
+// Distance to the groups listed for one tile segment (and the ground)
+float getTileSegmentDistance(uint first, uint count, float3 p)
+{
+    float best = SdfGroundEnabled ? p.y : SCENE_MAX_DISTANCE;
+
+    float baked = getTrustedBakedDistance(p);
+    if (baked >= 0.0)
+        return min(best, baked);
+
+    for (uint i = 0; i < count; i++)
+    {
+        uint2 entry = SdfTileEntries[first + i];
+        best = min(best, getGroupDistance(entry.x, p, entry.y));
+    }
+    return best;
+}
+
+// Surfaces closer than this count as hit: a fraction of the pixel's footprint at distance t
+float getHitEpsilon(float t)
+{
+    if (SdfPixelFootprint <= 0.0)
+        return SCENE_EPSILON * max(t, 1.0);
+
+    // Focal length 1 and a screen 2 units tall: one pixel spans 2 / Resolution.y per unit of distance
+    return max(SdfPixelFootprint * t / Resolution.y, SCENE_MIN_EPSILON);
+}
+
+// Start of the march: what the cone pre-pass proved empty for the pixel's block
+float getTraceStart(float2 pixel)
+{
+    if (SdfConeTileSize == 0)
+        return 0.0;
+
+    return SceneConeStart.Load(int3(uint2(pixel) / SdfConeTileSize, 0));
+}
+
+// Over-relaxed sphere tracing (Keinert et al. 2014): steps of omega * d, as long as the unbounding spheres
+// of consecutive points still overlap. When they do not, the step may have jumped a surface, so it falls
+// back to the plain step from the previous point and keeps omega at 1 from there on.
+struct RelaxedMarch
+{
+    float Omega;
+    float PrevT;
+    float PrevD;
+};
+
+RelaxedMarch beginRelaxedMarch(float t)
+{
+    RelaxedMarch march;
+    march.Omega = max(SdfRelaxation, 1.0);
+    march.PrevT = t;
+    march.PrevD = 0.0;
+    return march;
+}
+
+// d is the distance at t; returns false (and moves t back) when the previous step has to be redone
+bool stepRelaxedMarch(inout RelaxedMarch march, inout float t, float d)
+{
+    if (march.Omega > 1.0 && d + march.PrevD < t - march.PrevT)
+    {
+        t = march.PrevT + march.PrevD;
+        march.Omega = 1.0;
+        return false;
+    }
+
+    march.PrevT = t;
+    march.PrevD = d;
+    t += d * march.Omega;
+    return true;
+}
+
+// Called once t has stepped past end, the end of the range being traced. An over-relaxed step is only validated
+// by the distance at its landing point, which is never taken past end, so unless the plain step alone reaches end
+// it is redone from the previous point with omega 1. Returns false (and moves t back) in that case.
+bool leaveRelaxedMarch(inout RelaxedMarch march, inout float t, float end)
+{
+    float plainT = march.PrevT + march.PrevD;
+    if (march.Omega <= 1.0 || t <= plainT || plainT >= end)
+        return true;
+
+    t = plainT;
+    march.Omega = 1.0;
+    return false;
+}
+
+// Sphere tracing segment by segment through the pixel's tile. Groups missing from a list either do not
+// reach the segment's bounds or never win the min inside them, so steps are clamped to the segment end
+// and the relaxation restarts with each list.
+float traceSceneTiled(float3 ro, float3 rd, float2 pixel, inout uint steps)
+{
+    uint2 tile = uint2(pixel) / SdfTileSize;
+    uint base = (tile.y * SdfTilesX + tile.x) * SdfSegmentCount;
+
+    float t = getTraceStart(pixel);
+
+    [loop]
+    for (uint s = 0; s < SdfSegmentCount; s++)
+    {
+        float segmentEnd = SdfSegmentScale * (exp2(float(s + 1)) - 1.0);
+        if (t >= segmentEnd)
+            continue;
+
+        uint2 segment = SdfTileSegments[base + s];
+        if (segment.y & SDF_SEGMENT_EMPTY)
+        {
+            t = segmentEnd;
+            continue;
+        }
+
+        RelaxedMarch march = beginRelaxedMarch(t);
+
+        [loop]
+        while (t < segmentEnd)
+        {
+            float d = getTileSegmentDistance(segment.x, segment.y, ro + rd * t);
+            if (++steps >= SCENE_MAX_STEPS)
+                return -1.0;
+
+            if (!stepRelaxedMarch(march, t, d))
+                continue;
+
+            if (d < getHitEpsilon(march.PrevT))
+                return march.PrevT;
+
+            if (t >= segmentEnd && !leaveRelaxedMarch(march, t, segmentEnd))
+                continue;
+
+            t = min(t, segmentEnd);
+        }
+    }
+    return -1.0;
+}
+
+// Distance along rd to the first hit, or a negative value on a miss; pixel picks the tile lists and the
+// cone pre-pass start. steps counts the distance evaluations.
+float traceScene(float3 ro, float3 rd, float2 pixel, out uint steps)
+{
+    steps = 0;
+    if (SdfTileEnabled)
+        return traceSceneTiled(ro, rd, pixel, steps);
+
+    float t = getTraceStart(pixel);
+    float tEnd = SCENE_MAX_DISTANCE;
+
+    // Without the ground only the part of the ray inside the root bounds can hit anything
+    if (!SdfGroundEnabled)
+    {
+        if (SdfGroupCount == 0)
+            return -1.0;
+
+        if (SdfNodeCount > 0)
+        {
+            SdfNode root = SdfNodes[0];
+            float2 segment = intersectAABB(ro, rd, root.Min, root.Max);
+            if (segment.x > segment.y || segment.y < 0.0)
+                return -1.0;
+
+            t = max(segment.x, t);
+            tEnd = min(segment.y, SCENE_MAX_DISTANCE);
+        }
+    }
+
+    RelaxedMarch march = beginRelaxedMarch(t);
+
+    [loop]
+    while (steps < SCENE_MAX_STEPS)
+    {
+        float d = getSceneDistance(ro + rd * t);
+        steps++;
+
+        if (!stepRelaxedMarch(march, t, d))
+            continue;
+
+        if (d < getHitEpsilon(march.PrevT))
+            return march.PrevT;
+
+        if (t > tEnd)
+        {
+            if (!leaveRelaxedMarch(march, t, tEnd))
+                continue;
+            break;
+        }
+    }
+    return -1.0;
+}
+
+float traceScene(float3 ro, float3 rd, float2 pixel)
+{
+    uint steps;
+    return traceScene(ro, rd, pixel, steps);
+}
+
+// --- Shading ---
+// Normal, soft sun shadow and ambient occlusion of a hit. Done naively, every tap is a full scene query:
+// 6 for a central-difference normal, SCENE_AO_TAPS along it and up to SCENE_SHADOW_STEPS toward the sun.
+// The shared path traverses the BVH once for the few groups around the hit, then evaluates the 4 tetrahedral
+// normal taps, the AO taps and the shadow steps still close to the hit on those groups alone. Only the shadow
+// steps past the neighbourhood go back to full queries, where the baked field can stand in for the groups.
+// [Important] Mode ids must match SdfScene::ShadingMode
+
+#define SDF_SHADING_BASIC 0          // Normal only, no shadow or AO
+#define SDF_SHADING_NAIVE 1
+#define SDF_SHADING_SHARED 2
+
+#define SCENE_SHADE_GROUPS 8         // Groups the neighbourhood holds; more and the hit is shaded naively
+#define SCENE_AO_TAPS 5
+#define SCENE_AO_RADIUS 4.0          // Farthest AO tap along the normal
+#define SCENE_SHADOW_STEPS 32
+#define SCENE_SHADOW_DISTANCE 200.0
+#define SCENE_SHADOW_MIN_STEP 0.05
+#define SCENE_SHADOW_MAX_STEP 25.0
+
+// Groups whose bounds come within Radius of Centre
+struct SceneNeighbourhood
+{
+    float3 Centre;
+    float Radius;
+    uint Count;
+    uint Groups[SCENE_SHADE_GROUPS];
+};
+
+// False when more than SCENE_SHADE_GROUPS groups are that close
+bool gatherNeighbourhood(float3 p, float radius, inout SceneNeighbourhood nb)
+{
+    nb.Centre = p;
+    nb.Radius = radius;
+    nb.Count = 0;
+    if (SdfNodeCount == 0)
+        return true;
+
+    uint stack[SDF_MAX_STACK];
+    uint stackSize = 1;
+    stack[0] = 0;
+
+    [loop]
+    while (stackSize > 0)
+    {
+        uint nodeIndex = stack[--stackSize];
+        SdfNode node = SdfNodes[nodeIndex];
+        if (getBoxDistance(p, node.Min, node.Max) >= radius)
+            continue;
+
+        if (node.GroupCount > 0)
+        {
+            for (uint g = 0; g < node.GroupCount; g++)
+            {
+                if (nb.Count == SCENE_SHADE_GROUPS)
+                    return false;
+                nb.Groups[nb.Count++] = node.Next + g;
+            }
+            continue;
+        }
+
+        stack[stackSize++] = node.Next;
+        stack[stackSize++] = nodeIndex + 1;
+    }
+    return true;
+}
+
+// Exact below Radius - |q - Centre|, which every group left out is at least as far as
+float getNeighbourhoodDistance(SceneNeighbourhood nb, float3 q)
+{
+    float best = nb.Radius - length(q - nb.Centre);
+    if (SdfGroundEnabled)
+        best = min(best, q.y);
+
+    for (uint i = 0; i < nb.Count; i++)
+        best = min(best, getGroupDistance(nb.Groups[i], q));
+    return best;
+}
+
+// Distance for a shading tap: from the neighbourhood when q is well inside it, else a full query
+float getShadeDistance(SceneNeighbourhood nb, bool bShared, float3 q)
+{
+    if (bShared && length(q - nb.Centre) < nb.Radius * 0.5)
+        return getNeighbourhoodDistance(nb, q);
+    return getSceneDistance(q);
+}
+
+// Central differences: 6 full queries
+float3 getSceneNormal(float3 p, float e)
+{
+    const float2 k = float2(e, 0.0);
+    return normalize(float3(
+        getSceneDistance(p + k.xyy) - getSceneDistance(p - k.xyy),
+        getSceneDistance(p + k.yxy) - getSceneDistance(p - k.yxy),
+        getSceneDistance(p + k.yyx) - getSceneDistance(p - k.yyx)));
+}
+
+// Gradient from the 4 corners of a tetrahedron: each tap adds its distance along its own corner direction
+float3 getTetrahedralNormal(SceneNeighbourhood nb, float3 p, float e)
+{
+    const float2 k = float2(1.0, -1.0);
+    return normalize(
+        k.xyy * getNeighbourhoodDistance(nb, p + k.xyy * e) +
+        k.yyx * getNeighbourhoodDistance(nb, p + k.yyx * e) +
+        k.yxy * getNeighbourhoodDistance(nb, p + k.yxy * e) +
+        k.xxx * getNeighbourhoodDistance(nb, p + k.xxx * e));
+}
+
+// Taps along the normal: a tap closer to a surface than to p means something occludes the hemisphere
+float getAmbientOcclusion(SceneNeighbourhood nb, bool bShared, float3 p, float3 n)
+{
+    float occlusion = 0.0;
+    float total = 0.0;
+    float weight = 1.0;
+
+    [unroll]
+    for (uint i = 0; i < SCENE_AO_TAPS; i++)
+    {
+        float h = SCENE_AO_RADIUS * float(i + 1) / float(SCENE_AO_TAPS);
+        float d = getShadeDistance(nb, bShared, p + n * h);
+        occlusion += max(h - d, 0.0) * weight;
+        total += h * weight;
+        weight *= 0.7;
+    }
+    return saturate(1.0 - 1.5 * occlusion / total);
+}
+
+// Penumbra from the closest approach of the shadow ray to the surfaces. Between two steps the nearest point
+// lies where the current and the previous unbounding spheres meet (Quilez's improved estimate), which keeps
+// the penumbra free of the banding the step points alone leave.
+float getSoftShadow(SceneNeighbourhood nb, bool bShared, float3 p, float3 l)
+{
+    float visibility = 1.0;
+    float prevD = 1e10;
+    float t = 0.0;
+
+    [loop]
+    for (uint i = 0; i < SCENE_SHADOW_STEPS && t < SCENE_SHADOW_DISTANCE; i++)
+    {
+        float d = getShadeDistance(nb, bShared, p + l * t);
+        if (d < SCENE_MIN_EPSILON)
+            return 0.0;
+
+        float y = d * d / (2.0 * prevD);
+        float closest = sqrt(max(d * d - y * y, 0.0));
+        visibility = min(visibility, SdfShadowSharpness * closest / max(t - y, SCENE_MIN_EPSILON));
+
+        prevD = d;
+        t += clamp(d, SCENE_SHADOW_MIN_STEP, SCENE_SHADOW_MAX_STEP);
+    }
+    return smoothstep(0.0, 1.0, saturate(visibility));
+}
+
+// HDR radiance in the same range as the sky behind the clouds for a hit at distance t; sunVisibility is the
+// cloud shadow at p
+float3 shadeScene(float3 p, float t, float3 sunVisibility)
+{
+    uint evaluations = getGroupEvaluations();
+
+    // A few hit epsilons: wide enough to stay clear of the step noise of the hit, small enough for edges
+    float e = max(2.0 * getHitEpsilon(t), 1e-3);
+
+    SceneNeighbourhood nb = (SceneNeighbourhood)0;
+    bool bShared = false;
+    if (SdfShadingMode == SDF_SHADING_SHARED)
+        bShared = gatherNeighbourhood(p, 2.0 * SCENE_AO_RADIUS + e, nb);
+
+    float3 n = bShared ? getTetrahedralNormal(nb, p, e) : getSceneNormal(p, e);
+
+    float shadow = 1.0;
+    float ao = 1.0;
+    if (SdfShadingMode != SDF_SHADING_BASIC)
+    {
+        ao = getAmbientOcclusion(nb, bShared, p, n);
+        shadow = getSoftShadow(nb, bShared, p + n * (2.0 * e), SunDir);
+    }
+    recordSceneShading(getGroupEvaluations() - evaluations);
+
+    float3 albedo = float3(0.5, 0.48, 0.45);
+    float diffuse = saturate(dot(n, SunDir));
+    float3 ambient = lerp(float3(0.12, 0.12, 0.14), float3(0.3, 0.38, 0.5), n.y * 0.5 + 0.5);
+    return albedo * (diffuse * 1.5 * shadow * sunVisibility + ambient * ao);
+}
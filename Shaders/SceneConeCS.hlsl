@@ -0,0 +1,52 @@
+// Cone-marching pre-pass of the SDF scene: one thread per block of SdfConeTileSize^2 pixels marches a cone
+// around all of the block's rays and stores how far it got. Distance3DPS starts every ray of the block there.
+// The cone from the camera has half-angle a around its axis; a point at distance s on any of its rays lies
+// within s * a + |s - t| of the axis point at t. The ball of radius d there therefore clears the whole
+// cone from t up to t + (d - t * a) / (1 + a), which is the step taken.
+
+#include "Common.hlsli"
+#include "Scene3D.hlsli"
+
+RWTexture2D<float> ConeOut : register(u0);
+
+#define CONE_MAX_STEPS 64
+#define CONE_MIN_PROGRESS 0.05 // Stop once a step clears less than this share of the cone radius
+
+[numthreads(8, 8, 1)]
+void main(uint3 id : SV_DispatchThreadID)
+{
+    uint width, height;
+    ConeOut.GetDimensions(width, height);
+    if (id.x >= width || id.y >= height)
+        return;
+
+    // Block corners in uv, widened by a pixel for the ray jitter
+    float2 first = float2(id.xy * SdfConeTileSize);
+    float2 uvMin = (first - 1.0) / SdfPassSize;
+    float2 uvMax = (first + float(SdfConeTileSize) + 1.0) / SdfPassSize;
+
+    float3 axis = getCameraRay((uvMin + uvMax) * 0.5);
+    float cosAngle = 1.0;
+    cosAngle = min(cosAngle, dot(axis, getCameraRay(uvMin)));
+    cosAngle = min(cosAngle, dot(axis, getCameraRay(uvMax)));
+    cosAngle = min(cosAngle, dot(axis, getCameraRay(float2(uvMin.x, uvMax.y))));
+    cosAngle = min(cosAngle, dot(axis, getCameraRay(float2(uvMax.x, uvMin.y))));
+    float angle = acos(saturate(cosAngle));
+
+    float t = 0.0;
+
+    [loop]
+    for (int i = 0; i < CONE_MAX_STEPS; i++)
+    {
+        float d = getSceneDistance(CameraPos + axis * t);
+        float stepLength = (d - t * angle) / (1.0 + angle);
+        if (stepLength <= CONE_MIN_PROGRESS * max(t * angle, SCENE_MIN_EPSILON))
+            break;
+
+        t += stepLength;
+        if (t >= SCENE_MAX_DISTANCE)
+            break;
+    }
+
+    ConeOut[id.xy] = min(t, SCENE_MAX_DISTANCE);
+}
@@ -0,0 +1,42 @@
+// --- Per-pass Sample Counters ---
+// Compiled in only when CLOUD_STATS is defined; the renderer reads them back a few frames later.
+// [Important] Slot order must match Renderer::CloudStats
+
+#define STAT_LOD0 0
+#define STAT_LOD1 1
+#define STAT_LOD2 2
+#define STAT_LOD3 3
+#define STAT_PRIMARY_DENSITY 4
+#define STAT_LIGHT_DENSITY 5
+#define STAT_PIXELS 6
+#define STAT_COUNT 7
+
+#ifdef CLOUD_STATS
+
+// u0 and u1 are taken by the cloud color and guide targets
+RWByteAddressBuffer CloudStatsBuffer : register(u2);
+
+// Counted per pixel and flushed once, so a pixel costs one atomic per slot instead of one per sample
+static uint g_Stats[STAT_COUNT] = { 0, 0, 0, 0, 0, 0, 0 };
+
+#define STAT_INC(slot) g_Stats[(slot)]++
+
+void flushStats()
+{
+    [unroll]
+    for (uint i = 0; i < STAT_COUNT; i++)
+    {
+        if (g_Stats[i] > 0)
+            CloudStatsBuffer.InterlockedAdd(i * 4, g_Stats[i]);
+    }
+}
+
+#else
+
+#define STAT_INC(slot)
+
+void flushStats()
+{
+}
+
+#endif
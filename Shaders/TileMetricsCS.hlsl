@@ -0,0 +1,59 @@
+// Per-tile statistics of the coarse cloud pass, read back by the CPU to order the refinement tiles.
+// x = mean opacity (cloud coverage), y = squared coefficient of variation of the luminance (noise left by the coarse march)
+
+#include "Denoise.hlsli"
+
+Texture2D<float4> CoarseColor : register(t0);
+RWStructuredBuffer<float2> TileMetrics : register(u0);
+
+#define TILE_SIZE 64    // [Important] Must match TileScheduler::TileSize
+#define GROUP_SIZE 16
+#define PIXELS_PER_THREAD (TILE_SIZE / GROUP_SIZE)
+
+groupshared float4 g_Sum[GROUP_SIZE * GROUP_SIZE]; // opacity, luminance, luminance^2, pixel count
+
+[numthreads(GROUP_SIZE, GROUP_SIZE, 1)]
+void main(uint3 groupThreadId : SV_GroupThreadID, uint3 groupId : SV_GroupID, uint groupIndex : SV_GroupIndex)
+{
+    uint width, height;
+    CoarseColor.GetDimensions(width, height);
+
+    float4 sum = float4(0.0, 0.0, 0.0, 0.0);
+    uint2 base = groupId.xy * TILE_SIZE + groupThreadId.xy * PIXELS_PER_THREAD;
+
+    for (uint y = 0; y < PIXELS_PER_THREAD; y++)
+    {
+        for (uint x = 0; x < PIXELS_PER_THREAD; x++)
+        {
+            uint2 coord = base + uint2(x, y);
+            if (coord.x >= width || coord.y >= height)
+                continue;
+
+            float4 color = CoarseColor[coord];
+            float luminance = getLuminance(color.rgb);
+            sum += float4(1.0 - color.a, luminance, luminance * luminance, 1.0);
+        }
+    }
+
+    g_Sum[groupIndex] = sum;
+    GroupMemoryBarrierWithGroupSync();
+
+    [unroll]
+    for (uint stride = GROUP_SIZE * GROUP_SIZE / 2; stride > 0; stride >>= 1)
+    {
+        if (groupIndex < stride)
+            g_Sum[groupIndex] += g_Sum[groupIndex + stride];
+        GroupMemoryBarrierWithGroupSync();
+    }
+
+    if (groupIndex == 0)
+    {
+        float4 total = g_Sum[0];
+        float count = max(total.w, 1.0);
+        float mean = total.y / count;
+        float variance = max(total.z / count - mean * mean, 0.0);
+
+        uint tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+        TileMetrics[groupId.y * tilesX + groupId.x] = float2(total.x / count, variance / (mean * mean + 1e-4));
+    }
+}
@@ -0,0 +1,75 @@
+// --- Streamed Weather Tiles ---
+// [Important] Sizes must match WeatherMap.h
+
+#define WEATHER_COVERAGE_RES 64.0
+#define WEATHER_BRICK_RES_XZ 32.0
+#define WEATHER_BRICK_RES_Y 16.0
+
+cbuffer cbWeather : register(b2)
+{
+    float2 PageOrigin;
+    float TileSize;
+    float PageTableSize;
+
+    float LayerBottom;
+    float LayerTop;
+    float MaxDistance;
+    uint WeatherEnabled;
+};
+
+Texture2D<uint> PageTable : register(t2);
+Texture2DArray WeatherCoverage : register(t3);
+Texture3D DensityBricks : register(t4);
+
+// Finds the resident slot of the tile containing p.xz; tiles that are not streamed in yet read as clear sky
+bool getWeatherTile(float2 xz, out uint slot, out float2 local)
+{
+    float2 tileCoord = xz / TileSize;
+    float2 tile = floor(tileCoord);
+    int2 page = int2(tile - PageOrigin);
+
+    slot = 0;
+    local = tileCoord - tile;
+
+    if (any(page < 0) || any(page >= int(PageTableSize)))
+        return false;
+
+    uint entry = PageTable.Load(int3(page, 0));
+    if (entry == 0)
+        return false;
+
+    slot = entry - 1;
+    return true;
+}
+
+// Interior texel i covers [i, i + 1) / res and sits at i + 1 in the padded tile, so filtering never crosses slots
+float2 getPaddedUV(float2 local, float res)
+{
+    return (local * res + 1.0) / (res + 2.0);
+}
+
+float getWeatherBaseDensity(float3 p)
+{
+    if (p.y < LayerBottom || p.y > LayerTop)
+        return 0.0;
+
+    uint slot;
+    float2 local;
+    if (!getWeatherTile(p.xz, slot, local))
+        return 0.0;
+
+    float2 uv = getPaddedUV(local, WEATHER_COVERAGE_RES);
+    float coverage = WeatherCoverage.SampleLevel(LinearSampler, float3(uv, slot), 0).r;
+    if (coverage <= 0.0)
+        return 0.0;
+
+    uint width, height, depth;
+    DensityBricks.GetDimensions(width, height, depth);
+
+    float h = saturate((p.y - LayerBottom) / (LayerTop - LayerBottom));
+    float3 uvw;
+    uvw.xy = getPaddedUV(local, WEATHER_BRICK_RES_XZ);
+    uvw.z = (slot * (WEATHER_BRICK_RES_Y + 2.0) + h * WEATHER_BRICK_RES_Y + 1.0) / float(depth);
+
+    return DensityBricks.SampleLevel(LinearSampler, uvw, 0).r;
+}
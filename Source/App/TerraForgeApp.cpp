@@ -5,54 +5,169 @@
 
 extern LRESULT ImGui_ImplWin32_WndProcHandler(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam);
 
+namespace
+{
+	// Low-discrepancy sub-pixel offsets for the progressive accumulation
+	float Halton(uint32_t index, uint32_t base)
+	{
+		float result = 0.0f;
+		float fraction = 1.0f / base;
+		for (; index > 0; index /= base)
+		{
+			result += fraction * (index % base);
+			fraction /= base;
+		}
+		return result;
+	}
+}
+
 bool TerraForgeApp::Run()
 {
 	GameTimer timer;
 	timer.Reset();
 
+	// Clock of the cloud animation, frozen while the progressive mode accumulates
+	GameTimer cloudTimer;
+	cloudTimer.Reset();
+
 	bool bIsExit = false;
+	bool bLastFrameSkipped = false;
 
 	while (bIsExit == false)
 	{
 		timer.Tick();
 
+		if (m_Idle.m_Settings.bPauseAnimation) cloudTimer.Stop();
+		else cloudTimer.Start();
+		cloudTimer.Tick();
+
+		// Any message may change what is on screen (mouse over the GUI, resize, keys)
+		bool bMessages = false;
+
 		MSG msg;
 		while (PeekMessage(&msg, nullptr, 0, 0, PM_REMOVE))
 		{
+			bool bInput = (msg.message >= WM_MOUSEFIRST && msg.message <= WM_MOUSELAST)
+				|| (msg.message >= WM_KEYFIRST && msg.message <= WM_KEYLAST);
+			if (bInput) m_Preview.OnInput();
+
 			TranslateMessage(&msg);
 			DispatchMessage(&msg);
 			if (msg.message == WM_QUIT) bIsExit = true;
+			bMessages = true;
 		}
 		if (bIsExit) break;
 
 		float dt = timer.GetDeltaTime();
-		float totalTime = timer.GetTotalTime();
+		float totalTime = cloudTimer.GetTotalTime();
 
 		// --- Update ---
-		m_Camera.Update(timer.GetDeltaTime());
-		m_Constant.UpdateGlobal(m_Camera, totalTime, m_Width, m_Height);
-
-		bool bCloudChanged = m_Gui.Update(totalTime, m_Constant, m_Camera, m_Renderer, m_ResMgr);
-		if (bCloudChanged)
+		if (m_FlightBenchmark.GetState() != FlightBenchmark::State::Playing)
+			m_Camera.Update(timer.GetDeltaTime());
+		m_FlightBenchmark.Update(m_Camera, dt);
+
+		bool bCloudChanged = m_Gui.Update(totalTime, m_Constant, m_Camera, m_Renderer, m_ResMgr, m_WeatherMap, m_FlightBenchmark, m_Idle,
+			m_Governor, m_Preview);
+
+		// The governor owns quality unless progressive refinement is converging on a static image
+		bool bGovernorChanged = false;
+		if (m_Renderer.m_Progressive.bEnabled)
+			bGovernorChanged = m_Governor.Reset();
+		else if (!bLastFrameSkipped)
+			bGovernorChanged = m_Governor.Update(dt);
+
+		// Dragging a widget renders a cheap preview on top of the governor's level, refined once the value settles
+		bool bWasPreviewing = m_Preview.IsPreviewing();
+		bool bPreview = m_Preview.Update(m_Gui.IsInteracting(), bCloudChanged);
+
+		const auto& quality = m_Governor.GetQuality();
+		float previewScale = bPreview ? m_Preview.m_Settings.RenderScale : 1.0f;
+		float previewSteps = bPreview ? m_Preview.m_Settings.StepScale : 1.0f;
+		float renderScale = m_Renderer.m_Scene.bCloud ? quality.RenderScale * previewScale : 1.0f;
+		m_Renderer.SetRenderScale(renderScale);
+		m_Constant.SetStepScale(quality.PrimaryStepScale * previewSteps, quality.LightStepScale * previewSteps);
+
+		bool bQualityChanged = bGovernorChanged || bPreview != bWasPreviewing;
+		if (bCloudChanged || bQualityChanged)
 		{
 			m_Constant.UpdateCloud();
 		}
 
+		Constant::Vector2 jitter(0.0f, 0.0f);
+		if (m_Renderer.m_Progressive.bEnabled)
+		{
+			uint32_t sample = (uint32_t)m_Renderer.GetAccumulatedSamples() + 1;
+			jitter = Constant::Vector2(Halton(sample, 2) - 0.5f, Halton(sample, 3) - 0.5f);
+		}
+		m_Constant.SetJitter(jitter);
+
+		m_Constant.UpdateGlobal(m_Camera, totalTime, floorf(m_Width * renderScale), floorf(m_Height * renderScale));
+		m_WeatherMap.Update(m_Camera.m_Pos);
+
+		// Any change restarts the running average
+		const auto& weatherStats = m_WeatherMap.m_Stats;
+		bool bWeatherChanged = weatherStats.UploadsLastFrame > 0 || weatherStats.EvictionsTotal != m_LastEvictions;
+		m_LastEvictions = weatherStats.EvictionsTotal;
+
+		bool bSettingsChanged = m_Gui.HasRendererSettingsChanged();
+		bool bViewChanged = m_ViewTracker.Update(m_Camera, m_Constant.m_CloudConstants, totalTime,
+			bWeatherChanged || bQualityChanged || bSettingsChanged);
+		if (bViewChanged)
+		{
+			m_Renderer.ResetAccumulation();
+		}
+
 		if (GetAsyncKeyState(VK_ESCAPE) & 0x8000)
 		{
 			PostQuitMessage(0);
 			break;
 		}
 
+		// Work that needs frames even when the view is static
+		bool bBusy = m_Gui.IsInteracting()
+			|| m_Preview.IsMeasuring()
+			|| m_WeatherMap.m_Stats.PendingTiles > 0
+			|| m_FlightBenchmark.GetState() != FlightBenchmark::State::Idle
+			|| m_Renderer.IsFroxelBenchmarkRunning()
+			|| m_Renderer.m_SdfScene.IsBenchmarkRunning()
+			|| m_Renderer.m_SdfScene.GetBricks().IsBaking()
+			|| m_Renderer.m_bMeasureMarchError
+			|| m_Renderer.m_bExportMesh || m_Renderer.m_bBenchmarkMesh
+			|| m_Renderer.m_bRasterize2D || m_Renderer.m_bBenchmarkRaster2D
+			|| m_Renderer.m_bGenerateDistanceField || m_Renderer.m_bBenchmarkDistanceField
+			|| (m_Renderer.m_Scene.bCloud && m_Renderer.m_Progressive.bEnabled
+				&& m_Renderer.GetAccumulatedSamples() < m_Renderer.m_Progressive.MaxSamples);
+
+		// Nothing changed: the last presented image is still on screen, so skip drawing and Present and sleep
+		if (!m_Idle.BeginFrame(bViewChanged || bCloudChanged || bMessages || bBusy))
+		{
+			m_Gui.SkipRender();
+
+			// Keep the sleep out of the next frame's delta
+			timer.Stop();
+			m_Idle.Wait();
+			timer.Start();
+			bLastFrameSkipped = true;
+			continue;
+		}
+		bLastFrameSkipped = false;
+
 		// --- Rendering ---
 		m_Gfx.BeginFrame(m_ClearColor);
 
 		m_Renderer.PrepareShader();
 		m_Constant.BindConstantBuffer();
-		m_Renderer.Render();
+		m_WeatherMap.Bind();
+		m_Renderer.Render(m_Constant);
+		m_Renderer.MeasureMarchError(m_Constant);
+		m_Renderer.ExportMesh(m_Constant, m_WeatherMap);
+		m_Renderer.Rasterize2D();
+		m_Renderer.GenerateDistanceField();
 		m_Gui.Render();
 
 		m_Gfx.EndFrame();
+		m_Preview.EndFrame();
+		m_Idle.EndFrame(m_Renderer.m_Profiler.GetLastTime("Frame"));
 	}
 
 	return true;
@@ -101,6 +216,7 @@ void TerraForgeApp::Initialize(HINSTANCE hInstance)
 	m_Gfx.Initialize(hWnd, m_Width, m_Height);
 
 	m_Gui.Initialize(hWnd, m_Gfx.GetDevice(), m_Gfx.GetContext());
+	m_Preview.Initialize(m_Gfx.GetDevice(), m_Gfx.GetContext());
 	m_Constant.Initialize(m_Gfx.GetDevice(), m_Gfx.GetContext());
 	m_Camera.Initialize(m_Width / m_Height, hWnd);
 
@@ -109,6 +225,8 @@ void TerraForgeApp::Initialize(HINSTANCE hInstance)
 		m_ResMgr.LoadTexture("BlueNoise", L"Assets/Noise/LDR_LLL1_0.png");
 	}
 
+	m_WeatherMap.Initialize(m_Gfx.GetDevice(), m_Gfx.GetContext());
+
 	{
 		m_Renderer.Initialize(m_Gfx.GetDevice(), m_Gfx.GetContext(), &m_ResMgr);
 		m_Renderer.Bake3DNoise();
@@ -4,6 +4,12 @@
 #include "Constant.h"
 #include "Camera.h"
 #include "ResourceManager.h"
+#include "WeatherMap.h"
+#include "FlightBenchmark.h"
+#include "ViewChangeTracker.h"
+#include "IdleScheduler.h"
+#include "ResolutionGovernor.h"
+#include "InteractivePreview.h"
 
 class TerraForgeApp {
 public:
@@ -21,6 +27,12 @@ public:
     Constant m_Constant;
     Camera m_Camera;
     ResourceManager m_ResMgr;
+    WeatherMap m_WeatherMap;
+    FlightBenchmark m_FlightBenchmark;
+    ViewChangeTracker m_ViewTracker;
+    IdleScheduler m_Idle;
+    ResolutionGovernor m_Governor;
+    InteractivePreview m_Preview;
 
     void Initialize(HINSTANCE hInstance);
 
@@ -32,4 +44,6 @@ private:
     float m_Width = 1280.0f;
     float m_Height = 720.0f;
     float m_ClearColor[4] = { 0.0f, 0.0f, 0.0f, 1.0f,};
+
+    int m_LastEvictions = 0;
 };
\ No newline at end of file
@@ -62,6 +62,21 @@ void Camera::ProcessMouse(float dt)
 
     GetCursorPos(&m_LastMousePos);
 
+    UpdateBasis();
+}
+
+void Camera::SetPose(const Vector3& pos, float yaw, float pitch)
+{
+    m_Pos = pos;
+    m_Yaw = yaw;
+    m_Pitch = std::clamp(pitch, -DirectX::XM_PIDIV2 + 0.01f, DirectX::XM_PIDIV2 - 0.01f);
+
+    UpdateBasis();
+    GetCursorPos(&m_LastMousePos);
+}
+
+void Camera::UpdateBasis()
+{
     Matrix rotation = Matrix::CreateFromYawPitchRoll(m_Yaw, m_Pitch, 0.0f);
 
     m_LookDir = Vector3::TransformNormal(Vector3(0, 0, 1), rotation);
@@ -18,6 +18,11 @@ public:
     Matrix GetViewMatrix() const;
     Matrix GetProjectionMatrix() const;
 
+    // Drives the camera from outside (e.g. path playback) instead of keyboard/mouse
+    void SetPose(const Vector3& pos, float yaw, float pitch);
+    float GetYaw() const { return m_Yaw; }
+    float GetPitch() const { return m_Pitch; }
+
     // Camera basis vectors using SimpleMath types
     Vector3 m_Pos{ -30.0f, 40, -100.0f };
     Vector3 m_LookDir{ 0.0f, 0.0f, 1.0f };
@@ -27,6 +32,7 @@ public:
 private:
     void ProcessKeyboard(float dt);
     void ProcessMouse(float dt);
+    void UpdateBasis();
 
 private:
     float m_Yaw = 0.0f;
@@ -8,7 +8,13 @@ void Constant::UpdateGlobal(Camera& camera, float totalTime, float width, float
 {
 	if (!m_GlobalConstantBuffer) return;
 
+	m_GlobalConstants.PrevCameraPos = m_GlobalConstants.CameraPos;
+	m_GlobalConstants.PrevCameraDir = m_GlobalConstants.CameraDir;
+	m_GlobalConstants.PrevCameraRight = m_GlobalConstants.CameraRight;
+	m_GlobalConstants.PrevCameraUp = m_GlobalConstants.CameraUp;
+
 	m_GlobalConstants.Time = totalTime;
+	m_GlobalConstants.FrameIndex++;
 	m_GlobalConstants.Resolution = Vector2(width, height);
 	m_GlobalConstants.CameraPos = camera.m_Pos;
 	m_GlobalConstants.CameraDir = camera.m_LookDir;
@@ -27,10 +33,14 @@ void Constant::UpdateCloud()
 {
 	if (!m_CloudConstantBuffer) return;
 
+	CloudConstants uploaded = m_CloudConstants;
+	uploaded.PrimarySteps = (std::max)(1u, (uint32_t)(m_CloudConstants.PrimarySteps * m_PrimaryStepScale + 0.5f));
+	uploaded.LightStepScale = m_CloudConstants.LightStepScale * m_LightStepScale;
+
 	D3D11_MAPPED_SUBRESOURCE msr;
 	if (SUCCEEDED(m_pContext->Map(m_CloudConstantBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &msr)))
 	{
-		memcpy(msr.pData, &m_CloudConstants, sizeof(CloudConstants));
+		memcpy(msr.pData, &uploaded, sizeof(CloudConstants));
 		m_pContext->Unmap(m_CloudConstantBuffer.Get(), 0);
 	}
 }
@@ -80,13 +90,14 @@ void Constant::CreateConstantBuffer()
 
 void Constant::BindConstantBuffer()
 {
-	m_pContext->PSSetConstantBuffers(0, 1, m_GlobalConstantBuffer.GetAddressOf());
-	m_pContext->PSSetConstantBuffers(1, 1, m_CloudConstantBuffer.GetAddressOf());
+	ID3D11Buffer* buffers[] = { m_GlobalConstantBuffer.Get(), m_CloudConstantBuffer.Get() };
+	m_pContext->PSSetConstantBuffers(0, 2, buffers);
+	m_pContext->CSSetConstantBuffers(0, 2, buffers);
 }
 
 void Constant::InitData()
 {
-	m_GlobalConstants.Time = 0.0f;
+	m_GlobalConstants = {};
 
 	m_CloudConstants.SunDir = Vector3(0.6f, 0.35f, 0.6f);
 	m_CloudConstants.SunDir.Normalize();
@@ -96,4 +107,24 @@ void Constant::InitData()
 	m_CloudConstants.ShapeStrength = 0.6f;
 	m_CloudConstants.DetailStrength = 0.35f;
 	m_CloudConstants.DensityMult = 1.0f;
+
+	m_CloudConstants.LayerMode = LayerBox;
+	m_CloudConstants.PlanetRadius = 6000.0f;
+	m_CloudConstants.ShellBottom = 80.0f;
+	m_CloudConstants.ShellTop = 160.0f;
+
+	m_CloudConstants.LodDistance = 1000.0f;
+	m_CloudConstants.LayerMaxDistance = 20000.0f;
+	m_CloudConstants.CoverageScale = 0.015f;
+	m_CloudConstants.PrimarySteps = 32;
+
+	m_CloudConstants.MarchMode = MarchUniform;
+	m_CloudConstants.CoarseSteps = 8;
+	m_CloudConstants.ImportanceFloor = 0.05f;
+	m_CloudConstants.LightStepScale = 1.0f;
+
+	m_CloudConstants.LightCacheEnabled = 1;
+	m_CloudConstants.LightRefreshPerStep = 1;
+	m_CloudConstants.LightCacheMaxLag = 2.0f;
+	m_CloudConstants.SceneDepthEnabled = 0;
 }
\ No newline at end of file
@@ -16,7 +16,7 @@ public:
 		float   Time;           // Elapsed Time (Packed into w channel)
 
 		Vector3 CameraDir;      // Camera Look Direction
-		float   Padding0;       // Padding for 16-byte alignment
+		uint32_t FrameIndex;    // Frames rendered, drives the per-frame dither
 
 		Vector3 CameraRight;    // Camera Right Vector
 		float   Padding1;
@@ -25,7 +25,17 @@ public:
 		float   Padding2;
 
 		Vector2 Resolution;     // Viewport Resolution (Width, Height)
-		Vector2 Padding3;       // Padding to fill 16-byte boundary
+		Vector2 Jitter;         // Sub-pixel offset of the camera rays, in pixels
+
+		// Camera of the previous frame, for temporal reprojection
+		Vector3 PrevCameraPos;
+		float   Padding4;
+		Vector3 PrevCameraDir;
+		float   Padding5;
+		Vector3 PrevCameraRight;
+		float   Padding6;
+		Vector3 PrevCameraUp;
+		float   Padding7;
 	} m_GlobalConstants;
 
 	struct CloudConstants
@@ -37,8 +47,31 @@ public:
 		float   ShapeStrength;
 		float   DetailStrength;
 		float   DensityMult;
+
+		uint32_t LayerMode;       // 0 = box, 1 = infinite slab, 2 = spherical shell
+		float   PlanetRadius;
+		float   ShellBottom;
+		float   ShellTop;
+
+		float   LodDistance;
+		float   LayerMaxDistance;
+		float   CoverageScale;
+		uint32_t PrimarySteps;
+
+		uint32_t MarchMode;       // 0 = uniform, 1 = importance sampled (coarse + fine pass)
+		uint32_t CoarseSteps;     // Segments of the coarse density estimate
+		float   ImportanceFloor;  // Share of the fine samples kept uniform, relative to the densest segment
+		float   LightStepScale;   // Multiplies the light march sample count (set by the resolution governor)
+
+		uint32_t LightCacheEnabled;   // Reuse light-march densities between consecutive primary samples
+		uint32_t LightRefreshPerStep; // Cached light samples re-evaluated per primary sample
+		float   LightCacheMaxLag;     // Oldest reusable light sample, in light steps moved along the view ray
+		uint32_t SceneDepthEnabled;   // Set by the renderer when the SDF scene is drawn under the clouds
 	} m_CloudConstants;
 
+	enum LayerMode : uint32_t { LayerBox = 0, LayerSlab = 1, LayerShell = 2 };
+	enum MarchMode : uint32_t { MarchUniform = 0, MarchImportance = 1 };
+
 public:
 	Constant() = default;
 	~Constant() = default;
@@ -49,7 +82,13 @@ public:
 
 	void Initialize(ID3D11Device* device, ID3D11DeviceContext* context);
 	void UpdateGlobal(Camera& camera, float totalTime, float width, float height);
+	void SetJitter(const Vector2& jitter) { m_GlobalConstants.Jitter = jitter; }
 	void UpdateCloud();
+
+	// Scales the uploaded primary/light step counts; m_CloudConstants keeps the values set in the GUI
+	void SetStepScale(float primary, float light) { m_PrimaryStepScale = primary; m_LightStepScale = light; }
+	float GetPrimaryStepScale() const { return m_PrimaryStepScale; }
+	float GetLightStepScale() const { return m_LightStepScale; }
 	void BindConstantBuffer();
 
 private:
@@ -61,4 +100,7 @@ private:
 	ID3D11DeviceContext* m_pContext = nullptr;
 	ComPtr<ID3D11Buffer> m_GlobalConstantBuffer;
 	ComPtr<ID3D11Buffer> m_CloudConstantBuffer;
+
+	float m_PrimaryStepScale = 1.0f;
+	float m_LightStepScale = 1.0f;
 };
\ No newline at end of file
@@ -22,4 +22,13 @@ inline void ThrowIfFailed(HRESULT hr)
 	{
 		throw HrException(hr);
 	}
+}
+
+// Seconds on the performance counter, for CPU-side timings
+inline double GetSeconds()
+{
+	__int64 counter, countsPerSec;
+	QueryPerformanceCounter((LARGE_INTEGER*)&counter);
+	QueryPerformanceFrequency((LARGE_INTEGER*)&countsPerSec);
+	return (double)counter / (double)countsPerSec;
 }
\ No newline at end of file
@@ -1,103 +1,1759 @@
+#include <cfloat>
+
 #include "Vertex.h"
+#include "Constant.h"
 #include "ResourceManager.h"
+#include "WeatherMap.h"
+
+#include "Renderer.h"
+
+namespace
+{
+	// [Important] Must match CloudExtent in Shaders/Cloud.hlsli
+	const DirectX::SimpleMath::Vector3 CloudExtent(100.0f, 40.0f, 100.0f);
+}
+
+void Renderer::Initialize(ID3D11Device* device, ID3D11DeviceContext* context, ResourceManager* pResMgr)
+{
+	m_pDevice = device;
+	m_pContext = context;
+	m_pResMgr = pResMgr;
+
+	CreateShader();
+	CreateTexture();
+	CreateSamplerState();
+	CreateStatsBuffer();
+	CreateSceneStatsBuffer();
+	CreateDenoiseConstantBuffer();
+	CreateCloudShadowConstantBuffer();
+	CreateLightShaftConstantBuffer();
+	m_Workers.Initialize();
+	m_SdfScene.Initialize(device, context, m_Workers);
+	m_MeshExtractor.Initialize(m_Workers);
+	m_Rasterizer.Initialize(m_Workers);
+	m_DistanceTransform.Initialize(m_Workers);
+	m_Profiler.Initialize(device, context);
+	//CreateQuadVertexBuffer();
+}
+
+void Renderer::CreateShader()
+{
+	ID3DBlob* vsBlob = nullptr;
+	ID3DBlob* psBlob = nullptr;
+	ID3DBlob* csBlob = nullptr;
+
+	if (SUCCEEDED(CompileShader(L"FullScreenVS.hlsl", "vs_5_0", &vsBlob)))
+	{
+		m_pDevice->CreateVertexShader(
+			vsBlob->GetBufferPointer(),
+			vsBlob->GetBufferSize(),
+			nullptr,
+			&m_FullScreenVS
+		);
+
+		//// Define Input Layout
+		//D3D11_INPUT_ELEMENT_DESC layout[] =
+		//{
+		//	{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 }
+		//};
+
+		//m_pDevice->CreateInputLayout(layout, ARRAYSIZE(layout), vertexshaderCSO->GetBufferPointer(), vertexshaderCSO->GetBufferSize(), &m_InputLayout);
+
+		//m_Stride = sizeof(Vertex);
+	}
+
+	if (SUCCEEDED(CompileShader(L"Distance2DPS.hlsl", "ps_5_0", &psBlob)))
+	{
+		m_pDevice->CreatePixelShader(psBlob->GetBufferPointer(), psBlob->GetBufferSize(), nullptr, &m_Distance2DPS);
+		psBlob->Release();
+		psBlob = nullptr;
+	}
+	const D3D_SHADER_MACRO sdfTextureDefines[] = { { "SDF_TEXTURE", "1" }, { nullptr, nullptr } };
+	if (SUCCEEDED(CompileShader(L"Distance2DPS.hlsl", "ps_5_0", &psBlob, sdfTextureDefines)))
+	{
+		m_pDevice->CreatePixelShader(psBlob->GetBufferPointer(), psBlob->GetBufferSize(), nullptr, &m_Distance2DTexturePS);
+		psBlob->Release();
+		psBlob = nullptr;
+	}
+	if (SUCCEEDED(CompileShader(L"Distance3DPS.hlsl", "ps_5_0", &psBlob)))
+	{
+		m_pDevice->CreatePixelShader(psBlob->GetBufferPointer(), psBlob->GetBufferSize(), nullptr, &m_Distance3DPS);
+		psBlob->Release();
+		psBlob = nullptr;
+	}
+
+	if (SUCCEEDED(CompileShader(L"CloudPS.hlsl", "ps_5_0", &psBlob)))
+	{
+		m_pDevice->CreatePixelShader(psBlob->GetBufferPointer(), psBlob->GetBufferSize(), nullptr, &m_CloudPS);
+		psBlob->Release();
+		psBlob = nullptr;
+	}
+
+	if (SUCCEEDED(CompileShader(L"CompositePS.hlsl", "ps_5_0", &psBlob)))
+	{
+		m_pDevice->CreatePixelShader(psBlob->GetBufferPointer(), psBlob->GetBufferSize(), nullptr, &m_CompositePS);
+		psBlob->Release();
+		psBlob = nullptr;
+	}
+
+	if (SUCCEEDED(CompileShader(L"FroxelResolvePS.hlsl", "ps_5_0", &psBlob)))
+	{
+		m_pDevice->CreatePixelShader(psBlob->GetBufferPointer(), psBlob->GetBufferSize(), nullptr, &m_FroxelResolvePS);
+		psBlob->Release();
+		psBlob = nullptr;
+	}
+
+	const D3D_SHADER_MACRO sceneDepthDefines[] = { { "SCENE_DEPTH", "1" }, { nullptr, nullptr } };
+	if (SUCCEEDED(CompileShader(L"Distance3DPS.hlsl", "ps_5_0", &psBlob, sceneDepthDefines)))
+	{
+		m_pDevice->CreatePixelShader(psBlob->GetBufferPointer(), psBlob->GetBufferSize(), nullptr, &m_Distance3DDepthPS);
+		psBlob->Release();
+		psBlob = nullptr;
+	}
+
+	const D3D_SHADER_MACRO sceneStatsDefines[] = { { "SCENE_STATS", "1" }, { nullptr, nullptr } };
+	if (SUCCEEDED(CompileShader(L"Distance3DPS.hlsl", "ps_5_0", &psBlob, sceneStatsDefines)))
+	{
+		m_pDevice->CreatePixelShader(psBlob->GetBufferPointer(), psBlob->GetBufferSize(), nullptr, &m_Distance3DStatsPS);
+		psBlob->Release();
+		psBlob = nullptr;
+	}
+
+	const D3D_SHADER_MACRO sceneDepthStatsDefines[] = { { "SCENE_DEPTH", "1" }, { "SCENE_STATS", "1" }, { nullptr, nullptr } };
+	if (SUCCEEDED(CompileShader(L"Distance3DPS.hlsl", "ps_5_0", &psBlob, sceneDepthStatsDefines)))
+	{
+		m_pDevice->CreatePixelShader(psBlob->GetBufferPointer(), psBlob->GetBufferSize(), nullptr, &m_Distance3DDepthStatsPS);
+		psBlob->Release();
+		psBlob = nullptr;
+	}
+
+	const D3D_SHADER_MACRO statsDefines[] = { { "CLOUD_STATS", "1" }, { nullptr, nullptr } };
+	if (SUCCEEDED(CompileShader(L"CloudPS.hlsl", "ps_5_0", &psBlob, statsDefines)))
+	{
+		m_pDevice->CreatePixelShader(psBlob->GetBufferPointer(), psBlob->GetBufferSize(), nullptr, &m_CloudStatsPS);
+		psBlob->Release();
+		psBlob = nullptr;
+	}
+
+	if (SUCCEEDED(CompileShader(L"NoiseBaker.hlsl", "cs_5_0", &csBlob)))
+	{
+		ThrowIfFailed(m_pDevice->CreateComputeShader(csBlob->GetBufferPointer(), csBlob->GetBufferSize(), nullptr, &m_NoiseBakerCS));
+		csBlob->Release();
+		csBlob = nullptr;
+	}
+
+	if (SUCCEEDED(CompileShader(L"MarchErrorCS.hlsl", "cs_5_0", &csBlob)))
+	{
+		ThrowIfFailed(m_pDevice->CreateComputeShader(csBlob->GetBufferPointer(), csBlob->GetBufferSize(), nullptr, &m_MarchErrorCS));
+		csBlob->Release();
+		csBlob = nullptr;
+	}
+
+	if (SUCCEEDED(CompileShader(L"DenoiseTemporalCS.hlsl", "cs_5_0", &csBlob)))
+	{
+		ThrowIfFailed(m_pDevice->CreateComputeShader(csBlob->GetBufferPointer(), csBlob->GetBufferSize(), nullptr, &m_DenoiseTemporalCS));
+		csBlob->Release();
+		csBlob = nullptr;
+	}
+
+	if (SUCCEEDED(CompileShader(L"DenoiseAtrousCS.hlsl", "cs_5_0", &csBlob)))
+	{
+		ThrowIfFailed(m_pDevice->CreateComputeShader(csBlob->GetBufferPointer(), csBlob->GetBufferSize(), nullptr, &m_DenoiseAtrousCS));
+		csBlob->Release();
+		csBlob = nullptr;
+	}
+
+	if (SUCCEEDED(CompileShader(L"ProgressiveCS.hlsl", "cs_5_0", &csBlob)))
+	{
+		ThrowIfFailed(m_pDevice->CreateComputeShader(csBlob->GetBufferPointer(), csBlob->GetBufferSize(), nullptr, &m_ProgressiveCS));
+		csBlob->Release();
+		csBlob = nullptr;
+	}
+
+	if (SUCCEEDED(CompileShader(L"TileMetricsCS.hlsl", "cs_5_0", &csBlob)))
+	{
+		ThrowIfFailed(m_pDevice->CreateComputeShader(csBlob->GetBufferPointer(), csBlob->GetBufferSize(), nullptr, &m_TileMetricsCS));
+		csBlob->Release();
+		csBlob = nullptr;
+	}
+
+	if (SUCCEEDED(CompileShader(L"FroxelInjectCS.hlsl", "cs_5_0", &csBlob)))
+	{
+		ThrowIfFailed(m_pDevice->CreateComputeShader(csBlob->GetBufferPointer(), csBlob->GetBufferSize(), nullptr, &m_FroxelInjectCS));
+		csBlob->Release();
+		csBlob = nullptr;
+	}
+
+	if (SUCCEEDED(CompileShader(L"FroxelIntegrateCS.hlsl", "cs_5_0", &csBlob)))
+	{
+		ThrowIfFailed(m_pDevice->CreateComputeShader(csBlob->GetBufferPointer(), csBlob->GetBufferSize(), nullptr, &m_FroxelIntegrateCS));
+		csBlob->Release();
+		csBlob = nullptr;
+	}
+
+	if (SUCCEEDED(CompileShader(L"CloudShadowCS.hlsl", "cs_5_0", &csBlob)))
+	{
+		ThrowIfFailed(m_pDevice->CreateComputeShader(csBlob->GetBufferPointer(), csBlob->GetBufferSize(), nullptr, &m_CloudShadowCS));
+		csBlob->Release();
+		csBlob = nullptr;
+	}
+
+	if (SUCCEEDED(CompileShader(L"LightShaftCS.hlsl", "cs_5_0", &csBlob)))
+	{
+		ThrowIfFailed(m_pDevice->CreateComputeShader(csBlob->GetBufferPointer(), csBlob->GetBufferSize(), nullptr, &m_LightShaftCS));
+		csBlob->Release();
+		csBlob = nullptr;
+	}
+
+	if (SUCCEEDED(CompileShader(L"SceneConeCS.hlsl", "cs_5_0", &csBlob)))
+	{
+		ThrowIfFailed(m_pDevice->CreateComputeShader(csBlob->GetBufferPointer(), csBlob->GetBufferSize(), nullptr, &m_SceneConeCS));
+		csBlob->Release();
+		csBlob = nullptr;
+	}
+
+	if (SUCCEEDED(CompileShader(L"DensityGridCS.hlsl", "cs_5_0", &csBlob)))
+	{
+		ThrowIfFailed(m_pDevice->CreateComputeShader(csBlob->GetBufferPointer(), csBlob->GetBufferSize(), nullptr, &m_DensityGridCS));
+		csBlob->Release();
+		csBlob = nullptr;
+	}
+
+	if (vsBlob) vsBlob->Release();
+}
+
+void Renderer::PrepareShader()
+{
+	m_pContext->VSSetShader(m_FullScreenVS.Get(), nullptr, 0);
+
+	if (m_Scene.bDistance2D)
+	{
+		// The generated distance field in place of the analytic box
+		if (m_DistanceField.bShowOnScreen && m_DistanceFieldSRV)
+		{
+			m_pContext->PSSetShader(m_Distance2DTexturePS.Get(), nullptr, 0);
+			m_pContext->PSSetShaderResources(17, 1, m_DistanceFieldSRV.GetAddressOf());
+			m_pContext->PSSetSamplers(2, 1, m_LinearClampSampler.GetAddressOf());
+		}
+		else
+		{
+			m_pContext->PSSetShader(m_Distance2DPS.Get(), nullptr, 0);
+		}
+	}
+	if (m_Scene.bDistance3D)
+		m_pContext->PSSetShader(m_Distance3DPS.Get(), nullptr, 0);
+	if (m_Scene.bCloud)
+	{
+		m_pContext->PSSetShader(m_bCollectCloudStats ? m_CloudStatsPS.Get() : m_CloudPS.Get(), nullptr, 0);
+		m_pContext->PSSetShaderResources(0, 1, m_CloudMapSRV.GetAddressOf());
+		m_pContext->PSSetShaderResources(1, 1, m_pResMgr->GetTexture("BlueNoise"));
+		ID3D11SamplerState* samplers[] = { m_LinearSampler.Get(), m_PointSampler.Get(), m_LinearClampSampler.Get() };
+		m_pContext->PSSetSamplers(0, 3, samplers);
+	}
+	//m_pContext->IASetInputLayout(m_InputLayout.Get());
+
+}
+
+void Renderer::Render(Constant& constant)
+{
+	m_Profiler.BeginFrame();
+	m_Profiler.BeginScope("Frame");
+
+	UINT offset = 0;
+	m_pContext->IASetVertexBuffers(0, 1, m_VertexBuffer.GetAddressOf(), &m_Stride, &offset);
+
+	UINT viewportCount = 1;
+	D3D11_VIEWPORT viewport = {};
+	m_pContext->RSGetViewports(&viewportCount, &viewport);
+
+	// Full resolution for the standalone pass; the combined mode binds the scene at cloud resolution instead
+	if (!m_Scene.bCloud || m_SdfScene.IsBenchmarkRunning())
+		m_SdfScene.BeginPass(constant, (UINT)viewport.Width, (UINT)viewport.Height);
+
+	bool bSdfBenchmark = m_SdfScene.IsBenchmarkRunning() && m_Distance3DPS;
+	if (bSdfBenchmark)
+	{
+		// The standalone pass alone, one ray per back buffer pixel
+		m_Profiler.BeginScope("Scene");
+		DrawScene(m_Distance3DPS.Get(), m_Distance3DStatsPS.Get(), (UINT)viewport.Width, (UINT)viewport.Height);
+		m_Profiler.EndScope("Scene");
+	}
+	else if (m_Scene.bCloud)
+	{
+		RenderCloud(constant);
+	}
+	else
+	{
+		m_Profiler.BeginScope("Scene");
+		if (m_Scene.bDistance3D)
+			DrawScene(m_Distance3DPS.Get(), m_Distance3DStatsPS.Get(), (UINT)viewport.Width, (UINT)viewport.Height);
+		else
+			m_pContext->Draw(3, 0);
+		m_Profiler.EndScope("Scene");
+	}
+
+	m_Profiler.EndScope("Frame");
+	if (m_Profiler.EndFrame())
+	{
+		UpdateFroxelBenchmark();
+		m_Tiles.ReportTimes(m_Profiler.GetLastTime("Cloud Coarse"), m_Profiler.GetLastTime("Cloud Refine"));
+
+		if (bSdfBenchmark)
+		{
+			m_SdfScene.UpdateBenchmark(m_Profiler.GetLastTime("Scene"), (UINT64)viewport.Width * (UINT64)viewport.Height);
+		}
+	}
+}
+
+void Renderer::RenderCloud(Constant& constant)
+{
+	UINT viewportCount = 1;
+	D3D11_VIEWPORT viewport = {};
+	m_pContext->RSGetViewports(&viewportCount, &viewport);
+
+	// Same rounding as the Resolution the app puts in the global constants
+	D3D11_VIEWPORT cloudViewport = viewport;
+	cloudViewport.Width = floorf(viewport.Width * m_RenderScale);
+	cloudViewport.Height = floorf(viewport.Height * m_RenderScale);
+	CreateCloudTargets((UINT)cloudViewport.Width, (UINT)cloudViewport.Height);
+
+	bool bProgressive = m_Progressive.bEnabled && m_ProgressiveCS;
+	if (bProgressive && m_AccumulatedSamples >= m_Progressive.MaxSamples)
+	{
+		// Converged: only the composite runs
+		Composite(constant, m_Accumulation.SRV.Get());
+		return;
+	}
+
+	// Before the scene pass, which shades its surfaces with it
+	UpdateCloudShadow(constant);
+
+	// The cloud passes render HDR into their own targets; the back buffer only receives the composite
+	ComPtr<ID3D11RenderTargetView> backBufferRTV;
+	ComPtr<ID3D11DepthStencilView> backBufferDSV;
+	m_pContext->OMGetRenderTargets(1, &backBufferRTV, &backBufferDSV);
+	m_pContext->RSSetViewports(1, &cloudViewport);
+
+	// Combined mode: the SDF scene goes first so the cloud passes can read its depth
+	bool bSceneDepth = m_Scene.bDistance3D && m_Distance3DDepthPS;
+	if (constant.m_CloudConstants.SceneDepthEnabled != (bSceneDepth ? 1u : 0u))
+	{
+		constant.m_CloudConstants.SceneDepthEnabled = bSceneDepth ? 1 : 0;
+		constant.UpdateCloud();
+	}
+	if (bSceneDepth)
+	{
+		RenderSceneDepth(constant);
+	}
+
+	ID3D11RenderTargetView* cloudRTVs[] = { m_CloudColor.RTV.Get(), m_CloudGuide.RTV.Get() };
+	m_pContext->OMSetRenderTargets(2, cloudRTVs, nullptr);
+
+	bool bFroxel = m_Froxel.bEnabled;
+	if (m_BenchmarkPhase != BenchmarkPhase::Idle)
+		bFroxel = (m_BenchmarkPhase == BenchmarkPhase::Froxel);
+
+	if (bFroxel && m_FroxelInjectCS && m_FroxelIntegrateCS && m_FroxelResolvePS)
+	{
+		RenderFroxels();
+	}
+	else
+	{
+		bool bStats = m_bCollectCloudStats && m_StatsUAV;
+		bool bTiles = m_Tiles.m_Settings.bEnabled && m_TileMetricsCS;
+		if (bStats)
+		{
+			UINT zeros[4] = { 0, 0, 0, 0 };
+			m_pContext->ClearUnorderedAccessViewUint(m_StatsUAV.Get(), zeros);
+
+			// Keep the bound render targets, add the counters after them (u2)
+			// The tiled path binds them for its refine draws only, which overwrite coarse pixels
+			if (!bTiles)
+				m_pContext->OMSetRenderTargetsAndUnorderedAccessViews(D3D11_KEEP_RENDER_TARGETS_AND_DEPTH_STENCIL, nullptr, nullptr,
+					2, 1, m_StatsUAV.GetAddressOf(), nullptr);
+		}
+
+		m_Profiler.BeginScope("Cloud");
+		if (bTiles)
+			RenderCloudTiles(constant, bStats);
+		else
+			m_pContext->Draw(3, 0);
+		m_Profiler.EndScope("Cloud");
+
+		if (bStats)
+		{
+			ID3D11UnorderedAccessView* nullUAV = nullptr;
+			m_pContext->OMSetRenderTargetsAndUnorderedAccessViews(D3D11_KEEP_RENDER_TARGETS_AND_DEPTH_STENCIL, nullptr, nullptr,
+				2, 1, &nullUAV, nullptr);
+
+			ReadCloudStats();
+		}
+	}
+
+	m_pContext->OMSetRenderTargets(1, backBufferRTV.GetAddressOf(), backBufferDSV.Get());
+	m_pContext->RSSetViewports(1, &viewport);
+
+	if (bSceneDepth)
+	{
+		// Released before the next frame binds them as targets again
+		ID3D11ShaderResourceView* nullSRVs[2] = { nullptr, nullptr };
+		m_pContext->PSSetShaderResources(6, 2, nullSRVs);
+	}
+
+	ID3D11ShaderResourceView* result = m_CloudColor.SRV.Get();
+	if (bProgressive)
+	{
+		// The average of jittered frames replaces the denoiser; its history goes stale meanwhile
+		Accumulate();
+		result = m_Accumulation.SRV.Get();
+		m_bHistoryValid = false;
+	}
+	else if (m_Denoise.bEnabled && m_DenoiseTemporalCS && m_DenoiseAtrousCS)
+	{
+		result = Denoise();
+	}
+	else
+	{
+		m_bHistoryValid = false;
+	}
+
+	Composite(constant, result);
+}
+
+void Renderer::RenderSceneDepth(const Constant& constant)
+{
+	m_SdfScene.BeginPass(constant, m_CloudWidth, m_CloudHeight);
+
+	m_Profiler.BeginScope("Scene SDF");
+
+	ID3D11RenderTargetView* sceneRTVs[] = { m_SceneColor.RTV.Get(), m_SceneDepth.RTV.Get() };
+	m_pContext->OMSetRenderTargets(2, sceneRTVs, nullptr);
+	DrawScene(m_Distance3DDepthPS.Get(), m_Distance3DDepthStatsPS.Get(), m_CloudWidth, m_CloudHeight);
+
+	// The cloud passes read both at t6/t7, pixel for pixel (same viewport)
+	ID3D11RenderTargetView* nullRTVs[2] = { nullptr, nullptr };
+	m_pContext->OMSetRenderTargets(2, nullRTVs, nullptr);
+
+	ID3D11ShaderResourceView* sceneSRVs[] = { m_SceneColor.SRV.Get(), m_SceneDepth.SRV.Get() };
+	m_pContext->PSSetShaderResources(6, 2, sceneSRVs);
+	m_pContext->PSSetShader(m_bCollectCloudStats ? m_CloudStatsPS.Get() : m_CloudPS.Get(), nullptr, 0);
+
+	m_Profiler.EndScope("Scene SDF");
+}
+
+void Renderer::DrawScene(ID3D11PixelShader* shader, ID3D11PixelShader* statsShader, UINT width, UINT height)
+{
+	// Inside the caller's profiler scope, so timings include the pre-pass
+	RenderSceneCone(width, height);
+
+	bool bStats = m_SdfScene.WantsTraceStats() && statsShader && m_SceneStatsUAV;
+	if (bStats)
+	{
+		// Keep the bound render targets, add the counters after them (u2)
+		UINT zeros[4] = { 0, 0, 0, 0 };
+		m_pContext->ClearUnorderedAccessViewUint(m_SceneStatsUAV.Get(), zeros);
+		m_pContext->OMSetRenderTargetsAndUnorderedAccessViews(D3D11_KEEP_RENDER_TARGETS_AND_DEPTH_STENCIL, nullptr, nullptr,
+			2, 1, m_SceneStatsUAV.GetAddressOf(), nullptr);
+	}
+
+	m_pContext->PSSetShader(bStats ? statsShader : shader, nullptr, 0);
+	m_pContext->Draw(3, 0);
+
+	if (bStats)
+	{
+		ID3D11UnorderedAccessView* nullUAV = nullptr;
+		m_pContext->OMSetRenderTargetsAndUnorderedAccessViews(D3D11_KEEP_RENDER_TARGETS_AND_DEPTH_STENCIL, nullptr, nullptr,
+			2, 1, &nullUAV, nullptr);
+
+		ReadSceneStats();
+	}
+}
+
+void Renderer::RenderSceneCone(UINT width, UINT height)
+{
+	// Unbound, the start texture reads 0 and every ray starts at the camera
+	ID3D11ShaderResourceView* nullSRV = nullptr;
+	m_pContext->PSSetShaderResources(14, 1, &nullSRV);
+	if (!m_SdfScene.m_Settings.bConePrepass || !m_SceneConeCS) return;
+
+	UINT coneWidth = (width + SdfScene::ConeTileSize - 1) / SdfScene::ConeTileSize;
+	UINT coneHeight = (height + SdfScene::ConeTileSize - 1) / SdfScene::ConeTileSize;
+	if (!m_SceneCone.Texture || m_SceneConeWidth != coneWidth || m_SceneConeHeight != coneHeight)
+	{
+		CreateRenderTexture(m_SceneCone, coneWidth, coneHeight, DXGI_FORMAT_R32_FLOAT, D3D11_BIND_UNORDERED_ACCESS);
+		m_SceneConeWidth = coneWidth;
+		m_SceneConeHeight = coneHeight;
+	}
+
+	ID3D11UnorderedAccessView* nullUAV = nullptr;
+	m_pContext->CSSetShader(m_SceneConeCS.Get(), nullptr, 0);
+	m_pContext->CSSetUnorderedAccessViews(0, 1, m_SceneCone.UAV.GetAddressOf(), nullptr);
+	m_pContext->Dispatch((coneWidth + 7) / 8, (coneHeight + 7) / 8, 1);
+	m_pContext->CSSetUnorderedAccessViews(0, 1, &nullUAV, nullptr);
+
+	m_pContext->PSSetShaderResources(14, 1, m_SceneCone.SRV.GetAddressOf());
+}
+
+void Renderer::RenderCloudTiles(Constant& constant, bool bStats)
+{
+	if (m_Tiles.Resize(m_CloudWidth, m_CloudHeight))
+	{
+		CreateTileMetricsBuffer(m_Tiles.GetTileCount());
+	}
+
+	float primaryScale = constant.GetPrimaryStepScale();
+	float lightScale = constant.GetLightStepScale();
+
+	// 1. Coarse pass over the whole image, so the frame is complete however little refinement fits
+	m_Profiler.BeginScope("Cloud Coarse");
+	constant.SetStepScale(primaryScale * m_Tiles.m_Settings.CoarseStepScale, lightScale);
+	constant.UpdateCloud();
+	m_pContext->Draw(3, 0);
+
+	// 2. Coverage and noise per tile
+	ID3D11RenderTargetView* nullRTVs[2] = { nullptr, nullptr };
+	ID3D11ShaderResourceView* nullSRV = nullptr;
+	ID3D11UnorderedAccessView* nullUAV = nullptr;
+	m_pContext->OMSetRenderTargets(2, nullRTVs, nullptr);
+
+	m_pContext->CSSetShader(m_TileMetricsCS.Get(), nullptr, 0);
+	m_pContext->CSSetShaderResources(0, 1, m_CloudColor.SRV.GetAddressOf());
+	m_pContext->CSSetUnorderedAccessViews(0, 1, m_TileMetricsUAV.GetAddressOf(), nullptr);
+	m_pContext->Dispatch(m_Tiles.GetTilesX(), m_Tiles.GetTilesY(), 1);
+	m_pContext->CSSetUnorderedAccessViews(0, 1, &nullUAV, nullptr);
+	m_pContext->CSSetShaderResources(0, 1, &nullSRV);
+	m_pContext->CSSetShader(nullptr, nullptr, 0);
+	m_Profiler.EndScope("Cloud Coarse");
+
+	ReadTileMetrics();
+
+	// Counters cover the full-step draws only; the coarse pass would count refined pixels twice
+	ID3D11RenderTargetView* cloudRTVs[] = { m_CloudColor.RTV.Get(), m_CloudGuide.RTV.Get() };
+	if (bStats)
+		m_pContext->OMSetRenderTargetsAndUnorderedAccessViews(2, cloudRTVs, nullptr, 2, 1, m_StatsUAV.GetAddressOf(), nullptr);
+	else
+		m_pContext->OMSetRenderTargets(2, cloudRTVs, nullptr);
+
+	// 3. Full-step tiles in priority order; each overwrites its coarse pixels
+	constant.SetStepScale(primaryScale, lightScale);
+	constant.UpdateCloud();
+
+	ComPtr<ID3D11RasterizerState> previousState;
+	m_pContext->RSGetState(&previousState);
+	if (!m_ScissorState)
+	{
+		D3D11_RASTERIZER_DESC desc = {};
+		desc.FillMode = D3D11_FILL_SOLID;
+		desc.CullMode = D3D11_CULL_NONE;
+		desc.DepthClipEnable = TRUE;
+		if (previousState) previousState->GetDesc(&desc);
+		desc.ScissorEnable = TRUE;
+		ThrowIfFailed(m_pDevice->CreateRasterizerState(&desc, &m_ScissorState));
+	}
+
+	m_Profiler.BeginScope("Cloud Refine");
+	m_pContext->RSSetState(m_ScissorState.Get());
+	for (const auto& tile : m_Tiles.Schedule())
+	{
+		m_pContext->RSSetScissorRects(1, &tile.Rect);
+		m_pContext->Draw(3, 0);
+	}
+	m_pContext->RSSetState(previousState.Get());
+	m_Profiler.EndScope("Cloud Refine");
+}
+
+void Renderer::CreateCloudShadowConstantBuffer()
+{
+	D3D11_BUFFER_DESC bufferDesc = {};
+	bufferDesc.ByteWidth = sizeof(CloudShadowConstants);
+	bufferDesc.Usage = D3D11_USAGE_DYNAMIC; // The baked row band moves every frame
+	bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	bufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+
+	ThrowIfFailed(m_pDevice->CreateBuffer(&bufferDesc, nullptr, &m_CloudShadowConstantBuffer));
+}
+
+void Renderer::UpdateCloudShadow(const Constant& constant)
+{
+	CloudShadowConstants constants = {};
+	bool bEnabled = m_CloudShadow.bEnabled && m_CloudShadowCS;
+
+	if (bEnabled)
+	{
+		UINT resolution = (UINT)(std::max)(m_CloudShadow.Resolution, 16);
+		if (resolution != m_CloudShadowResolution)
+		{
+			CreateRenderTexture(m_CloudShadowMap, resolution, resolution, DXGI_FORMAT_R16G16B16A16_FLOAT, D3D11_BIND_UNORDERED_ACCESS);
+			m_CloudShadowResolution = resolution;
+			m_bCloudShadowValid = false;
+		}
+
+		// The open-layer window follows the camera in steps of an eighth, so it is only rebuilt whole now and then
+		float extent = m_CloudShadow.OpenLayerExtent;
+		float snap = extent / 8.0f;
+		const auto& cameraPos = constant.m_GlobalConstants.CameraPos;
+		constants.Origin[0] = floorf(cameraPos.x / snap) * snap - extent * 0.5f;
+		constants.Origin[1] = floorf(cameraPos.z / snap) * snap - extent * 0.5f;
+		constants.Size = extent;
+
+		// Time is left out on purpose: the scroll is picked up by the rolling band below
+		const auto& cloud = constant.m_CloudConstants;
+		float key[] = {
+			cloud.SunDir.x, cloud.SunDir.y, cloud.SunDir.z,
+			cloud.CloudScale, cloud.ShapeStrength, cloud.DensityMult,
+			(float)cloud.LayerMode, cloud.ShellBottom, cloud.ShellTop, cloud.CoverageScale,
+			constants.Origin[0], constants.Origin[1] };
+		static_assert(sizeof(key) == sizeof(m_CloudShadowKey), "Cloud shadow key size mismatch");
+
+		if (memcmp(key, m_CloudShadowKey, sizeof(key)) != 0)
+		{
+			memcpy(m_CloudShadowKey, key, sizeof(key));
+			m_bCloudShadowValid = false;
+		}
+
+		UINT rowOffset = 0;
+		UINT rowCount = resolution;
+		if (m_bCloudShadowValid)
+		{
+			rowOffset = m_CloudShadowNextRow % resolution;
+			rowCount = (std::min)((UINT)(std::max)(m_CloudShadow.RowsPerFrame, 1), resolution - rowOffset);
+		}
+		m_CloudShadowNextRow = (rowOffset + rowCount) % resolution;
+
+		constants.Enabled = 1;
+		constants.InMarch = m_CloudShadow.bUseInMarch ? 1 : 0;
+		constants.Resolution = resolution;
+		constants.RowOffset = rowOffset;
+		constants.RowCount = rowCount;
+	}
+
+	D3D11_MAPPED_SUBRESOURCE msr;
+	if (SUCCEEDED(m_pContext->Map(m_CloudShadowConstantBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &msr)))
+	{
+		memcpy(msr.pData, &constants, sizeof(CloudShadowConstants));
+		m_pContext->Unmap(m_CloudShadowConstantBuffer.Get(), 0);
+	}
+	m_pContext->PSSetConstantBuffers(4, 1, m_CloudShadowConstantBuffer.GetAddressOf());
+	m_pContext->CSSetConstantBuffers(4, 1, m_CloudShadowConstantBuffer.GetAddressOf());
+
+	// Disabled, the lookups return before touching t8
+	if (!bEnabled) return;
+
+	m_Profiler.BeginScope("Cloud Shadow");
+
+	ID3D11ShaderResourceView* nullSRV = nullptr;
+	ID3D11UnorderedAccessView* nullUAV = nullptr;
+	m_pContext->PSSetShaderResources(8, 1, &nullSRV);
+	m_pContext->CSSetShaderResources(8, 1, &nullSRV);
+
+	ID3D11SamplerState* samplers[] = { m_LinearSampler.Get(), m_PointSampler.Get(), m_LinearClampSampler.Get() };
+	m_pContext->CSSetShaderResources(0, 1, m_CloudMapSRV.GetAddressOf());
+	m_pContext->CSSetSamplers(0, 3, samplers);
+
+	m_pContext->CSSetShader(m_CloudShadowCS.Get(), nullptr, 0);
+	m_pContext->CSSetUnorderedAccessViews(0, 1, m_CloudShadowMap.UAV.GetAddressOf(), nullptr);
+	m_pContext->Dispatch((constants.Resolution + 7) / 8, (constants.RowCount + 7) / 8, 1);
+	m_pContext->CSSetUnorderedAccessViews(0, 1, &nullUAV, nullptr);
+	m_pContext->CSSetShader(nullptr, nullptr, 0);
+
+	// Read by the scene, cloud and froxel passes
+	m_pContext->PSSetShaderResources(8, 1, m_CloudShadowMap.SRV.GetAddressOf());
+	m_pContext->CSSetShaderResources(8, 1, m_CloudShadowMap.SRV.GetAddressOf());
+	m_bCloudShadowValid = true;
+
+	m_Profiler.EndScope("Cloud Shadow");
+}
+
+void Renderer::CreateTileMetricsBuffer(UINT tileCount)
+{
+	D3D11_BUFFER_DESC bufferDesc = {};
+	bufferDesc.ByteWidth = tileCount * sizeof(float) * 2;
+	bufferDesc.Usage = D3D11_USAGE_DEFAULT;
+	bufferDesc.BindFlags = D3D11_BIND_UNORDERED_ACCESS;
+	bufferDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+	bufferDesc.StructureByteStride = sizeof(float) * 2;
+
+	ThrowIfFailed(m_pDevice->CreateBuffer(&bufferDesc, nullptr, m_TileMetricsBuffer.ReleaseAndGetAddressOf()));
+
+	D3D11_UNORDERED_ACCESS_VIEW_DESC uavDesc = {};
+	uavDesc.Format = DXGI_FORMAT_UNKNOWN;
+	uavDesc.ViewDimension = D3D11_UAV_DIMENSION_BUFFER;
+	uavDesc.Buffer.NumElements = tileCount;
+
+	ThrowIfFailed(m_pDevice->CreateUnorderedAccessView(m_TileMetricsBuffer.Get(), &uavDesc, m_TileMetricsUAV.ReleaseAndGetAddressOf()));
+
+	// Same ring as the cloud stats; each slot remembers the grid it was copied with
+	bufferDesc.Usage = D3D11_USAGE_STAGING;
+	bufferDesc.BindFlags = 0;
+	bufferDesc.MiscFlags = 0;
+	bufferDesc.StructureByteStride = 0;
+	bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+
+	for (UINT i = 0; i < StatsLatency; i++)
+	{
+		ThrowIfFailed(m_pDevice->CreateBuffer(&bufferDesc, nullptr, m_TileMetricsStaging[i].ReleaseAndGetAddressOf()));
+		m_TileMetricsCount[i] = 0;
+	}
+	m_TileMetricsFrame = 0;
+}
+
+void Renderer::ReadTileMetrics()
+{
+	UINT slot = m_TileMetricsFrame % StatsLatency;
+	m_pContext->CopyResource(m_TileMetricsStaging[slot].Get(), m_TileMetricsBuffer.Get());
+	m_TileMetricsCount[slot] = m_Tiles.GetTileCount();
+	m_TileMetricsFrame++;
+
+	if (m_TileMetricsFrame < StatsLatency) return;
+
+	// Oldest copy; skip rather than stall if the GPU has not finished it
+	slot = m_TileMetricsFrame % StatsLatency;
+	D3D11_MAPPED_SUBRESOURCE msr;
+	if (m_pContext->Map(m_TileMetricsStaging[slot].Get(), 0, D3D11_MAP_READ, D3D11_MAP_FLAG_DO_NOT_WAIT, &msr) == S_OK)
+	{
+		m_Tiles.SetMetrics(static_cast<const float*>(msr.pData), m_TileMetricsCount[slot]);
+		m_pContext->Unmap(m_TileMetricsStaging[slot].Get(), 0);
+	}
+}
+
+void Renderer::Composite(const Constant& constant, ID3D11ShaderResourceView* result)
+{
+	// Without the pass t1 stays empty and the composite adds nothing
+	ID3D11ShaderResourceView* shafts = RenderLightShafts(constant, result) ? m_LightShaftTarget.SRV.Get() : nullptr;
+
+	m_Profiler.BeginScope("Composite");
+	m_pContext->PSSetShader(m_CompositePS.Get(), nullptr, 0);
+	m_pContext->PSSetShaderResources(0, 1, &result);
+	m_pContext->PSSetShaderResources(1, 1, &shafts);
+	m_pContext->Draw(3, 0);
+	m_Profiler.EndScope("Composite");
+
+	// Back to the cloud pass bindings for anything drawn later in the frame
+	m_pContext->PSSetShaderResources(0, 1, m_CloudMapSRV.GetAddressOf());
+	m_pContext->PSSetShaderResources(1, 1, m_pResMgr->GetTexture("BlueNoise"));
+	m_pContext->PSSetShader(m_bCollectCloudStats ? m_CloudStatsPS.Get() : m_CloudPS.Get(), nullptr, 0);
+}
+
+void Renderer::CreateLightShaftConstantBuffer()
+{
+	D3D11_BUFFER_DESC bufferDesc = {};
+	bufferDesc.ByteWidth = sizeof(LightShaftConstants);
+	bufferDesc.Usage = D3D11_USAGE_DYNAMIC; // The projected sun moves with the camera
+	bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	bufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+
+	ThrowIfFailed(m_pDevice->CreateBuffer(&bufferDesc, nullptr, &m_LightShaftConstantBuffer));
+}
+
+bool Renderer::RenderLightShafts(const Constant& constant, ID3D11ShaderResourceView* cloud)
+{
+	if (!m_LightShafts.bEnabled || !m_LightShaftCS) return false;
+
+	// Project the sun with the camera basis of getCameraRay (focal length 1, y down in uv)
+	const auto& global = constant.m_GlobalConstants;
+	const auto& sunDir = constant.m_CloudConstants.SunDir;
+	float z = sunDir.Dot(global.CameraDir);
+	if (z <= 0.0f) return false;
+
+	float aspect = global.Resolution.x / global.Resolution.y;
+	float sunU = sunDir.Dot(global.CameraRight) / z / aspect * 0.5f + 0.5f;
+	float sunV = -sunDir.Dot(global.CameraUp) / z * 0.5f + 0.5f;
+
+	// Fade as the sun turns away, leaves the screen by more than half a view, or sets
+	float outside = (std::max)((std::max)(-sunU, sunU - 1.0f), (std::max)(-sunV, sunV - 1.0f));
+	float fade = (std::min)(z * 4.0f, 1.0f) * (std::max)(1.0f - (std::max)(outside, 0.0f) * 2.0f, 0.0f)
+		* (std::min)((std::max)(sunDir.y * 5.0f, 0.0f), 1.0f);
+	if (fade <= 0.0f) return false;
+
+	LightShaftConstants constants = {};
+	constants.SunUV[0] = sunU;
+	constants.SunUV[1] = sunV;
+	constants.Density = m_LightShafts.Density;
+	constants.Decay = m_LightShafts.Decay;
+	constants.ShaftColor[0] = 1.0f * m_LightShafts.Exposure * fade;
+	constants.ShaftColor[1] = 0.95f * m_LightShafts.Exposure * fade;
+	constants.ShaftColor[2] = 0.85f * m_LightShafts.Exposure * fade;
+	constants.SourceRadius = (std::max)(m_LightShafts.SourceRadius, 1e-3f);
+	constants.SampleCount = (uint32_t)(std::max)(m_LightShafts.Samples, 1);
+
+	D3D11_MAPPED_SUBRESOURCE msr;
+	if (SUCCEEDED(m_pContext->Map(m_LightShaftConstantBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &msr)))
+	{
+		memcpy(msr.pData, &constants, sizeof(LightShaftConstants));
+		m_pContext->Unmap(m_LightShaftConstantBuffer.Get(), 0);
+	}
+
+	m_Profiler.BeginScope("Light Shafts");
+
+	// The scene coverage occludes the sky as well in the combined mode; unbound it reads 0
+	bool bSceneDepth = m_Scene.bDistance3D && m_Distance3DDepthPS;
+	ID3D11ShaderResourceView* srvs[] = { cloud, *m_pResMgr->GetTexture("BlueNoise") };
+	ID3D11ShaderResourceView* sceneSRV = bSceneDepth ? m_SceneColor.SRV.Get() : nullptr;
+	ID3D11SamplerState* samplers[] = { m_LinearSampler.Get(), m_PointSampler.Get(), m_LinearClampSampler.Get() };
+	m_pContext->CSSetShaderResources(0, 2, srvs);
+	m_pContext->CSSetShaderResources(6, 1, &sceneSRV);
+	m_pContext->CSSetSamplers(0, 3, samplers);
+	m_pContext->CSSetConstantBuffers(5, 1, m_LightShaftConstantBuffer.GetAddressOf());
+
+	m_pContext->CSSetShader(m_LightShaftCS.Get(), nullptr, 0);
+	m_pContext->CSSetUnorderedAccessViews(0, 1, m_LightShaftTarget.UAV.GetAddressOf(), nullptr);
+	m_pContext->Dispatch((m_CloudWidth + 7) / 8, (m_CloudHeight + 7) / 8, 1);
+
+	ID3D11ShaderResourceView* nullSRV = nullptr;
+	ID3D11UnorderedAccessView* nullUAV = nullptr;
+	m_pContext->CSSetUnorderedAccessViews(0, 1, &nullUAV, nullptr);
+	m_pContext->CSSetShaderResources(0, 1, &nullSRV);
+	m_pContext->CSSetShaderResources(6, 1, &nullSRV);
+	m_pContext->CSSetShader(nullptr, nullptr, 0);
+	m_Profiler.EndScope("Light Shafts");
+
+	return true;
+}
+
+void Renderer::Accumulate()
+{
+	UpdateDenoiseConstants(0, (UINT)m_AccumulatedSamples);
+
+	m_Profiler.BeginScope("Accumulate");
+	m_pContext->CSSetShader(m_ProgressiveCS.Get(), nullptr, 0);
+	m_pContext->CSSetConstantBuffers(3, 1, m_DenoiseConstantBuffer.GetAddressOf());
+	m_pContext->CSSetShaderResources(0, 1, m_CloudColor.SRV.GetAddressOf());
+	m_pContext->CSSetUnorderedAccessViews(0, 1, m_Accumulation.UAV.GetAddressOf(), nullptr);
+	m_pContext->Dispatch((m_CloudWidth + 7) / 8, (m_CloudHeight + 7) / 8, 1);
+
+	ID3D11ShaderResourceView* nullSRV = nullptr;
+	ID3D11UnorderedAccessView* nullUAV = nullptr;
+	m_pContext->CSSetUnorderedAccessViews(0, 1, &nullUAV, nullptr);
+	m_pContext->CSSetShaderResources(0, 1, &nullSRV);
+	m_pContext->CSSetShader(nullptr, nullptr, 0);
+	m_Profiler.EndScope("Accumulate");
+
+	m_AccumulatedSamples++;
+}
+
+void Renderer::CreateRenderTexture(RenderTexture& target, UINT width, UINT height, DXGI_FORMAT format, UINT bindFlags)
+{
+	D3D11_TEXTURE2D_DESC texDesc = {};
+	texDesc.Width = width;
+	texDesc.Height = height;
+	texDesc.MipLevels = 1;
+	texDesc.ArraySize = 1;
+	texDesc.Format = format;
+	texDesc.SampleDesc.Count = 1;
+	texDesc.Usage = D3D11_USAGE_DEFAULT;
+	texDesc.BindFlags = bindFlags | D3D11_BIND_SHADER_RESOURCE;
+
+	ThrowIfFailed(m_pDevice->CreateTexture2D(&texDesc, nullptr, target.Texture.ReleaseAndGetAddressOf()));
+	ThrowIfFailed(m_pDevice->CreateShaderResourceView(target.Texture.Get(), nullptr, target.SRV.ReleaseAndGetAddressOf()));
+
+	target.RTV.Reset();
+	target.UAV.Reset();
+	if (bindFlags & D3D11_BIND_RENDER_TARGET)
+		ThrowIfFailed(m_pDevice->CreateRenderTargetView(target.Texture.Get(), nullptr, &target.RTV));
+	if (bindFlags & D3D11_BIND_UNORDERED_ACCESS)
+		ThrowIfFailed(m_pDevice->CreateUnorderedAccessView(target.Texture.Get(), nullptr, &target.UAV));
+}
+
+void Renderer::CreateCloudTargets(UINT width, UINT height)
+{
+	if (m_CloudColor.Texture && m_CloudWidth == width && m_CloudHeight == height) return;
+	m_CloudWidth = width;
+	m_CloudHeight = height;
+
+	CreateRenderTexture(m_CloudColor, width, height, DXGI_FORMAT_R16G16B16A16_FLOAT, D3D11_BIND_RENDER_TARGET);
+	CreateRenderTexture(m_CloudGuide, width, height, DXGI_FORMAT_R16G16_FLOAT, D3D11_BIND_RENDER_TARGET);
+	CreateRenderTexture(m_SceneColor, width, height, DXGI_FORMAT_R16G16B16A16_FLOAT, D3D11_BIND_RENDER_TARGET);
+	CreateRenderTexture(m_SceneDepth, width, height, DXGI_FORMAT_R32_FLOAT, D3D11_BIND_RENDER_TARGET);
+	CreateRenderTexture(m_LightShaftTarget, width, height, DXGI_FORMAT_R16G16B16A16_FLOAT, D3D11_BIND_UNORDERED_ACCESS);
+
+	for (UINT i = 0; i < 2; i++)
+	{
+		CreateRenderTexture(m_History[i], width, height, DXGI_FORMAT_R16G16B16A16_FLOAT, D3D11_BIND_UNORDERED_ACCESS);
+		CreateRenderTexture(m_DenoiseTemp[i], width, height, DXGI_FORMAT_R16G16B16A16_FLOAT, D3D11_BIND_UNORDERED_ACCESS);
+	}
+	m_bHistoryValid = false;
+
+	// Full float: hundreds of small increments would stall in half precision
+	CreateRenderTexture(m_Accumulation, width, height, DXGI_FORMAT_R32G32B32A32_FLOAT, D3D11_BIND_UNORDERED_ACCESS);
+	m_AccumulatedSamples = 0;
+}
+
+ID3D11ShaderResourceView* Renderer::Denoise()
+{
+	ID3D11SamplerState* samplers[] = { m_LinearSampler.Get(), m_PointSampler.Get(), m_LinearClampSampler.Get() };
+	m_pContext->CSSetSamplers(0, 3, samplers);
+	m_pContext->CSSetConstantBuffers(3, 1, m_DenoiseConstantBuffer.GetAddressOf());
+
+	ID3D11ShaderResourceView* nullSRVs[3] = { nullptr, nullptr, nullptr };
+	ID3D11UnorderedAccessView* nullUAV = nullptr;
+	UINT groupsX = (m_CloudWidth + 7) / 8;
+	UINT groupsY = (m_CloudHeight + 7) / 8;
+
+	ID3D11ShaderResourceView* current = m_CloudColor.SRV.Get();
+
+	// 1. Temporal accumulation into the history ping-pong
+	if (m_Denoise.bTemporal)
+	{
+		UINT write = m_HistoryIndex ^ 1;
+		UpdateDenoiseConstants(0);
+
+		m_Profiler.BeginScope("Denoise Temporal");
+		ID3D11ShaderResourceView* srvs[] = { m_CloudColor.SRV.Get(), m_CloudGuide.SRV.Get(), m_History[m_HistoryIndex].SRV.Get() };
+		m_pContext->CSSetShader(m_DenoiseTemporalCS.Get(), nullptr, 0);
+		m_pContext->CSSetShaderResources(0, 3, srvs);
+		m_pContext->CSSetUnorderedAccessViews(0, 1, m_History[write].UAV.GetAddressOf(), nullptr);
+		m_pContext->Dispatch(groupsX, groupsY, 1);
+		m_pContext->CSSetUnorderedAccessViews(0, 1, &nullUAV, nullptr);
+		m_pContext->CSSetShaderResources(0, 3, nullSRVs);
+		m_Profiler.EndScope("Denoise Temporal");
+
+		m_HistoryIndex = write;
+		m_bHistoryValid = true;
+		current = m_History[write].SRV.Get();
+	}
+	else
+	{
+		m_bHistoryValid = false;
+	}
+
+	// 2. Edge-avoiding a-trous iterations, doubling the tap spacing each time
+	if (m_Denoise.AtrousIterations > 0)
+	{
+		m_Profiler.BeginScope("Denoise A-Trous");
+		m_pContext->CSSetShader(m_DenoiseAtrousCS.Get(), nullptr, 0);
+
+		for (int i = 0; i < m_Denoise.AtrousIterations; i++)
+		{
+			UpdateDenoiseConstants(1u << i);
+
+			RenderTexture& target = m_DenoiseTemp[i & 1];
+			ID3D11ShaderResourceView* srvs[] = { current, m_CloudGuide.SRV.Get() };
+			m_pContext->CSSetShaderResources(0, 2, srvs);
+			m_pContext->CSSetUnorderedAccessViews(0, 1, target.UAV.GetAddressOf(), nullptr);
+			m_pContext->Dispatch(groupsX, groupsY, 1);
+			m_pContext->CSSetUnorderedAccessViews(0, 1, &nullUAV, nullptr);
+			m_pContext->CSSetShaderResources(0, 2, nullSRVs);
+
+			current = target.SRV.Get();
+		}
+		m_Profiler.EndScope("Denoise A-Trous");
+	}
+
+	m_pContext->CSSetShader(nullptr, nullptr, 0);
+	return current;
+}
+
+void Renderer::UpdateDenoiseConstants(UINT stepWidth, UINT accumulationIndex)
+{
+	DenoiseConstants constants = {};
+	constants.HistoryWeight = m_Denoise.HistoryWeight;
+	constants.ClipGamma = m_Denoise.ClipGamma;
+	constants.TransmittanceReject = m_Denoise.TransmittanceReject;
+	constants.HistoryValid = m_bHistoryValid ? 1 : 0;
+	constants.ColorSigma = m_Denoise.ColorSigma;
+	constants.TransmittanceSigma = m_Denoise.TransmittanceSigma;
+	constants.StepSigma = m_Denoise.StepSigma;
+	constants.StepWidth = stepWidth;
+	constants.AccumulationIndex = accumulationIndex;
+
+	D3D11_MAPPED_SUBRESOURCE msr;
+	if (SUCCEEDED(m_pContext->Map(m_DenoiseConstantBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &msr)))
+	{
+		memcpy(msr.pData, &constants, sizeof(DenoiseConstants));
+		m_pContext->Unmap(m_DenoiseConstantBuffer.Get(), 0);
+	}
+}
+
+void Renderer::CreateFroxelVolumes()
+{
+	UINT size[3] = { (UINT)m_Froxel.Width, (UINT)m_Froxel.Height, (UINT)m_Froxel.Depth };
+	if (m_FroxelScatterTexture && memcmp(size, m_FroxelSize, sizeof(size)) == 0) return;
+	memcpy(m_FroxelSize, size, sizeof(size));
+
+	D3D11_TEXTURE3D_DESC texDesc = {};
+	texDesc.Width = size[0];
+	texDesc.Height = size[1];
+	texDesc.Depth = size[2];
+	texDesc.MipLevels = 1;
+	texDesc.Format = DXGI_FORMAT_R16G16B16A16_FLOAT;
+	texDesc.Usage = D3D11_USAGE_DEFAULT;
+	texDesc.BindFlags = D3D11_BIND_UNORDERED_ACCESS | D3D11_BIND_SHADER_RESOURCE;
+
+	ThrowIfFailed(m_pDevice->CreateTexture3D(&texDesc, nullptr, m_FroxelScatterTexture.ReleaseAndGetAddressOf()));
+	ThrowIfFailed(m_pDevice->CreateUnorderedAccessView(m_FroxelScatterTexture.Get(), nullptr, m_FroxelScatterUAV.ReleaseAndGetAddressOf()));
+	ThrowIfFailed(m_pDevice->CreateShaderResourceView(m_FroxelScatterTexture.Get(), nullptr, m_FroxelScatterSRV.ReleaseAndGetAddressOf()));
+
+	ThrowIfFailed(m_pDevice->CreateTexture3D(&texDesc, nullptr, m_FroxelIntegratedTexture.ReleaseAndGetAddressOf()));
+	ThrowIfFailed(m_pDevice->CreateUnorderedAccessView(m_FroxelIntegratedTexture.Get(), nullptr, m_FroxelIntegratedUAV.ReleaseAndGetAddressOf()));
+	ThrowIfFailed(m_pDevice->CreateShaderResourceView(m_FroxelIntegratedTexture.Get(), nullptr, m_FroxelIntegratedSRV.ReleaseAndGetAddressOf()));
+}
+
+void Renderer::RenderFroxels()
+{
+	CreateFroxelVolumes();
+
+	ID3D11ShaderResourceView* srvs[] = { m_CloudMapSRV.Get(), *m_pResMgr->GetTexture("BlueNoise") };
+	ID3D11SamplerState* samplers[] = { m_LinearSampler.Get(), m_PointSampler.Get(), m_LinearClampSampler.Get() };
+	m_pContext->CSSetShaderResources(0, 2, srvs);
+	m_pContext->CSSetSamplers(0, 3, samplers);
+
+	ID3D11ShaderResourceView* nullSRV = nullptr;
+	ID3D11UnorderedAccessView* nullUAV = nullptr;
+	UINT groupsX = (m_FroxelSize[0] + 7) / 8;
+	UINT groupsY = (m_FroxelSize[1] + 7) / 8;
 
-#include "Renderer.h"
+	// 1. Density and in-scattering per froxel
+	m_Profiler.BeginScope("Froxel Inject");
+	m_pContext->CSSetShader(m_FroxelInjectCS.Get(), nullptr, 0);
+	m_pContext->CSSetUnorderedAccessViews(0, 1, m_FroxelScatterUAV.GetAddressOf(), nullptr);
+	m_pContext->Dispatch(groupsX, groupsY, m_FroxelSize[2]);
+	m_pContext->CSSetUnorderedAccessViews(0, 1, &nullUAV, nullptr);
+	m_Profiler.EndScope("Froxel Inject");
 
-void Renderer::Initialize(ID3D11Device* device, ID3D11DeviceContext* context, ResourceManager* pResMgr)
+	// 2. Front-to-back integration, one thread per column
+	m_Profiler.BeginScope("Froxel Integrate");
+	m_pContext->CSSetShader(m_FroxelIntegrateCS.Get(), nullptr, 0);
+	m_pContext->CSSetShaderResources(5, 1, m_FroxelScatterSRV.GetAddressOf());
+	m_pContext->CSSetUnorderedAccessViews(0, 1, m_FroxelIntegratedUAV.GetAddressOf(), nullptr);
+	m_pContext->Dispatch(groupsX, groupsY, 1);
+	m_pContext->CSSetUnorderedAccessViews(0, 1, &nullUAV, nullptr);
+	m_pContext->CSSetShaderResources(5, 1, &nullSRV);
+	m_pContext->CSSetShader(nullptr, nullptr, 0);
+	m_Profiler.EndScope("Froxel Integrate");
+
+	// 3. One lookup per pixel
+	m_Profiler.BeginScope("Froxel Resolve");
+	m_pContext->PSSetShader(m_FroxelResolvePS.Get(), nullptr, 0);
+	m_pContext->PSSetShaderResources(5, 1, m_FroxelIntegratedSRV.GetAddressOf());
+	m_pContext->Draw(3, 0);
+	m_pContext->PSSetShaderResources(5, 1, &nullSRV);
+	m_Profiler.EndScope("Froxel Resolve");
+}
+
+void Renderer::StartFroxelBenchmark()
 {
-	m_pDevice = device;
-	m_pContext = context;
-	m_pResMgr = pResMgr;
+	m_BenchmarkPhase = BenchmarkPhase::PerPixel;
+	m_BenchmarkPerPixelMs = 0.0;
+	m_BenchmarkFroxelMs = 0.0;
+	m_BenchmarkPerPixelFrames = 0;
+	m_BenchmarkFroxelFrames = 0;
+}
 
-	CreateShader();
-	CreateTexture();
-	CreateSamplerState();
-	//CreateQuadVertexBuffer();
+void Renderer::UpdateFroxelBenchmark()
+{
+	if (m_BenchmarkPhase == BenchmarkPhase::Idle) return;
+
+	// Resolved frames lag behind the phase, so they are sorted by the scopes they contain
+	float perPixel = m_Profiler.GetLastTime("Cloud");
+	float inject = m_Profiler.GetLastTime("Froxel Inject");
+	float integrate = m_Profiler.GetLastTime("Froxel Integrate");
+	float resolve = m_Profiler.GetLastTime("Froxel Resolve");
+
+	if (perPixel >= 0.0f && m_BenchmarkPerPixelFrames < BenchmarkFrames)
+	{
+		m_BenchmarkPerPixelMs += perPixel;
+		m_BenchmarkPerPixelFrames++;
+	}
+	else if (inject >= 0.0f && integrate >= 0.0f && resolve >= 0.0f && m_BenchmarkFroxelFrames < BenchmarkFrames)
+	{
+		m_BenchmarkFroxelMs += inject + integrate + resolve;
+		m_BenchmarkFroxelFrames++;
+	}
+
+	if (m_BenchmarkPhase == BenchmarkPhase::PerPixel && m_BenchmarkPerPixelFrames >= BenchmarkFrames)
+		m_BenchmarkPhase = BenchmarkPhase::Froxel;
+
+	if (m_BenchmarkFroxelFrames < BenchmarkFrames) return;
+
+	m_BenchmarkPhase = BenchmarkPhase::Idle;
+	m_FroxelBenchmark.bValid = true;
+	m_FroxelBenchmark.Frames = BenchmarkFrames;
+	m_FroxelBenchmark.PerPixelMs = (float)(m_BenchmarkPerPixelMs / BenchmarkFrames);
+	m_FroxelBenchmark.FroxelMs = (float)(m_BenchmarkFroxelMs / BenchmarkFrames);
+
+	char buffer[256];
+	sprintf_s(buffer, "[FroxelBenchmark] %dx%dx%d froxels: per-pixel %.3f ms, froxel %.3f ms (%.2fx)\n",
+		m_FroxelSize[0], m_FroxelSize[1], m_FroxelSize[2], m_FroxelBenchmark.PerPixelMs, m_FroxelBenchmark.FroxelMs,
+		m_FroxelBenchmark.PerPixelMs / std::max(m_FroxelBenchmark.FroxelMs, 1e-3f));
+	OutputDebugStringA(buffer);
 }
 
-void Renderer::CreateShader()
+void Renderer::CreateStatsBuffer()
 {
-	ID3DBlob* vsBlob = nullptr;
-	ID3DBlob* psBlob = nullptr;
-	ID3DBlob* csBlob = nullptr;
+	D3D11_BUFFER_DESC bufferDesc = {};
+	bufferDesc.ByteWidth = sizeof(CloudStats);
+	bufferDesc.Usage = D3D11_USAGE_DEFAULT;
+	bufferDesc.BindFlags = D3D11_BIND_UNORDERED_ACCESS;
+	bufferDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_ALLOW_RAW_VIEWS;
 
-	if (SUCCEEDED(CompileShader(L"FullScreenVS.hlsl", "vs_5_0", &vsBlob)))
+	ThrowIfFailed(m_pDevice->CreateBuffer(&bufferDesc, nullptr, &m_StatsBuffer));
+
+	D3D11_UNORDERED_ACCESS_VIEW_DESC uavDesc = {};
+	uavDesc.Format = DXGI_FORMAT_R32_TYPELESS;
+	uavDesc.ViewDimension = D3D11_UAV_DIMENSION_BUFFER;
+	uavDesc.Buffer.NumElements = sizeof(CloudStats) / 4;
+	uavDesc.Buffer.Flags = D3D11_BUFFER_UAV_FLAG_RAW;
+
+	ThrowIfFailed(m_pDevice->CreateUnorderedAccessView(m_StatsBuffer.Get(), &uavDesc, &m_StatsUAV));
+
+	// Staging ring so the CPU never waits on the frame that is still in flight
+	bufferDesc.Usage = D3D11_USAGE_STAGING;
+	bufferDesc.BindFlags = 0;
+	bufferDesc.MiscFlags = 0;
+	bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+
+	for (UINT i = 0; i < StatsLatency; i++)
 	{
-		m_pDevice->CreateVertexShader(
-			vsBlob->GetBufferPointer(),
-			vsBlob->GetBufferSize(),
-			nullptr,
-			&m_FullScreenVS
-		);
+		ThrowIfFailed(m_pDevice->CreateBuffer(&bufferDesc, nullptr, &m_StatsStaging[i]));
+	}
+}
 
-		//// Define Input Layout
-		//D3D11_INPUT_ELEMENT_DESC layout[] =
-		//{
-		//	{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 }
-		//};
+void Renderer::CreateSceneStatsBuffer()
+{
+	D3D11_BUFFER_DESC bufferDesc = {};
+	bufferDesc.ByteWidth = SdfScene::TraceStatSlots * sizeof(uint32_t);
+	bufferDesc.Usage = D3D11_USAGE_DEFAULT;
+	bufferDesc.BindFlags = D3D11_BIND_UNORDERED_ACCESS;
+	bufferDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_ALLOW_RAW_VIEWS;
 
-		//m_pDevice->CreateInputLayout(layout, ARRAYSIZE(layout), vertexshaderCSO->GetBufferPointer(), vertexshaderCSO->GetBufferSize(), &m_InputLayout);
+	ThrowIfFailed(m_pDevice->CreateBuffer(&bufferDesc, nullptr, &m_SceneStatsBuffer));
 
-		//m_Stride = sizeof(Vertex);
+	D3D11_UNORDERED_ACCESS_VIEW_DESC uavDesc = {};
+	uavDesc.Format = DXGI_FORMAT_R32_TYPELESS;
+	uavDesc.ViewDimension = D3D11_UAV_DIMENSION_BUFFER;
+	uavDesc.Buffer.NumElements = SdfScene::TraceStatSlots;
+	uavDesc.Buffer.Flags = D3D11_BUFFER_UAV_FLAG_RAW;
+
+	ThrowIfFailed(m_pDevice->CreateUnorderedAccessView(m_SceneStatsBuffer.Get(), &uavDesc, &m_SceneStatsUAV));
+
+	bufferDesc.Usage = D3D11_USAGE_STAGING;
+	bufferDesc.BindFlags = 0;
+	bufferDesc.MiscFlags = 0;
+	bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+
+	for (UINT i = 0; i < StatsLatency; i++)
+	{
+		ThrowIfFailed(m_pDevice->CreateBuffer(&bufferDesc, nullptr, &m_SceneStatsStaging[i]));
 	}
+}
 
-	if (SUCCEEDED(CompileShader(L"Distance2DPS.hlsl", "ps_5_0", &psBlob)))
+void Renderer::CreateDenoiseConstantBuffer()
+{
+	D3D11_BUFFER_DESC bufferDesc = {};
+	bufferDesc.ByteWidth = sizeof(DenoiseConstants);
+	bufferDesc.Usage = D3D11_USAGE_DYNAMIC; // Rewritten per a-trous iteration
+	bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	bufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+
+	ThrowIfFailed(m_pDevice->CreateBuffer(&bufferDesc, nullptr, &m_DenoiseConstantBuffer));
+}
+
+void Renderer::ReadCloudStats()
+{
+	m_pContext->CopyResource(m_StatsStaging[m_StatsFrame % StatsLatency].Get(), m_StatsBuffer.Get());
+	m_StatsFrame++;
+
+	if (m_StatsFrame < StatsLatency) return;
+
+	// Oldest copy in the ring; skip this frame rather than stall if the GPU is not done with it yet
+	ID3D11Buffer* staging = m_StatsStaging[m_StatsFrame % StatsLatency].Get();
+	D3D11_MAPPED_SUBRESOURCE msr;
+	if (m_pContext->Map(staging, 0, D3D11_MAP_READ, D3D11_MAP_FLAG_DO_NOT_WAIT, &msr) == S_OK)
 	{
-		m_pDevice->CreatePixelShader(psBlob->GetBufferPointer(), psBlob->GetBufferSize(), nullptr, &m_Distance2DPS);
-		psBlob->Release();
-		psBlob = nullptr;
+		memcpy(&m_CloudStats, msr.pData, sizeof(CloudStats));
+		m_pContext->Unmap(staging, 0);
 	}
-	if (SUCCEEDED(CompileShader(L"Distance3DPS.hlsl", "ps_5_0", &psBlob)))
+}
+
+void Renderer::ReadSceneStats()
+{
+	m_pContext->CopyResource(m_SceneStatsStaging[m_SceneStatsFrame % StatsLatency].Get(), m_SceneStatsBuffer.Get());
+	m_SceneStatsFrame++;
+
+	if (m_SceneStatsFrame < StatsLatency) return;
+
+	ID3D11Buffer* staging = m_SceneStatsStaging[m_SceneStatsFrame % StatsLatency].Get();
+	D3D11_MAPPED_SUBRESOURCE msr;
+	if (m_pContext->Map(staging, 0, D3D11_MAP_READ, D3D11_MAP_FLAG_DO_NOT_WAIT, &msr) == S_OK)
 	{
-		m_pDevice->CreatePixelShader(psBlob->GetBufferPointer(), psBlob->GetBufferSize(), nullptr, &m_Distance3DPS);
-		psBlob->Release();
-		psBlob = nullptr;
+		m_SdfScene.ReportTraceCounters((const uint32_t*)msr.pData);
+		m_pContext->Unmap(staging, 0);
 	}
+}
 
-	if (SUCCEEDED(CompileShader(L"CloudPS.hlsl", "ps_5_0", &psBlob)))
+void Renderer::MeasureMarchError(Constant& constant)
+{
+	if (!m_bMeasureMarchError) return;
+	m_bMeasureMarchError = false;
+
+	if (!m_Scene.bCloud || !m_CloudStatsPS || !m_MarchErrorCS) return;
+
+	UINT width = (UINT)constant.m_GlobalConstants.Resolution.x;
+	UINT height = (UINT)constant.m_GlobalConstants.Resolution.y;
+	CreateProbeTargets(width, height);
+
+	// The frame's own target and the cloud settings are restored afterwards
+	ComPtr<ID3D11RenderTargetView> frameRTV;
+	ComPtr<ID3D11DepthStencilView> frameDSV;
+	m_pContext->OMGetRenderTargets(1, &frameRTV, &frameDSV);
+
+	// Resolution follows the cloud render scale, so the probes do too
+	UINT viewportCount = 1;
+	D3D11_VIEWPORT frameViewport = {};
+	m_pContext->RSGetViewports(&viewportCount, &frameViewport);
+	D3D11_VIEWPORT probeViewport = frameViewport;
+	probeViewport.Width = (float)width;
+	probeViewport.Height = (float)height;
+	m_pContext->RSSetViewports(1, &probeViewport);
+
+	// Compare at the step counts set in the GUI, not the governor's reduced ones
+	float savedPrimaryScale = constant.GetPrimaryStepScale();
+	float savedLightScale = constant.GetLightStepScale();
+	constant.SetStepScale(1.0f, 1.0f);
+
+	Constant::CloudConstants saved = constant.m_CloudConstants;
+	constant.m_CloudConstants.SceneDepthEnabled = 0;   // The probes render the clouds alone
+	auto renderVariant = [&](ProbeImage image, uint32_t marchMode, uint32_t steps)
 	{
-		m_pDevice->CreatePixelShader(psBlob->GetBufferPointer(), psBlob->GetBufferSize(), nullptr, &m_CloudPS);
-		psBlob->Release();
-		psBlob = nullptr;
+		constant.m_CloudConstants.MarchMode = marchMode;
+		constant.m_CloudConstants.PrimarySteps = steps;
+		constant.UpdateCloud();
+		return RenderProbeImage(image);
+	};
+
+	m_pContext->PSSetShader(m_CloudStatsPS.Get(), nullptr, 0);
+
+	// Same Time and therefore the same dithering in all three images; the reference marches every light sample
+	constant.m_CloudConstants.LightCacheEnabled = 0;
+	m_MarchError.ReferenceDensityCalls = renderVariant(ProbeReference, Constant::MarchUniform, ReferenceSteps);
+	constant.m_CloudConstants.LightCacheEnabled = saved.LightCacheEnabled;
+	m_MarchError.ImportanceDensityCalls = renderVariant(ProbeImportance, Constant::MarchImportance, saved.PrimarySteps);
+	m_MarchError.UniformDensityCalls = renderVariant(ProbeUniform, Constant::MarchUniform, saved.PrimarySteps);
+
+	constant.m_CloudConstants = saved;
+	constant.SetStepScale(savedPrimaryScale, savedLightScale);
+	constant.UpdateCloud();
+
+	m_pContext->OMSetRenderTargets(1, frameRTV.GetAddressOf(), frameDSV.Get());
+	m_pContext->RSSetViewports(1, &frameViewport);
+	m_pContext->PSSetShader(m_bCollectCloudStats ? m_CloudStatsPS.Get() : m_CloudPS.Get(), nullptr, 0);
+
+	double channels = (double)width * height * 3.0;
+	m_MarchError.ImportanceRmse = (float)sqrt(ComputeProbeError(ProbeImportance) / channels);
+	m_MarchError.UniformRmse = (float)sqrt(ComputeProbeError(ProbeUniform) / channels);
+	m_MarchError.bValid = true;
+
+	char buffer[256];
+	sprintf_s(buffer, "[MarchError] %u steps: importance RMSE %.5f (%u density calls), uniform RMSE %.5f (%u), reference %u\n",
+		saved.PrimarySteps, m_MarchError.ImportanceRmse, m_MarchError.ImportanceDensityCalls,
+		m_MarchError.UniformRmse, m_MarchError.UniformDensityCalls, m_MarchError.ReferenceDensityCalls);
+	OutputDebugStringA(buffer);
+}
+
+void Renderer::CreateProbeTargets(UINT width, UINT height)
+{
+	if (m_ProbeWidth == width && m_ProbeHeight == height) return;
+	m_ProbeWidth = width;
+	m_ProbeHeight = height;
+
+	D3D11_TEXTURE2D_DESC texDesc = {};
+	texDesc.Width = width;
+	texDesc.Height = height;
+	texDesc.MipLevels = 1;
+	texDesc.ArraySize = 1;
+	texDesc.Format = DXGI_FORMAT_R16G16B16A16_FLOAT; // Keeps the small differences that 8 bit would round away
+	texDesc.SampleDesc.Count = 1;
+	texDesc.Usage = D3D11_USAGE_DEFAULT;
+	texDesc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
+
+	for (UINT i = 0; i < ProbeImageCount; i++)
+	{
+		ThrowIfFailed(m_pDevice->CreateTexture2D(&texDesc, nullptr, m_ProbeTextures[i].ReleaseAndGetAddressOf()));
+		ThrowIfFailed(m_pDevice->CreateRenderTargetView(m_ProbeTextures[i].Get(), nullptr, m_ProbeRTVs[i].ReleaseAndGetAddressOf()));
+		ThrowIfFailed(m_pDevice->CreateShaderResourceView(m_ProbeTextures[i].Get(), nullptr, m_ProbeSRVs[i].ReleaseAndGetAddressOf()));
 	}
 
-	if (SUCCEEDED(CompileShader(L"NoiseBaker.hlsl", "cs_5_0", &csBlob)))
+	// One float per 16x16 group of MarchErrorCS
+	UINT groups = ((width + 15) / 16) * ((height + 15) / 16);
+
+	D3D11_BUFFER_DESC bufferDesc = {};
+	bufferDesc.ByteWidth = groups * sizeof(float);
+	bufferDesc.Usage = D3D11_USAGE_DEFAULT;
+	bufferDesc.BindFlags = D3D11_BIND_UNORDERED_ACCESS;
+	bufferDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+	bufferDesc.StructureByteStride = sizeof(float);
+
+	ThrowIfFailed(m_pDevice->CreateBuffer(&bufferDesc, nullptr, m_ProbeSumBuffer.ReleaseAndGetAddressOf()));
+	ThrowIfFailed(m_pDevice->CreateUnorderedAccessView(m_ProbeSumBuffer.Get(), nullptr, m_ProbeSumUAV.ReleaseAndGetAddressOf()));
+
+	bufferDesc.Usage = D3D11_USAGE_STAGING;
+	bufferDesc.BindFlags = 0;
+	bufferDesc.MiscFlags = 0;
+	bufferDesc.StructureByteStride = 0;
+	bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+
+	ThrowIfFailed(m_pDevice->CreateBuffer(&bufferDesc, nullptr, m_ProbeSumStaging.ReleaseAndGetAddressOf()));
+
+	if (!m_ProbeStatsStaging)
 	{
-		ThrowIfFailed(m_pDevice->CreateComputeShader(csBlob->GetBufferPointer(), csBlob->GetBufferSize(), nullptr, &m_NoiseBakerCS));
-		csBlob->Release();
-		csBlob = nullptr;
+		bufferDesc.ByteWidth = sizeof(CloudStats);
+		ThrowIfFailed(m_pDevice->CreateBuffer(&bufferDesc, nullptr, &m_ProbeStatsStaging));
 	}
+}
 
-	if (vsBlob) vsBlob->Release();
+uint32_t Renderer::RenderProbeImage(ProbeImage image)
+{
+	const float black[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+	m_pContext->ClearRenderTargetView(m_ProbeRTVs[image].Get(), black);
+
+	UINT zeros[4] = { 0, 0, 0, 0 };
+	m_pContext->ClearUnorderedAccessViewUint(m_StatsUAV.Get(), zeros);
+
+	ID3D11UnorderedAccessView* uavs[] = { m_StatsUAV.Get() };
+	m_pContext->OMSetRenderTargetsAndUnorderedAccessViews(1, m_ProbeRTVs[image].GetAddressOf(), nullptr, 2, 1, uavs, nullptr);
+	m_pContext->Draw(3, 0);
+	m_pContext->OMSetRenderTargets(0, nullptr, nullptr);
+
+	m_pContext->CopyResource(m_ProbeStatsStaging.Get(), m_StatsBuffer.Get());
+
+	CloudStats stats = {};
+	D3D11_MAPPED_SUBRESOURCE msr;
+	if (SUCCEEDED(m_pContext->Map(m_ProbeStatsStaging.Get(), 0, D3D11_MAP_READ, 0, &msr)))
+	{
+		memcpy(&stats, msr.pData, sizeof(CloudStats));
+		m_pContext->Unmap(m_ProbeStatsStaging.Get(), 0);
+	}
+	return stats.PrimaryDensity + stats.LightDensity;
 }
 
-void Renderer::PrepareShader()
+double Renderer::ComputeProbeError(ProbeImage image)
 {
-	m_pContext->VSSetShader(m_FullScreenVS.Get(), nullptr, 0);
+	ID3D11ShaderResourceView* srvs[] = { m_ProbeSRVs[image].Get(), m_ProbeSRVs[ProbeReference].Get() };
 
-	if (m_Scene.bDistance2D)
-		m_pContext->PSSetShader(m_Distance2DPS.Get(), nullptr, 0);
-	if (m_Scene.bDistance3D)
-		m_pContext->PSSetShader(m_Distance3DPS.Get(), nullptr, 0);
-	if (m_Scene.bCloud)
+	m_pContext->CSSetShader(m_MarchErrorCS.Get(), nullptr, 0);
+	m_pContext->CSSetShaderResources(0, 2, srvs);
+	m_pContext->CSSetUnorderedAccessViews(0, 1, m_ProbeSumUAV.GetAddressOf(), nullptr);
+
+	UINT groupsX = (m_ProbeWidth + 15) / 16;
+	UINT groupsY = (m_ProbeHeight + 15) / 16;
+	m_pContext->Dispatch(groupsX, groupsY, 1);
+
+	ID3D11ShaderResourceView* nullSRVs[2] = { nullptr, nullptr };
+	ID3D11UnorderedAccessView* nullUAV = nullptr;
+	m_pContext->CSSetShaderResources(0, 2, nullSRVs);
+	m_pContext->CSSetUnorderedAccessViews(0, 1, &nullUAV, nullptr);
+	m_pContext->CSSetShader(nullptr, nullptr, 0);
+
+	m_pContext->CopyResource(m_ProbeSumStaging.Get(), m_ProbeSumBuffer.Get());
+
+	double sum = 0.0;
+	D3D11_MAPPED_SUBRESOURCE msr;
+	if (SUCCEEDED(m_pContext->Map(m_ProbeSumStaging.Get(), 0, D3D11_MAP_READ, 0, &msr)))
 	{
-		m_pContext->PSSetShader(m_CloudPS.Get(), nullptr, 0);
-		m_pContext->PSSetShaderResources(0, 1, m_CloudMapSRV.GetAddressOf());
-		m_pContext->PSSetShaderResources(1, 1, m_pResMgr->GetTexture("BlueNoise"));
-		m_pContext->PSSetSamplers(0, 1, m_LinearSampler.GetAddressOf());
+		const float* partial = (const float*)msr.pData;
+		for (UINT i = 0; i < groupsX * groupsY; i++)
+		{
+			sum += partial[i];
+		}
+		m_pContext->Unmap(m_ProbeSumStaging.Get(), 0);
+	}
+	return sum;
+}
+
+void Renderer::ExportMesh(const Constant& constant, const WeatherMap& weather)
+{
+	if (!m_bExportMesh && !m_bBenchmarkMesh) return;
+	bool bBenchmark = m_bBenchmarkMesh;
+	m_bExportMesh = false;
+	m_bBenchmarkMesh = false;
+
+	bool bDensity = m_MeshExport.Source == 1;
+	int limit = bDensity ? MaxDensityResolution : (int)MeshExtractor::MaxResolution;
+
+	// The SDF field is sampled on the fly; the density one from a grid the GPU fills at the mesh resolution
+	auto extract = [&](UINT resolution, MeshExtractor::Mesh& mesh, float& sampleMs)
+	{
+		sampleMs = 0.0f;
+		MeshExtractor::Field field;
+		if (bDensity)
+		{
+			double start = GetSeconds();
+			if (!SampleDensityGrid(constant, weather, resolution, m_DensityGrid)) return false;
+			sampleMs = (float)((GetSeconds() - start) * 1000.0);
+			field = MeshExtractor::MakeField(m_DensityGrid, -m_MeshExport.DensityIso);
+
+			// Cells on the samples, apron included
+			resolution = (std::max)(m_DensityGrid.Size[0], (std::max)(m_DensityGrid.Size[1], m_DensityGrid.Size[2])) - 1;
+		}
+		else if (!GetSdfField(field))
+		{
+			return false;
+		}
+		return m_MeshExtractor.Extract(field, resolution, mesh);
+	};
+
+	char buffer[256];
+	if (bBenchmark)
+	{
+		m_MeshBenchmark.clear();
+		for (int resolution : MeshBenchmarkResolutions)
+		{
+			if (resolution > limit) break;
 
-		ID3D11SamplerState* samplers[] = { m_LinearSampler.Get(), m_PointSampler.Get() };
-		m_pContext->PSSetSamplers(0, 2, samplers);
+			MeshExtractor::Mesh mesh;
+			float sampleMs;
+			if (!extract((UINT)resolution, mesh, sampleMs)) break;
+
+			const MeshExtractor::Stats& stats = m_MeshExtractor.GetStats();
+			m_MeshBenchmark.push_back(stats);
+
+			sprintf_s(buffer, "[Mesh] %d: %d/%d blocks, %d triangles in %.1f ms (%.2f M/s), peak %.1f MB, file %.1f MB\n",
+				resolution, stats.SampledBlocks, stats.Blocks, stats.Triangles, stats.Ms, stats.TrianglesPerSec * 1e-6,
+				stats.PeakBytes / (1024.0 * 1024.0), stats.FileBytes / (1024.0 * 1024.0));
+			OutputDebugStringA(buffer);
+		}
+		m_DensityGrid = MeshExtractor::GridField();
+		return;
 	}
-	//m_pContext->IASetInputLayout(m_InputLayout.Get());
 
+	MeshExtractor::Mesh mesh;
+	m_MeshReport = MeshExportReport();
+	if (!extract((UINT)(std::min)(m_MeshExport.Resolution, limit), mesh, m_MeshReport.SampleMs)) return;
+
+	m_MeshReport.Stats = m_MeshExtractor.GetStats();
+	m_MeshReport.Path = bDensity ? "mesh_cloud.tfms" : "mesh_sdf.tfms";
+	m_MeshReport.bSaved = MeshExtractor::SaveMesh(mesh, m_MeshReport.Path);
+	m_MeshReport.bValid = true;
+	m_DensityGrid = MeshExtractor::GridField();
+
+	sprintf_s(buffer, "[Mesh] %s: %d vertices, %d triangles in %.1f ms%s\n", m_MeshReport.Path.c_str(),
+		m_MeshReport.Stats.Vertices, m_MeshReport.Stats.Triangles, m_MeshReport.Stats.Ms, m_MeshReport.bSaved ? "" : " (save failed)");
+	OutputDebugStringA(buffer);
 }
 
-void Renderer::Render()
+bool Renderer::GetSdfField(MeshExtractor::Field& field)
 {
-	UINT offset = 0;
-	m_pContext->IASetVertexBuffers(0, 1, m_VertexBuffer.GetAddressOf(), &m_Stride, &offset);
-	m_pContext->Draw(3, 0);
+	Vector3 boundsMin, boundsMax;
+	if (!m_SdfScene.GetBounds(boundsMin, boundsMax)) return false;
+
+	// A margin so the surface never touches the border cells, which get no quads
+	Vector3 margin = (boundsMax - boundsMin) * 0.02f + Vector3(0.01f, 0.01f, 0.01f);
+	field.Min = boundsMin - margin;
+	field.Max = boundsMax + margin;
+	field.IsoLevel = 0.0f;
+
+	const SdfScene* scene = &m_SdfScene;
+	field.Sample = [scene](const SdfKernels::Points& points, float* out)
+	{
+		thread_local std::vector<UINT> groups;
+		thread_local std::vector<float> distances;
+
+		Vector3 batchMin(FLT_MAX, FLT_MAX, FLT_MAX);
+		Vector3 batchMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+		for (UINT i = 0; i < points.Count; i++)
+		{
+			Vector3 p(points.X[i], points.Y[i], points.Z[i]);
+			batchMin = Vector3::Min(batchMin, p);
+			batchMax = Vector3::Max(batchMax, p);
+		}
+
+		// Groups past the clamp cannot move a sample across zero, so distances are only exact near the surface
+		Vector3 extent = batchMax - batchMin;
+		float clamp = (std::max)(extent.x, (std::max)(extent.y, extent.z)) * 0.125f;
+		Vector3 apron(clamp, clamp, clamp);
+		scene->GatherGroups(batchMin - apron, batchMax + apron, groups);
+
+		for (UINT i = 0; i < points.Count; i++)
+			out[i] = clamp;
+
+		distances.resize(points.Count);
+		for (UINT group : groups)
+		{
+			scene->GetGroupDistances(group, points, distances.data());
+			for (UINT i = 0; i < points.Count; i++)
+				out[i] = (std::min)(out[i], distances[i]);
+		}
+	};
+
+	// A distance field changes by at most the distance moved, so a box farther than its half diagonal is one-sided
+	field.MayCross = [scene](const Vector3& boxMin, const Vector3& boxMax)
+	{
+		float d = scene->GetDistance((boxMin + boxMax) * 0.5f);
+		return fabsf(d) <= (boxMax - boxMin).Length() * 0.5f;
+	};
+	return true;
+}
+
+bool Renderer::SampleDensityGrid(const Constant& constant, const WeatherMap& weather, UINT resolution, MeshExtractor::GridField& grid)
+{
+	if (!m_DensityGridCS) return false;
+
+	// Region getCloudSegment marches in the current layer mode
+	const auto& cloud = constant.m_CloudConstants;
+	const auto& weatherConstants = weather.m_WeatherConstants;
+	const Vector3& cameraPos = constant.m_GlobalConstants.CameraPos;
+	float halfExtent = m_MeshExport.DensityExtent * 0.5f;
+
+	Vector3 regionMin, regionMax;
+	if (weatherConstants.Enabled)
+	{
+		halfExtent = (std::min)(halfExtent, weatherConstants.MaxDistance);
+		regionMin = Vector3(cameraPos.x - halfExtent, weatherConstants.LayerBottom, cameraPos.z - halfExtent);
+		regionMax = Vector3(cameraPos.x + halfExtent, weatherConstants.LayerTop, cameraPos.z + halfExtent);
+	}
+	else if (cloud.LayerMode == Constant::LayerBox)
+	{
+		regionMin = Vector3(-CloudExtent.x, 0.0f, -CloudExtent.z);
+		regionMax = CloudExtent;
+	}
+	else
+	{
+		regionMin = Vector3(cameraPos.x - halfExtent, cloud.ShellBottom, cameraPos.z - halfExtent);
+		regionMax = Vector3(cameraPos.x + halfExtent, cloud.ShellTop, cameraPos.z + halfExtent);
+
+		// The shell curves down away from the point above the planet centre: lowest at the farthest corner
+		if (cloud.LayerMode == Constant::LayerShell)
+		{
+			float farX = (std::max)(fabsf(regionMin.x), fabsf(regionMax.x));
+			float farZ = (std::max)(fabsf(regionMin.z), fabsf(regionMax.z));
+			float bottomRadius = cloud.PlanetRadius + cloud.ShellBottom;
+			float reach = farX * farX + farZ * farZ;
+			regionMin.y = reach < bottomRadius * bottomRadius ? sqrtf(bottomRadius * bottomRadius - reach) - cloud.PlanetRadius : -cloud.PlanetRadius;
+		}
+	}
+
+	// One sample past the region on each side, so density that reaches the border still closes
+	Vector3 extent = regionMax - regionMin;
+	float spacing = (std::max)(extent.x, (std::max)(extent.y, extent.z)) / resolution;
+	regionMin -= Vector3(spacing, spacing, spacing);
+	regionMax += Vector3(spacing, spacing, spacing);
+	extent = regionMax - regionMin;
+
+	grid.Origin = regionMin;
+	grid.Spacing = spacing;
+	grid.Size[0] = (UINT)ceilf(extent.x / spacing) + 1;
+	grid.Size[1] = (UINT)ceilf(extent.y / spacing) + 1;
+	grid.Size[2] = (UINT)ceilf(extent.z / spacing) + 1;
+	const UINT count = grid.Size[0] * grid.Size[1] * grid.Size[2];
+
+	ComPtr<ID3D11Buffer> gridBuffer, stagingBuffer, constantBuffer;
+	ComPtr<ID3D11UnorderedAccessView> gridUAV;
+
+	D3D11_BUFFER_DESC bufferDesc = {};
+	bufferDesc.ByteWidth = count * sizeof(float);
+	bufferDesc.Usage = D3D11_USAGE_DEFAULT;
+	bufferDesc.BindFlags = D3D11_BIND_UNORDERED_ACCESS;
+	bufferDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+	bufferDesc.StructureByteStride = sizeof(float);
+	ThrowIfFailed(m_pDevice->CreateBuffer(&bufferDesc, nullptr, &gridBuffer));
+
+	D3D11_UNORDERED_ACCESS_VIEW_DESC uavDesc = {};
+	uavDesc.Format = DXGI_FORMAT_UNKNOWN;
+	uavDesc.ViewDimension = D3D11_UAV_DIMENSION_BUFFER;
+	uavDesc.Buffer.NumElements = count;
+	ThrowIfFailed(m_pDevice->CreateUnorderedAccessView(gridBuffer.Get(), &uavDesc, &gridUAV));
+
+	bufferDesc.Usage = D3D11_USAGE_STAGING;
+	bufferDesc.BindFlags = 0;
+	bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+	ThrowIfFailed(m_pDevice->CreateBuffer(&bufferDesc, nullptr, &stagingBuffer));
+
+	D3D11_BUFFER_DESC constantDesc = {};
+	constantDesc.ByteWidth = sizeof(DensityGridConstants);
+	constantDesc.Usage = D3D11_USAGE_DYNAMIC;
+	constantDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	constantDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	ThrowIfFailed(m_pDevice->CreateBuffer(&constantDesc, nullptr, &constantBuffer));
+
+	// b0-b2 and the weather views are still bound from the frame
+	ID3D11SamplerState* samplers[] = { m_LinearSampler.Get(), m_PointSampler.Get(), m_LinearClampSampler.Get() };
+	m_pContext->CSSetShaderResources(0, 1, m_CloudMapSRV.GetAddressOf());
+	m_pContext->CSSetSamplers(0, 3, samplers);
+	m_pContext->CSSetConstantBuffers(7, 1, constantBuffer.GetAddressOf());
+	m_pContext->CSSetShader(m_DensityGridCS.Get(), nullptr, 0);
+	m_pContext->CSSetUnorderedAccessViews(0, 1, gridUAV.GetAddressOf(), nullptr);
+
+	const UINT slabSlices = 16;
+	for (UINT slice = 0; slice < grid.Size[2]; slice += slabSlices)
+	{
+		DensityGridConstants constants = {};
+		constants.GridMin[0] = regionMin.x;
+		constants.GridMin[1] = regionMin.y;
+		constants.GridMin[2] = regionMin.z;
+		constants.Spacing = spacing;
+		constants.Size[0] = grid.Size[0];
+		constants.Size[1] = grid.Size[1];
+		constants.Size[2] = grid.Size[2];
+		constants.SliceOffset = slice;
+
+		D3D11_MAPPED_SUBRESOURCE msr;
+		if (SUCCEEDED(m_pContext->Map(constantBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &msr)))
+		{
+			memcpy(msr.pData, &constants, sizeof(DensityGridConstants));
+			m_pContext->Unmap(constantBuffer.Get(), 0);
+		}
+
+		UINT slices = (std::min)(slabSlices, grid.Size[2] - slice);
+		m_pContext->Dispatch((grid.Size[0] + 3) / 4, (grid.Size[1] + 3) / 4, (slices + 3) / 4);
+	}
+
+	ID3D11UnorderedAccessView* nullUAV = nullptr;
+	ID3D11Buffer* nullBuffer = nullptr;
+	m_pContext->CSSetUnorderedAccessViews(0, 1, &nullUAV, nullptr);
+	m_pContext->CSSetConstantBuffers(7, 1, &nullBuffer);
+	m_pContext->CSSetShader(nullptr, nullptr, 0);
+
+	m_pContext->CopyResource(stagingBuffer.Get(), gridBuffer.Get());
+
+	D3D11_MAPPED_SUBRESOURCE msr;
+	if (FAILED(m_pContext->Map(stagingBuffer.Get(), 0, D3D11_MAP_READ, 0, &msr))) return false;
+
+	grid.Values.assign((const float*)msr.pData, (const float*)msr.pData + count);
+	m_pContext->Unmap(stagingBuffer.Get(), 0);
+	return true;
+}
+
+void Renderer::Rasterize2D()
+{
+	if (!m_bRasterize2D && !m_bBenchmarkRaster2D) return;
+	bool bBenchmark = m_bBenchmarkRaster2D;
+	m_bRasterize2D = false;
+	m_bBenchmarkRaster2D = false;
+
+	UINT width = (UINT)m_Raster2D.Width, height = (UINT)m_Raster2D.Height;
+	SdfRasterizer::Settings settings;
+	settings.Mode = (SdfRasterizer::Shading)m_Raster2D.Shading;
+	settings.BandPixels = m_Raster2D.BandPixels;
+
+	char buffer[256];
+	SdfRasterizer::Image image;
+	if (bBenchmark)
+	{
+		m_Raster2DBenchmark.clear();
+		for (int count : Raster2DBenchmarkCounts)
+		{
+			std::vector<SdfKernels::Shape2D> shapes = SdfRasterizer::MakeOverlayScene((UINT)count, width, height, 7);
+
+			Raster2DBenchmarkResult result;
+			result.Shapes = count;
+			settings.bTiled = true;
+			if (!m_Rasterizer.Rasterize(shapes, width, height, settings, image)) return;
+			result.Tiled = m_Rasterizer.GetStats();
+
+			if (count <= Raster2DMaxBruteShapes)
+			{
+				settings.bTiled = false;
+				m_Rasterizer.Rasterize(shapes, width, height, settings, image);
+				result.BruteMs = m_Rasterizer.GetStats().Ms;
+			}
+			m_Raster2DBenchmark.push_back(result);
+
+			sprintf_s(buffer, "[Raster2D] %d shapes at %ux%u: tiled %.1f ms (%d edge, %d interior, %d empty tiles), brute %.1f ms\n",
+				count, width, height, result.Tiled.Ms, result.Tiled.EdgeTiles, result.Tiled.InteriorTiles, result.Tiled.EmptyTiles, result.BruteMs);
+			OutputDebugStringA(buffer);
+		}
+		return;
+	}
+
+	std::vector<SdfKernels::Shape2D> shapes = SdfRasterizer::MakeOverlayScene((UINT)m_Raster2D.ShapeCount, width, height, 7);
+	if (!m_Rasterizer.Rasterize(shapes, width, height, settings, image)) return;
+	m_Raster2DStats = m_Rasterizer.GetStats();
+
+	// A new texture per run, the size follows the settings
+	D3D11_TEXTURE2D_DESC texDesc = {};
+	texDesc.Width = width;
+	texDesc.Height = height;
+	texDesc.MipLevels = 1;
+	texDesc.ArraySize = 1;
+	texDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	texDesc.SampleDesc.Count = 1;
+	texDesc.Usage = D3D11_USAGE_IMMUTABLE;
+	texDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+	D3D11_SUBRESOURCE_DATA initData = {};
+	initData.pSysMem = image.Pixels.data();
+	initData.SysMemPitch = width * sizeof(uint32_t);
+	ThrowIfFailed(m_pDevice->CreateTexture2D(&texDesc, &initData, m_Raster2DTexture.ReleaseAndGetAddressOf()));
+	ThrowIfFailed(m_pDevice->CreateShaderResourceView(m_Raster2DTexture.Get(), nullptr, m_Raster2DSRV.ReleaseAndGetAddressOf()));
+
+	sprintf_s(buffer, "[Raster2D] %d shapes at %ux%u in %.1f ms (%.0f Mpixel/s), %llu shape evaluations\n", m_Raster2DStats.Shapes,
+		width, height, m_Raster2DStats.Ms, m_Raster2DStats.PixelsPerSec * 1e-6, (unsigned long long)m_Raster2DStats.ShapeEvaluations);
+	OutputDebugStringA(buffer);
+}
+
+void Renderer::GenerateDistanceField()
+{
+	if (!m_bGenerateDistanceField && !m_bBenchmarkDistanceField) return;
+	bool bBenchmark = m_bBenchmarkDistanceField;
+	m_bGenerateDistanceField = false;
+	m_bBenchmarkDistanceField = false;
+
+	UINT channels = (UINT)m_DistanceField.Channels;
+	char buffer[256];
+	if (bBenchmark)
+	{
+		// 8-bit output keeps a 16K field near 1 GB: mask, column distances and result
+		DistanceTransform::Settings settings;
+		settings.Output = DistanceTransform::Encoding::Unorm8;
+		settings.Spread = m_DistanceField.Spread;
+
+		m_DistanceFieldBenchmark.clear();
+		for (int size : DistanceFieldBenchmarkSizes)
+		{
+			DistanceTransform::Field field;
+			{
+				DistanceTransform::Bitmap bitmap = DistanceTransform::MakeTestBitmap((UINT)size, (UINT)size, channels, 11);
+				if (!m_DistanceTransform.Transform(bitmap, settings, field)) break;
+			}
+
+			const DistanceTransform::Stats& stats = m_DistanceTransform.GetStats();
+			m_DistanceFieldBenchmark.push_back(stats);
+
+			sprintf_s(buffer, "[DistanceTransform] %d x %d x %u: %.1f ms (columns %.1f, rows %.1f), %.1f Mpixel/s, peak %.0f MB\n",
+				size, size, channels, stats.Ms, stats.ColumnMs, stats.RowMs, stats.PixelsPerSec * 1e-6, stats.PeakBytes / (1024.0 * 1024.0));
+			OutputDebugStringA(buffer);
+		}
+		return;
+	}
+
+	UINT size = (UINT)(std::min)(m_DistanceField.Size, MaxDistanceFieldSize);
+	DistanceTransform::Bitmap bitmap = DistanceTransform::MakeTestBitmap(size, size, channels, 11);
+	DistanceTransform::Field field;
+	if (!m_DistanceTransform.Transform(bitmap, DistanceTransform::Settings(), field)) return;
+
+	m_DistanceFieldStats = m_DistanceTransform.GetStats();
+	m_DistanceFieldError = DistanceTransform::MeasureError(bitmap, field, 4096, 13);
+
+	// Float texels for Distance2DPS; the shader reads the first channel
+	D3D11_TEXTURE2D_DESC texDesc = {};
+	texDesc.Width = size;
+	texDesc.Height = size;
+	texDesc.MipLevels = 1;
+	texDesc.ArraySize = 1;
+	texDesc.Format = (channels == 1) ? DXGI_FORMAT_R32_FLOAT : DXGI_FORMAT_R32G32B32A32_FLOAT;
+	texDesc.SampleDesc.Count = 1;
+	texDesc.Usage = D3D11_USAGE_IMMUTABLE;
+	texDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+	// Two and three channels padded to four, the formats the SRV can sample as float
+	if (channels != 1 && channels != 4)
+	{
+		std::vector<float> padded((size_t)size * size * 4, 0.0f);
+		for (size_t i = 0; i < (size_t)size * size; i++)
+			for (UINT c = 0; c < channels; c++)
+				padded[i * 4 + c] = field.Distances[i * channels + c];
+		field.Distances.swap(padded);
+	}
+
+	D3D11_SUBRESOURCE_DATA initData = {};
+	initData.pSysMem = field.Distances.data();
+	initData.SysMemPitch = size * (channels == 1 ? 1 : 4) * sizeof(float);
+	ThrowIfFailed(m_pDevice->CreateTexture2D(&texDesc, &initData, m_DistanceFieldTexture.ReleaseAndGetAddressOf()));
+	ThrowIfFailed(m_pDevice->CreateShaderResourceView(m_DistanceFieldTexture.Get(), nullptr, m_DistanceFieldSRV.ReleaseAndGetAddressOf()));
+
+	sprintf_s(buffer, "[DistanceTransform] %u x %u x %u in %.1f ms, max error %.3g px against brute force\n",
+		size, size, channels, m_DistanceFieldStats.Ms, m_DistanceFieldError);
+	OutputDebugStringA(buffer);
 }
 
 void Renderer::CreateQuadVertexBuffer()
@@ -112,7 +1768,8 @@ void Renderer::CreateQuadVertexBuffer()
 	m_pDevice->CreateBuffer(&vertexbufferdesc, &vertexbufferSRD, &m_VertexBuffer);
 }
 
-HRESULT Renderer::CompileShader(const std::wstring& filename, const std::string& profile, ID3DBlob** shaderBlob)
+HRESULT Renderer::CompileShader(const std::wstring& filename, const std::string& profile, ID3DBlob** shaderBlob,
+	const D3D_SHADER_MACRO* defines)
 {
 	ID3DBlob* errorBlob = nullptr;
 
@@ -120,7 +1777,7 @@ HRESULT Renderer::CompileShader(const std::wstring& filename, const std::string&
 
 	HRESULT hr = D3DCompileFromFile(
 		path.c_str(),
-		nullptr,
+		defines,
 		D3D_COMPILE_STANDARD_FILE_INCLUDE,
 		"main",                 // Entry Point
 		profile.c_str(),        // version
@@ -147,13 +1804,14 @@ void Renderer::CreateTexture()
 	D3D11_TEXTURE2D_DESC texDesc = {};
 	texDesc.Width = 204;
 	texDesc.Height = 204;
-	texDesc.MipLevels = 1;
+	texDesc.MipLevels = NoiseMipLevels; // Coarser mips are used by the far-field LOD
 	texDesc.ArraySize = 1;
 	texDesc.Format = DXGI_FORMAT_R32G32B32A32_FLOAT; // High precision for noise data
 	texDesc.SampleDesc.Count = 1;
 	texDesc.Usage = D3D11_USAGE_DEFAULT; // GPU will both read and write
-	texDesc.BindFlags = D3D11_BIND_UNORDERED_ACCESS | D3D11_BIND_SHADER_RESOURCE;
+	texDesc.BindFlags = D3D11_BIND_UNORDERED_ACCESS | D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_RENDER_TARGET;
 	texDesc.CPUAccessFlags = 0;
+	texDesc.MiscFlags = D3D11_RESOURCE_MISC_GENERATE_MIPS; // GenerateMips needs the render target binding
 
 	// Create the Texture Resource
 	ThrowIfFailed(m_pDevice->CreateTexture2D(&texDesc, nullptr, &m_CloudMapTexture));
@@ -171,7 +1829,7 @@ void Renderer::CreateTexture()
 	srvDesc.Format = texDesc.Format;
 	srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
 	srvDesc.Texture2D.MostDetailedMip = 0;
-	srvDesc.Texture2D.MipLevels = 1;
+	srvDesc.Texture2D.MipLevels = NoiseMipLevels;
 
 	ThrowIfFailed(m_pDevice->CreateShaderResourceView(m_CloudMapTexture.Get(), &srvDesc, &m_CloudMapSRV));
 }
@@ -201,6 +1859,9 @@ void Renderer::Bake3DNoise()
 
 	// Optional: Unbind the Compute Shader to maintain a clean pipeline state
 	m_pContext->CSSetShader(nullptr, nullptr, 0);
+
+	// 5. Build the mip chain from the baked top level
+	m_pContext->GenerateMips(m_CloudMapSRV.Get());
 }
 
 void Renderer::CreateSamplerState()
@@ -222,4 +1883,11 @@ void Renderer::CreateSamplerState()
 
 	sampDesc.Filter = D3D11_FILTER_MIN_MAG_MIP_POINT;
 	m_pDevice->CreateSamplerState(&sampDesc, &m_PointSampler);
+
+	// Screen-aligned volumes must not wrap around the frustum edges
+	sampDesc.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
+	sampDesc.AddressU = D3D11_TEXTURE_ADDRESS_CLAMP;
+	sampDesc.AddressV = D3D11_TEXTURE_ADDRESS_CLAMP;
+	sampDesc.AddressW = D3D11_TEXTURE_ADDRESS_CLAMP;
+	m_pDevice->CreateSamplerState(&sampDesc, &m_LinearClampSampler);
 }
\ No newline at end of file
@@ -1,9 +1,21 @@
 #pragma once
 
+#include "GpuProfiler.h"
+#include "TileScheduler.h"
+#include "SdfScene.h"
+#include "MeshExtractor.h"
+#include "SdfRasterizer.h"
+#include "DistanceTransform.h"
+
 class ResourceManager;
+class Constant;
+class WeatherMap;
 
 class Renderer
 {
+public:
+	using Vector3 = DirectX::SimpleMath::Vector3;
+
 public:
 	Renderer() {}
 	~Renderer() {}
@@ -15,14 +27,209 @@ public:
 
 	void Initialize(ID3D11Device* device, ID3D11DeviceContext* context, ResourceManager* ResMgr);
 	void PrepareShader();
-	void Render();
+	void Render(Constant& constant);
 
+	// Distance3D together with Cloud renders the SDF scene first and clips the cloud march to its depth
 	struct Scene {
 		bool bDistance2D = false;
 		bool bDistance3D = false;
 		bool bCloud = true;
 	} m_Scene;
 
+	// Sample counters of the cloud pass, read back with a few frames of latency
+	// [Important] Slot order must match Shaders/Stats.hlsli
+	struct CloudStats
+	{
+		uint32_t LodSamples[4];      // Primary samples per LOD level
+		uint32_t PrimaryDensity;     // getDensity calls of the primary march
+		uint32_t LightDensity;       // getDensity calls of the light march
+		uint32_t Pixels;             // Pixels whose ray hit the cloud volume
+	} m_CloudStats = {};
+
+	bool m_bCollectCloudStats = false;
+
+	// Importance vs uniform marching at the same step budget, both against a 256-step uniform reference
+	struct MarchErrorReport
+	{
+		bool     bValid = false;
+		float    ImportanceRmse = 0.0f;
+		float    UniformRmse = 0.0f;
+		uint32_t ImportanceDensityCalls = 0;
+		uint32_t UniformDensityCalls = 0;
+		uint32_t ReferenceDensityCalls = 0;
+	} m_MarchError;
+
+	bool m_bMeasureMarchError = false; // Set by the GUI, handled by the next MeasureMarchError call
+
+	// Renders the three variants off screen and compares them; stalls on the readback, so only on request
+	void MeasureMarchError(Constant& constant);
+
+	// Alternative cloud path: density and lighting per froxel, integrated per column, one lookup per pixel
+	struct FroxelSettings
+	{
+		bool bEnabled = false;
+		int  Width = 160;
+		int  Height = 90;
+		int  Depth = 64;
+	} m_Froxel;
+
+	struct FroxelBenchmarkReport
+	{
+		bool  bValid = false;
+		float PerPixelMs = 0.0f;   // Average GPU time of the per-pixel march
+		float FroxelMs = 0.0f;     // Average GPU time of inject + integrate + resolve
+		int   Frames = 0;          // Frames averaged per path
+	} m_FroxelBenchmark;
+
+	// Renders BenchmarkFrames frames with each path and compares the GPU times
+	void StartFroxelBenchmark();
+	bool IsFroxelBenchmarkRunning() const { return m_BenchmarkPhase != BenchmarkPhase::Idle; }
+
+	// Spatio-temporal denoiser on the HDR cloud image, guided by transmittance and the share of steps taken
+	struct DenoiseSettings
+	{
+		bool  bEnabled = false;
+		bool  bTemporal = true;
+		int   AtrousIterations = 3;
+		float HistoryWeight = 0.9f;
+		float ClipGamma = 1.25f;
+		float TransmittanceReject = 4.0f;
+		float ColorSigma = 0.5f;
+		float TransmittanceSigma = 0.1f;
+		float StepSigma = 0.2f;
+	} m_Denoise;
+
+	// Averages jittered frames while nothing changes; the app resets it on any change, the cloud clock included
+	struct ProgressiveSettings
+	{
+		bool bEnabled = false;
+		int  MaxSamples = 256;     // Converged: the cloud pass is skipped from here on
+	} m_Progressive;
+
+	void ResetAccumulation() { m_AccumulatedSamples = 0; }
+	int GetAccumulatedSamples() const { return m_AccumulatedSamples; }
+
+	// Cloud targets are rendered at this fraction of the back buffer and upsampled by the composite
+	void SetRenderScale(float scale) { m_RenderScale = scale; }
+	float GetRenderScale() const { return m_RenderScale; }
+
+	// Coarse pass over the whole cloud image, then full-step tiles in priority order until the GPU deadline
+	TileScheduler m_Tiles;
+
+	// Density toward the sun baked over the cloud layer: shadows the SDF scene with one fetch and can stand in
+	// for the light march of the cloud passes
+	struct CloudShadowSettings
+	{
+		bool  bEnabled = true;
+		bool  bUseInMarch = false;          // Light the cloud march from the map instead of the light ray
+		int   Resolution = 256;
+		int   RowsPerFrame = 16;            // Rows re-baked per frame as the noise scrolls; all of them after a change
+		float OpenLayerExtent = 8000.0f;    // World size of the camera-centred map of the slab/shell/weather layers
+	} m_CloudShadow;
+
+	ID3D11ShaderResourceView* GetCloudShadowSRV() const { return m_CloudShadowMap.SRV.Get(); }
+
+	// Post pass: the sky seen through the clouds near the sun, radially blurred toward it and added before the tonemap
+	struct LightShaftSettings
+	{
+		bool  bEnabled = false;
+		int   Samples = 64;
+		float Density = 0.9f;        // Share of the way to the sun the blur covers
+		float Decay = 0.97f;
+		float Exposure = 0.6f;
+		float SourceRadius = 0.4f;   // Sky around the sun that emits shafts, in view heights
+	} m_LightShafts;
+
+	// Primitives and BVH traced by Distance3DPS
+	SdfScene m_SdfScene;
+
+	// Surface-net mesh of the SDF scene or of the cloud density, saved as TFMS next to the executable
+	struct MeshExportSettings
+	{
+		int   Source = 0;                // 0 = SDF scene, 1 = cloud density
+		int   Resolution = 128;          // Cells along the longest side of the region
+		float DensityIso = 0.05f;        // Density the cloud surface is drawn at
+		float DensityExtent = 1000.0f;   // World size of the camera-centred region of the slab and shell layers
+	} m_MeshExport;
+
+	struct MeshExportReport
+	{
+		bool   bValid = false;
+		bool   bSaved = false;
+		std::string Path;
+		float  SampleMs = 0.0f;          // GPU density grid and readback; 0 for the SDF scene
+		MeshExtractor::Stats Stats;
+	} m_MeshReport;
+
+	// One extraction per resolution from MeshBenchmarkResolutions, up to the source's limit
+	std::vector<MeshExtractor::Stats> m_MeshBenchmark;
+
+	bool m_bExportMesh = false;      // Set by the GUI, handled by the next ExportMesh call
+	bool m_bBenchmarkMesh = false;
+
+	// Meshes and saves the selected source, or runs the resolution sweep; stalls on the extraction
+	void ExportMesh(const Constant& constant, const WeatherMap& weather);
+
+	static constexpr int MeshBenchmarkResolutions[] = { 32, 64, 128, 256, 512 };
+	static constexpr int MaxDensityResolution = 256;   // Grid points read back: 257^3 floats at most
+
+	// CPU 2D SDF overlay from SdfRasterizer: a generated scene of panels, markers and strokes, previewed in the GUI
+	struct Raster2DSettings
+	{
+		int   Width = 2048;
+		int   Height = 2048;
+		int   ShapeCount = 1024;
+		int   Shading = 0;               // SdfRasterizer::Shading
+		float BandPixels = 48.0f;
+	} m_Raster2D;
+
+	SdfRasterizer::Stats m_Raster2DStats;   // Of the last Rasterize2D; Width is 0 until then
+
+	// Tiled against every shape at every pixel, per count in Raster2DBenchmarkCounts at the settings' size
+	struct Raster2DBenchmarkResult
+	{
+		int   Shapes = 0;
+		SdfRasterizer::Stats Tiled;
+		float BruteMs = -1.0f;           // Negative past Raster2DMaxBruteShapes
+	};
+	std::vector<Raster2DBenchmarkResult> m_Raster2DBenchmark;
+
+	bool m_bRasterize2D = false;     // Set by the GUI, handled by the next Rasterize2D call
+	bool m_bBenchmarkRaster2D = false;
+
+	// Renders the overlay and uploads it for the preview, or runs the shape count sweep; stalls on the CPU
+	void Rasterize2D();
+	ID3D11ShaderResourceView* GetRaster2DSRV() const { return m_Raster2DSRV.Get(); }
+
+	static constexpr int Raster2DBenchmarkCounts[] = { 64, 256, 1024, 4096, 16384 };
+	static constexpr int Raster2DMaxBruteShapes = 1024;
+
+	// Signed distance field of a generated mask from DistanceTransform, shown by Distance2D in place of its box
+	struct DistanceFieldSettings
+	{
+		int   Size = 2048;               // Square mask, up to MaxDistanceFieldSize
+		int   Channels = 1;              // Independent masks, 1-4
+		float Spread = 8.0f;             // Pixels either side of the edge the 8-bit benchmark output keeps
+		bool  bShowOnScreen = true;
+	} m_DistanceField;
+
+	DistanceTransform::Stats m_DistanceFieldStats;   // Of the last GenerateDistanceField; Width is 0 until then
+	float m_DistanceFieldError = 0.0f;               // Largest error in pixels against a brute-force search
+
+	// One transform per size in DistanceFieldBenchmarkSizes
+	std::vector<DistanceTransform::Stats> m_DistanceFieldBenchmark;
+
+	bool m_bGenerateDistanceField = false;   // Set by the GUI, handled by the next GenerateDistanceField call
+	bool m_bBenchmarkDistanceField = false;
+
+	// Transforms the mask and uploads the field, or runs the size sweep; stalls on the CPU
+	void GenerateDistanceField();
+
+	static constexpr int DistanceFieldBenchmarkSizes[] = { 4096, 8192, 16384 };
+	static constexpr int MaxDistanceFieldSize = 4096;   // Uploaded as float texels
+
+	GpuProfiler m_Profiler;
+
 private:
 	ID3D11Device* m_pDevice = nullptr;
 	ID3D11DeviceContext* m_pContext = nullptr;
@@ -33,10 +240,26 @@ private:
 	ComPtr<ID3D11VertexShader> m_FullScreenVS;
 
 	ComPtr<ID3D11PixelShader> m_Distance2DPS;
+	ComPtr<ID3D11PixelShader> m_Distance2DTexturePS;   // Distance2DPS compiled with SDF_TEXTURE
 	ComPtr<ID3D11PixelShader> m_Distance3DPS;
+	ComPtr<ID3D11PixelShader> m_Distance3DDepthPS; // Distance3DPS compiled with SCENE_DEPTH
+	ComPtr<ID3D11PixelShader> m_Distance3DStatsPS;      // Distance3DPS compiled with SCENE_STATS
+	ComPtr<ID3D11PixelShader> m_Distance3DDepthStatsPS; // ... with SCENE_DEPTH and SCENE_STATS
 	ComPtr<ID3D11PixelShader> m_CloudPS;
+	ComPtr<ID3D11PixelShader> m_CloudStatsPS;   // CloudPS compiled with CLOUD_STATS
+	ComPtr<ID3D11PixelShader> m_FroxelResolvePS;
+	ComPtr<ID3D11PixelShader> m_CompositePS;
 
 	ComPtr<ID3D11ComputeShader> m_NoiseBakerCS;
+	ComPtr<ID3D11ComputeShader> m_MarchErrorCS;
+	ComPtr<ID3D11ComputeShader> m_DenoiseTemporalCS;
+	ComPtr<ID3D11ComputeShader> m_DenoiseAtrousCS;
+	ComPtr<ID3D11ComputeShader> m_FroxelInjectCS;
+	ComPtr<ID3D11ComputeShader> m_FroxelIntegrateCS;
+	ComPtr<ID3D11ComputeShader> m_CloudShadowCS;
+	ComPtr<ID3D11ComputeShader> m_LightShaftCS;
+	ComPtr<ID3D11ComputeShader> m_SceneConeCS;
+	ComPtr<ID3D11ComputeShader> m_DensityGridCS;
 
 	ComPtr<ID3D11InputLayout> m_InputLayout;
 	unsigned int m_Stride;
@@ -44,16 +267,222 @@ private:
 	void CreateQuadVertexBuffer();
 	ComPtr<ID3D11Buffer> m_VertexBuffer;
 
-	HRESULT CompileShader(const std::wstring& filename, const std::string& profile, ID3DBlob** shaderBlob);
+	HRESULT CompileShader(const std::wstring& filename, const std::string& profile, ID3DBlob** shaderBlob,
+		const D3D_SHADER_MACRO* defines = nullptr);
+
+	void CreateStatsBuffer();
+	void ReadCloudStats();
+
+	// Screen-sized texture with the views its bind flags allow
+	struct RenderTexture
+	{
+		ComPtr<ID3D11Texture2D> Texture;
+		ComPtr<ID3D11RenderTargetView> RTV;
+		ComPtr<ID3D11ShaderResourceView> SRV;
+		ComPtr<ID3D11UnorderedAccessView> UAV;
+	};
+
+	void CreateRenderTexture(RenderTexture& target, UINT width, UINT height, DXGI_FORMAT format, UINT bindFlags);
+	void CreateCloudTargets(UINT width, UINT height);
+	void RenderCloud(Constant& constant);
+	void RenderCloudTiles(Constant& constant, bool bStats);
+	void Composite(const Constant& constant, ID3D11ShaderResourceView* result);
+
+	UINT m_CloudWidth = 0;
+	UINT m_CloudHeight = 0;
+	RenderTexture m_CloudColor;   // HDR radiance, a = transmittance
+	RenderTexture m_CloudGuide;   // Step share and cloud depth for the denoiser
+	RenderTexture m_SceneColor;   // Combined mode: SDF surface radiance, a = hit
+	RenderTexture m_SceneDepth;   // Combined mode: SDF hit distance along the view ray
+
+	void RenderSceneDepth(const Constant& constant);
+
+	// SDF scene trace into the bound targets: cone pre-pass, then shader (or its stats variant)
+	void DrawScene(ID3D11PixelShader* shader, ID3D11PixelShader* statsShader, UINT width, UINT height);
+	void RenderSceneCone(UINT width, UINT height);
+	RenderTexture m_SceneCone;    // Start distance per block of SdfScene::ConeTileSize pixels
+	UINT m_SceneConeWidth = 0;
+	UINT m_SceneConeHeight = 0;
+
+	// [Important] Layout must match cbDenoise in Shaders/Denoise.hlsli
+	struct DenoiseConstants
+	{
+		float    HistoryWeight;
+		float    ClipGamma;
+		float    TransmittanceReject;
+		uint32_t HistoryValid;
+
+		float    ColorSigma;
+		float    TransmittanceSigma;
+		float    StepSigma;
+		uint32_t StepWidth;
+
+		uint32_t AccumulationIndex;
+		float    Padding[3];
+	};
+
+	void CreateDenoiseConstantBuffer();
+	void UpdateDenoiseConstants(UINT stepWidth, UINT accumulationIndex = 0);
+	ID3D11ShaderResourceView* Denoise();   // Returns the view holding the filtered image
+
+	ComPtr<ID3D11Buffer> m_DenoiseConstantBuffer;
+	RenderTexture m_History[2];
+	RenderTexture m_DenoiseTemp[2];
+	UINT m_HistoryIndex = 0;
+	bool m_bHistoryValid = false;
+
+	void Accumulate();
+	ComPtr<ID3D11ComputeShader> m_ProgressiveCS;
+	RenderTexture m_Accumulation;
+	int m_AccumulatedSamples = 0;
+
+	float m_RenderScale = 1.0f;
+
+	static constexpr UINT StatsLatency = 3;
+	ComPtr<ID3D11Buffer> m_StatsBuffer;
+	ComPtr<ID3D11UnorderedAccessView> m_StatsUAV;
+	ComPtr<ID3D11Buffer> m_StatsStaging[StatsLatency];
+	UINT64 m_StatsFrame = 0;
+
+	// Iteration histogram of the scene trace, read back like the cloud stats
+	void CreateSceneStatsBuffer();
+	void ReadSceneStats();
+	ComPtr<ID3D11Buffer> m_SceneStatsBuffer;
+	ComPtr<ID3D11UnorderedAccessView> m_SceneStatsUAV;
+	ComPtr<ID3D11Buffer> m_SceneStatsStaging[StatsLatency];
+	UINT64 m_SceneStatsFrame = 0;
+
+	// [Important] Layout must match cbCloudShadow in Shaders/CloudShadow.hlsli
+	struct CloudShadowConstants
+	{
+		float    Origin[2];
+		float    Size;
+		uint32_t Enabled;
+
+		uint32_t InMarch;
+		uint32_t Resolution;
+		uint32_t RowOffset;
+		uint32_t RowCount;
+	};
+
+	void CreateCloudShadowConstantBuffer();
+	void UpdateCloudShadow(const Constant& constant);
+
+	ComPtr<ID3D11Buffer> m_CloudShadowConstantBuffer;
+	RenderTexture m_CloudShadowMap;       // Density still ahead toward the sun at 0, 1/4, 1/2 and 3/4 of the layer
+	UINT m_CloudShadowResolution = 0;
+	UINT m_CloudShadowNextRow = 0;
+	float m_CloudShadowKey[12] = {};      // Inputs of the last full bake; any change invalidates every row
+	bool m_bCloudShadowValid = false;
+
+	// [Important] Layout must match cbLightShaft in Shaders/LightShaftCS.hlsl
+	struct LightShaftConstants
+	{
+		float    SunUV[2];
+		float    Density;
+		float    Decay;
+
+		float    ShaftColor[3];
+		float    SourceRadius;
+
+		uint32_t SampleCount;
+		float    Padding[3];
+	};
+
+	void CreateLightShaftConstantBuffer();
+	bool RenderLightShafts(const Constant& constant, ID3D11ShaderResourceView* cloud);
+
+	ComPtr<ID3D11Buffer> m_LightShaftConstantBuffer;
+	RenderTexture m_LightShaftTarget;   // Cloud resolution, HDR shaft radiance
+
+	// [Important] Layout must match cbDensityGrid in Shaders/DensityGridCS.hlsl
+	struct DensityGridConstants
+	{
+		float    GridMin[3];
+		float    Spacing;
+
+		uint32_t Size[3];
+		uint32_t SliceOffset;
+	};
+
+	// Fields of the two sources over their regions, for the extractor
+	bool GetSdfField(MeshExtractor::Field& field);
+	bool SampleDensityGrid(const Constant& constant, const WeatherMap& weather, UINT resolution, MeshExtractor::GridField& grid);
+
+	// CPU workers of the scene's tile lists and bakes and of the tools below
+	ThreadPool m_Workers;
+
+	MeshExtractor m_MeshExtractor;
+	MeshExtractor::GridField m_DensityGrid;   // Kept alive for the field made from it
+
+	SdfRasterizer m_Rasterizer;
+	ComPtr<ID3D11Texture2D> m_Raster2DTexture;
+	ComPtr<ID3D11ShaderResourceView> m_Raster2DSRV;
+
+	DistanceTransform m_DistanceTransform;
+	ComPtr<ID3D11Texture2D> m_DistanceFieldTexture;
+	ComPtr<ID3D11ShaderResourceView> m_DistanceFieldSRV;
+
+	void CreateTileMetricsBuffer(UINT tileCount);
+	void ReadTileMetrics();
+
+	ComPtr<ID3D11ComputeShader> m_TileMetricsCS;
+	ComPtr<ID3D11Buffer> m_TileMetricsBuffer;
+	ComPtr<ID3D11UnorderedAccessView> m_TileMetricsUAV;
+	ComPtr<ID3D11Buffer> m_TileMetricsStaging[StatsLatency];
+	UINT m_TileMetricsCount[StatsLatency] = {};   // Grid size each staging copy was made with
+	UINT64 m_TileMetricsFrame = 0;
+	ComPtr<ID3D11RasterizerState> m_ScissorState;
+
+	static constexpr UINT ReferenceSteps = 256;
+	enum ProbeImage { ProbeReference = 0, ProbeImportance = 1, ProbeUniform = 2, ProbeImageCount = 3 };
+
+	void CreateProbeTargets(UINT width, UINT height);
+	uint32_t RenderProbeImage(ProbeImage image);
+	double ComputeProbeError(ProbeImage image);
+
+	UINT m_ProbeWidth = 0;
+	UINT m_ProbeHeight = 0;
+	ComPtr<ID3D11Texture2D> m_ProbeTextures[ProbeImageCount];
+	ComPtr<ID3D11RenderTargetView> m_ProbeRTVs[ProbeImageCount];
+	ComPtr<ID3D11ShaderResourceView> m_ProbeSRVs[ProbeImageCount];
+	ComPtr<ID3D11Buffer> m_ProbeSumBuffer;
+	ComPtr<ID3D11UnorderedAccessView> m_ProbeSumUAV;
+	ComPtr<ID3D11Buffer> m_ProbeSumStaging;
+	ComPtr<ID3D11Buffer> m_ProbeStatsStaging;
+
+	void CreateFroxelVolumes();
+	void RenderFroxels();
+	void UpdateFroxelBenchmark();
+
+	UINT m_FroxelSize[3] = { 0, 0, 0 };
+	ComPtr<ID3D11Texture3D> m_FroxelScatterTexture;     // Per-froxel scattering and density
+	ComPtr<ID3D11UnorderedAccessView> m_FroxelScatterUAV;
+	ComPtr<ID3D11ShaderResourceView> m_FroxelScatterSRV;
+	ComPtr<ID3D11Texture3D> m_FroxelIntegratedTexture;  // Accumulated scattering and transmittance
+	ComPtr<ID3D11UnorderedAccessView> m_FroxelIntegratedUAV;
+	ComPtr<ID3D11ShaderResourceView> m_FroxelIntegratedSRV;
+
+	static constexpr int BenchmarkFrames = 120;
+	enum class BenchmarkPhase { Idle, PerPixel, Froxel };
+	BenchmarkPhase m_BenchmarkPhase = BenchmarkPhase::Idle;
+	double m_BenchmarkPerPixelMs = 0.0;
+	double m_BenchmarkFroxelMs = 0.0;
+	int m_BenchmarkPerPixelFrames = 0;
+	int m_BenchmarkFroxelFrames = 0;
 
 	void CreateTexture();
 
+	// 204 -> 102 -> 51: the 34 texel atlas tiles stay texel aligned down to mip 1
+	static constexpr UINT NoiseMipLevels = 3;
+
 	ComPtr<ID3D11Texture2D> m_CloudMapTexture;
 	ComPtr<ID3D11UnorderedAccessView> m_CloudMapUAV;
 
 	void CreateSamplerState();
 	ComPtr<ID3D11SamplerState> m_LinearSampler;
 	ComPtr<ID3D11SamplerState> m_PointSampler;
+	ComPtr<ID3D11SamplerState> m_LinearClampSampler;
 
 public:
 	ComPtr<ID3D11ShaderResourceView> m_CloudMapSRV;
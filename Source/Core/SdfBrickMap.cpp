@@ -0,0 +1,371 @@
+#include <cfloat>
+#include <DirectXPackedVector.h>
+
+#include "SdfBrickMap.h"
+#include "SdfScene.h"
+
+namespace
+{
+	// Cells per edge of the top-level blocks the workers start from
+	constexpr UINT BlockCells = 8;
+}
+
+void SdfBrickMap::Initialize(ID3D11Device* device, ID3D11DeviceContext* context)
+{
+	m_pDevice = device;
+	m_pContext = context;
+
+	// Trilinear inside a brick; the shared border samples make clamping at the brick edge unnecessary
+	D3D11_SAMPLER_DESC samplerDesc = {};
+	samplerDesc.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
+	samplerDesc.AddressU = D3D11_TEXTURE_ADDRESS_CLAMP;
+	samplerDesc.AddressV = D3D11_TEXTURE_ADDRESS_CLAMP;
+	samplerDesc.AddressW = D3D11_TEXTURE_ADDRESS_CLAMP;
+	samplerDesc.ComparisonFunc = D3D11_COMPARISON_NEVER;
+	samplerDesc.MaxLOD = D3D11_FLOAT32_MAX;
+
+	ThrowIfFailed(m_pDevice->CreateSamplerState(&samplerDesc, &m_Sampler));
+}
+
+void SdfBrickMap::Cancel()
+{
+	std::shared_ptr<BakeState> bake = std::move(m_pBake);
+	if (!bake) return;
+
+	// Jobs still queued see the flag and return at once; running ones stop at their next block
+	bake->bCancelled = true;
+	std::unique_lock<std::mutex> lock(bake->Mutex);
+	bake->Idle.wait(lock, [&bake]() { return bake->InFlight == 0; });
+}
+
+void SdfBrickMap::Clear()
+{
+	Cancel();
+	m_Atlas.Reset();
+	m_AtlasSRV.Reset();
+	m_CellTexture.Reset();
+	m_CellSRV.Reset();
+	m_Constants = {};
+	m_Stats = Stats();
+}
+
+void SdfBrickMap::Bake(const SdfScene& scene, float voxelSize, float bandVoxels, ThreadPool& workers)
+{
+	Cancel();
+
+	std::shared_ptr<BakeState> bake = std::make_shared<BakeState>();
+	bake->Start = GetSeconds();
+	if (!scene.GetBounds(bake->BoundsMin, bake->BoundsMax))
+	{
+		Clear();
+		return;
+	}
+
+	bake->Workers = &workers;
+	bake->Context.Scene = &scene;
+	bake->Context.Cancelled = &bake->bCancelled;
+	bake->BandVoxels = (std::max)(bandVoxels, 1.0f);
+
+	m_pBake = bake;
+	StartRound(bake, (std::max)(voxelSize, 1e-3f));
+}
+
+void SdfBrickMap::StartRound(const std::shared_ptr<BakeState>& bake, float voxelSize)
+{
+	BakeContext& context = bake->Context;
+	float h = voxelSize;
+	for (;;)
+	{
+		// A cell of margin past the band keeps the grid faces clear of the surface, so the tracer can bound
+		// the distance outside the grid by the distance to it plus that margin
+		context.VoxelSize = h;
+		context.CellSize = h * BrickVoxels;
+		context.Band = bake->BandVoxels * h;
+		context.Clamp = context.Band + context.CellSize * 1.7320508f;
+		bake->Padding = context.Band + context.CellSize;
+
+		float padding = bake->Padding;
+		context.Origin = bake->BoundsMin - Vector3(padding, padding, padding);
+		Vector3 extent = bake->BoundsMax - bake->BoundsMin + Vector3(padding, padding, padding) * 2.0f;
+		context.Grid[0] = (std::max)((UINT)ceilf(extent.x / context.CellSize), 1u);
+		context.Grid[1] = (std::max)((UINT)ceilf(extent.y / context.CellSize), 1u);
+		context.Grid[2] = (std::max)((UINT)ceilf(extent.z / context.CellSize), 1u);
+
+		UINT64 cellCount = (UINT64)context.Grid[0] * context.Grid[1] * context.Grid[2];
+		bool bFits = cellCount <= MaxGridCells && context.Grid[0] <= 2048 && context.Grid[1] <= 2048 && context.Grid[2] <= 2048;
+		if (bFits) break;
+		h *= 1.25f;
+	}
+
+	bake->Cells.assign((size_t)context.Grid[0] * context.Grid[1] * context.Grid[2], EmptyCell);
+	context.Cells = bake->Cells.data();
+
+	// One job per row of top-level blocks; jobs write disjoint cells. Small jobs let the per-frame work
+	// queued through Submit overtake the bake.
+	bake->BlocksY = (context.Grid[1] + BlockCells - 1) / BlockCells;
+	UINT blocksZ = (context.Grid[2] + BlockCells - 1) / BlockCells;
+	UINT rows = bake->BlocksY * blocksZ;
+	bake->Jobs.assign(rows, BakeJob());
+	bake->Remaining = rows;
+
+	{
+		std::lock_guard<std::mutex> lock(bake->Mutex);
+		bake->InFlight += rows;
+	}
+	for (UINT row = 0; row < rows; row++)
+	{
+		bake->Workers->SubmitBackground([this, bake, row]() { RunJob(bake, row); });
+	}
+}
+
+void SdfBrickMap::RunJob(const std::shared_ptr<BakeState>& bake, UINT row)
+{
+	if (!bake->bCancelled)
+	{
+		const BakeContext& context = bake->Context;
+		UINT by = row % bake->BlocksY;
+		UINT bz = row / bake->BlocksY;
+		UINT blocksX = (context.Grid[0] + BlockCells - 1) / BlockCells;
+		for (UINT bx = 0; bx < blocksX; bx++)
+			Subdivide(context, bx * BlockCells, by * BlockCells, bz * BlockCells, BlockCells, bake->Jobs[row]);
+	}
+
+	// The next round's jobs are counted before this one leaves, so Cancel never sees a gap
+	if (bake->Remaining.fetch_sub(1) == 1 && !bake->bCancelled)
+		FinishRound(bake);
+
+	// Notified under the lock, so Cancel cannot return and release the bake in between
+	std::lock_guard<std::mutex> lock(bake->Mutex);
+	bake->InFlight--;
+	bake->Idle.notify_all();
+}
+
+void SdfBrickMap::FinishRound(const std::shared_ptr<BakeState>& bake)
+{
+	UINT brickCount = 0;
+	for (const BakeJob& job : bake->Jobs)
+		brickCount += (UINT)job.Bricks.size();
+
+	// Past the atlas limit the band is too fine for the scene; coarsen and bake again
+	if (brickCount > AtlasBricks * AtlasBricks * MaxAtlasSlices)
+	{
+		StartRound(bake, bake->Context.VoxelSize * 1.25f);
+		return;
+	}
+
+	// Atlas of AtlasBricks x AtlasBricks bricks per slice of bricks, brick indices in job order
+	const UINT width = AtlasBricks * BrickSamples;
+	const UINT height = AtlasBricks * BrickSamples;
+	const UINT slices = (std::max)((brickCount + AtlasBricks * AtlasBricks - 1) / (AtlasBricks * AtlasBricks), 1u);
+	bake->AtlasDepth = slices * BrickSamples;
+	bake->BrickCount = brickCount;
+	bake->Texels.assign((size_t)width * height * bake->AtlasDepth, 0);
+
+	UINT brickIndex = 0;
+	for (const BakeJob& job : bake->Jobs)
+	{
+		for (const Brick& brick : job.Bricks)
+		{
+			bake->Cells[brick.Cell] = brickIndex;
+
+			UINT bx = brickIndex % AtlasBricks;
+			UINT by = (brickIndex / AtlasBricks) % AtlasBricks;
+			UINT bz = brickIndex / (AtlasBricks * AtlasBricks);
+			brickIndex++;
+
+			const uint16_t* samples = job.Samples.data() + brick.FirstSample;
+			for (UINT k = 0; k < BrickSamples; k++)
+			{
+				for (UINT j = 0; j < BrickSamples; j++)
+				{
+					size_t texel = ((size_t)(bz * BrickSamples + k) * height + by * BrickSamples + j) * width + bx * BrickSamples;
+					memcpy(&bake->Texels[texel], samples + (k * BrickSamples + j) * BrickSamples, BrickSamples * sizeof(uint16_t));
+				}
+			}
+		}
+	}
+	bake->Jobs.clear();
+	bake->Seconds = GetSeconds() - bake->Start;
+	bake->bReady = true;
+}
+
+bool SdfBrickMap::Update()
+{
+	if (!m_pBake || !m_pBake->bReady) return false;
+
+	double start = GetSeconds();
+	const BakeState& bake = *m_pBake;
+	const BakeContext& context = bake.Context;
+	Upload(bake);
+
+	float h = context.VoxelSize;
+	m_Constants.Origin = context.Origin;
+	m_Constants.VoxelSize = h;
+	m_Constants.Grid[0] = context.Grid[0];
+	m_Constants.Grid[1] = context.Grid[1];
+	m_Constants.Grid[2] = context.Grid[2];
+	m_Constants.Trust = TrustVoxels * h;
+	m_Constants.Padding = bake.Padding;
+
+	UINT64 denseSamples = (UINT64)(context.Grid[0] * BrickVoxels + 1) * (context.Grid[1] * BrickVoxels + 1) * (context.Grid[2] * BrickVoxels + 1);
+	m_Stats.Bricks = (int)bake.BrickCount;
+	m_Stats.Cells = (int)bake.Cells.size();
+	m_Stats.VoxelSize = h;
+	m_Stats.DenseBytes = denseSamples * sizeof(uint16_t);
+	m_Stats.BakeMs = (float)(bake.Seconds * 1000.0);
+	m_Stats.UploadMs = (float)((GetSeconds() - start) * 1000.0);
+
+	// Past bReady the last job only leaves; wait for it and release the bake
+	Cancel();
+	return true;
+}
+
+void SdfBrickMap::Subdivide(const BakeContext& context, UINT x0, UINT y0, UINT z0, UINT size, BakeJob& job)
+{
+	if (*context.Cancelled) return;
+
+	UINT x1 = (std::min)(x0 + size, context.Grid[0]);
+	UINT y1 = (std::min)(y0 + size, context.Grid[1]);
+	UINT z1 = (std::min)(z0 + size, context.Grid[2]);
+	if (x0 >= x1 || y0 >= y1 || z0 >= z1) return;
+
+	Vector3 boxMin = context.Origin + Vector3((float)x0, (float)y0, (float)z0) * context.CellSize;
+	Vector3 boxMax = context.Origin + Vector3((float)x1, (float)y1, (float)z1) * context.CellSize;
+	Vector3 centre = (boxMin + boxMax) * 0.5f;
+	float radius = ((boxMax - boxMin) * 0.5f).Length();
+
+	// The distance is 1-Lipschitz: beyond radius + band at the centre, no cell of the block reaches the band
+	float d = context.Scene->GetDistance(centre);
+	if (fabsf(d) > radius + context.Band)
+	{
+		// Each cell keeps the bound left at its own centre; solid interiors get 0 and defer to the analytic scene
+		float cellRadius = context.CellSize * 0.5f * 1.7320508f;
+		for (UINT z = z0; z < z1; z++)
+		{
+			for (UINT y = y0; y < y1; y++)
+			{
+				for (UINT x = x0; x < x1; x++)
+				{
+					uint32_t bound = 0;
+					if (d > 0.0f)
+					{
+						Vector3 cellCentre = context.Origin + Vector3(x + 0.5f, y + 0.5f, z + 0.5f) * context.CellSize;
+						float lower = d - (cellCentre - centre).Length() - cellRadius;
+						bound = (uint32_t)(std::min)((std::max)(lower / context.VoxelSize, 0.0f), (float)(EmptyCell - 1));
+					}
+					context.Cells[((size_t)z * context.Grid[1] + y) * context.Grid[0] + x] = EmptyCell | bound;
+				}
+			}
+		}
+		return;
+	}
+
+	if (size == 1)
+	{
+		BakeBrick(context, x0, y0, z0, job);
+		return;
+	}
+
+	UINT half = size / 2;
+	for (UINT child = 0; child < 8; child++)
+	{
+		Subdivide(context, x0 + ((child & 1) ? half : 0), y0 + ((child & 2) ? half : 0), z0 + ((child & 4) ? half : 0), half, job);
+	}
+}
+
+void SdfBrickMap::BakeBrick(const BakeContext& context, UINT x, UINT y, UINT z, BakeJob& job)
+{
+	Vector3 cellMin = context.Origin + Vector3((float)x, (float)y, (float)z) * context.CellSize;
+	Vector3 cellMax = cellMin + Vector3(context.CellSize, context.CellSize, context.CellSize);
+
+	// Groups farther than the clamp from the cell cannot lower any sample below it
+	Vector3 margin(context.Clamp, context.Clamp, context.Clamp);
+	context.Scene->GatherGroups(cellMin - margin, cellMax + margin, job.Groups);
+
+	Brick brick;
+	brick.Cell = (UINT)(((size_t)z * context.Grid[1] + y) * context.Grid[0] + x);
+	brick.FirstSample = (UINT)job.Samples.size();
+	job.Bricks.push_back(brick);
+
+	// All samples of the brick as one batch through the SIMD kernels, x fastest
+	const UINT sampleCount = BrickSamples * BrickSamples * BrickSamples;
+	job.X.resize(sampleCount);
+	job.Y.resize(sampleCount);
+	job.Z.resize(sampleCount);
+	job.Distances.assign(sampleCount, context.Clamp);
+	job.GroupDistances.resize(sampleCount);
+
+	UINT sample = 0;
+	for (UINT k = 0; k < BrickSamples; k++)
+	{
+		for (UINT j = 0; j < BrickSamples; j++)
+		{
+			for (UINT i = 0; i < BrickSamples; i++, sample++)
+			{
+				job.X[sample] = cellMin.x + i * context.VoxelSize;
+				job.Y[sample] = cellMin.y + j * context.VoxelSize;
+				job.Z[sample] = cellMin.z + k * context.VoxelSize;
+			}
+		}
+	}
+
+	SdfKernels::Points points = { job.X.data(), job.Y.data(), job.Z.data(), sampleCount };
+	for (UINT group : job.Groups)
+	{
+		context.Scene->GetGroupDistances(group, points, job.GroupDistances.data());
+		for (UINT i = 0; i < sampleCount; i++)
+			job.Distances[i] = (std::min)(job.Distances[i], job.GroupDistances[i]);
+	}
+
+	for (UINT i = 0; i < sampleCount; i++)
+		job.Samples.push_back(DirectX::PackedVector::XMConvertFloatToHalf((std::max)(job.Distances[i], -context.Clamp)));
+}
+
+void SdfBrickMap::Upload(const BakeState& bake)
+{
+	const UINT width = AtlasBricks * BrickSamples;
+	const UINT height = AtlasBricks * BrickSamples;
+	const UINT* grid = bake.Context.Grid;
+
+	D3D11_TEXTURE3D_DESC texDesc = {};
+	texDesc.Width = width;
+	texDesc.Height = height;
+	texDesc.Depth = bake.AtlasDepth;
+	texDesc.MipLevels = 1;
+	texDesc.Format = DXGI_FORMAT_R16_FLOAT;
+	texDesc.Usage = D3D11_USAGE_IMMUTABLE; // Replaced as a whole on every bake
+	texDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+	D3D11_SUBRESOURCE_DATA initData = {};
+	initData.pSysMem = bake.Texels.data();
+	initData.SysMemPitch = width * sizeof(uint16_t);
+	initData.SysMemSlicePitch = width * height * sizeof(uint16_t);
+
+	ThrowIfFailed(m_pDevice->CreateTexture3D(&texDesc, &initData, m_Atlas.ReleaseAndGetAddressOf()));
+	ThrowIfFailed(m_pDevice->CreateShaderResourceView(m_Atlas.Get(), nullptr, m_AtlasSRV.ReleaseAndGetAddressOf()));
+
+	// Cells: brick index or empty bound, read with Load
+	texDesc.Width = grid[0];
+	texDesc.Height = grid[1];
+	texDesc.Depth = grid[2];
+	texDesc.Format = DXGI_FORMAT_R32_UINT;
+
+	initData.pSysMem = bake.Cells.data();
+	initData.SysMemPitch = grid[0] * sizeof(uint32_t);
+	initData.SysMemSlicePitch = grid[0] * grid[1] * sizeof(uint32_t);
+
+	ThrowIfFailed(m_pDevice->CreateTexture3D(&texDesc, &initData, m_CellTexture.ReleaseAndGetAddressOf()));
+	ThrowIfFailed(m_pDevice->CreateShaderResourceView(m_CellTexture.Get(), nullptr, m_CellSRV.ReleaseAndGetAddressOf()));
+
+	m_Constants.AtlasScale = Vector3(1.0f / width, 1.0f / height, 1.0f / bake.AtlasDepth);
+	m_Stats.Bytes = (UINT64)bake.Texels.size() * sizeof(uint16_t) + (UINT64)bake.Cells.size() * sizeof(uint32_t);
+}
+
+void SdfBrickMap::Bind()
+{
+	ID3D11ShaderResourceView* srvs[] = { m_AtlasSRV.Get(), m_CellSRV.Get() };
+	m_pContext->PSSetShaderResources(15, 2, srvs);
+	m_pContext->PSSetSamplers(3, 1, m_Sampler.GetAddressOf());
+	m_pContext->CSSetShaderResources(15, 2, srvs);
+	m_pContext->CSSetSamplers(3, 1, m_Sampler.GetAddressOf());
+}
@@ -0,0 +1,169 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+
+class SdfScene;
+class ThreadPool;
+
+// Sparse narrow-band bake of the SDF groups: a coarse grid of cells, each either a brick of 8^3 distance
+// samples (cells within the band of the surface) or a single clamped lower bound of the distance (everything
+// else). Bricks sit in a 3D atlas and are sampled trilinearly; neighbouring bricks repeat their shared border
+// samples, so a lookup never reads across bricks.
+// The bake runs as background jobs on the workers; the render thread only creates the textures once it is done.
+// [Important] Constants and cell encoding must match Shaders/Scene3D.hlsli
+class SdfBrickMap
+{
+public:
+	using Vector3 = DirectX::SimpleMath::Vector3;
+
+	static constexpr UINT BrickSamples = 8;                    // SDF_BRICK_SAMPLES
+	static constexpr UINT BrickVoxels = BrickSamples - 1;      // Voxels per cell edge
+	static constexpr UINT AtlasBricks = 32;                    // SDF_BRICK_ATLAS bricks per atlas row and column
+	static constexpr UINT MaxAtlasSlices = 2048 / BrickSamples;
+	static constexpr uint32_t EmptyCell = 0x80000000u;         // SDF_BRICK_EMPTY; the low bits hold the bound in voxels
+	static constexpr UINT64 MaxGridCells = 1u << 22;           // The voxel size grows until the grid fits
+	static constexpr float TrustVoxels = 1.5f;                 // Baked values closer than this defer to the analytic scene
+
+	// [Important] Layout must match the SdfBrick fields of cbSdfScene in Shaders/Scene3D.hlsli
+	struct FieldConstants
+	{
+		Vector3  Origin;       // World position of cell (0, 0, 0)
+		float    VoxelSize;    // 0 when nothing is baked
+
+		uint32_t Grid[3];      // Cells per axis
+		float    Trust;        // Distance below which the tracer evaluates the groups instead
+
+		Vector3  AtlasScale;   // 1 / atlas texels per axis
+		float    Padding;      // Empty margin between the grid bounds and the groups
+	};
+
+	struct Stats
+	{
+		int    Bricks = 0;
+		int    Cells = 0;
+		float  VoxelSize = 0.0f;   // After growing to fit MaxGridCells
+		float  BakeMs = 0.0f;        // From Bake to the result being ready, on the workers
+		float  UploadMs = 0.0f;      // Texture creation on the render thread
+		UINT64 Bytes = 0;          // Atlas and cell grid on the GPU
+		UINT64 DenseBytes = 0;     // A dense grid at the same voxel size, for comparison
+	};
+
+public:
+	SdfBrickMap() {}
+	~SdfBrickMap() { Cancel(); }
+
+	// [Rule] System classes should NOT be copied.
+	SdfBrickMap(const SdfBrickMap&) = delete;
+	SdfBrickMap& operator=(const SdfBrickMap&) = delete;
+
+	void Initialize(ID3D11Device* device, ID3D11DeviceContext* context);
+
+	// Starts sampling scene's groups around their surface as background jobs on workers, one per row of
+	// top-level blocks. The previous bake stays in use until Update replaces it.
+	// [Important] scene must not change until the bake lands or is cancelled.
+	void Bake(const SdfScene& scene, float voxelSize, float bandVoxels, ThreadPool& workers);
+
+	// Waits for the jobs of a running bake to return, dropping its result
+	void Cancel();
+	void Clear();
+
+	// Once per frame: uploads a finished bake; true if the bricks changed
+	bool Update();
+
+	bool IsBaked() const { return m_Constants.VoxelSize > 0.0f; }
+	bool IsBaking() const { return m_pBake != nullptr; }
+	const FieldConstants& GetConstants() const { return m_Constants; }
+	const Stats& GetStats() const { return m_Stats; }
+
+	// Atlas at t15, cells at t16, trilinear sampler at s3
+	void Bind();
+
+private:
+	struct Brick
+	{
+		UINT Cell;             // Index in the cell grid
+		UINT FirstSample;      // Offset in the job's samples
+	};
+
+	// Bricks and samples of one slab of top-level blocks; brick indices are assigned when the slabs merge
+	struct BakeJob
+	{
+		std::vector<Brick> Bricks;
+		std::vector<uint16_t> Samples;   // Half floats, BrickSamples^3 per brick, x fastest
+		std::vector<UINT> Groups;        // Scratch for the group gathers
+
+		// Scratch for one brick's samples as a batch of points
+		std::vector<float> X, Y, Z;
+		std::vector<float> Distances, GroupDistances;
+	};
+
+	struct BakeContext
+	{
+		const SdfScene* Scene;
+		uint32_t* Cells;           // Brick index, or EmptyCell | distance bound in voxels
+		const std::atomic<bool>* Cancelled;
+		Vector3 Origin;
+		float VoxelSize;
+		float CellSize;
+		float Band;
+		float Clamp;               // Brick samples are clamped to +-Clamp
+		UINT Grid[3];
+	};
+
+	// One bake, shared by its jobs; a round bakes every row once, and a round with too many bricks for the
+	// atlas starts another at a coarser voxel size
+	struct BakeState
+	{
+		ThreadPool* Workers = nullptr;
+		BakeContext Context = {};
+		Vector3 BoundsMin, BoundsMax;
+		float BandVoxels = 0.0f;
+		float Padding = 0.0f;
+		UINT BlocksY = 0;
+		double Start = 0.0;
+		double Seconds = 0.0;            // Bake time, set with bReady
+
+		std::vector<BakeJob> Jobs;       // Per row of top-level blocks
+		std::vector<uint32_t> Cells;
+		std::vector<uint16_t> Texels;    // The atlas, assembled by the round's last job
+		UINT BrickCount = 0;
+		UINT AtlasDepth = 0;
+
+		std::atomic<UINT> Remaining{ 0 };   // Jobs of the current round not done yet
+		std::atomic<bool> bCancelled{ false };
+		std::atomic<bool> bReady{ false };
+
+		std::mutex Mutex;
+		std::condition_variable Idle;
+		UINT InFlight = 0;               // Submitted jobs that have not returned
+	};
+
+	// Grows the voxel size until the grid fits, then submits the round's jobs
+	void StartRound(const std::shared_ptr<BakeState>& bake, float voxelSize);
+	void RunJob(const std::shared_ptr<BakeState>& bake, UINT row);
+	// On the last job of a round: another round, or the atlas
+	void FinishRound(const std::shared_ptr<BakeState>& bake);
+
+	// Cells [x0, x0 + size)^3, clipped to the grid: empty when the surface is provably beyond the band
+	void Subdivide(const BakeContext& context, UINT x0, UINT y0, UINT z0, UINT size, BakeJob& job);
+	void BakeBrick(const BakeContext& context, UINT x, UINT y, UINT z, BakeJob& job);
+	void Upload(const BakeState& bake);
+
+private:
+	ID3D11Device* m_pDevice = nullptr;
+	ID3D11DeviceContext* m_pContext = nullptr;
+
+	std::shared_ptr<BakeState> m_pBake;   // Running bake, if any
+
+	ComPtr<ID3D11Texture3D> m_Atlas;
+	ComPtr<ID3D11ShaderResourceView> m_AtlasSRV;
+	ComPtr<ID3D11Texture3D> m_CellTexture;
+	ComPtr<ID3D11ShaderResourceView> m_CellSRV;
+	ComPtr<ID3D11SamplerState> m_Sampler;
+
+	FieldConstants m_Constants = {};
+	Stats m_Stats;
+};
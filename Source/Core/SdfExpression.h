@@ -0,0 +1,80 @@
+#pragma once
+
+#include "SdfKernels.h"
+
+// Expression templates over the SdfKernels operators. A scene whose structure is fixed at compile time is
+// written as nested nodes, e.g. SmoothUnion(Sphere(a), Box(b), k), and each ISA build instantiates it as one
+// fused kernel: every node inlined into the loop over the vectors, no per-node dispatch or intermediate
+// buffers. Only the structure is static; the primitives and smoothness stay runtime values.
+// SdfProgram.h's Emit writes the same expression as an SdfKernels::Program, the interpreted path for scenes
+// built at run time.
+// [Important] Expressions are built and emitted in SdfKernels.cpp only. The AVX files may only call Evaluate,
+// which they instantiate with their own internal kernel types (see SdfKernelsImpl.h).
+namespace SdfExpression
+{
+	template <uint32_t Type>
+	struct ShapeNode
+	{
+		SdfKernels::Primitive Primitive;
+
+		template <typename Kernels, typename V>
+		V Evaluate(V x, V y, V z) const
+		{
+			return Kernels::template Shape<Type>(Primitive, x, y, z);
+		}
+	};
+
+	template <typename A, typename B>
+	struct UnionNode
+	{
+		A First;
+		B Second;
+
+		template <typename Kernels, typename V>
+		V Evaluate(V x, V y, V z) const
+		{
+			return Kernels::Union(First.template Evaluate<Kernels>(x, y, z), Second.template Evaluate<Kernels>(x, y, z));
+		}
+	};
+
+	template <typename A, typename B>
+	struct SmoothUnionNode
+	{
+		A First;
+		B Second;
+		float K;
+
+		template <typename Kernels, typename V>
+		V Evaluate(V x, V y, V z) const
+		{
+			return Kernels::SmoothUnion(First.template Evaluate<Kernels>(x, y, z), Second.template Evaluate<Kernels>(x, y, z), K);
+		}
+	};
+
+	// The primitive's Type must match the node; it is not read back
+	inline ShapeNode<SdfKernels::Sphere> Sphere(const SdfKernels::Primitive& primitive) { return { primitive }; }
+	inline ShapeNode<SdfKernels::Box> Box(const SdfKernels::Primitive& primitive) { return { primitive }; }
+	inline ShapeNode<SdfKernels::Cylinder> Cylinder(const SdfKernels::Primitive& primitive) { return { primitive }; }
+	inline ShapeNode<SdfKernels::CutSphere> CutSphere(const SdfKernels::Primitive& primitive) { return { primitive }; }
+
+	template <typename A, typename B>
+	UnionNode<A, B> Union(const A& first, const B& second) { return { first, second }; }
+
+	template <typename A, typename B>
+	SmoothUnionNode<A, B> SmoothUnion(const A& first, const B& second, float k) { return { first, second, k }; }
+
+	// The scenes every build compiles. Adding one means a type here, an entry in SdfKernels::Detail::Table
+	// and an Evaluate overload below.
+
+	// SdfScene's demo preset: the tower (cylinder smooth-blended with its cap) next to the ball
+	using TowerScene = UnionNode<SmoothUnionNode<ShapeNode<SdfKernels::Cylinder>, ShapeNode<SdfKernels::Sphere>>,
+		ShapeNode<SdfKernels::Sphere>>;
+
+	// Every primitive type smooth-blended in order, as SdfKernels::EvaluateGroup runs a group of four
+	using BlendChain = SmoothUnionNode<SmoothUnionNode<SmoothUnionNode<ShapeNode<SdfKernels::Sphere>,
+		ShapeNode<SdfKernels::Box>>, ShapeNode<SdfKernels::Cylinder>>, ShapeNode<SdfKernels::CutSphere>>;
+
+	// out[i] = the scene's distance at point i, through the build SdfKernels currently uses
+	void Evaluate(const TowerScene& scene, const SdfKernels::Points& points, float* out);
+	void Evaluate(const BlendChain& scene, const SdfKernels::Points& points, float* out);
+}
@@ -0,0 +1,735 @@
+#include <intrin.h>
+#include <random>
+#include <chrono>
+#include <atomic>
+#include <memory>
+
+#include "SdfKernelsImpl.h"
+#include "SdfProgram.h"
+#include "SdfKernelsCheck.h"
+
+namespace
+{
+	// One point at a time; here rather than in SdfKernelsImpl.h, which the AVX files include, for the CRT math
+	struct ScalarLanes
+	{
+		using Value = float;
+		using Mask = bool;
+		static constexpr UINT Width = 1;
+
+		static Value Set(float v) { return v; }
+		static Value Load(const float* p, UINT) { return *p; }
+		static void Store(float* p, Value v, UINT) { *p = v; }
+		static Value Add(Value a, Value b) { return a + b; }
+		static Value Sub(Value a, Value b) { return a - b; }
+		static Value Mul(Value a, Value b) { return a * b; }
+		static Value Div(Value a, Value b) { return a / b; }
+		static Value Min(Value a, Value b) { return a < b ? a : b; }
+		static Value Max(Value a, Value b) { return a > b ? a : b; }
+		static Value Abs(Value a) { return fabsf(a); }
+		static Value Sqrt(Value a) { return sqrtf(a); }
+		static Mask Less(Value a, Value b) { return a < b; }
+		static Value Select(Mask m, Value a, Value b) { return m ? a : b; }
+	};
+
+	// --- Dispatch ---
+
+	struct CpuFeatures
+	{
+		bool bAvx2 = false;
+		bool bAvx512 = false;
+	};
+
+	CpuFeatures DetectCpuFeatures()
+	{
+		CpuFeatures features;
+
+		int info[4] = {};
+		__cpuid(info, 0);
+		int maxLeaf = info[0];
+		if (maxLeaf < 7) return features;
+
+		__cpuid(info, 1);
+		bool bOsXsave = (info[2] & (1 << 27)) != 0;
+		bool bAvx = (info[2] & (1 << 28)) != 0;
+		bool bFma = (info[2] & (1 << 12)) != 0;
+		if (!bOsXsave || !bAvx) return features;
+
+		// The OS must save the YMM (and for AVX-512 the opmask and ZMM) state across context switches
+		unsigned long long xcr0 = _xgetbv(0);
+		bool bYmmState = (xcr0 & 0x6) == 0x6;
+		bool bZmmState = (xcr0 & 0xE6) == 0xE6;
+
+		__cpuidex(info, 7, 0);
+		bool bAvx2 = (info[1] & (1 << 5)) != 0;
+		bool bAvx512F = (info[1] & (1 << 16)) != 0;
+
+		// /arch:AVX512 targets the Skylake-X set, so the compiler is free to use DQ, CD, BW and VL too
+		bool bAvx512Dq = (info[1] & (1 << 17)) != 0;
+		bool bAvx512Cd = (info[1] & (1 << 28)) != 0;
+		bool bAvx512Bw = (info[1] & (1 << 30)) != 0;
+		bool bAvx512Vl = (info[1] & (1u << 31)) != 0;
+
+		// /arch:AVX2 lets the compiler contract into FMA, so the build needs it as well
+		features.bAvx2 = bYmmState && bAvx2 && bFma;
+		features.bAvx512 = features.bAvx2 && bZmmState && bAvx512F && bAvx512Dq && bAvx512Cd && bAvx512Bw && bAvx512Vl;
+		return features;
+	}
+
+	const CpuFeatures& GetCpuFeatures()
+	{
+		static const CpuFeatures features = DetectCpuFeatures();
+		return features;
+	}
+
+	const SdfKernels::Detail::Table& GetIsaTable(SdfKernels::Isa isa)
+	{
+		switch (isa)
+		{
+		case SdfKernels::Isa::Avx512: return SdfKernels::Detail::GetAvx512Table();
+		case SdfKernels::Isa::Avx2:   return SdfKernels::Detail::GetAvx2Table();
+		default:                      return GetTable<ScalarLanes>();
+		}
+	}
+
+	SdfKernels::Isa GetBestIsa()
+	{
+		if (SdfKernels::IsSupported(SdfKernels::Isa::Avx512)) return SdfKernels::Isa::Avx512;
+		if (SdfKernels::IsSupported(SdfKernels::Isa::Avx2)) return SdfKernels::Isa::Avx2;
+		return SdfKernels::Isa::Scalar;
+	}
+
+	// Set once on first use and by SetIsa; read by every worker
+	std::atomic<SdfKernels::Isa> s_Isa{ SdfKernels::Isa::Count };
+	std::atomic<const SdfKernels::Detail::Table*> s_Table{ nullptr };
+
+	const SdfKernels::Detail::Table& GetActiveTable()
+	{
+		const SdfKernels::Detail::Table* table = s_Table.load(std::memory_order_acquire);
+		if (table) return *table;
+
+		SdfKernels::SetIsa(GetBestIsa());
+		return *s_Table.load(std::memory_order_acquire);
+	}
+
+	// --- Reference ---
+	// Shaders/SDF.hlsli transcribed line by line, one point at a time, to check the lane kernels against
+
+	using SdfKernels::Float2;
+
+	float Length(Float2 v) { return sqrtf(v.x * v.x + v.y * v.y); }
+
+	float sdSphere(float px, float py, float pz, float s)
+	{
+		return sqrtf(px * px + py * py + pz * pz) - s;
+	}
+
+	float sdCylinder(float px, float py, float pz, Float2 h)
+	{
+		Float2 d = { fabsf(Length({ px, pz })) - h.x, fabsf(py) - h.y };
+		return (std::min)((std::max)(d.x, d.y), 0.0f) + Length({ (std::max)(d.x, 0.0f), (std::max)(d.y, 0.0f) });
+	}
+
+	float opSmoothUnion(float d1, float d2, float k)
+	{
+		float h = (std::min)((std::max)(0.5f + 0.5f * (d2 - d1) / k, 0.0f), 1.0f);
+		return d2 + (d1 - d2) * h - k * h * (1.0f - h);
+	}
+
+	float sdCutSphere(float px, float py, float pz, float r, float h)
+	{
+		float w = sqrtf(r * r - h * h);
+
+		Float2 q = { Length({ px, pz }), py };
+		float s = (std::max)((h - r) * q.x * q.x + w * w * (h + r - 2.0f * q.y), h * q.x - w * q.y);
+		return (s < 0.0f) ? Length(q) - r :
+			(q.x < w) ? h - q.y :
+			Length({ q.x - w, q.y - h });
+	}
+
+	float sdBox(float px, float py, float pz, float bx, float by, float bz)
+	{
+		float dx = fabsf(px) - bx;
+		float dy = fabsf(py) - by;
+		float dz = fabsf(pz) - bz;
+		float ox = (std::max)(dx, 0.0f), oy = (std::max)(dy, 0.0f), oz = (std::max)(dz, 0.0f);
+		return (std::min)((std::max)(dx, (std::max)(dy, dz)), 0.0f) + sqrtf(ox * ox + oy * oy + oz * oz);
+	}
+
+	// getPrimitiveDistance in Scene3D.hlsli
+	float GetReferenceDistance(const SdfKernels::Primitive& primitive, float x, float y, float z)
+	{
+		const SdfKernels::Float4* m = primitive.WorldToLocal;
+		float qx = (m[0].x * x + m[0].y * y + m[0].z * z + m[0].w) / primitive.Scale;
+		float qy = (m[1].x * x + m[1].y * y + m[1].z * z + m[1].w) / primitive.Scale;
+		float qz = (m[2].x * x + m[2].y * y + m[2].z * z + m[2].w) / primitive.Scale;
+		const SdfKernels::Float4& params = primitive.Params;
+
+		float d;
+		switch (primitive.Type)
+		{
+		case SdfKernels::Box:       d = sdBox(qx, qy, qz, params.x, params.y, params.z); break;
+		case SdfKernels::Cylinder:  d = sdCylinder(qx, qy, qz, { params.x, params.y }); break;
+		case SdfKernels::CutSphere: d = sdCutSphere(qx, qy, qz, params.x, params.y); break;
+		default:                    d = sdSphere(qx, qy, qz, params.x); break;
+		}
+		return d * primitive.Scale;
+	}
+
+	// sdCircle, sdBox and the segment as Distance2DPS.hlsl writes them
+	float GetReferenceDistance2D(const SdfKernels::Shape2D& shape, float x, float y)
+	{
+		Float2 p = { x - shape.A.x, y - shape.A.y };
+		switch (shape.Type)
+		{
+		case SdfKernels::Box2D:
+		{
+			Float2 q = { shape.Axis.x * p.x + shape.Axis.y * p.y, shape.Axis.x * p.y - shape.Axis.y * p.x };
+			Float2 d = { fabsf(q.x) - (shape.B.x - shape.Radius), fabsf(q.y) - (shape.B.y - shape.Radius) };
+			return Length({ (std::max)(d.x, 0.0f), (std::max)(d.y, 0.0f) }) + (std::min)((std::max)(d.x, d.y), 0.0f) - shape.Radius;
+		}
+		case SdfKernels::Segment2D:
+		{
+			Float2 ba = { shape.B.x - shape.A.x, shape.B.y - shape.A.y };
+			float h = (std::min)((std::max)((p.x * ba.x + p.y * ba.y) / (ba.x * ba.x + ba.y * ba.y), 0.0f), 1.0f);
+			return Length({ p.x - ba.x * h, p.y - ba.y * h }) - shape.Radius;
+		}
+		default:
+			return Length(p) - shape.Radius;
+		}
+	}
+
+	// One 2D shape of each type across the point box, the box rotated
+	std::vector<SdfKernels::Shape2D> MakeTestShapes2D()
+	{
+		std::vector<SdfKernels::Shape2D> shapes(3);
+		shapes[0] = { SdfKernels::Circle2D, 2.5f, { 1.0f, -1.0f }, {}, {} };
+		shapes[1] = { SdfKernels::Box2D, 0.5f, { 0.5f, 1.0f }, { 3.0f, 1.5f }, { cosf(0.6f), sinf(0.6f) } };
+		shapes[2] = { SdfKernels::Segment2D, 0.75f, { -4.0f, -3.0f }, { 3.0f, 4.0f }, {} };
+		return shapes;
+	}
+
+	// One primitive of each type with a random rotation, offset and scale; params as in SdfScene's field preset
+	std::vector<SdfKernels::Primitive> MakeTestPrimitives(std::mt19937& rng)
+	{
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+		std::vector<SdfKernels::Primitive> primitives;
+		for (uint32_t type = SdfKernels::Sphere; type <= SdfKernels::CutSphere; type++)
+		{
+			// As SdfScene::ToGpuPrimitive builds them
+			DirectX::SimpleMath::Matrix rotation = DirectX::SimpleMath::Matrix::CreateFromYawPitchRoll(
+				unit(rng) * 6.28f, unit(rng) * 6.28f, unit(rng) * 6.28f);
+			DirectX::SimpleMath::Vector3 position(unit(rng) * 4.0f - 2.0f, unit(rng) * 4.0f - 2.0f, unit(rng) * 4.0f - 2.0f);
+
+			SdfKernels::Primitive primitive = {};
+			for (int row = 0; row < 3; row++)
+			{
+				DirectX::SimpleMath::Vector3 axis(rotation.m[row][0], rotation.m[row][1], rotation.m[row][2]);
+				primitive.WorldToLocal[row] = { axis.x, axis.y, axis.z, -axis.Dot(position) };
+			}
+			primitive.Type = type;
+			primitive.Scale = 0.5f + unit(rng) * 1.5f;
+
+			switch (type)
+			{
+			case SdfKernels::Box:       primitive.Params = { 1.5f, 1.0f + unit(rng), 1.5f, 0.0f }; break;
+			case SdfKernels::Cylinder:  primitive.Params = { 1.0f, 1.5f + unit(rng) * 2.0f, 0.0f, 0.0f }; break;
+			case SdfKernels::CutSphere: primitive.Params = { 2.0f, 0.5f, 0.0f, 0.0f }; break;
+			default:                    primitive.Params = { 1.0f + unit(rng), 0.0f, 0.0f, 0.0f }; break;
+			}
+			primitives.push_back(primitive);
+		}
+		return primitives;
+	}
+
+	// Structure-of-arrays points in a box around the test primitives, inside and outside all of them
+	struct PointSet
+	{
+		std::vector<float> X, Y, Z;
+
+		PointSet(UINT count, std::mt19937& rng)
+		{
+			std::uniform_real_distribution<float> coordinate(-8.0f, 8.0f);
+			X.resize(count);
+			Y.resize(count);
+			Z.resize(count);
+			for (UINT i = 0; i < count; i++)
+			{
+				X[i] = coordinate(rng);
+				Y[i] = coordinate(rng);
+				Z[i] = coordinate(rng);
+			}
+		}
+
+		SdfKernels::Points Get(UINT first, UINT count) const
+		{
+			return { X.data() + first, Y.data() + first, Z.data() + first, count };
+		}
+	};
+
+	// --- Expressions ---
+
+	// The tower of the demo preset over the test primitives: cylinder, sphere cap, and the sphere moved aside as the ball
+	SdfExpression::TowerScene MakeTowerScene(const std::vector<SdfKernels::Primitive>& primitives)
+	{
+		SdfKernels::Primitive ball = primitives[SdfKernels::Sphere];
+		for (int row = 0; row < 3; row++)
+			ball.WorldToLocal[row].w += 3.0f;
+
+		using namespace SdfExpression;
+		return Union(SmoothUnion(Cylinder(primitives[SdfKernels::Cylinder]), Sphere(primitives[SdfKernels::Sphere]), 0.5f), Sphere(ball));
+	}
+
+	SdfExpression::BlendChain MakeBlendChain(const std::vector<SdfKernels::Primitive>& primitives)
+	{
+		using namespace SdfExpression;
+		return SmoothUnion(SmoothUnion(SmoothUnion(Sphere(primitives[SdfKernels::Sphere]), Box(primitives[SdfKernels::Box]), 0.5f),
+			Cylinder(primitives[SdfKernels::Cylinder]), 0.5f), CutSphere(primitives[SdfKernels::CutSphere]), 0.5f);
+	}
+
+	SdfKernels::Program MakeProgram(const SdfExpression::TowerScene& scene) { SdfKernels::Program program; SdfExpression::Emit(scene, program); return program; }
+	SdfKernels::Program MakeProgram(const SdfExpression::BlendChain& scene) { SdfKernels::Program program; SdfExpression::Emit(scene, program); return program; }
+
+	// The usual interpreter a scene editor would start from: a node per operator, a virtual call per node and point
+	struct TreeNode
+	{
+		virtual ~TreeNode() {}
+		virtual float Evaluate(float x, float y, float z) const = 0;
+	};
+
+	struct TreeShape : TreeNode
+	{
+		SdfKernels::Primitive Primitive;
+
+		float Evaluate(float x, float y, float z) const override { return GetReferenceDistance(Primitive, x, y, z); }
+	};
+
+	struct TreeUnion : TreeNode
+	{
+		std::unique_ptr<TreeNode> First, Second;
+		float K = 0.0f;     // 0 = plain min
+
+		float Evaluate(float x, float y, float z) const override
+		{
+			float d1 = First->Evaluate(x, y, z);
+			float d2 = Second->Evaluate(x, y, z);
+			return K > 0.0f ? opSmoothUnion(d1, d2, K) : (std::min)(d1, d2);
+		}
+	};
+
+	// Rebuilds the tree a valid program was flattened from
+	std::unique_ptr<TreeNode> MakeTree(const SdfKernels::Program& program)
+	{
+		std::vector<std::unique_ptr<TreeNode>> stack;
+		for (const SdfKernels::Instruction& instruction : program.Code)
+		{
+			if (instruction.Code == SdfKernels::Op::Union || instruction.Code == SdfKernels::Op::SmoothUnion)
+			{
+				auto node = std::make_unique<TreeUnion>();
+				node->Second = std::move(stack.back());
+				stack.pop_back();
+				node->First = std::move(stack.back());
+				stack.pop_back();
+				node->K = (instruction.Code == SdfKernels::Op::SmoothUnion) ? instruction.K : 0.0f;
+				stack.push_back(std::move(node));
+			}
+			else
+			{
+				auto node = std::make_unique<TreeShape>();
+				node->Primitive = program.Primitives[instruction.Index];
+				stack.push_back(std::move(node));
+			}
+		}
+		return std::move(stack.back());
+	}
+}
+
+bool SdfKernels::IsSupported(Isa isa)
+{
+	switch (isa)
+	{
+	case Isa::Scalar: return true;
+	case Isa::Avx2:   return GetCpuFeatures().bAvx2;
+	case Isa::Avx512: return GetCpuFeatures().bAvx512;
+	default:          return false;
+	}
+}
+
+const char* SdfKernels::GetIsaName(Isa isa)
+{
+	switch (isa)
+	{
+	case Isa::Avx2:   return "AVX2";
+	case Isa::Avx512: return "AVX-512";
+	default:          return "Scalar";
+	}
+}
+
+SdfKernels::Isa SdfKernels::GetIsa()
+{
+	GetActiveTable();
+	return s_Isa.load(std::memory_order_acquire);
+}
+
+void SdfKernels::SetIsa(Isa isa)
+{
+	while (isa != Isa::Scalar && !IsSupported(isa))
+		isa = (Isa)((int)isa - 1);
+
+	s_Isa.store(isa, std::memory_order_release);
+	s_Table.store(&GetIsaTable(isa), std::memory_order_release);
+}
+
+void SdfKernels::EvaluatePrimitive(const Primitive& primitive, const Points& points, float* out)
+{
+	GetActiveTable().EvaluatePrimitive(primitive, points, out);
+}
+
+float SdfKernels::GetPrimitiveDistance(const Primitive& primitive, float x, float y, float z)
+{
+	// A batch of one point: the same lane kernel SelfCheck holds against the reference, not another copy
+	float out;
+	Points point = { &x, &y, &z, 1 };
+	Kernels<ScalarLanes>::EvaluatePrimitive(primitive, point, &out);
+	return out;
+}
+
+void SdfKernels::EvaluateGroup(const Primitive* primitives, UINT count, float smoothness, uint32_t memberMask,
+	const Points& points, float* out)
+{
+	GetActiveTable().EvaluateGroup(primitives, count, smoothness, memberMask, points, out);
+}
+
+void SdfKernels::SmoothUnion(float* d, const float* di, float k, UINT count)
+{
+	GetActiveTable().SmoothUnion(d, di, k, count);
+}
+
+void SdfKernels::Program::Clear()
+{
+	Code.clear();
+	Primitives.clear();
+}
+
+void SdfKernels::Program::PushPrimitive(const Primitive& primitive)
+{
+	Op code = primitive.Type <= CutSphere ? (Op)primitive.Type : Op::Sphere;
+	Code.push_back({ code, (uint32_t)Primitives.size(), 0.0f });
+	Primitives.push_back(primitive);
+}
+
+void SdfKernels::Program::PushUnion()
+{
+	Code.push_back({ Op::Union, 0, 0.0f });
+}
+
+void SdfKernels::Program::PushSmoothUnion(float k)
+{
+	Code.push_back({ Op::SmoothUnion, 0, k });
+}
+
+bool SdfKernels::Program::IsValid() const
+{
+	UINT depth = 0;
+	for (const Instruction& instruction : Code)
+	{
+		switch (instruction.Code)
+		{
+		case Op::Sphere:
+		case Op::Box:
+		case Op::Cylinder:
+		case Op::CutSphere:
+			if (instruction.Index >= Primitives.size() || ++depth > MaxProgramStack) return false;
+			break;
+		case Op::Union:
+			if (depth < 2) return false;
+			depth--;
+			break;
+		case Op::SmoothUnion:
+			if (depth < 2 || !(instruction.K > 0.0f)) return false;
+			depth--;
+			break;
+		default:
+			return false;
+		}
+	}
+	return depth == 1;
+}
+
+void SdfKernels::EvaluateProgram(const Program& program, const Points& points, float* out)
+{
+	if (!program.IsValid())
+	{
+		std::fill(out, out + points.Count, FarDistance);
+		return;
+	}
+	GetActiveTable().EvaluateProgram(program.Code.data(), (UINT)program.Code.size(), program.Primitives.data(), points, out);
+}
+
+void SdfKernels::EvaluateShapes2D(const Shape2D* shapes, const uint32_t* indices, UINT count, const Points& points, float* out)
+{
+	GetActiveTable().EvaluateShapes2D(shapes, indices, count, points, out);
+}
+
+void SdfExpression::Evaluate(const TowerScene& scene, const SdfKernels::Points& points, float* out)
+{
+	GetActiveTable().EvaluateTowerScene(scene, points, out);
+}
+
+void SdfExpression::Evaluate(const BlendChain& scene, const SdfKernels::Points& points, float* out)
+{
+	GetActiveTable().EvaluateBlendChain(scene, points, out);
+}
+
+bool SdfKernels::SelfCheck(std::vector<CheckResult>& results, float tolerance)
+{
+	// An odd count leaves a tail behind every vector width
+	constexpr UINT PointCount = 4096 + 7;
+	constexpr float Smoothness = 0.5f;
+
+	std::mt19937 rng(1234);
+	std::vector<Primitive> primitives = MakeTestPrimitives(rng);
+	PointSet pointSet(PointCount, rng);
+	Points points = pointSet.Get(0, PointCount);
+
+	SdfExpression::TowerScene tower = MakeTowerScene(primitives);
+	SdfExpression::BlendChain chain = MakeBlendChain(primitives);
+	Program towerProgram = MakeProgram(tower);
+	Program chainProgram = MakeProgram(chain);
+	const SdfKernels::Primitive& ball = towerProgram.Primitives[2];
+
+	std::vector<Shape2D> shapes2D = MakeTestShapes2D();
+	const uint32_t shapeIndices[] = { 0, 1, 2 };
+
+	// Every type alone, then all of them smooth-blended as one group (the blend chain too), then the tower,
+	// then each 2D shape and their union
+	const size_t groupRow = primitives.size();
+	const size_t towerRow = groupRow + 1;
+	const size_t shapeRow = towerRow + 1;
+	std::vector<float> reference((shapeRow + shapes2D.size() + 1) * PointCount);
+	for (UINT i = 0; i < PointCount; i++)
+	{
+		float x = points.X[i], y = points.Y[i], z = points.Z[i];
+		float blended = FarDistance;
+		for (size_t p = 0; p < primitives.size(); p++)
+		{
+			float d = GetReferenceDistance(primitives[p], x, y, z);
+			reference[p * PointCount + i] = d;
+			blended = (p == 0) ? (std::min)(blended, d) : opSmoothUnion(blended, d, Smoothness);
+		}
+		reference[groupRow * PointCount + i] = blended;
+
+		float towerDistance = opSmoothUnion(reference[Cylinder * PointCount + i], reference[Sphere * PointCount + i], Smoothness);
+		reference[towerRow * PointCount + i] = (std::min)(towerDistance, GetReferenceDistance(ball, x, y, z));
+
+		float union2D = FarDistance;
+		for (size_t s = 0; s < shapes2D.size(); s++)
+		{
+			float d = GetReferenceDistance2D(shapes2D[s], x, y);
+			reference[(shapeRow + s) * PointCount + i] = d;
+			union2D = (std::min)(union2D, d);
+		}
+		reference[(shapeRow + shapes2D.size()) * PointCount + i] = union2D;
+	}
+
+	results.clear();
+	bool bAllPassed = true;
+	std::vector<float> out(PointCount);
+	for (int isa = 0; isa < (int)Isa::Count; isa++)
+	{
+		if (!IsSupported((Isa)isa)) continue;
+		const Detail::Table& table = GetIsaTable((Isa)isa);
+
+		CheckResult result;
+		auto compare = [&](size_t row)
+		{
+			for (UINT i = 0; i < PointCount; i++)
+			{
+				float expected = reference[row * PointCount + i];
+				float error = fabsf(out[i] - expected) / (std::max)(fabsf(expected), 1.0f);
+				result.MaxError = (std::max)(result.MaxError, error);
+			}
+		};
+
+		result.Build = (Isa)isa;
+		for (size_t p = 0; p < primitives.size(); p++)
+		{
+			table.EvaluatePrimitive(primitives[p], points, out.data());
+			compare(p);
+		}
+
+		table.EvaluateGroup(primitives.data(), (UINT)primitives.size(), Smoothness, 0xFFFFFFFFu, points, out.data());
+		compare(groupRow);
+		table.EvaluateBlendChain(chain, points, out.data());
+		compare(groupRow);
+		table.EvaluateProgram(chainProgram.Code.data(), (UINT)chainProgram.Code.size(), chainProgram.Primitives.data(), points, out.data());
+		compare(groupRow);
+
+		table.EvaluateTowerScene(tower, points, out.data());
+		compare(towerRow);
+		table.EvaluateProgram(towerProgram.Code.data(), (UINT)towerProgram.Code.size(), towerProgram.Primitives.data(), points, out.data());
+		compare(towerRow);
+
+		// Each 2D shape alone, then their union
+		for (UINT s = 0; s <= (UINT)shapes2D.size(); s++)
+		{
+			UINT count = s < shapes2D.size() ? 1 : (UINT)shapes2D.size();
+			table.EvaluateShapes2D(shapes2D.data(), s < shapes2D.size() ? &shapeIndices[s] : shapeIndices, count, points, out.data());
+			compare(shapeRow + s);
+		}
+
+		result.bPassed = result.MaxError <= tolerance;
+		bAllPassed &= result.bPassed;
+
+		if (!result.bPassed)
+		{
+			char buffer[256];
+			sprintf_s(buffer, "[SdfKernels] %s build is off the scalar reference by %g\n", GetIsaName(result.Build), result.MaxError);
+			OutputDebugStringA(buffer);
+		}
+		results.push_back(result);
+	}
+	return bAllPassed;
+}
+
+void SdfKernels::RunBenchmark(std::vector<BenchmarkResult>& results)
+{
+	// Enough points per run to leave the timer resolution far behind, small enough to stay in L2
+	constexpr UINT PoolPoints = 16384;
+	constexpr UINT Repeats = 32;
+
+	std::mt19937 rng(5678);
+	std::vector<Primitive> primitives = MakeTestPrimitives(rng);
+	PointSet pointSet(PoolPoints, rng);
+	std::vector<float> out(PoolPoints, 1.0f);
+	std::vector<float> other(PoolPoints, 0.5f);
+
+	static const char* KernelNames[] = { "Sphere", "Box", "Cylinder", "CutSphere", "Smooth union", "Group of 4" };
+	const UINT kernelCount = (UINT)(sizeof(KernelNames) / sizeof(KernelNames[0]));
+
+	results.clear();
+	for (UINT kernel = 0; kernel < kernelCount; kernel++)
+	{
+		for (UINT batch : BenchmarkBatches)
+		{
+			BenchmarkResult result;
+			result.Kernel = KernelNames[kernel];
+			result.Batch = batch;
+
+			for (int isa = 0; isa < (int)Isa::Count; isa++)
+			{
+				if (!IsSupported((Isa)isa))
+				{
+					result.NsPerPoint[isa] = -1.0f;
+					continue;
+				}
+				const Detail::Table& table = GetIsaTable((Isa)isa);
+
+				auto start = std::chrono::high_resolution_clock::now();
+				for (UINT repeat = 0; repeat < Repeats; repeat++)
+				{
+					// One call per batch, as a caller gathering batch points at a time would make
+					for (UINT first = 0; first + batch <= PoolPoints; first += batch)
+					{
+						Points points = pointSet.Get(first, batch);
+						float* dst = out.data() + first;
+						if (kernel < primitives.size())
+							table.EvaluatePrimitive(primitives[kernel], points, dst);
+						else if (kernel == primitives.size())
+							table.SmoothUnion(dst, other.data() + first, 0.5f, batch);
+						else
+							table.EvaluateGroup(primitives.data(), (UINT)primitives.size(), 0.5f, 0xFFFFFFFFu, points, dst);
+					}
+				}
+				auto end = std::chrono::high_resolution_clock::now();
+
+				double ns = std::chrono::duration<double, std::nano>(end - start).count();
+				result.NsPerPoint[isa] = (float)(ns / ((double)PoolPoints * Repeats));
+			}
+			results.push_back(result);
+		}
+	}
+
+	// Keeps the results alive past the optimizer
+	volatile float sink = out[PoolPoints / 2];
+	(void)sink;
+}
+
+void SdfKernels::RunExpressionBenchmark(std::vector<BenchmarkResult>& results)
+{
+	constexpr UINT PoolPoints = 16384;
+	constexpr UINT Repeats = 32;
+	constexpr UINT Batch = 64;
+
+	std::mt19937 rng(5678);
+	std::vector<Primitive> primitives = MakeTestPrimitives(rng);
+	PointSet pointSet(PoolPoints, rng);
+	std::vector<float> out(PoolPoints, 1.0f);
+
+	SdfExpression::TowerScene tower = MakeTowerScene(primitives);
+	SdfExpression::BlendChain chain = MakeBlendChain(primitives);
+	const Program programs[] = { MakeProgram(tower), MakeProgram(chain) };
+
+	static const char* SceneNames[][3] = {
+		{ "Tower: compiled", "Tower: bytecode", "Tower: node tree" },
+		{ "Blend chain: compiled", "Blend chain: bytecode", "Blend chain: node tree" },
+	};
+
+	results.clear();
+	for (UINT scene = 0; scene < 2; scene++)
+	{
+		const Program& program = programs[scene];
+		std::unique_ptr<TreeNode> tree = MakeTree(program);
+
+		for (UINT path = 0; path < 3; path++)
+		{
+			BenchmarkResult result;
+			result.Kernel = SceneNames[scene][path];
+			result.Batch = Batch;
+
+			for (int isa = 0; isa < (int)Isa::Count; isa++)
+			{
+				// The tree has no lanes to widen
+				if (!IsSupported((Isa)isa) || (path == 2 && isa != (int)Isa::Scalar))
+				{
+					result.NsPerPoint[isa] = -1.0f;
+					continue;
+				}
+				const Detail::Table& table = GetIsaTable((Isa)isa);
+
+				auto start = std::chrono::high_resolution_clock::now();
+				for (UINT repeat = 0; repeat < Repeats; repeat++)
+				{
+					for (UINT first = 0; first + Batch <= PoolPoints; first += Batch)
+					{
+						Points points = pointSet.Get(first, Batch);
+						float* dst = out.data() + first;
+						if (path == 0)
+						{
+							if (scene == 0) table.EvaluateTowerScene(tower, points, dst);
+							else table.EvaluateBlendChain(chain, points, dst);
+						}
+						else if (path == 1)
+						{
+							table.EvaluateProgram(program.Code.data(), (UINT)program.Code.size(), program.Primitives.data(), points, dst);
+						}
+						else
+						{
+							for (UINT i = 0; i < Batch; i++)
+								dst[i] = tree->Evaluate(points.X[i], points.Y[i], points.Z[i]);
+						}
+					}
+				}
+				auto end = std::chrono::high_resolution_clock::now();
+
+				double ns = std::chrono::duration<double, std::nano>(end - start).count();
+				result.NsPerPoint[isa] = (float)(ns / ((double)PoolPoints * Repeats));
+			}
+			results.push_back(result);
+		}
+	}
+
+	volatile float sink = out[PoolPoints / 2];
+	(void)sink;
+}
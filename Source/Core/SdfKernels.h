@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstdint>
+
+// CPU evaluation of the SDF primitives (Shaders/SDF.hlsli) over batches of points in structure-of-arrays
+// form. Each kernel exists in a scalar, an AVX2 (8 lanes) and an AVX-512 (16 lanes) build; the widest one the
+// CPU and OS support is picked on first use. Batches of any size work, the last vector of a batch is masked
+// rather than left to a scalar loop. Everything CPU-side that samples many points (baking, meshing,
+// tracing) should come through here rather than SdfScene's per-point functions.
+namespace SdfKernels
+{
+	// Plain vectors rather than SimpleMath's: the AVX builds see this header without the precompiled one
+	// (see SdfKernelsImpl.h), so it may only depend on <cstdint>. The program and the checks, which need the
+	// STL, are declared in SdfProgram.h and SdfKernelsCheck.h.
+	struct Float2 { float x, y; };
+	struct Float4 { float x, y, z, w; };
+
+	enum class Isa { Scalar = 0, Avx2 = 1, Avx512 = 2, Count = 3 };
+
+	// Same ids as SdfScene::PrimitiveType and SDF_* in Shaders/Scene3D.hlsli
+	enum PrimitiveType : uint32_t { Sphere = 0, Box = 1, Cylinder = 2, CutSphere = 3 };
+
+	// [Important] Layout must match SdfPrimitive in Shaders/Scene3D.hlsli; SdfScene uploads these as they are
+	struct Primitive
+	{
+		Float4   WorldToLocal[3];   // Rows of the rigid world-to-local transform
+		Float4   Params;            // Sphere: radius. Box: half extents. Cylinder: radius, half height. CutSphere: radius, cut height
+		uint32_t Type;
+		float    Scale;             // Uniform scale; distances are evaluated at p / Scale and scaled back
+		float    Padding[2];
+	};
+
+	// Count points, one array per coordinate; no alignment required
+	struct Points
+	{
+		const float* X;
+		const float* Y;
+		const float* Z;
+		uint32_t Count;
+	};
+
+	// Lanes of each build, and the batch sizes the benchmark runs
+	constexpr uint32_t IsaLanes[(int)Isa::Count] = { 1, 8, 16 };
+	constexpr uint32_t BenchmarkBatches[] = { 8, 16, 64 };
+
+	// Empty group result, SdfScene::TraceDistance
+	constexpr float FarDistance = 2000.0f;
+
+	bool IsSupported(Isa isa);
+	const char* GetIsaName(Isa isa);
+
+	// The build used by the functions below; SetIsa falls back to the widest supported one below isa
+	Isa GetIsa();
+	void SetIsa(Isa isa);
+
+	// out[i] = distance from point i to the transformed primitive
+	void EvaluatePrimitive(const Primitive& primitive, const Points& points, float* out);
+
+	// One point through the scalar build, whatever GetIsa says, for callers that walk points one at a time
+	float GetPrimitiveDistance(const Primitive& primitive, float x, float y, float z);
+
+	// out[i] = distance to the group: its members blended with opSmoothUnion(d, di, smoothness) in order,
+	// or a plain min when smoothness <= 0. Members whose bit is clear in memberMask are skipped (the first 32).
+	void EvaluateGroup(const Primitive* primitives, uint32_t count, float smoothness, uint32_t memberMask,
+		const Points& points, float* out);
+
+	// d[i] = opSmoothUnion(d[i], di[i], k)
+	void SmoothUnion(float* d, const float* di, float k, uint32_t count);
+
+	// Flat postfix bytecode for scenes whose structure is only known at run time: each instruction pushes the
+	// distance to a primitive or combines the top two values, one pass over the code per vector of points.
+	// Shapes are opcodes of their own (the PrimitiveType ids), so every node costs a single dispatch.
+	// Scenes fixed at compile time are better written as SdfExpression templates, which fuse into one kernel.
+	// Programs are built and run through SdfProgram.h.
+	enum class Op : uint32_t { Sphere = 0, Box = 1, Cylinder = 2, CutSphere = 3, Union = 4, SmoothUnion = 5 };
+
+	struct Instruction
+	{
+		Op       Code;
+		uint32_t Index;             // Shapes: the primitive in Program::Primitives
+		float    K;                 // SmoothUnion: smoothness
+	};
+
+	constexpr uint32_t MaxProgramStack = 16;
+
+	// 2D shapes of SdfRasterizer (Source/Tools/SdfRasterizer.h), in pixels: sdCircle and sdBox of
+	// Shaders/Distance2DPS.hlsl, the box with rounded corners and a rotation, and a segment with round caps
+	enum Shape2DType : uint32_t { Circle2D = 0, Box2D = 1, Segment2D = 2 };
+
+	struct Shape2D
+	{
+		uint32_t Type;
+		float    Radius;            // Circle: radius. Box: corner radius. Segment: half thickness
+		Float2   A;                 // Circle and box: centre. Segment: start
+		Float2   B;                 // Box: half extents, corners included. Segment: end
+		Float2   Axis;              // Box: (cos, sin) of its rotation
+	};
+
+	// out[i] = distance from point i to the nearest of shapes[indices[0 .. count - 1]], FarDistance when count
+	// is 0; points.Z is not read
+	void EvaluateShapes2D(const Shape2D* shapes, const uint32_t* indices, uint32_t count, const Points& points, float* out);
+}
@@ -0,0 +1,46 @@
+// Compiled with /arch:AVX2 and without the precompiled or forced pch.h; see SdfKernelsImpl.h before adding anything
+#include <immintrin.h>
+
+#include "SdfKernelsImpl.h"
+
+namespace
+{
+	struct Avx2Lanes
+	{
+		using Value = __m256;
+		using Mask = __m256;
+		static constexpr uint32_t Width = 8;
+
+		static Value Set(float v) { return _mm256_set1_ps(v); }
+		static __m256i LaneMask(uint32_t lanes) { return _mm256_cmpgt_epi32(_mm256_set1_epi32((int)lanes), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7)); }
+
+		static Value Load(const float* p, uint32_t lanes)
+		{
+			return lanes == Width ? _mm256_loadu_ps(p) : _mm256_maskload_ps(p, LaneMask(lanes));
+		}
+
+		static void Store(float* p, Value v, uint32_t lanes)
+		{
+			if (lanes == Width)
+				_mm256_storeu_ps(p, v);
+			else
+				_mm256_maskstore_ps(p, LaneMask(lanes), v);
+		}
+
+		static Value Add(Value a, Value b) { return _mm256_add_ps(a, b); }
+		static Value Sub(Value a, Value b) { return _mm256_sub_ps(a, b); }
+		static Value Mul(Value a, Value b) { return _mm256_mul_ps(a, b); }
+		static Value Div(Value a, Value b) { return _mm256_div_ps(a, b); }
+		static Value Min(Value a, Value b) { return _mm256_min_ps(a, b); }
+		static Value Max(Value a, Value b) { return _mm256_max_ps(a, b); }
+		static Value Abs(Value a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+		static Value Sqrt(Value a) { return _mm256_sqrt_ps(a); }
+		static Mask Less(Value a, Value b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+		static Value Select(Mask m, Value a, Value b) { return _mm256_blendv_ps(b, a, m); }
+	};
+}
+
+const SdfKernels::Detail::Table& SdfKernels::Detail::GetAvx2Table()
+{
+	return GetTable<Avx2Lanes>();
+}
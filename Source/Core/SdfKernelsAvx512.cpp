@@ -0,0 +1,46 @@
+// Compiled with /arch:AVX512 and without the precompiled or forced pch.h; see SdfKernelsImpl.h before adding anything
+#include <immintrin.h>
+
+#include "SdfKernelsImpl.h"
+
+namespace
+{
+	struct Avx512Lanes
+	{
+		using Value = __m512;
+		using Mask = __mmask16;
+		static constexpr uint32_t Width = 16;
+
+		static Value Set(float v) { return _mm512_set1_ps(v); }
+		static __mmask16 LaneMask(uint32_t lanes) { return (__mmask16)((1u << lanes) - 1); }
+
+		static Value Load(const float* p, uint32_t lanes)
+		{
+			return lanes == Width ? _mm512_loadu_ps(p) : _mm512_maskz_loadu_ps(LaneMask(lanes), p);
+		}
+
+		static void Store(float* p, Value v, uint32_t lanes)
+		{
+			if (lanes == Width)
+				_mm512_storeu_ps(p, v);
+			else
+				_mm512_mask_storeu_ps(p, LaneMask(lanes), v);
+		}
+
+		static Value Add(Value a, Value b) { return _mm512_add_ps(a, b); }
+		static Value Sub(Value a, Value b) { return _mm512_sub_ps(a, b); }
+		static Value Mul(Value a, Value b) { return _mm512_mul_ps(a, b); }
+		static Value Div(Value a, Value b) { return _mm512_div_ps(a, b); }
+		static Value Min(Value a, Value b) { return _mm512_min_ps(a, b); }
+		static Value Max(Value a, Value b) { return _mm512_max_ps(a, b); }
+		static Value Abs(Value a) { return _mm512_abs_ps(a); }
+		static Value Sqrt(Value a) { return _mm512_sqrt_ps(a); }
+		static Mask Less(Value a, Value b) { return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ); }
+		static Value Select(Mask m, Value a, Value b) { return _mm512_mask_blend_ps(m, b, a); }
+	};
+}
+
+const SdfKernels::Detail::Table& SdfKernels::Detail::GetAvx512Table()
+{
+	return GetTable<Avx512Lanes>();
+}
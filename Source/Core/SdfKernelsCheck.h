@@ -0,0 +1,33 @@
+#pragma once
+
+#include "SdfKernels.h"
+
+// Correctness and speed of every SdfKernels build, for the Gui's "[ CPU Kernels ]" tables
+namespace SdfKernels
+{
+	// Compares every build the CPU supports against a plain scalar transcription of SDF.hlsli on random
+	// points around every primitive type, their group, the SdfExpression scenes compiled and as programs, and
+	// the 2D shapes; false (and a log line per failure) when one is off by more than
+	// tolerance relative to the distance
+	struct CheckResult
+	{
+		Isa   Build = Isa::Scalar;
+		float MaxError = 0.0f;
+		bool  bPassed = true;
+	};
+	bool SelfCheck(std::vector<CheckResult>& results, float tolerance = 1e-4f);
+
+	// Nanoseconds per point of each kernel at each batch size in BenchmarkBatches, per build; negative where
+	// the CPU lacks the build
+	struct BenchmarkResult
+	{
+		const char* Kernel = "";
+		UINT        Batch = 0;
+		float       NsPerPoint[(int)Isa::Count] = {};
+	};
+	void RunBenchmark(std::vector<BenchmarkResult>& results);
+
+	// The same scenes three ways at a batch of 64: fused from SdfExpression templates, interpreted from a
+	// Program, and as a tree of virtual nodes walked per point (scalar only, the other builds negative)
+	void RunExpressionBenchmark(std::vector<BenchmarkResult>& results);
+}
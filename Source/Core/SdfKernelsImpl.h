@@ -0,0 +1,323 @@
+#pragma once
+
+#include "SdfExpression.h"
+
+namespace SdfKernels
+{
+	namespace Detail
+	{
+		// One build's entry points; full batches of any size
+		struct Table
+		{
+			void (*EvaluatePrimitive)(const Primitive& primitive, const Points& points, float* out);
+			void (*EvaluateGroup)(const Primitive* primitives, uint32_t count, float smoothness, uint32_t memberMask, const Points& points, float* out);
+			void (*SmoothUnion)(float* d, const float* di, float k, uint32_t count);
+
+			// Takes the Program's arrays unpacked, std::vector code must not be compiled into the AVX builds (see below)
+			void (*EvaluateProgram)(const Instruction* code, uint32_t codeSize, const Primitive* primitives, const Points& points, float* out);
+
+			// One instantiation per SdfExpression scene
+			void (*EvaluateTowerScene)(const SdfExpression::TowerScene& scene, const Points& points, float* out);
+			void (*EvaluateBlendChain)(const SdfExpression::BlendChain& scene, const Points& points, float* out);
+
+			void (*EvaluateShapes2D)(const Shape2D* shapes, const uint32_t* indices, uint32_t count, const Points& points, float* out);
+		};
+
+		// Defined by SdfKernelsAvx2.cpp and SdfKernelsAvx512.cpp; only called once the CPU is known to support them
+		const Table& GetAvx2Table();
+		const Table& GetAvx512Table();
+	}
+}
+
+// Kernel bodies shared by the per-ISA translation units (SdfKernels.cpp, SdfKernelsAvx2.cpp,
+// SdfKernelsAvx512.cpp), written once against a lane type L:
+//   L::Value, L::Width, Set, Load, Store, Add, Sub, Mul, Div, Min, Max, Abs, Sqrt, Less, Select
+// Load and Store take the number of lanes in use, so the last vector of a batch is masked rather than left to
+// a scalar loop: a batch of 8 still runs as one vector in the AVX-512 build.
+// [Important] Everything here lives in an unnamed namespace. The AVX files are compiled with their own /arch,
+// so any function with external linkage they emitted could be picked by the linker for the scalar build too
+// and fault on older CPUs. Only intrinsics and these internal templates may be used from those files.
+// For the same reason they are compiled without the forced pch.h: this header and the ones it includes depend
+// on <cstdint> alone, the AVX files add <immintrin.h>, and the scalar lanes (CRT math) live in SdfKernels.cpp.
+namespace
+{
+	// Lanes in use for the vector starting remaining points before the end (no std::min, see above)
+	uint32_t GetLanes(uint32_t width, uint32_t remaining)
+	{
+		return remaining < width ? remaining : width;
+	}
+
+	template <typename L>
+	struct Kernels
+	{
+		using V = typename L::Value;
+
+		static V Length(V x, V y) { return L::Sqrt(L::Add(L::Mul(x, x), L::Mul(y, y))); }
+		static V Length(V x, V y, V z) { return L::Sqrt(L::Add(L::Add(L::Mul(x, x), L::Mul(y, y)), L::Mul(z, z))); }
+
+		// q = (WorldToLocal * p) / scale
+		static void ToLocal(const SdfKernels::Primitive& primitive, V x, V y, V z, V& qx, V& qy, V& qz)
+		{
+			const V invScale = L::Set(1.0f / primitive.Scale);
+			const SdfKernels::Float4* m = primitive.WorldToLocal;
+			qx = L::Mul(L::Add(L::Add(L::Mul(L::Set(m[0].x), x), L::Mul(L::Set(m[0].y), y)), L::Add(L::Mul(L::Set(m[0].z), z), L::Set(m[0].w))), invScale);
+			qy = L::Mul(L::Add(L::Add(L::Mul(L::Set(m[1].x), x), L::Mul(L::Set(m[1].y), y)), L::Add(L::Mul(L::Set(m[1].z), z), L::Set(m[1].w))), invScale);
+			qz = L::Mul(L::Add(L::Add(L::Mul(L::Set(m[2].x), x), L::Mul(L::Set(m[2].y), y)), L::Add(L::Mul(L::Set(m[2].z), z), L::Set(m[2].w))), invScale);
+		}
+
+		// sdSphere
+		static V Sphere(const SdfKernels::Float4& params, V qx, V qy, V qz)
+		{
+			return L::Sub(Length(qx, qy, qz), L::Set(params.x));
+		}
+
+		// sdBox
+		static V Box(const SdfKernels::Float4& params, V qx, V qy, V qz)
+		{
+			const V zero = L::Set(0.0f);
+			V ex = L::Sub(L::Abs(qx), L::Set(params.x));
+			V ey = L::Sub(L::Abs(qy), L::Set(params.y));
+			V ez = L::Sub(L::Abs(qz), L::Set(params.z));
+			V inside = L::Min(L::Max(ex, L::Max(ey, ez)), zero);
+			return L::Add(inside, Length(L::Max(ex, zero), L::Max(ey, zero), L::Max(ez, zero)));
+		}
+
+		// sdCylinder
+		static V Cylinder(const SdfKernels::Float4& params, V qx, V qy, V qz)
+		{
+			const V zero = L::Set(0.0f);
+			V ex = L::Sub(Length(qx, qz), L::Set(params.x));
+			V ey = L::Sub(L::Abs(qy), L::Set(params.y));
+			return L::Add(L::Min(L::Max(ex, ey), zero), Length(L::Max(ex, zero), L::Max(ey, zero)));
+		}
+
+		// sdCutSphere: all three branches, then selected per lane
+		static V CutSphere(const SdfKernels::Float4& params, V qx, V qy, V qz)
+		{
+			float r = params.x;
+			float h = params.y;
+			float w2 = r * r - h * h;
+			if (w2 < 0.0f) w2 = 0.0f;
+			V w = L::Sqrt(L::Set(w2));
+
+			V rx = Length(qx, qz);
+			V side = L::Max(
+				L::Add(L::Mul(L::Set(h - r), L::Mul(rx, rx)), L::Mul(L::Set(w2), L::Sub(L::Set(h + r), L::Add(qy, qy)))),
+				L::Sub(L::Mul(L::Set(h), rx), L::Mul(w, qy)));
+			V sphere = L::Sub(Length(rx, qy), L::Set(r));
+			V cap = L::Sub(L::Set(h), qy);
+			V rim = Length(L::Sub(rx, w), L::Sub(qy, L::Set(h)));
+			return L::Select(L::Less(side, L::Set(0.0f)), sphere, L::Select(L::Less(rx, w), cap, rim));
+		}
+
+		// Distance in world units from the points (x, y, z) to a primitive of a type known at compile time
+		template <uint32_t Type>
+		static V Shape(const SdfKernels::Primitive& primitive, V x, V y, V z)
+		{
+			V qx, qy, qz;
+			ToLocal(primitive, x, y, z, qx, qy, qz);
+
+			V d;
+			if constexpr (Type == SdfKernels::Box)
+				d = Box(primitive.Params, qx, qy, qz);
+			else if constexpr (Type == SdfKernels::Cylinder)
+				d = Cylinder(primitive.Params, qx, qy, qz);
+			else if constexpr (Type == SdfKernels::CutSphere)
+				d = CutSphere(primitive.Params, qx, qy, qz);
+			else
+				d = Sphere(primitive.Params, qx, qy, qz);
+			return L::Mul(d, L::Set(primitive.Scale));
+		}
+
+		// Same, with the type read from the primitive
+		static V Primitive(const SdfKernels::Primitive& primitive, V x, V y, V z)
+		{
+			switch (primitive.Type)
+			{
+			case SdfKernels::Box:       return Shape<SdfKernels::Box>(primitive, x, y, z);
+			case SdfKernels::Cylinder:  return Shape<SdfKernels::Cylinder>(primitive, x, y, z);
+			case SdfKernels::CutSphere: return Shape<SdfKernels::CutSphere>(primitive, x, y, z);
+			default:                    return Shape<SdfKernels::Sphere>(primitive, x, y, z);
+			}
+		}
+
+		// min(d1, d2)
+		static V Union(V d1, V d2)
+		{
+			return L::Min(d1, d2);
+		}
+
+		// opSmoothUnion(d, di, k)
+		static V SmoothUnion(V d, V di, float k)
+		{
+			V h = L::Add(L::Set(0.5f), L::Mul(L::Set(0.5f / k), L::Sub(di, d)));
+			h = L::Min(L::Max(h, L::Set(0.0f)), L::Set(1.0f));
+			V blend = L::Add(di, L::Mul(L::Sub(d, di), h));
+			return L::Sub(blend, L::Mul(L::Set(k), L::Mul(h, L::Sub(L::Set(1.0f), h))));
+		}
+
+		// Distance from the points (x, y) to one 2D shape
+		static V Distance2D(const SdfKernels::Shape2D& shape, V x, V y)
+		{
+			const V zero = L::Set(0.0f);
+			V px = L::Sub(x, L::Set(shape.A.x));
+			V py = L::Sub(y, L::Set(shape.A.y));
+
+			switch (shape.Type)
+			{
+			case SdfKernels::Box2D:
+			{
+				// Into the box frame, then sdBox with the corners pulled in by the radius
+				V qx = L::Add(L::Mul(L::Set(shape.Axis.x), px), L::Mul(L::Set(shape.Axis.y), py));
+				V qy = L::Sub(L::Mul(L::Set(shape.Axis.x), py), L::Mul(L::Set(shape.Axis.y), px));
+				V dx = L::Sub(L::Abs(qx), L::Set(shape.B.x - shape.Radius));
+				V dy = L::Sub(L::Abs(qy), L::Set(shape.B.y - shape.Radius));
+				V d = L::Add(Length(L::Max(dx, zero), L::Max(dy, zero)), L::Min(L::Max(dx, dy), zero));
+				return L::Sub(d, L::Set(shape.Radius));
+			}
+			case SdfKernels::Segment2D:
+			{
+				// Nearest point on the segment, clamped to its ends
+				float bax = shape.B.x - shape.A.x;
+				float bay = shape.B.y - shape.A.y;
+				float length2 = bax * bax + bay * bay;
+				V h = L::Mul(L::Add(L::Mul(px, L::Set(bax)), L::Mul(py, L::Set(bay))), L::Set(length2 > 0.0f ? 1.0f / length2 : 0.0f));
+				h = L::Min(L::Max(h, zero), L::Set(1.0f));
+				return L::Sub(Length(L::Sub(px, L::Mul(L::Set(bax), h)), L::Sub(py, L::Mul(L::Set(bay), h))), L::Set(shape.Radius));
+			}
+			default: // Circle2D
+				return L::Sub(Length(px, py), L::Set(shape.Radius));
+			}
+		}
+
+		static V Group(const SdfKernels::Primitive* primitives, uint32_t count, float smoothness, uint32_t memberMask, V x, V y, V z)
+		{
+			V d = L::Set(SdfKernels::FarDistance);
+			for (uint32_t i = 0; i < count; i++)
+			{
+				if (i < 32 && !(memberMask & (1u << i))) continue;
+
+				V di = Primitive(primitives[i], x, y, z);
+				d = (i == 0 || smoothness <= 0.0f) ? L::Min(d, di) : SmoothUnion(d, di, smoothness);
+			}
+			return d;
+		}
+
+		static void EvaluatePrimitive(const SdfKernels::Primitive& primitive, const SdfKernels::Points& points, float* out)
+		{
+			for (uint32_t i = 0; i < points.Count; i += L::Width)
+			{
+				uint32_t lanes = GetLanes(L::Width, points.Count - i);
+				V x = L::Load(points.X + i, lanes);
+				V y = L::Load(points.Y + i, lanes);
+				V z = L::Load(points.Z + i, lanes);
+				L::Store(out + i, Primitive(primitive, x, y, z), lanes);
+			}
+		}
+
+		static void EvaluateGroup(const SdfKernels::Primitive* primitives, uint32_t count, float smoothness, uint32_t memberMask,
+			const SdfKernels::Points& points, float* out)
+		{
+			// Every member on one vector of points while it sits in registers
+			for (uint32_t i = 0; i < points.Count; i += L::Width)
+			{
+				uint32_t lanes = GetLanes(L::Width, points.Count - i);
+				V x = L::Load(points.X + i, lanes);
+				V y = L::Load(points.Y + i, lanes);
+				V z = L::Load(points.Z + i, lanes);
+				L::Store(out + i, Group(primitives, count, smoothness, memberMask, x, y, z), lanes);
+			}
+		}
+
+		static void SmoothUnion(float* d, const float* di, float k, uint32_t count)
+		{
+			for (uint32_t i = 0; i < count; i += L::Width)
+			{
+				uint32_t lanes = GetLanes(L::Width, count - i);
+				L::Store(d + i, SmoothUnion(L::Load(d + i, lanes), L::Load(di + i, lanes), k), lanes);
+			}
+		}
+
+		static void EvaluateShapes2D(const SdfKernels::Shape2D* shapes, const uint32_t* indices, uint32_t count,
+			const SdfKernels::Points& points, float* out)
+		{
+			for (uint32_t i = 0; i < points.Count; i += L::Width)
+			{
+				uint32_t lanes = GetLanes(L::Width, points.Count - i);
+				V x = L::Load(points.X + i, lanes);
+				V y = L::Load(points.Y + i, lanes);
+
+				V d = L::Set(SdfKernels::FarDistance);
+				for (uint32_t s = 0; s < count; s++)
+					d = L::Min(d, Distance2D(shapes[indices[s]], x, y));
+				L::Store(out + i, d, lanes);
+			}
+		}
+
+		// The whole expression per vector of points, fused at compile time
+		template <typename E>
+		static void EvaluateExpression(const E& expression, const SdfKernels::Points& points, float* out)
+		{
+			for (uint32_t i = 0; i < points.Count; i += L::Width)
+			{
+				uint32_t lanes = GetLanes(L::Width, points.Count - i);
+				V x = L::Load(points.X + i, lanes);
+				V y = L::Load(points.Y + i, lanes);
+				V z = L::Load(points.Z + i, lanes);
+				L::Store(out + i, expression.template Evaluate<Kernels>(x, y, z), lanes);
+			}
+		}
+
+		// The program once per vector of points, on a stack of vectors; the caller has checked Program::IsValid
+		static void EvaluateProgram(const SdfKernels::Instruction* code, uint32_t codeSize, const SdfKernels::Primitive* primitives,
+			const SdfKernels::Points& points, float* out)
+		{
+			// Zeroed once per call: IsValid proves no slot is read before it is written, but the compiler cannot see that
+			V stack[SdfKernels::MaxProgramStack] = {};
+			for (uint32_t i = 0; i < points.Count; i += L::Width)
+			{
+				uint32_t lanes = GetLanes(L::Width, points.Count - i);
+				V x = L::Load(points.X + i, lanes);
+				V y = L::Load(points.Y + i, lanes);
+				V z = L::Load(points.Z + i, lanes);
+
+				uint32_t top = 0;
+				for (uint32_t pc = 0; pc < codeSize; pc++)
+				{
+					const SdfKernels::Instruction& instruction = code[pc];
+					switch (instruction.Code)
+					{
+					case SdfKernels::Op::Sphere:    stack[top++] = Shape<SdfKernels::Sphere>(primitives[instruction.Index], x, y, z); break;
+					case SdfKernels::Op::Box:       stack[top++] = Shape<SdfKernels::Box>(primitives[instruction.Index], x, y, z); break;
+					case SdfKernels::Op::Cylinder:  stack[top++] = Shape<SdfKernels::Cylinder>(primitives[instruction.Index], x, y, z); break;
+					case SdfKernels::Op::CutSphere: stack[top++] = Shape<SdfKernels::CutSphere>(primitives[instruction.Index], x, y, z); break;
+					case SdfKernels::Op::Union:
+						top--;
+						stack[top - 1] = Union(stack[top - 1], stack[top]);
+						break;
+					default: // SmoothUnion
+						top--;
+						stack[top - 1] = SmoothUnion(stack[top - 1], stack[top], instruction.K);
+						break;
+					}
+				}
+				L::Store(out + i, stack[0], lanes);
+			}
+		}
+	};
+
+	template <typename L>
+	const SdfKernels::Detail::Table& GetTable()
+	{
+		static const SdfKernels::Detail::Table table = {
+			&Kernels<L>::EvaluatePrimitive,
+			&Kernels<L>::EvaluateGroup,
+			static_cast<void (*)(float*, const float*, float, uint32_t)>(&Kernels<L>::SmoothUnion),
+			&Kernels<L>::EvaluateProgram,
+			&Kernels<L>::template EvaluateExpression<SdfExpression::TowerScene>,
+			&Kernels<L>::template EvaluateExpression<SdfExpression::BlendChain>,
+			&Kernels<L>::EvaluateShapes2D,
+		};
+		return table;
+	}
+}
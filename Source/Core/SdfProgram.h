@@ -0,0 +1,52 @@
+#pragma once
+
+#include "SdfExpression.h"
+
+// SdfKernels' interpreted path: a scene built at run time as postfix bytecode (see SdfKernels::Op).
+// [Important] Kept out of SdfKernels.h and SdfExpression.h, which the AVX builds include: std::vector code
+// must not be compiled with their /arch (see SdfKernelsImpl.h).
+namespace SdfKernels
+{
+	struct Program
+	{
+		std::vector<Instruction> Code;
+		std::vector<Primitive> Primitives;
+
+		void Clear();
+		void PushPrimitive(const Primitive& primitive);
+		void PushUnion();
+		void PushSmoothUnion(float k);
+
+		// Leaves exactly one value and never holds more than MaxProgramStack on the way
+		bool IsValid() const;
+	};
+
+	// out[i] = the program's distance at point i; FarDistance everywhere when the program is not valid
+	void EvaluateProgram(const Program& program, const Points& points, float* out);
+}
+
+// Writes an SdfExpression scene as the Program that computes the same distance
+namespace SdfExpression
+{
+	template <uint32_t Type>
+	void Emit(const ShapeNode<Type>& node, SdfKernels::Program& program)
+	{
+		program.PushPrimitive(node.Primitive);
+	}
+
+	template <typename A, typename B>
+	void Emit(const UnionNode<A, B>& node, SdfKernels::Program& program)
+	{
+		Emit(node.First, program);
+		Emit(node.Second, program);
+		program.PushUnion();
+	}
+
+	template <typename A, typename B>
+	void Emit(const SmoothUnionNode<A, B>& node, SdfKernels::Program& program)
+	{
+		Emit(node.First, program);
+		Emit(node.Second, program);
+		program.PushSmoothUnion(node.K);
+	}
+}
@@ -0,0 +1,1063 @@
+#include <random>
+#include <cfloat>
+
+#include "SdfScene.h"
+#include "Constant.h"
+
+namespace
+{
+	// Primitive counts of the benchmark sweep
+	constexpr int BenchmarkCounts[] = { 16, 64, 256, 1024, 4096, 16384 };
+	constexpr int BenchmarkCountSize = (int)(sizeof(BenchmarkCounts) / sizeof(BenchmarkCounts[0]));
+
+	// Tile segment flag: no surface inside, the ray skips to the segment end (SDF_SEGMENT_EMPTY)
+	constexpr uint32_t SegmentEmpty = 0x80000000u;
+	constexpr uint32_t AllMembers = 0xFFFFFFFFu;
+
+	// Benchmark modes per primitive count
+	enum BenchmarkMode { BenchmarkBvh = 0, BenchmarkTiled = 1, BenchmarkBrute = 2, BenchmarkModeCount = 3 };
+
+	// Trace benchmark variants, each adding one improvement to the plain march
+	struct TraceVariant
+	{
+		const char* Name;
+		float       Relaxation;
+		float       PixelFootprint;
+		bool        bConePrepass;
+		bool        bBricks;
+	};
+
+	constexpr TraceVariant TraceVariants[] = {
+		{ "Plain",               1.0f,                          0.0f,                             false, false },
+		{ "Over-relaxed",        SdfScene::DefaultRelaxation,   0.0f,                             false, false },
+		{ "+ Footprint epsilon", SdfScene::DefaultRelaxation,   SdfScene::DefaultPixelFootprint, false, false },
+		{ "+ Cone pre-pass",     SdfScene::DefaultRelaxation,   SdfScene::DefaultPixelFootprint, true,  false },
+		{ "+ Baked bricks",      SdfScene::DefaultRelaxation,   SdfScene::DefaultPixelFootprint, true,  true },
+	};
+	constexpr int TraceVariantCount = (int)(sizeof(TraceVariants) / sizeof(TraceVariants[0]));
+
+	// Shading benchmark variants over the same trace; the naive one sets the cost the others are compared to
+	struct ShadingVariant
+	{
+		const char*           Name;
+		SdfScene::ShadingMode Mode;
+	};
+
+	constexpr ShadingVariant ShadingVariants[] = {
+		{ "Naive (6 + AO + shadow queries)", SdfScene::ShadingMode::Naive },
+		{ "Shared neighbourhood",            SdfScene::ShadingMode::Shared },
+		{ "Normal only",                     SdfScene::ShadingMode::Basic },
+	};
+	constexpr int ShadingVariantCount = (int)(sizeof(ShadingVariants) / sizeof(ShadingVariants[0]));
+}
+
+void SdfScene::Initialize(ID3D11Device* device, ID3D11DeviceContext* context, ThreadPool& workers)
+{
+	m_pDevice = device;
+	m_pContext = context;
+	m_pWorkers = &workers;
+
+	D3D11_BUFFER_DESC bufferDesc = {};
+	bufferDesc.ByteWidth = sizeof(SceneConstants);
+	bufferDesc.Usage = D3D11_USAGE_DYNAMIC; // The BVH and ground toggles apply without a rebuild
+	bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	bufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+
+	ThrowIfFailed(m_pDevice->CreateBuffer(&bufferDesc, nullptr, &m_ConstantBuffer));
+
+	m_Bricks.Initialize(device, context);
+
+	// A wide build that disagrees with the reference is not worth its speed
+	m_bKernelCheckPassed = SdfKernels::SelfCheck(m_KernelChecks);
+	if (!m_bKernelCheckPassed)
+		SdfKernels::SetIsa(SdfKernels::Isa::Scalar);
+
+	Rebuild();
+}
+
+void SdfScene::Clear()
+{
+	m_Groups.clear();
+}
+
+int SdfScene::AddGroup(float smoothness)
+{
+	Group group;
+	group.Smoothness = smoothness;
+	m_Groups.push_back(group);
+	return (int)m_Groups.size() - 1;
+}
+
+void SdfScene::AddPrimitive(int group, const Primitive& primitive)
+{
+	m_Groups[group].Primitives.push_back(primitive);
+}
+
+void SdfScene::Rebuild()
+{
+	Clear();
+	if (m_Settings.ScenePreset == Preset::Field)
+		BuildFieldScene(m_Settings.FieldPrimitives, m_Settings.FieldGroupSize);
+	else
+		BuildDemoScene();
+	Build();
+}
+
+void SdfScene::BuildDemoScene()
+{
+	// Placed inside the cloud box so clouds sit both in front of and behind it
+	Primitive pillar;
+	pillar.Type = PrimitiveType::Cylinder;
+	pillar.Position = Vector3(0.0f, 20.0f, 0.0f);
+	pillar.Params = Vector4(6.0f, 20.0f, 0.0f, 0.0f);
+
+	Primitive cap;
+	cap.Type = PrimitiveType::Sphere;
+	cap.Position = Vector3(0.0f, 42.0f, 0.0f);
+	cap.Params = Vector4(10.0f, 0.0f, 0.0f, 0.0f);
+
+	int tower = AddGroup(4.0f);
+	AddPrimitive(tower, pillar);
+	AddPrimitive(tower, cap);
+
+	Primitive ball;
+	ball.Type = PrimitiveType::Sphere;
+	ball.Position = Vector3(40.0f, 12.0f, -40.0f);
+	ball.Params = Vector4(12.0f, 0.0f, 0.0f, 0.0f);
+	AddPrimitive(AddGroup(0.0f), ball);
+}
+
+void SdfScene::BuildFieldScene(int primitiveCount, int groupSize)
+{
+	// Fixed seed: benchmark runs trace the same field
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+	groupSize = (std::max)(groupSize, 1);
+	int groupCount = (primitiveCount + groupSize - 1) / groupSize;
+
+	// Groups on a jittered grid centred on the origin, about one per 12 x 12 units
+	const float spacing = 12.0f;
+	int side = (int)ceilf(sqrtf((float)groupCount));
+	float half = side * spacing * 0.5f;
+
+	int remaining = primitiveCount;
+	for (int g = 0; g < groupCount; g++)
+	{
+		float cx = (g % side) * spacing - half + spacing * (0.25f + 0.5f * unit(rng));
+		float cz = (g / side) * spacing - half + spacing * (0.25f + 0.5f * unit(rng));
+		int group = AddGroup(1.5f);
+
+		int members = (std::min)(groupSize, remaining);
+		remaining -= members;
+		for (int i = 0; i < members; i++)
+		{
+			Primitive primitive;
+			primitive.Type = (PrimitiveType)(int)(unit(rng) * 4.0f);
+			primitive.Position = Vector3(cx + (unit(rng) - 0.5f) * 6.0f, 1.0f + unit(rng) * 6.0f, cz + (unit(rng) - 0.5f) * 6.0f);
+			primitive.Rotation = Vector3(unit(rng), unit(rng), unit(rng)) * 6.2831853f;
+			primitive.Scale = 0.6f + unit(rng);
+
+			switch (primitive.Type)
+			{
+			case PrimitiveType::Box:       primitive.Params = Vector4(1.5f, 1.0f + unit(rng), 1.5f, 0.0f); break;
+			case PrimitiveType::Cylinder:  primitive.Params = Vector4(1.0f, 1.5f + unit(rng) * 2.0f, 0.0f, 0.0f); break;
+			case PrimitiveType::CutSphere: primitive.Params = Vector4(2.0f, 0.5f, 0.0f, 0.0f); break;
+			default:                       primitive.Params = Vector4(1.5f + unit(rng), 0.0f, 0.0f, 0.0f); break; // Sphere
+			}
+			AddPrimitive(group, primitive);
+		}
+	}
+}
+
+SdfScene::Bounds SdfScene::GetPrimitiveBounds(const Primitive& primitive)
+{
+	// Local box around the primitive before its transform
+	const Vector4& params = primitive.Params;
+	Vector3 extent;
+	switch (primitive.Type)
+	{
+	case PrimitiveType::Box:       extent = Vector3(params.x, params.y, params.z); break;
+	case PrimitiveType::Cylinder:  extent = Vector3(params.x, params.y, params.x); break;
+	default:                       extent = Vector3(params.x, params.x, params.x); break; // Spheres, cut or not
+	}
+
+	// Rotated corners, scaled and moved
+	DirectX::SimpleMath::Matrix rotation = DirectX::SimpleMath::Matrix::CreateFromYawPitchRoll(
+		primitive.Rotation.x, primitive.Rotation.y, primitive.Rotation.z);
+
+	Bounds bounds = { Vector3(FLT_MAX, FLT_MAX, FLT_MAX), Vector3(-FLT_MAX, -FLT_MAX, -FLT_MAX) };
+	for (int i = 0; i < 8; i++)
+	{
+		Vector3 corner((i & 1) ? extent.x : -extent.x, (i & 2) ? extent.y : -extent.y, (i & 4) ? extent.z : -extent.z);
+		Vector3 world = Vector3::TransformNormal(corner, rotation) * primitive.Scale + primitive.Position;
+		bounds.Min = Vector3::Min(bounds.Min, world);
+		bounds.Max = Vector3::Max(bounds.Max, world);
+	}
+	return bounds;
+}
+
+SdfScene::GpuPrimitive SdfScene::ToGpuPrimitive(const Primitive& primitive)
+{
+	// SimpleMath multiplies row vectors: world = local * R + t, so local = (world - t) * R^T and the
+	// rows of R are the rows of the inverse rotation
+	DirectX::SimpleMath::Matrix rotation = DirectX::SimpleMath::Matrix::CreateFromYawPitchRoll(
+		primitive.Rotation.x, primitive.Rotation.y, primitive.Rotation.z);
+
+	GpuPrimitive gpu = {};
+	for (int row = 0; row < 3; row++)
+	{
+		Vector3 axis(rotation.m[row][0], rotation.m[row][1], rotation.m[row][2]);
+		gpu.WorldToLocal[row] = { axis.x, axis.y, axis.z, -axis.Dot(primitive.Position) };
+	}
+	gpu.Params = { primitive.Params.x, primitive.Params.y, primitive.Params.z, primitive.Params.w };
+	gpu.Type = (uint32_t)primitive.Type;
+	gpu.Scale = (std::max)(primitive.Scale, 1e-4f);
+	return gpu;
+}
+
+void SdfScene::Build()
+{
+	// The bake reads the buffers rebuilt below, and its bricks belong to the old scene
+	m_Bricks.Clear();
+
+	double start = GetSeconds();
+
+	// A chain of n smooth unions can undercut the nearest member by (n - 1) * k / 4, so the group
+	// bounds grow by that much to stay a lower bound of the group distance
+	std::vector<Bounds> groupBounds(m_Groups.size());
+	for (size_t g = 0; g < m_Groups.size(); g++)
+	{
+		const Group& group = m_Groups[g];
+		Bounds bounds = { Vector3(FLT_MAX, FLT_MAX, FLT_MAX), Vector3(-FLT_MAX, -FLT_MAX, -FLT_MAX) };
+		for (const Primitive& primitive : group.Primitives)
+		{
+			Bounds primitiveBounds = GetPrimitiveBounds(primitive);
+			bounds.Min = Vector3::Min(bounds.Min, primitiveBounds.Min);
+			bounds.Max = Vector3::Max(bounds.Max, primitiveBounds.Max);
+		}
+
+		float inflate = (std::max)((int)group.Primitives.size() - 1, 0) * (std::max)(group.Smoothness, 0.0f) * 0.25f;
+		bounds.Min -= Vector3(inflate, inflate, inflate);
+		bounds.Max += Vector3(inflate, inflate, inflate);
+		groupBounds[g] = bounds;
+	}
+
+	// Empty groups would never be hit; leave them out of the tree
+	m_Order.clear();
+	for (UINT g = 0; g < (UINT)m_Groups.size(); g++)
+	{
+		if (!m_Groups[g].Primitives.empty()) m_Order.push_back(g);
+	}
+
+	m_Nodes.clear();
+	m_Stats.Depth = 0;
+	if (!m_Order.empty())
+		BuildNode(groupBounds, 0, (UINT)m_Order.size(), 0);
+
+	// Groups and their primitives in leaf order, so a leaf reads one contiguous range
+	std::vector<GpuGroup>& groups = m_GpuGroups;
+	std::vector<GpuPrimitive>& primitives = m_GpuPrimitives;
+	groups.clear();
+	primitives.clear();
+	groups.reserve(m_Order.size());
+	m_GroupBounds.clear();
+	for (UINT index : m_Order)
+	{
+		const Group& group = m_Groups[index];
+
+		GpuGroup gpu = {};
+		gpu.FirstPrimitive = (uint32_t)primitives.size();
+		gpu.PrimitiveCount = (uint32_t)group.Primitives.size();
+		gpu.Smoothness = group.Smoothness;
+		groups.push_back(gpu);
+		m_GroupBounds.push_back(groupBounds[index]);
+
+		for (const Primitive& primitive : group.Primitives)
+			primitives.push_back(ToGpuPrimitive(primitive));
+	}
+
+	CreateStructuredBuffer(m_Nodes.data(), sizeof(GpuNode), (UINT)m_Nodes.size(), m_NodeBuffer, m_NodeSRV);
+	CreateStructuredBuffer(groups.data(), sizeof(GpuGroup), (UINT)groups.size(), m_GroupBuffer, m_GroupSRV);
+	CreateStructuredBuffer(primitives.data(), sizeof(GpuPrimitive), (UINT)primitives.size(), m_PrimitiveBuffer, m_PrimitiveSRV);
+
+	m_Stats.Primitives = (int)primitives.size();
+	m_Stats.Groups = (int)groups.size();
+	m_Stats.Nodes = (int)m_Nodes.size();
+	m_Stats.BuildMs = (float)((GetSeconds() - start) * 1000.0);
+
+	// Tile lists index groups in leaf order
+	m_BuildIndex++;
+	m_bTilesValid = false;
+}
+
+void SdfScene::BuildNode(const std::vector<Bounds>& groupBounds, UINT first, UINT count, int depth)
+{
+	UINT index = (UINT)m_Nodes.size();
+	m_Nodes.push_back({});
+	m_Stats.Depth = (std::max)(m_Stats.Depth, depth);
+
+	Bounds bounds = { Vector3(FLT_MAX, FLT_MAX, FLT_MAX), Vector3(-FLT_MAX, -FLT_MAX, -FLT_MAX) };
+	Bounds centroids = bounds;
+	for (UINT i = first; i < first + count; i++)
+	{
+		const Bounds& group = groupBounds[m_Order[i]];
+		Vector3 centroid = (group.Min + group.Max) * 0.5f;
+		bounds.Min = Vector3::Min(bounds.Min, group.Min);
+		bounds.Max = Vector3::Max(bounds.Max, group.Max);
+		centroids.Min = Vector3::Min(centroids.Min, centroid);
+		centroids.Max = Vector3::Max(centroids.Max, centroid);
+	}
+
+	m_Nodes[index].Min = bounds.Min;
+	m_Nodes[index].Max = bounds.Max;
+
+	Vector3 spread = centroids.Max - centroids.Min;
+	int axis = (spread.x >= spread.y && spread.x >= spread.z) ? 0 : (spread.y >= spread.z ? 1 : 2);
+	float axisSpread = (axis == 0) ? spread.x : (axis == 1 ? spread.y : spread.z);
+
+	// The depth limit keeps the traversal inside the shader's fixed stack; such a leaf just holds more groups
+	if (count <= MaxLeafGroups || depth >= MaxDepth || axisSpread <= 0.0f)
+	{
+		m_Nodes[index].Next = first;
+		m_Nodes[index].GroupCount = count;
+		return;
+	}
+
+	auto centre = [&groupBounds, axis](UINT group)
+	{
+		const Bounds& b = groupBounds[group];
+		return (axis == 0) ? b.Min.x + b.Max.x : (axis == 1 ? b.Min.y + b.Max.y : b.Min.z + b.Max.z);
+	};
+
+	UINT half = count / 2;
+	std::nth_element(m_Order.begin() + first, m_Order.begin() + first + half, m_Order.begin() + first + count,
+		[&centre](UINT a, UINT b) { return centre(a) < centre(b); });
+
+	// Left child directly follows its parent; the right child index is known once the left subtree is laid out
+	BuildNode(groupBounds, first, half, depth + 1);
+	m_Nodes[index].Next = (uint32_t)m_Nodes.size();
+	m_Nodes[index].GroupCount = 0;
+	BuildNode(groupBounds, first + half, count - half, depth + 1);
+}
+
+void SdfScene::CreateStructuredBuffer(const void* data, UINT stride, UINT count,
+	ComPtr<ID3D11Buffer>& buffer, ComPtr<ID3D11ShaderResourceView>& srv)
+{
+	// An empty scene still binds one zeroed element; the counts in the constants keep the shader off it
+	std::vector<uint8_t> zeros;
+	if (count == 0)
+	{
+		zeros.assign(stride, 0);
+		data = zeros.data();
+		count = 1;
+	}
+
+	D3D11_BUFFER_DESC bufferDesc = {};
+	bufferDesc.ByteWidth = stride * count;
+	bufferDesc.Usage = D3D11_USAGE_IMMUTABLE; // Replaced as a whole on every build
+	bufferDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	bufferDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+	bufferDesc.StructureByteStride = stride;
+
+	D3D11_SUBRESOURCE_DATA initData = {};
+	initData.pSysMem = data;
+
+	ThrowIfFailed(m_pDevice->CreateBuffer(&bufferDesc, &initData, buffer.ReleaseAndGetAddressOf()));
+	ThrowIfFailed(m_pDevice->CreateShaderResourceView(buffer.Get(), nullptr, srv.ReleaseAndGetAddressOf()));
+}
+
+bool SdfScene::GetBounds(Vector3& boundsMin, Vector3& boundsMax) const
+{
+	if (m_Nodes.empty()) return false;
+
+	boundsMin = m_Nodes[0].Min;
+	boundsMax = m_Nodes[0].Max;
+	return true;
+}
+
+float SdfScene::GetGroupDistance(UINT groupIndex, const Vector3& p, uint32_t memberMask) const
+{
+	const GpuGroup& group = m_GpuGroups[groupIndex];
+
+	float d = TraceDistance;
+	for (UINT i = 0; i < group.PrimitiveCount; i++)
+	{
+		if (i < 32 && !(memberMask & (1u << i))) continue;
+
+		float di = SdfKernels::GetPrimitiveDistance(m_GpuPrimitives[group.FirstPrimitive + i], p.x, p.y, p.z);
+		if (i == 0 || group.Smoothness <= 0.0f)
+		{
+			d = (std::min)(d, di);
+			continue;
+		}
+
+		// opSmoothUnion(d, di, k)
+		float k = group.Smoothness;
+		float h = (std::min)((std::max)(0.5f + 0.5f * (di - d) / k, 0.0f), 1.0f);
+		d = di + (d - di) * h - k * h * (1.0f - h);
+	}
+	return d;
+}
+
+void SdfScene::GetGroupDistances(UINT groupIndex, const SdfKernels::Points& points, float* out, uint32_t memberMask) const
+{
+	const GpuGroup& group = m_GpuGroups[groupIndex];
+	SdfKernels::EvaluateGroup(m_GpuPrimitives.data() + group.FirstPrimitive, group.PrimitiveCount, group.Smoothness, memberMask, points, out);
+}
+
+void SdfScene::BenchmarkKernels()
+{
+	SdfKernels::RunBenchmark(m_KernelResults);
+	SdfKernels::RunExpressionBenchmark(m_ExpressionResults);
+}
+
+float SdfScene::GetDistance(const Vector3& p) const
+{
+	// Nearest child first, as getSceneDistance does
+	float best = FLT_MAX;
+	if (m_Nodes.empty()) return best;
+
+	auto boxDistance = [&p](const GpuNode& node)
+	{
+		Vector3 gap = Vector3::Max(Vector3::Max(node.Min - p, p - node.Max), Vector3(0.0f, 0.0f, 0.0f));
+		return gap.Length();
+	};
+
+	UINT stack[MaxDepth + 1];
+	float stackDistance[MaxDepth + 1];
+	UINT stackSize = 0;
+	stack[stackSize] = 0;
+	stackDistance[stackSize++] = 0.0f;
+
+	while (stackSize > 0)
+	{
+		stackSize--;
+		if (stackDistance[stackSize] >= best) continue;
+
+		UINT index = stack[stackSize];
+		const GpuNode& node = m_Nodes[index];
+		if (node.GroupCount > 0)
+		{
+			for (UINT g = node.Next; g < node.Next + node.GroupCount; g++)
+				best = (std::min)(best, GetGroupDistance(g, p));
+			continue;
+		}
+
+		UINT left = index + 1;
+		UINT right = node.Next;
+		float leftDistance = boxDistance(m_Nodes[left]);
+		float rightDistance = boxDistance(m_Nodes[right]);
+		bool bLeftFirst = leftDistance <= rightDistance;
+
+		if ((std::max)(leftDistance, rightDistance) < best)
+		{
+			stack[stackSize] = bLeftFirst ? right : left;
+			stackDistance[stackSize++] = (std::max)(leftDistance, rightDistance);
+		}
+		if ((std::min)(leftDistance, rightDistance) < best)
+		{
+			stack[stackSize] = bLeftFirst ? left : right;
+			stackDistance[stackSize++] = (std::min)(leftDistance, rightDistance);
+		}
+	}
+	return best;
+}
+
+void SdfScene::GatherGroups(const Vector3& boxMin, const Vector3& boxMax, std::vector<UINT>& groups) const
+{
+	groups.clear();
+	if (m_Nodes.empty()) return;
+
+	UINT stack[MaxDepth + 1];
+	UINT stackSize = 0;
+	stack[stackSize++] = 0;
+
+	while (stackSize > 0)
+	{
+		UINT index = stack[--stackSize];
+		const GpuNode& node = m_Nodes[index];
+		if (node.Min.x > boxMax.x || node.Max.x < boxMin.x ||
+			node.Min.y > boxMax.y || node.Max.y < boxMin.y ||
+			node.Min.z > boxMax.z || node.Max.z < boxMin.z)
+			continue;
+
+		if (node.GroupCount > 0)
+		{
+			for (UINT g = node.Next; g < node.Next + node.GroupCount; g++)
+				groups.push_back(g);
+			continue;
+		}
+
+		stack[stackSize++] = node.Next;
+		stack[stackSize++] = index + 1;
+	}
+}
+
+float SdfScene::GetSegmentStart(UINT segment)
+{
+	// Segments double in length, so near tiles get fine depth slices and the horizon a few long ones
+	const float scale = TraceDistance / (float)((1u << SegmentCount) - 1);
+	return scale * (float)((1u << segment) - 1);
+}
+
+SdfScene::Bounds SdfScene::GetTileSegmentBounds(const TileView& view, UINT x0, UINT y0, UINT size, UINT segment) const
+{
+	float u[2] = { (float)x0 / view.Width - view.PadU, (float)(x0 + size) / view.Width + view.PadU };
+	float v[2] = { (float)y0 / view.Height - view.PadV, (float)(y0 + size) / view.Height + view.PadV };
+
+	auto getRay = [&view](float uvX, float uvY)
+	{
+		Vector3 ray = view.Right * ((uvX - 0.5f) * 2.0f * view.Aspect) - view.Up * ((uvY - 0.5f) * 2.0f) + view.Dir;
+		ray.Normalize();
+		return ray;
+	};
+
+	// Every ray of the tile lies in the pyramid of the corner rays, and its points at distance t project
+	// onto the tile axis between t * cos(widest corner angle) and t, so the pyramid slab between those
+	// depths holds the whole segment; the corners of that slab bound it
+	Vector3 axis = getRay((u[0] + u[1]) * 0.5f, (v[0] + v[1]) * 0.5f);
+	Vector3 corners[4];
+	float minCos = 1.0f;
+	for (int i = 0; i < 4; i++)
+	{
+		Vector3 ray = getRay(u[i & 1], v[i >> 1]);
+		float cosine = (std::max)(ray.Dot(axis), 1e-3f);
+		minCos = (std::min)(minCos, cosine);
+		corners[i] = ray / cosine;
+	}
+
+	float nearDepth = GetSegmentStart(segment) * minCos;
+	float farDepth = GetSegmentStart(segment + 1);
+
+	Bounds bounds = { Vector3(FLT_MAX, FLT_MAX, FLT_MAX), Vector3(-FLT_MAX, -FLT_MAX, -FLT_MAX) };
+	for (int i = 0; i < 4; i++)
+	{
+		Vector3 nearPoint = view.Position + corners[i] * nearDepth;
+		Vector3 farPoint = view.Position + corners[i] * farDepth;
+		bounds.Min = Vector3::Min(bounds.Min, Vector3::Min(nearPoint, farPoint));
+		bounds.Max = Vector3::Max(bounds.Max, Vector3::Max(nearPoint, farPoint));
+	}
+	return bounds;
+}
+
+void SdfScene::QueryGroups(const Bounds& box, std::vector<TileEntry>& entries) const
+{
+	std::vector<UINT> groups;
+	GatherGroups(box.Min, box.Max, groups);
+
+	entries.clear();
+	for (UINT group : groups)
+		entries.push_back({ group, AllMembers });
+}
+
+bool SdfScene::PruneEntries(const Bounds& box, const std::vector<TileEntry>& entries, std::vector<TileEntry>& pruned) const
+{
+	// Every primitive distance is 1-Lipschitz, so over the box it stays within the half diagonal of its
+	// value at the centre. Those leaf intervals go through the min / smooth-union tree of each group,
+	// and the group's inflated bounds tighten the lower end.
+	Vector3 centre = (box.Min + box.Max) * 0.5f;
+	float radius = ((box.Max - box.Min) * 0.5f).Length();
+
+	// The ground plane is p.y itself
+	float sceneHi = m_Settings.bGroundEnabled ? box.Max.y : FLT_MAX;
+	float sceneLo = m_Settings.bGroundEnabled ? box.Min.y : FLT_MAX;
+
+	std::vector<Interval> intervals(entries.size());
+	std::vector<uint32_t> masks(entries.size());
+	for (size_t e = 0; e < entries.size(); e++)
+	{
+		const TileEntry& entry = entries[e];
+		const GpuGroup& group = m_GpuGroups[entry.Group];
+		float k = (std::max)(group.Smoothness, 0.0f);
+
+		// Groups past the 32 mask bits are kept whole
+		bool bMaskable = group.PrimitiveCount <= 32;
+		uint32_t mask = bMaskable ? 0u : AllMembers;
+
+		float runningHi = FLT_MAX;
+		float lo = FLT_MAX;
+		UINT kept = 0;
+		for (UINT i = 0; i < group.PrimitiveCount; i++)
+		{
+			if (bMaskable && !(entry.MemberMask & (1u << i))) continue;
+
+			float d = SdfKernels::GetPrimitiveDistance(m_GpuPrimitives[group.FirstPrimitive + i], centre.x, centre.y, centre.z);
+
+			// A member at least k above everything blended before it leaves the chain unchanged
+			if (kept > 0 && bMaskable && d - radius >= runningHi + k) continue;
+
+			runningHi = (std::min)(runningHi, d + radius);
+			lo = (std::min)(lo, d - radius);
+			kept++;
+			if (bMaskable) mask |= 1u << i;
+		}
+
+		// The blend chain undercuts its nearest member by at most (n - 1) * k / 4 and never exceeds it
+		const Bounds& bounds = m_GroupBounds[entry.Group];
+		Vector3 gap = Vector3::Max(Vector3::Max(bounds.Min - box.Max, box.Min - bounds.Max), Vector3(0.0f, 0.0f, 0.0f));
+		intervals[e].Lo = (std::max)(lo - (float)(kept - 1) * k * 0.25f, gap.Length());
+		intervals[e].Hi = runningHi;
+		masks[e] = mask;
+
+		sceneHi = (std::min)(sceneHi, runningHi);
+	}
+
+	// A group that stays above another's upper bound everywhere in the box never wins the min
+	pruned.clear();
+	for (size_t e = 0; e < entries.size(); e++)
+	{
+		if (intervals[e].Lo > sceneHi) continue;
+
+		pruned.push_back({ entries[e].Group, masks[e] });
+		sceneLo = (std::min)(sceneLo, intervals[e].Lo);
+	}
+	return sceneLo <= 0.0f;
+}
+
+void SdfScene::BuildTile(const TileView& view, UINT x0, UINT y0, UINT size, UINT segment,
+	const std::vector<TileEntry>& parent, TileRow& row)
+{
+	if (x0 >= view.Width || y0 >= view.Height) return;
+
+	std::vector<TileEntry> entries;
+	if (!PruneEntries(GetTileSegmentBounds(view, x0, y0, size, segment), parent, entries))
+	{
+		WriteTileSegment(x0, y0, size, segment, 0, SegmentEmpty);
+		return;
+	}
+
+	// Each level only re-evaluates what survived its parent
+	if (size > LeafTileSize && entries.size() >= SubdivideMinEntries)
+	{
+		UINT half = size / 2;
+		BuildTile(view, x0, y0, half, segment, entries, row);
+		BuildTile(view, x0 + half, y0, half, segment, entries, row);
+		BuildTile(view, x0, y0 + half, half, segment, entries, row);
+		BuildTile(view, x0 + half, y0 + half, half, segment, entries, row);
+		return;
+	}
+
+	// Leaf tiles under a coarse tile share its list
+	uint32_t offset = (uint32_t)row.Entries.size();
+	row.Entries.insert(row.Entries.end(), entries.begin(), entries.end());
+	WriteTileSegment(x0, y0, size, segment, offset, (uint32_t)entries.size());
+}
+
+void SdfScene::WriteTileSegment(UINT x0, UINT y0, UINT size, UINT segment, uint32_t offset, uint32_t count)
+{
+	UINT tileX1 = (std::min)((x0 + size) / LeafTileSize, m_TilesX);
+	UINT tileY1 = (std::min)((y0 + size) / LeafTileSize, m_TilesY);
+	for (UINT ty = y0 / LeafTileSize; ty < tileY1; ty++)
+	{
+		for (UINT tx = x0 / LeafTileSize; tx < tileX1; tx++)
+		{
+			size_t index = ((size_t)(ty * m_TilesX + tx) * SegmentCount + segment) * 2;
+			m_TileSegments[index] = offset;
+			m_TileSegments[index + 1] = count;
+		}
+	}
+}
+
+void SdfScene::UpdateTiles(const Constant& constant, UINT width, UINT height)
+{
+	if (!m_Settings.bTileLists || width == 0 || height == 0) return;
+
+	// Jitter stays within the tile margin, so only the camera, the pass size and the scene matter
+	const auto& global = constant.m_GlobalConstants;
+	float key[16] = {
+		global.CameraPos.x, global.CameraPos.y, global.CameraPos.z,
+		global.CameraDir.x, global.CameraDir.y, global.CameraDir.z,
+		global.CameraRight.x, global.CameraRight.y, global.CameraRight.z,
+		global.CameraUp.x, global.CameraUp.y, global.CameraUp.z,
+		(float)width, (float)height, (float)m_BuildIndex, m_Settings.bGroundEnabled ? 1.0f : 0.0f };
+	if (m_bTilesValid && memcmp(key, m_TileKey, sizeof(key)) == 0) return;
+	memcpy(m_TileKey, key, sizeof(key));
+
+	double start = GetSeconds();
+
+	TileView view = {};
+	view.Position = global.CameraPos;
+	view.Dir = global.CameraDir;
+	view.Right = global.CameraRight;
+	view.Up = global.CameraUp;
+	view.Aspect = global.Resolution.x / (std::max)(global.Resolution.y, 1.0f);
+	view.PadU = 1.0f / (std::max)(global.Resolution.x, 1.0f);
+	view.PadV = 1.0f / (std::max)(global.Resolution.y, 1.0f);
+	view.Width = width;
+	view.Height = height;
+
+	m_TilesX = (width + LeafTileSize - 1) / LeafTileSize;
+	m_TilesY = (height + LeafTileSize - 1) / LeafTileSize;
+	m_TileSegments.assign((size_t)m_TilesX * m_TilesY * SegmentCount * 2, 0);
+
+	// One job per row of root tiles; rows write disjoint leaf segments
+	UINT rootX = (width + RootTileSize - 1) / RootTileSize;
+	UINT rootY = (height + RootTileSize - 1) / RootTileSize;
+	std::vector<TileRow> rows(rootY);
+
+	m_pWorkers->ParallelFor(rootY, [this, &view, &rows, rootX](UINT ry)
+	{
+		std::vector<TileEntry> candidates;
+		for (UINT rx = 0; rx < rootX; rx++)
+		{
+			for (UINT segment = 0; segment < SegmentCount; segment++)
+			{
+				UINT x0 = rx * RootTileSize;
+				UINT y0 = ry * RootTileSize;
+				QueryGroups(GetTileSegmentBounds(view, x0, y0, RootTileSize, segment), candidates);
+				BuildTile(view, x0, y0, RootTileSize, segment, candidates, rows[ry]);
+			}
+		}
+	});
+
+	// Rows own consecutive leaf tile rows: shift their offsets past the rows before them
+	m_TileEntries.clear();
+	const UINT rowTiles = RootTileSize / LeafTileSize;
+	for (UINT ry = 0; ry < rootY; ry++)
+	{
+		uint32_t base = (uint32_t)m_TileEntries.size();
+		size_t first = (size_t)ry * rowTiles * m_TilesX * SegmentCount * 2;
+		size_t last = (std::min)((size_t)(ry + 1) * rowTiles, (size_t)m_TilesY) * m_TilesX * SegmentCount * 2;
+		for (size_t i = first; i < last; i += 2)
+		{
+			if (!(m_TileSegments[i + 1] & SegmentEmpty)) m_TileSegments[i] += base;
+		}
+		m_TileEntries.insert(m_TileEntries.end(), rows[ry].Entries.begin(), rows[ry].Entries.end());
+	}
+
+	UploadTiles();
+	m_bTilesValid = true;
+
+	UINT emptyCount = 0;
+	UINT64 entryCount = 0;
+	int maxEntries = 0;
+	UINT segmentTotal = (UINT)(m_TileSegments.size() / 2);
+	for (size_t i = 0; i < m_TileSegments.size(); i += 2)
+	{
+		uint32_t count = m_TileSegments[i + 1];
+		if (count & SegmentEmpty)
+		{
+			emptyCount++;
+			continue;
+		}
+		entryCount += count;
+		maxEntries = (std::max)(maxEntries, (int)count);
+	}
+
+	m_Stats.TileMs = (float)((GetSeconds() - start) * 1000.0);
+	m_Stats.AvgEntries = (segmentTotal > emptyCount) ? (float)entryCount / (float)(segmentTotal - emptyCount) : 0.0f;
+	m_Stats.MaxEntries = maxEntries;
+	m_Stats.EmptySegments = (segmentTotal > 0) ? (float)emptyCount / (float)segmentTotal : 0.0f;
+}
+
+void SdfScene::UploadTiles()
+{
+	// Dynamic buffers grown by half again when outgrown, refilled in place on each refresh
+	auto upload = [this](const void* data, UINT stride, UINT count, UINT& capacity,
+		ComPtr<ID3D11Buffer>& buffer, ComPtr<ID3D11ShaderResourceView>& srv)
+	{
+		count = (std::max)(count, 1u);
+		if (count > capacity)
+		{
+			capacity = count + count / 2;
+
+			D3D11_BUFFER_DESC bufferDesc = {};
+			bufferDesc.ByteWidth = stride * capacity;
+			bufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+			bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+			bufferDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+			bufferDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+			bufferDesc.StructureByteStride = stride;
+
+			ThrowIfFailed(m_pDevice->CreateBuffer(&bufferDesc, nullptr, buffer.ReleaseAndGetAddressOf()));
+			ThrowIfFailed(m_pDevice->CreateShaderResourceView(buffer.Get(), nullptr, srv.ReleaseAndGetAddressOf()));
+		}
+
+		D3D11_MAPPED_SUBRESOURCE msr;
+		if (SUCCEEDED(m_pContext->Map(buffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &msr)))
+		{
+			if (data) memcpy(msr.pData, data, (size_t)stride * count);
+			m_pContext->Unmap(buffer.Get(), 0);
+		}
+	};
+
+	upload(m_TileSegments.empty() ? nullptr : m_TileSegments.data(), sizeof(uint32_t) * 2,
+		(UINT)(m_TileSegments.size() / 2), m_TileSegmentCapacity, m_TileSegmentBuffer, m_TileSegmentSRV);
+	upload(m_TileEntries.empty() ? nullptr : m_TileEntries.data(), sizeof(TileEntry),
+		(UINT)m_TileEntries.size(), m_TileEntryCapacity, m_TileEntryBuffer, m_TileEntrySRV);
+}
+
+void SdfScene::BakeBricks()
+{
+	m_Bricks.Bake(*this, m_Settings.BrickVoxelSize, m_Settings.BrickBandVoxels, *m_pWorkers);
+	m_BrickBuildIndex = m_BuildIndex;
+}
+
+void SdfScene::BeginPass(const Constant& constant, UINT width, UINT height)
+{
+	UpdateTiles(constant, width, height);
+	UpdateBricks();
+	Bind(width, height);
+}
+
+void SdfScene::UpdateBricks()
+{
+	// Baked in the background on first use after each build; until it lands the trace stays analytic
+	if (m_Settings.bBricks && !m_Nodes.empty() && m_BrickBuildIndex != m_BuildIndex)
+		BakeBricks();
+	m_Bricks.Update();
+}
+
+bool SdfScene::IsBrickBakePending() const
+{
+	return m_Settings.bBricks && !m_Nodes.empty() && (m_Bricks.IsBaking() || m_BrickBuildIndex != m_BuildIndex);
+}
+
+void SdfScene::Bind(UINT width, UINT height)
+{
+	bool bBricks = m_Settings.bBricks && !m_Nodes.empty();
+
+	SceneConstants constants = {};
+	constants.NodeCount = (uint32_t)m_Nodes.size();
+	constants.GroupCount = (uint32_t)m_Stats.Groups;
+	constants.BvhEnabled = m_Settings.bBvhEnabled ? 1 : 0;
+	constants.GroundEnabled = m_Settings.bGroundEnabled ? 1 : 0;
+	constants.TileEnabled = (m_Settings.bTileLists && m_bTilesValid) ? 1 : 0;
+	constants.TileSize = LeafTileSize;
+	constants.TilesX = m_TilesX;
+	constants.SegmentCount = SegmentCount;
+	constants.SegmentScale = GetSegmentStart(1);
+	constants.Relaxation = (std::max)(m_Settings.Relaxation, 1.0f);
+	constants.PixelFootprint = (std::max)(m_Settings.PixelFootprint, 0.0f);
+	constants.ConeTileSize = m_Settings.bConePrepass ? ConeTileSize : 0;
+	constants.PassWidth = (float)width;
+	constants.PassHeight = (float)height;
+	constants.ShadingMode = (uint32_t)m_Settings.Shading;
+	constants.ShadowSharpness = (std::max)(m_Settings.ShadowSharpness, 0.5f);
+	if (bBricks && m_Bricks.IsBaked())
+		constants.Bricks = m_Bricks.GetConstants();
+
+	D3D11_MAPPED_SUBRESOURCE msr;
+	if (SUCCEEDED(m_pContext->Map(m_ConstantBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &msr)))
+	{
+		memcpy(msr.pData, &constants, sizeof(SceneConstants));
+		m_pContext->Unmap(m_ConstantBuffer.Get(), 0);
+	}
+
+	ID3D11ShaderResourceView* srvs[] = { m_NodeSRV.Get(), m_GroupSRV.Get(), m_PrimitiveSRV.Get(),
+		m_TileSegmentSRV.Get(), m_TileEntrySRV.Get() };
+	m_pContext->PSSetConstantBuffers(6, 1, m_ConstantBuffer.GetAddressOf());
+	m_pContext->PSSetShaderResources(9, 5, srvs);
+
+	// The cone pre-pass traces the same scene
+	m_pContext->CSSetConstantBuffers(6, 1, m_ConstantBuffer.GetAddressOf());
+	m_pContext->CSSetShaderResources(9, 5, srvs);
+
+	m_Bricks.Bind();
+}
+
+void SdfScene::StartBenchmark()
+{
+	if (IsBenchmarkRunning()) return;
+
+	m_SavedSettings = m_Settings;
+	m_BenchmarkResults.clear();
+	m_BenchmarkStep = -1;
+	NextBenchmarkStep();
+}
+
+void SdfScene::NextBenchmarkStep()
+{
+	for (m_BenchmarkStep++; m_BenchmarkStep < BenchmarkCountSize * BenchmarkModeCount; m_BenchmarkStep++)
+	{
+		// The unculled pass only runs where it stays well inside the driver timeout
+		bool bBrute = (m_BenchmarkStep % BenchmarkModeCount) == BenchmarkBrute;
+		if (!bBrute || BenchmarkCounts[m_BenchmarkStep / BenchmarkModeCount] <= BruteForceMaxPrimitives) break;
+	}
+
+	if (m_BenchmarkStep >= BenchmarkCountSize * BenchmarkModeCount)
+	{
+		m_BenchmarkStep = -1;
+		m_Settings = m_SavedSettings;
+		Rebuild();
+		return;
+	}
+
+	m_Settings.ScenePreset = Preset::Field;
+	m_Settings.FieldPrimitives = BenchmarkCounts[m_BenchmarkStep / BenchmarkModeCount];
+	m_Settings.bBvhEnabled = (m_BenchmarkStep % BenchmarkModeCount) != BenchmarkBrute;
+	m_Settings.bTileLists = (m_BenchmarkStep % BenchmarkModeCount) == BenchmarkTiled;
+	m_Settings.bGroundEnabled = true;
+	Rebuild();
+
+	m_BenchmarkFrame = 0;
+	m_BenchmarkSumMs = 0.0;
+	m_BenchmarkSamples = 0;
+}
+
+void SdfScene::StartTraceBenchmark()
+{
+	if (IsBenchmarkRunning()) return;
+
+	m_SavedSettings = m_Settings;
+	m_TraceResults.clear();
+	m_bShadingBenchmark = false;
+	m_TraceStep = -1;
+	NextTraceStep();
+}
+
+void SdfScene::StartShadingBenchmark()
+{
+	if (IsBenchmarkRunning()) return;
+
+	m_SavedSettings = m_Settings;
+	m_ShadingResults.clear();
+	m_bShadingBenchmark = true;
+	m_TraceStep = -1;
+	NextTraceStep();
+}
+
+void SdfScene::NextTraceStep()
+{
+	m_TraceStep++;
+	if (m_TraceStep >= (m_bShadingBenchmark ? ShadingVariantCount : TraceVariantCount))
+	{
+		m_TraceStep = -1;
+		m_Settings = m_SavedSettings;
+		return;
+	}
+
+	if (m_bShadingBenchmark)
+	{
+		// Same scene and march; only the shading of the hits changes
+		m_Settings.Shading = ShadingVariants[m_TraceStep].Mode;
+	}
+	else
+	{
+		// Same scene and traversal; only the march and the distance source change
+		const TraceVariant& variant = TraceVariants[m_TraceStep];
+		m_Settings.Relaxation = variant.Relaxation;
+		m_Settings.PixelFootprint = variant.PixelFootprint;
+		m_Settings.bConePrepass = variant.bConePrepass;
+		m_Settings.bBricks = variant.bBricks;
+	}
+
+	m_BenchmarkFrame = 0;
+	m_BenchmarkSumMs = 0.0;
+	m_BenchmarkSamples = 0;
+	memset(m_TraceCounters, 0, sizeof(m_TraceCounters));
+}
+
+void SdfScene::ReportTraceCounters(const uint32_t* counters)
+{
+	UINT64 frame[TraceStatSlots];
+	for (UINT i = 0; i < TraceStatSlots; i++)
+		frame[i] = counters[i];
+	m_TraceStats = GetTraceStats(frame);
+
+	// Readbacks lag a few frames, well inside the warmup, so measured frames only see the current variant
+	if (IsTraceBenchmarkRunning() && m_BenchmarkFrame > BenchmarkWarmupFrames)
+	{
+		for (UINT i = 0; i < TraceStatSlots; i++)
+			m_TraceCounters[i] += counters[i];
+	}
+}
+
+SdfScene::TraceStats SdfScene::GetTraceStats(const UINT64* counters)
+{
+	const UINT hitSlot = TraceHitSlot;
+
+	UINT64 pixels = 0;
+	UINT64 steps = 0;
+	TraceStats stats;
+	for (UINT i = 0; i < hitSlot; i++)
+	{
+		pixels += counters[i];
+		steps += counters[i] * i;
+		if (counters[i] > 0) stats.MaxSteps = (int)i;
+	}
+	if (pixels == 0) return stats;
+
+	// First bin at which 99% of the pixels are done
+	UINT64 target = (pixels * 99 + 99) / 100;
+	UINT64 cumulative = 0;
+	for (UINT i = 0; i < hitSlot; i++)
+	{
+		cumulative += counters[i];
+		if (cumulative >= target)
+		{
+			stats.P99Steps = (int)i;
+			break;
+		}
+	}
+
+	stats.AvgSteps = (float)((double)steps / (double)pixels);
+	stats.HitRate = (float)((double)counters[hitSlot] / (double)pixels);
+	if (counters[hitSlot] > 0)
+		stats.ShadeGroups = (float)((double)counters[TraceShadeSlot] / (double)counters[hitSlot]);
+	return stats;
+}
+
+void SdfScene::UpdateBenchmark(float sceneMs, UINT64 rayCount)
+{
+	if (!IsBenchmarkRunning()) return;
+
+	// A variant marching the bricks is only measured once its bake has landed
+	if (IsBrickBakePending())
+	{
+		m_BenchmarkFrame = 0;
+		return;
+	}
+
+	// The first results still belong to frames queued before the scene changed; a frame without a timestamp
+	// result yet is not a sample
+	if (++m_BenchmarkFrame <= BenchmarkWarmupFrames || sceneMs < 0.0f) return;
+
+	m_BenchmarkSumMs += sceneMs;
+	if (++m_BenchmarkSamples < BenchmarkFrames) return;
+
+	float avgMs = (float)(m_BenchmarkSumMs / m_BenchmarkSamples);
+
+	if (IsTraceBenchmarkRunning())
+	{
+		std::vector<TraceResult>& results = m_bShadingBenchmark ? m_ShadingResults : m_TraceResults;
+
+		TraceResult result;
+		result.Name = m_bShadingBenchmark ? ShadingVariants[m_TraceStep].Name : TraceVariants[m_TraceStep].Name;
+		result.Ms = avgMs;
+		result.Stats = GetTraceStats(m_TraceCounters);
+		if (!results.empty() && avgMs > 0.0f)
+			result.Speedup = results.front().Ms / avgMs;
+		results.push_back(result);
+
+		NextTraceStep();
+		return;
+	}
+
+	double raysPerSec = (avgMs > 0.0f) ? (double)rayCount / (avgMs * 0.001) : 0.0;
+
+	int mode = m_BenchmarkStep % BenchmarkModeCount;
+	if (mode == BenchmarkBvh)
+	{
+		BenchmarkResult result;
+		result.Primitives = m_Stats.Primitives;
+		result.BvhMs = avgMs;
+		result.BvhRaysPerSec = raysPerSec;
+		m_BenchmarkResults.push_back(result);
+	}
+	else if (!m_BenchmarkResults.empty() && mode == BenchmarkTiled)
+	{
+		// The camera holds still, so the lists were built once; that build is what a moving camera pays per frame
+		m_BenchmarkResults.back().TiledMs = avgMs;
+		m_BenchmarkResults.back().TiledRaysPerSec = raysPerSec;
+		m_BenchmarkResults.back().TiledCpuMs = m_Stats.TileMs;
+	}
+	else if (!m_BenchmarkResults.empty())
+	{
+		m_BenchmarkResults.back().BruteMs = avgMs;
+		m_BenchmarkResults.back().BruteRaysPerSec = raysPerSec;
+	}
+
+	NextBenchmarkStep();
+}
@@ -0,0 +1,397 @@
+#pragma once
+
+#include "ThreadPool.h"
+#include "SdfBrickMap.h"
+#include "SdfKernelsCheck.h"
+
+class Constant;
+
+// Scene graph of the SDF tracer: primitives with rigid transforms and a uniform scale, gathered in groups whose
+// members are blended with opSmoothUnion. A BVH over conservative group bounds lets the shader skip everything
+// farther than the best distance found so far, so a query touches a handful of groups out of thousands.
+// Tile lists go further: per screen tile and depth segment, interval bounds of every group over the segment's
+// box drop the groups (and smooth-union members) that cannot win the min there, refined down a quadtree, so a
+// pixel only evaluates the few groups that can shape its own ray.
+// The march settings (over-relaxation, footprint epsilon, cone pre-pass) and the shading mode of the hits ride
+// along in the same constants.
+// A sparse brick volume baked from the groups (SdfBrickMap) can stand in for them away from the surface.
+// [Important] GPU layouts and type ids must match Shaders/Scene3D.hlsli
+class SdfScene
+{
+public:
+	using Vector3 = DirectX::SimpleMath::Vector3;
+	using Vector4 = DirectX::SimpleMath::Vector4;
+
+	enum class PrimitiveType : uint32_t { Sphere = 0, Box = 1, Cylinder = 2, CutSphere = 3 };
+
+	struct Primitive
+	{
+		PrimitiveType Type = PrimitiveType::Sphere;
+		Vector3 Position;
+		Vector3 Rotation;        // Yaw, pitch, roll in radians
+		float   Scale = 1.0f;
+		Vector4 Params;          // Sphere: radius. Box: half extents. Cylinder: radius, half height. CutSphere: radius, cut height
+	};
+
+	enum class Preset { Demo, Field };
+
+	// Same ids as SDF_SHADING_* in Shaders/Scene3D.hlsli
+	enum class ShadingMode : uint32_t { Basic = 0, Naive = 1, Shared = 2 };
+
+	static constexpr float DefaultRelaxation = 1.6f;
+	static constexpr float DefaultPixelFootprint = 0.5f;
+
+	struct Settings
+	{
+		Preset ScenePreset = Preset::Demo;
+		int    FieldPrimitives = 1024;
+		int    FieldGroupSize = 3;       // Primitives blended together per group in the field preset
+		bool   bBvhEnabled = true;
+		bool   bGroundEnabled = true;
+		bool   bTileLists = false;        // Pruned per-tile lists instead of the BVH during the trace
+
+		// March
+		float  Relaxation = DefaultRelaxation;         // Over-relaxation factor; 1 = plain sphere tracing
+		float  PixelFootprint = DefaultPixelFootprint; // Hit epsilon in pixel radii; 0 = fixed relative epsilon
+		bool   bConePrepass = false;      // Start each ray where a low-resolution cone march stopped
+		bool   bTraceStats = false;       // Read back the iteration histogram of the trace
+
+		// Shading of the hits
+		ShadingMode Shading = ShadingMode::Shared;
+		float  ShadowSharpness = 8.0f;    // Penumbra scale; higher is harder
+
+		// Baked field
+		bool   bBricks = false;           // March through the brick volume, analytic only near the surface
+		float  BrickVoxelSize = 0.25f;
+		float  BrickBandVoxels = 3.0f;    // Narrow band half-width around the surface, in voxels
+	} m_Settings;
+
+	struct Stats
+	{
+		int   Primitives = 0;
+		int   Groups = 0;
+		int   Nodes = 0;
+		int   Depth = 0;
+		float BuildMs = 0.0f;
+
+		// Tile lists, from the last refresh
+		float TileMs = 0.0f;              // CPU time of the pruning
+		float AvgEntries = 0.0f;          // Groups per non-empty tile segment
+		int   MaxEntries = 0;
+		float EmptySegments = 0.0f;       // Share of tile segments skipped without a single step
+	};
+
+	// Distance evaluations per pixel, from the iteration histogram
+	struct TraceStats
+	{
+		float AvgSteps = 0.0f;
+		int   P99Steps = 0;
+		int   MaxSteps = 0;
+		float HitRate = 0.0f;
+		float ShadeGroups = 0.0f;         // Group evaluations per hit spent on its normal, shadow and AO
+	};
+
+	struct TraceResult
+	{
+		const char* Name = "";
+		float       Ms = 0.0f;
+		float       Speedup = 1.0f;       // Against the first variant (plain march, naive shading)
+		TraceStats  Stats;
+	};
+
+	struct BenchmarkResult
+	{
+		int    Primitives = 0;
+		float  BvhMs = 0.0f;
+		float  TiledMs = 0.0f;
+		float  TiledCpuMs = 0.0f;        // Pruning time of one refresh, paid every frame the camera moves
+		float  BruteMs = -1.0f;          // Negative where brute force was skipped
+		double BvhRaysPerSec = 0.0;
+		double TiledRaysPerSec = 0.0;
+		double BruteRaysPerSec = 0.0;
+	};
+
+	static constexpr int MaxDepth = 31;               // Traversal stack of SDF_MAX_STACK entries
+	static constexpr UINT MaxLeafGroups = 2;
+	static constexpr int BenchmarkWarmupFrames = 8;
+	static constexpr int BenchmarkFrames = 32;
+	static constexpr int BruteForceMaxPrimitives = 256; // Beyond this the unculled pass risks a device timeout
+
+	// Tile lists: root tiles split down to leaf tiles while their lists still shrink by subdividing
+	static constexpr UINT RootTileSize = 64;
+	static constexpr UINT LeafTileSize = 8;
+	static constexpr UINT SegmentCount = 8;            // Depth segments doubling in length up to the trace range
+	static constexpr float TraceDistance = 2000.0f;    // SCENE_MAX_DISTANCE
+	static constexpr UINT SubdivideMinEntries = 2;     // Lists this short are not worth splitting further
+
+	static constexpr UINT ConeTileSize = 8;            // Pixels per cone pre-pass texel edge
+	static constexpr UINT TraceHitSlot = 128 + 1;      // SCENE_STAT_HITS: after one bin per step count up to SCENE_MAX_STEPS
+	static constexpr UINT TraceShadeSlot = 128 + 2;    // SCENE_STAT_SHADE_GROUPS
+	static constexpr UINT TraceStatSlots = 128 + 3;    // SCENE_STAT_COUNT
+
+public:
+	SdfScene() {}
+	~SdfScene() {}
+
+	// [Rule] System classes should NOT be copied.
+	SdfScene(const SdfScene&) = delete;
+	SdfScene& operator=(const SdfScene&) = delete;
+
+	// Tile lists and bakes run on workers, which stay owned by the caller
+	void Initialize(ID3D11Device* device, ID3D11DeviceContext* context, ThreadPool& workers);
+
+	// Scene description; Build() turns it into the GPU buffers
+	void Clear();
+	int AddGroup(float smoothness);
+	void AddPrimitive(int group, const Primitive& primitive);
+	void Build();
+
+	// Replaces the description with m_Settings.ScenePreset and builds it
+	void Rebuild();
+
+	// Starts sampling the groups into the brick volume with the current voxel settings, in the background
+	void BakeBricks();
+	const SdfBrickMap& GetBricks() const { return m_Bricks; }
+	// Bricks are enabled but the trace still runs without them
+	bool IsBrickBakePending() const;
+
+	// CPU evaluation of the groups, without the ground plane; same math as Shaders/Scene3D.hlsli.
+	// Group indices are in leaf order, as in the GPU buffers.
+	bool GetBounds(Vector3& boundsMin, Vector3& boundsMax) const;
+	float GetDistance(const Vector3& p) const;
+	void GatherGroups(const Vector3& boxMin, const Vector3& boxMax, std::vector<UINT>& groups) const;
+	float GetGroupDistance(UINT group, const Vector3& p, uint32_t memberMask = 0xFFFFFFFFu) const;
+
+	// GetGroupDistance over a batch of points, through the SIMD kernels
+	void GetGroupDistances(UINT group, const SdfKernels::Points& points, float* out, uint32_t memberMask = 0xFFFFFFFFu) const;
+
+	// CPU kernel builds: checked against the scalar reference on Initialize, timed on request
+	void BenchmarkKernels();
+	bool HasKernelCheckPassed() const { return m_bKernelCheckPassed; }
+	const std::vector<SdfKernels::CheckResult>& GetKernelChecks() const { return m_KernelChecks; }
+	const std::vector<SdfKernels::BenchmarkResult>& GetKernelResults() const { return m_KernelResults; }
+	const std::vector<SdfKernels::BenchmarkResult>& GetExpressionResults() const { return m_ExpressionResults; }
+
+	// Binds the scene for a width x height pass seen by the camera in constant (PS and CS), refreshing the
+	// tile lists first when anything changed
+	void BeginPass(const Constant& constant, UINT width, UINT height);
+
+	// Traces the standalone scene at each primitive count, with and without the BVH
+	void StartBenchmark();
+	bool IsBenchmarkRunning() const { return m_BenchmarkStep >= 0 || m_TraceStep >= 0; }
+
+	// Traces the current scene with each march improvement added in turn
+	void StartTraceBenchmark();
+	bool IsTraceBenchmarkRunning() const { return m_TraceStep >= 0; }
+
+	// Traces the current scene with each shading mode, naive first
+	void StartShadingBenchmark();
+
+	// Once per profiler result; sceneMs is the GPU time of the standalone pass that traced rayCount rays
+	void UpdateBenchmark(float sceneMs, UINT64 rayCount);
+
+	// Iteration histogram of one frame, TraceStatSlots counters
+	bool WantsTraceStats() const { return m_Settings.bTraceStats || IsTraceBenchmarkRunning(); }
+	void ReportTraceCounters(const uint32_t* counters);
+
+	const Stats& GetStats() const { return m_Stats; }
+	const TraceStats& GetTraceStats() const { return m_TraceStats; }
+	const std::vector<BenchmarkResult>& GetBenchmarkResults() const { return m_BenchmarkResults; }
+	const std::vector<TraceResult>& GetTraceResults() const { return m_TraceResults; }
+	const std::vector<TraceResult>& GetShadingResults() const { return m_ShadingResults; }
+
+private:
+	// [Important] Layout must match SdfNode in Shaders/Scene3D.hlsli
+	struct GpuNode
+	{
+		Vector3  Min;
+		uint32_t Next;         // Right child, or the first group of a leaf
+		Vector3  Max;
+		uint32_t GroupCount;   // 0 for interior nodes
+	};
+
+	// [Important] Layout must match SdfGroup in Shaders/Scene3D.hlsli
+	struct GpuGroup
+	{
+		uint32_t FirstPrimitive;
+		uint32_t PrimitiveCount;
+		float    Smoothness;
+		float    Padding;
+	};
+
+	// [Important] Layout must match SdfPrimitive in Shaders/Scene3D.hlsli; shared with the CPU batch kernels
+	using GpuPrimitive = SdfKernels::Primitive;
+
+	// [Important] Layout must match cbSdfScene in Shaders/Scene3D.hlsli
+	struct SceneConstants
+	{
+		uint32_t NodeCount;
+		uint32_t GroupCount;
+		uint32_t BvhEnabled;
+		uint32_t GroundEnabled;
+
+		uint32_t TileEnabled;
+		uint32_t TileSize;
+		uint32_t TilesX;
+		uint32_t SegmentCount;
+
+		float    SegmentScale;
+		float    Relaxation;
+		float    PixelFootprint;
+		uint32_t ConeTileSize;
+
+		float    PassWidth;
+		float    PassHeight;
+		uint32_t ShadingMode;
+		float    ShadowSharpness;
+
+		SdfBrickMap::FieldConstants Bricks;
+	};
+
+	// [Important] Layout must match the uint2 entries of SdfTileEntries in Shaders/Scene3D.hlsli
+	struct TileEntry
+	{
+		uint32_t Group;        // Index in leaf order
+		uint32_t MemberMask;   // Members kept; all bits set for groups too large to prune
+	};
+
+	// Distance interval of one group over a box
+	struct Interval
+	{
+		float Lo;
+		float Hi;
+	};
+
+	struct Group
+	{
+		float Smoothness = 0.0f;
+		std::vector<Primitive> Primitives;
+	};
+
+	struct Bounds
+	{
+		Vector3 Min;
+		Vector3 Max;
+	};
+
+	// Camera rays of the tile pass, as getCameraRay() builds them
+	struct TileView
+	{
+		Vector3 Position;
+		Vector3 Dir;
+		Vector3 Right;
+		Vector3 Up;
+		float   Aspect;
+		float   PadU;          // Jitter margin around each tile, in uv
+		float   PadV;
+		UINT    Width;
+		UINT    Height;
+	};
+
+	// Entries of one row of root tiles; the row writes its leaf segments with offsets local to these
+	struct TileRow
+	{
+		std::vector<TileEntry> Entries;
+	};
+
+	void BuildDemoScene();
+	void BuildFieldScene(int primitiveCount, int groupSize);
+
+	static Bounds GetPrimitiveBounds(const Primitive& primitive);
+	static GpuPrimitive ToGpuPrimitive(const Primitive& primitive);
+
+	// Splits groups [first, first + count) of m_Order at the centroid median of the longest axis
+	void BuildNode(const std::vector<Bounds>& groupBounds, UINT first, UINT count, int depth);
+
+	void CreateStructuredBuffer(const void* data, UINT stride, UINT count,
+		ComPtr<ID3D11Buffer>& buffer, ComPtr<ID3D11ShaderResourceView>& srv);
+
+	// Tile lists
+	static float GetSegmentStart(UINT segment);
+	Bounds GetTileSegmentBounds(const TileView& view, UINT x0, UINT y0, UINT size, UINT segment) const;
+
+	// Groups whose bounds reach the box, from the BVH
+	void QueryGroups(const Bounds& box, std::vector<TileEntry>& entries) const;
+
+	// Interval-prunes entries over box into pruned; false if no surface can lie inside the box
+	bool PruneEntries(const Bounds& box, const std::vector<TileEntry>& entries, std::vector<TileEntry>& pruned) const;
+
+	void BuildTile(const TileView& view, UINT x0, UINT y0, UINT size, UINT segment,
+		const std::vector<TileEntry>& parent, TileRow& row);
+	void WriteTileSegment(UINT x0, UINT y0, UINT size, UINT segment, uint32_t offset, uint32_t count);
+	void UploadTiles();
+	void UpdateTiles(const Constant& constant, UINT width, UINT height);
+	// Starts the bake a build needs and uploads a finished one
+	void UpdateBricks();
+
+	void Bind(UINT width, UINT height);
+
+	static TraceStats GetTraceStats(const UINT64* counters);
+	void NextTraceStep();
+
+	void NextBenchmarkStep();
+
+private:
+	ID3D11Device* m_pDevice = nullptr;
+	ID3D11DeviceContext* m_pContext = nullptr;
+
+	std::vector<Group> m_Groups;
+
+	// Build output
+	std::vector<UINT> m_Order;       // Group indices in leaf order
+	std::vector<GpuNode> m_Nodes;
+	std::vector<GpuGroup> m_GpuGroups;
+	std::vector<GpuPrimitive> m_GpuPrimitives;
+	std::vector<Bounds> m_GroupBounds;   // In leaf order
+	UINT m_BuildIndex = 0;
+
+	// Tile lists: (first entry, count | SegmentEmpty) per leaf tile and segment
+	std::vector<uint32_t> m_TileSegments;
+	std::vector<TileEntry> m_TileEntries;
+	UINT m_TilesX = 0;
+	UINT m_TilesY = 0;
+	float m_TileKey[16] = {};
+	bool m_bTilesValid = false;
+
+	ComPtr<ID3D11Buffer> m_ConstantBuffer;
+	ComPtr<ID3D11Buffer> m_NodeBuffer;
+	ComPtr<ID3D11ShaderResourceView> m_NodeSRV;
+	ComPtr<ID3D11Buffer> m_GroupBuffer;
+	ComPtr<ID3D11ShaderResourceView> m_GroupSRV;
+	ComPtr<ID3D11Buffer> m_PrimitiveBuffer;
+	ComPtr<ID3D11ShaderResourceView> m_PrimitiveSRV;
+	ComPtr<ID3D11Buffer> m_TileSegmentBuffer;
+	ComPtr<ID3D11ShaderResourceView> m_TileSegmentSRV;
+	UINT m_TileSegmentCapacity = 0;
+	ComPtr<ID3D11Buffer> m_TileEntryBuffer;
+	ComPtr<ID3D11ShaderResourceView> m_TileEntrySRV;
+	UINT m_TileEntryCapacity = 0;
+
+	Stats m_Stats;
+
+	// Benchmark: step 3i traces count i with the BVH, 3i + 1 through the tile lists, 3i + 2 brute force
+	int m_BenchmarkStep = -1;
+	int m_BenchmarkFrame = 0;
+	int m_BenchmarkSamples = 0;   // Measured frames that had a timestamp result
+	double m_BenchmarkSumMs = 0.0;
+	Settings m_SavedSettings;
+	std::vector<BenchmarkResult> m_BenchmarkResults;
+
+	SdfBrickMap m_Bricks;
+	UINT m_BrickBuildIndex = 0;   // m_BuildIndex the bricks were baked from
+
+	// Trace and shading benchmarks: step i runs variant i; counters summed over its measured frames
+	int m_TraceStep = -1;
+	bool m_bShadingBenchmark = false;
+	UINT64 m_TraceCounters[TraceStatSlots] = {};
+	TraceStats m_TraceStats;
+	std::vector<TraceResult> m_TraceResults;
+	std::vector<TraceResult> m_ShadingResults;
+
+	bool m_bKernelCheckPassed = true;
+	std::vector<SdfKernels::CheckResult> m_KernelChecks;
+	std::vector<SdfKernels::BenchmarkResult> m_KernelResults;
+	std::vector<SdfKernels::BenchmarkResult> m_ExpressionResults;
+
+	ThreadPool* m_pWorkers = nullptr;
+};
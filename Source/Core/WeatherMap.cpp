@@ -0,0 +1,440 @@
+#include "WeatherMap.h"
+
+namespace
+{
+	constexpr int CoverageStride = WeatherMap::CoverageRes + 2;
+	constexpr int BrickStrideXZ = WeatherMap::BrickResXZ + 2;
+	constexpr int BrickStrideY = WeatherMap::BrickResY + 2;
+
+	float Saturate(float x) { return std::clamp(x, 0.0f, 1.0f); }
+
+	float Remap(float x, float low1, float high1, float low2, float high2)
+	{
+		return low2 + (x - low1) * (high2 - low2) / (high1 - low1);
+	}
+
+	float Hash2(int x, int z)
+	{
+		uint32_t h = (uint32_t)x * 374761393u + (uint32_t)z * 668265263u;
+		h = (h ^ (h >> 13)) * 1274126177u;
+		h ^= h >> 16;
+		return (float)(h & 0x00FFFFFF) / 16777215.0f;
+	}
+
+	float ValueNoise(float x, float z)
+	{
+		float fx = std::floor(x);
+		float fz = std::floor(z);
+		int ix = (int)fx;
+		int iz = (int)fz;
+		float tx = x - fx;
+		float tz = z - fz;
+		tx = tx * tx * (3.0f - 2.0f * tx);
+		tz = tz * tz * (3.0f - 2.0f * tz);
+
+		float a = Hash2(ix, iz);
+		float b = Hash2(ix + 1, iz);
+		float c = Hash2(ix, iz + 1);
+		float d = Hash2(ix + 1, iz + 1);
+		return (a + (b - a) * tx) + ((c + (d - c) * tx) - (a + (b - a) * tx)) * tz;
+	}
+
+	float Fbm(float x, float z)
+	{
+		float v = 0.0f;
+		float amp = 0.5f;
+		for (int i = 0; i < 4; i++)
+		{
+			v += ValueNoise(x, z) * amp;
+			x *= 2.03f;
+			z *= 2.03f;
+			amp *= 0.5f;
+		}
+		return v;
+	}
+
+	// World-space weather: generated from absolute coordinates so neighbouring tiles agree on their shared border
+	float GetCoverage(float x, float z)
+	{
+		float f = Fbm(x / 700.0f, z / 700.0f);
+		return Saturate(Remap(f, 0.42f, 0.72f, 0.0f, 1.0f));
+	}
+
+	float GetCloudType(float x, float z)
+	{
+		return Fbm(x / 1900.0f + 17.0f, z / 1900.0f - 31.0f);
+	}
+
+	// Same height profile as getDensity in CloudPS.hlsl, with the top scaled by the cloud type
+	float GetBaseDensity(float coverage, float cloudType, float height)
+	{
+		if (coverage <= 0.0f) return 0.0f;
+
+		float hLimit = std::pow(coverage, 0.75f) * (0.55f + 0.45f * cloudType);
+		float bottom = std::max(0.25f * (1.0f - coverage), 1e-4f);
+		float verticalShaping = Saturate(Remap(height, 0.0f, bottom, 0.0f, 1.0f))
+			* Saturate(Remap(height, 0.75f * hLimit, std::max(hLimit, 1e-4f), 1.0f, 0.0f));
+
+		return coverage * verticalShaping;
+	}
+}
+
+WeatherMap::~WeatherMap()
+{
+	// Let queued jobs return early; m_Workers joins them when it is destroyed
+	for (auto& [key, tile] : m_Tiles)
+	{
+		tile->bCancelled = true;
+	}
+}
+
+void WeatherMap::Initialize(ID3D11Device* device, ID3D11DeviceContext* context)
+{
+	m_pDevice = device;
+	m_pContext = context;
+
+	m_SlotCount = (int)std::clamp(m_Settings.MemoryBudgetBytes / GetBytesPerTile(), (size_t)1, (size_t)MaxSlots);
+	m_TileSize = m_Settings.TileSize;
+
+	m_FreeSlots.clear();
+	for (int i = m_SlotCount - 1; i >= 0; i--)
+	{
+		m_FreeSlots.push_back(i);
+	}
+	m_PageTable.assign(PageTableSize * PageTableSize, 0);
+
+	CreateResources();
+	m_Workers.Initialize();
+}
+
+size_t WeatherMap::GetBytesPerTile()
+{
+	return (size_t)CoverageStride * CoverageStride
+		+ (size_t)BrickStrideXZ * BrickStrideXZ * BrickStrideY;
+}
+
+void WeatherMap::CreateResources()
+{
+	{
+		D3D11_BUFFER_DESC constantbufferdesc = {};
+		constantbufferdesc.ByteWidth = sizeof(WeatherConstants);
+		constantbufferdesc.Usage = D3D11_USAGE_DYNAMIC;
+		constantbufferdesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		constantbufferdesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+
+		ThrowIfFailed(m_pDevice->CreateBuffer(&constantbufferdesc, nullptr, &m_WeatherConstantBuffer));
+	}
+
+	{
+		// Page table: one entry per tile of the window, 0 = not resident, otherwise slot + 1
+		D3D11_TEXTURE2D_DESC texDesc = {};
+		texDesc.Width = PageTableSize;
+		texDesc.Height = PageTableSize;
+		texDesc.MipLevels = 1;
+		texDesc.ArraySize = 1;
+		texDesc.Format = DXGI_FORMAT_R16_UINT;
+		texDesc.SampleDesc.Count = 1;
+		texDesc.Usage = D3D11_USAGE_DEFAULT;
+		texDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+		D3D11_SUBRESOURCE_DATA initData = { m_PageTable.data(), PageTableSize * sizeof(uint16_t), 0 };
+		ThrowIfFailed(m_pDevice->CreateTexture2D(&texDesc, &initData, &m_PageTableTexture));
+		ThrowIfFailed(m_pDevice->CreateShaderResourceView(m_PageTableTexture.Get(), nullptr, &m_PageTableSRV));
+	}
+
+	{
+		// Coverage: one array slice per slot
+		D3D11_TEXTURE2D_DESC texDesc = {};
+		texDesc.Width = CoverageStride;
+		texDesc.Height = CoverageStride;
+		texDesc.MipLevels = 1;
+		texDesc.ArraySize = m_SlotCount;
+		texDesc.Format = DXGI_FORMAT_R8_UNORM;
+		texDesc.SampleDesc.Count = 1;
+		texDesc.Usage = D3D11_USAGE_DEFAULT;
+		texDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+		ThrowIfFailed(m_pDevice->CreateTexture2D(&texDesc, nullptr, &m_CoverageTexture));
+		ThrowIfFailed(m_pDevice->CreateShaderResourceView(m_CoverageTexture.Get(), nullptr, &m_CoverageSRV));
+	}
+
+	{
+		// Density bricks: slots are stacked along the depth axis of a single 3D atlas
+		D3D11_TEXTURE3D_DESC texDesc = {};
+		texDesc.Width = BrickStrideXZ;
+		texDesc.Height = BrickStrideXZ;
+		texDesc.Depth = BrickStrideY * m_SlotCount;
+		texDesc.MipLevels = 1;
+		texDesc.Format = DXGI_FORMAT_R8_UNORM;
+		texDesc.Usage = D3D11_USAGE_DEFAULT;
+		texDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+		ThrowIfFailed(m_pDevice->CreateTexture3D(&texDesc, nullptr, &m_BrickTexture));
+		ThrowIfFailed(m_pDevice->CreateShaderResourceView(m_BrickTexture.Get(), nullptr, &m_BrickSRV));
+	}
+}
+
+void WeatherMap::Update(const Vector3& cameraPos)
+{
+	m_Stats.UploadsLastFrame = 0;
+
+	// Without the hysteresis ring, tiles at the load edge would be evicted and requested again every frame
+	m_Settings.EvictRadius = std::max(m_Settings.EvictRadius, m_Settings.LoadRadius + 1);
+
+	if (m_Settings.bEnabled)
+	{
+		if (m_Settings.TileSize != m_TileSize)
+		{
+			Flush();
+			m_TileSize = m_Settings.TileSize;
+		}
+
+		TileKey center = { (int)std::floor(cameraPos.x / m_TileSize), (int)std::floor(cameraPos.z / m_TileSize) };
+
+		EvictTiles(center);
+		RequestTiles(center);
+		UploadTiles(center);
+		UpdatePageTable(center);
+
+		m_WeatherConstants.PageOrigin = DirectX::SimpleMath::Vector2(
+			(float)(center.x - PageTableSize / 2), (float)(center.z - PageTableSize / 2));
+	}
+
+	m_WeatherConstants.TileSize = m_TileSize;
+	m_WeatherConstants.PageTableSize = (float)PageTableSize;
+	m_WeatherConstants.LayerBottom = m_Settings.LayerBottom;
+	m_WeatherConstants.LayerTop = m_Settings.LayerTop;
+	m_WeatherConstants.MaxDistance = (float)m_Settings.LoadRadius * m_TileSize;
+	m_WeatherConstants.Enabled = m_Settings.bEnabled ? 1 : 0;
+
+	m_Stats.ResidentTiles = 0;
+	m_Stats.PendingTiles = 0;
+	for (auto& [key, tile] : m_Tiles)
+	{
+		if (tile->State == TileState::Resident) m_Stats.ResidentTiles++;
+		else m_Stats.PendingTiles++;
+	}
+	m_Stats.SlotCount = m_SlotCount;
+	m_Stats.ResidentBytes = m_Stats.ResidentTiles * GetBytesPerTile();
+
+	D3D11_MAPPED_SUBRESOURCE msr;
+	if (SUCCEEDED(m_pContext->Map(m_WeatherConstantBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &msr)))
+	{
+		memcpy(msr.pData, &m_WeatherConstants, sizeof(WeatherConstants));
+		m_pContext->Unmap(m_WeatherConstantBuffer.Get(), 0);
+	}
+}
+
+void WeatherMap::Bind()
+{
+	m_pContext->PSSetConstantBuffers(2, 1, m_WeatherConstantBuffer.GetAddressOf());
+	m_pContext->CSSetConstantBuffers(2, 1, m_WeatherConstantBuffer.GetAddressOf());
+
+	// The froxel passes sample the same cloud model from compute
+	ID3D11ShaderResourceView* srvs[] = { m_PageTableSRV.Get(), m_CoverageSRV.Get(), m_BrickSRV.Get() };
+	m_pContext->PSSetShaderResources(2, 3, srvs);
+	m_pContext->CSSetShaderResources(2, 3, srvs);
+}
+
+void WeatherMap::Flush()
+{
+	for (auto& [key, tile] : m_Tiles)
+	{
+		tile->bCancelled = true;
+		if (tile->Slot >= 0) m_FreeSlots.push_back(tile->Slot);
+	}
+	m_Tiles.clear();
+}
+
+int WeatherMap::TileDistance(const TileKey& a, const TileKey& b)
+{
+	return std::max(std::abs(a.x - b.x), std::abs(a.z - b.z));
+}
+
+void WeatherMap::EvictTiles(const TileKey& center)
+{
+	for (auto it = m_Tiles.begin(); it != m_Tiles.end();)
+	{
+		if (TileDistance(it->first, center) > m_Settings.EvictRadius)
+		{
+			it->second->bCancelled = true;
+			if (it->second->Slot >= 0) m_FreeSlots.push_back(it->second->Slot);
+			it = m_Tiles.erase(it);
+			m_Stats.EvictionsTotal++;
+		}
+		else
+		{
+			++it;
+		}
+	}
+}
+
+bool WeatherMap::EvictFarthest(const TileKey& center, int maxDistance)
+{
+	auto farthest = m_Tiles.end();
+	int farthestDistance = maxDistance;
+
+	for (auto it = m_Tiles.begin(); it != m_Tiles.end(); ++it)
+	{
+		int distance = TileDistance(it->first, center);
+		if (distance > farthestDistance)
+		{
+			farthest = it;
+			farthestDistance = distance;
+		}
+	}
+
+	if (farthest == m_Tiles.end()) return false;
+
+	farthest->second->bCancelled = true;
+	if (farthest->second->Slot >= 0) m_FreeSlots.push_back(farthest->second->Slot);
+	m_Tiles.erase(farthest);
+	m_Stats.EvictionsTotal++;
+	return true;
+}
+
+void WeatherMap::RequestTiles(const TileKey& center)
+{
+	// Nearest tiles first so the area around the camera fills in before the horizon
+	std::vector<TileKey> missing;
+	int radius = m_Settings.LoadRadius;
+	for (int z = -radius; z <= radius; z++)
+	{
+		for (int x = -radius; x <= radius; x++)
+		{
+			TileKey key = { center.x + x, center.z + z };
+			if (m_Tiles.find(key) == m_Tiles.end()) missing.push_back(key);
+		}
+	}
+
+	std::sort(missing.begin(), missing.end(), [&center](const TileKey& a, const TileKey& b) {
+		int dxA = a.x - center.x, dzA = a.z - center.z;
+		int dxB = b.x - center.x, dzB = b.z - center.z;
+		return dxA * dxA + dzA * dzA < dxB * dxB + dzB * dzB;
+	});
+
+	for (const TileKey& key : missing)
+	{
+		// Every tile in flight reserves a slot, so the budget also bounds CPU-side staging memory
+		if ((int)m_Tiles.size() >= m_SlotCount && !EvictFarthest(center, TileDistance(key, center)))
+			break;
+
+		auto tile = std::make_shared<Tile>();
+		m_Tiles[key] = tile;
+
+		float tileSize = m_TileSize;
+		m_Workers.Submit([key, tileSize, tile]() {
+			if (tile->bCancelled) return;
+			GenerateTile(key, tileSize, *tile);
+			tile->State = TileState::Ready;
+		});
+	}
+}
+
+void WeatherMap::UploadTiles(const TileKey& center)
+{
+	std::vector<std::pair<int, Tile*>> ready;
+	for (auto& [key, tile] : m_Tiles)
+	{
+		if (tile->State == TileState::Ready) ready.push_back({ TileDistance(key, center), tile.get() });
+	}
+
+	std::sort(ready.begin(), ready.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+	int uploads = std::min((int)ready.size(), m_Settings.MaxUploadsPerFrame);
+	for (int i = 0; i < uploads && !m_FreeSlots.empty(); i++)
+	{
+		Tile* tile = ready[i].second;
+		tile->Slot = m_FreeSlots.back();
+		m_FreeSlots.pop_back();
+
+		UINT subresource = D3D11CalcSubresource(0, tile->Slot, 1);
+		m_pContext->UpdateSubresource(m_CoverageTexture.Get(), subresource, nullptr,
+			tile->Coverage.data(), CoverageStride, 0);
+
+		D3D11_BOX box = { 0, 0, (UINT)(tile->Slot * BrickStrideY), BrickStrideXZ, BrickStrideXZ, (UINT)((tile->Slot + 1) * BrickStrideY) };
+		m_pContext->UpdateSubresource(m_BrickTexture.Get(), 0, &box,
+			tile->Brick.data(), BrickStrideXZ, BrickStrideXZ * BrickStrideXZ);
+
+		// The GPU copy owns the data now
+		tile->Coverage = {};
+		tile->Brick = {};
+		tile->State = TileState::Resident;
+		m_Stats.UploadsLastFrame++;
+	}
+}
+
+void WeatherMap::UpdatePageTable(const TileKey& center)
+{
+	std::vector<uint16_t> pageTable(PageTableSize * PageTableSize, 0);
+	TileKey origin = { center.x - PageTableSize / 2, center.z - PageTableSize / 2 };
+
+	for (auto& [key, tile] : m_Tiles)
+	{
+		if (tile->State != TileState::Resident) continue;
+
+		int px = key.x - origin.x;
+		int pz = key.z - origin.z;
+		if (px < 0 || pz < 0 || px >= PageTableSize || pz >= PageTableSize) continue;
+
+		pageTable[pz * PageTableSize + px] = (uint16_t)(tile->Slot + 1);
+	}
+
+	if (pageTable != m_PageTable)
+	{
+		m_PageTable = std::move(pageTable);
+		m_pContext->UpdateSubresource(m_PageTableTexture.Get(), 0, nullptr,
+			m_PageTable.data(), PageTableSize * sizeof(uint16_t), 0);
+	}
+}
+
+void WeatherMap::GenerateTile(const TileKey& key, float tileSize, Tile& tile)
+{
+	// Texel i of the interior covers local [i, i + 1) / res; the 1 texel border duplicates the neighbour's edge
+	// so bilinear/trilinear filtering is seamless across tiles (same layout as the noise atlas).
+	float originX = key.x * tileSize;
+	float originZ = key.z * tileSize;
+
+	tile.Coverage.resize(CoverageStride * CoverageStride);
+	for (int z = 0; z < CoverageStride; z++)
+	{
+		for (int x = 0; x < CoverageStride; x++)
+		{
+			if (tile.bCancelled) return;
+
+			float wx = originX + ((float)x - 0.5f) / CoverageRes * tileSize;
+			float wz = originZ + ((float)z - 0.5f) / CoverageRes * tileSize;
+			tile.Coverage[z * CoverageStride + x] = (uint8_t)(GetCoverage(wx, wz) * 255.0f + 0.5f);
+		}
+	}
+
+	std::vector<float> coverage(BrickStrideXZ * BrickStrideXZ);
+	std::vector<float> cloudType(BrickStrideXZ * BrickStrideXZ);
+	for (int z = 0; z < BrickStrideXZ; z++)
+	{
+		for (int x = 0; x < BrickStrideXZ; x++)
+		{
+			float wx = originX + ((float)x - 0.5f) / BrickResXZ * tileSize;
+			float wz = originZ + ((float)z - 0.5f) / BrickResXZ * tileSize;
+			coverage[z * BrickStrideXZ + x] = GetCoverage(wx, wz);
+			cloudType[z * BrickStrideXZ + x] = GetCloudType(wx, wz);
+		}
+	}
+
+	tile.Brick.resize(BrickStrideXZ * BrickStrideXZ * BrickStrideY);
+	for (int y = 0; y < BrickStrideY; y++)
+	{
+		if (tile.bCancelled) return;
+
+		float height = Saturate(((float)y - 0.5f) / BrickResY);
+		for (int z = 0; z < BrickStrideXZ; z++)
+		{
+			for (int x = 0; x < BrickStrideXZ; x++)
+			{
+				int column = z * BrickStrideXZ + x;
+				float density = GetBaseDensity(coverage[column], cloudType[column], height);
+				tile.Brick[(y * BrickStrideXZ + z) * BrickStrideXZ + x] = (uint8_t)(Saturate(density) * 255.0f + 0.5f);
+			}
+		}
+	}
+}
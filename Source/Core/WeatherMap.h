@@ -0,0 +1,132 @@
+#pragma once
+
+#include <unordered_map>
+#include <atomic>
+
+#include "ThreadPool.h"
+
+// Streams the cloud field in square weather tiles around the camera.
+// Each resident tile owns one slot in a 2D coverage array and one slot in a 3D density brick atlas.
+// Tiles are generated on worker threads and uploaded a few per frame; the shader finds them through a page table.
+class WeatherMap
+{
+public:
+	using Vector3 = DirectX::SimpleMath::Vector3;
+
+	// [Important] These values must match Shaders/Weather.hlsli
+	static constexpr int   CoverageRes = 64;    // Coverage texels per tile edge (plus 1 texel border on each side)
+	static constexpr int   BrickResXZ = 32;     // Brick voxels per tile edge
+	static constexpr int   BrickResY = 16;      // Brick voxels over the layer height
+	static constexpr int   PageTableSize = 16;  // Page table window in tiles (centred on the camera tile)
+	static constexpr int   MaxSlots = 112;      // 3D atlas depth limit: 112 * (16 + 2) <= 2048
+
+	struct WeatherConstants
+	{
+		DirectX::SimpleMath::Vector2 PageOrigin; // Tile coordinate of page table texel (0, 0)
+		float TileSize;                          // World units per tile edge
+		float PageTableSize;
+
+		float LayerBottom;
+		float LayerTop;
+		float MaxDistance;                       // Maximum march distance in tiled mode
+		uint32_t Enabled;
+	} m_WeatherConstants = {};
+
+	struct Settings
+	{
+		bool  bEnabled = false;
+		float TileSize = 200.0f;
+		float LayerBottom = 0.0f;
+		float LayerTop = 40.0f;
+		int   LoadRadius = 3;                    // Tiles within this Chebyshev distance are requested
+		int   EvictRadius = 5;                   // Tiles beyond this distance are released; kept at LoadRadius + 1 or more
+		int   MaxUploadsPerFrame = 4;            // Bounds the per-frame upload cost to avoid hitches
+		size_t MemoryBudgetBytes = 2 * 1024 * 1024;
+	} m_Settings;
+
+	struct Stats
+	{
+		int ResidentTiles = 0;
+		int PendingTiles = 0;
+		int SlotCount = 0;
+		size_t ResidentBytes = 0;
+		int UploadsLastFrame = 0;
+		int EvictionsTotal = 0;
+	} m_Stats;
+
+public:
+	WeatherMap() {}
+	~WeatherMap();
+
+	// [Rule] System classes should NOT be copied.
+	// Copying a core system creates ambiguity in resource ownership.
+	WeatherMap(const WeatherMap&) = delete;
+	WeatherMap& operator=(const WeatherMap&) = delete;
+
+	void Initialize(ID3D11Device* device, ID3D11DeviceContext* context);
+	void Update(const Vector3& cameraPos);
+	void Bind();
+
+	static size_t GetBytesPerTile();
+
+private:
+	struct TileKey
+	{
+		int x, z;
+		bool operator==(const TileKey& other) const { return x == other.x && z == other.z; }
+	};
+
+	struct TileKeyHash
+	{
+		size_t operator()(const TileKey& key) const
+		{
+			return std::hash<int64_t>()(((int64_t)key.x << 32) ^ (uint32_t)key.z);
+		}
+	};
+
+	enum class TileState { Pending, Ready, Resident };
+
+	struct Tile
+	{
+		std::atomic<TileState> State{ TileState::Pending };
+		int Slot = -1;
+		std::vector<uint8_t> Coverage;           // (CoverageRes + 2)^2
+		std::vector<uint8_t> Brick;              // (BrickResXZ + 2)^2 * (BrickResY + 2)
+		std::atomic<bool> bCancelled{ false };
+	};
+
+	void CreateResources();
+	void Flush();
+	void RequestTiles(const TileKey& center);
+	void EvictTiles(const TileKey& center);
+	void UploadTiles(const TileKey& center);
+	void UpdatePageTable(const TileKey& center);
+
+	bool EvictFarthest(const TileKey& center, int maxDistance);
+	static int TileDistance(const TileKey& a, const TileKey& b);
+	static void GenerateTile(const TileKey& key, float tileSize, Tile& tile);
+
+private:
+	ID3D11Device* m_pDevice = nullptr;
+	ID3D11DeviceContext* m_pContext = nullptr;
+
+	ComPtr<ID3D11Buffer> m_WeatherConstantBuffer;
+
+	ComPtr<ID3D11Texture2D> m_PageTableTexture;
+	ComPtr<ID3D11ShaderResourceView> m_PageTableSRV;
+	ComPtr<ID3D11Texture2D> m_CoverageTexture;
+	ComPtr<ID3D11ShaderResourceView> m_CoverageSRV;
+	ComPtr<ID3D11Texture3D> m_BrickTexture;
+	ComPtr<ID3D11ShaderResourceView> m_BrickSRV;
+
+	std::vector<uint16_t> m_PageTable;
+	std::vector<int> m_FreeSlots;
+	int m_SlotCount = 0;
+	float m_TileSize = 200.0f;
+
+	// Tiles are shared with worker threads; the map itself is only touched by the main thread
+	std::unordered_map<TileKey, std::shared_ptr<Tile>, TileKeyHash> m_Tiles;
+
+	// Declared last so the workers are joined before the tiles they write into are destroyed
+	ThreadPool m_Workers;
+};
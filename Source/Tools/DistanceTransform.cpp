@@ -0,0 +1,303 @@
+#include <random>
+#include <atomic>
+#include <cfloat>
+
+#include "DistanceTransform.h"
+#include "SdfRasterizer.h"
+
+namespace
+{
+	constexpr uint16_t NoEdge = 0xFFFF;              // No pixel of the other class in the column
+	constexpr int32_t  NoSite = INT32_MAX;           // Row pass: not a parabola
+	constexpr int64_t  NoDistance = INT64_MAX;
+	constexpr UINT     ColumnBlock = 64;             // Adjacent columns per pass 1 job: one cache line of mask per row
+
+	bool IsInside(uint8_t value)
+	{
+		return value >= 128;
+	}
+
+	// d[q] = min over sites p of (q - p)^2 + f[p], exactly: the lower envelope of the parabolas rooted at the
+	// sites, built left to right, then read off left to right. v holds the envelope's sites, z the boundaries
+	// between them (n + 1 entries).
+	void Transform1D(const int32_t* f, UINT n, int32_t* v, double* z, int64_t* d)
+	{
+		auto intersect = [f](int32_t q, int32_t p)
+		{
+			return ((double)f[q] + (double)q * q - (double)f[p] - (double)p * p) / (2.0 * (q - p));
+		};
+
+		int k = -1;
+		for (int32_t q = 0; q < (int32_t)n; q++)
+		{
+			if (f[q] == NoSite) continue;
+			if (k < 0)
+			{
+				k = 0;
+				v[0] = q;
+				z[0] = -DBL_MAX;
+				z[1] = DBL_MAX;
+				continue;
+			}
+
+			double s = intersect(q, v[k]);
+			while (s <= z[k])
+			{
+				k--;
+				s = intersect(q, v[k]);
+			}
+			k++;
+			v[k] = q;
+			z[k] = s;
+			z[k + 1] = DBL_MAX;
+		}
+
+		if (k < 0)
+		{
+			std::fill(d, d + n, NoDistance);
+			return;
+		}
+
+		k = 0;
+		for (int32_t q = 0; q < (int32_t)n; q++)
+		{
+			while (z[k + 1] < q) k++;
+			int64_t offset = q - v[k];
+			d[q] = offset * offset + f[v[k]];
+		}
+	}
+
+	// Half a pixel in from the pixel centres, so the edge falls between the two classes
+	float ToSigned(bool bInside, int64_t squared, float far)
+	{
+		float d = (squared == NoDistance) ? far : sqrtf((float)squared) - 0.5f;
+		return bInside ? -d : d;
+	}
+}
+
+void DistanceTransform::Initialize(ThreadPool& workers)
+{
+	m_pWorkers = &workers;
+}
+
+bool DistanceTransform::Transform(const Bitmap& bitmap, const Settings& settings, Field& field)
+{
+	const UINT width = bitmap.Width, height = bitmap.Height, channels = bitmap.Channels;
+	if (width == 0 || height == 0 || width > MaxSize || height > MaxSize || channels < 1 || channels > 4) return false;
+	if (bitmap.Values.size() < (size_t)width * height * channels) return false;
+
+	double start = GetSeconds();
+	m_Stats = Stats();
+	m_Stats.Width = width;
+	m_Stats.Height = height;
+	m_Stats.Channels = channels;
+
+	const size_t pixels = (size_t)width * height;
+	const bool bFloat = settings.Output == Encoding::Float;
+	field.Width = width;
+	field.Height = height;
+	field.Channels = channels;
+	field.Distances.clear();
+	field.Encoded.clear();
+	if (bFloat) field.Distances.resize(pixels * channels);
+	else field.Encoded.resize(pixels * channels);
+
+	// Pass 1 output: vertical distance to the nearest pixel of the other class, whichever class the pixel is
+	std::vector<uint16_t> columnDistances(pixels);
+	m_Stats.PeakBytes = bitmap.Values.size() + columnDistances.size() * sizeof(uint16_t) +
+		(bFloat ? field.Distances.size() * sizeof(float) : field.Encoded.size());
+
+	const float far = (float)(width + height);
+	const float spread = (std::max)(settings.Spread, 1e-3f);
+	const UINT jobLimit = (std::max)(1u, m_pWorkers->GetThreadCount());
+
+	for (UINT channel = 0; channel < channels; channel++)
+	{
+		const uint8_t* mask = bitmap.Values.data() + channel;
+		uint16_t* g = columnDistances.data();
+
+		// --- Pass 1: columns, a block of them per row, down then up ---
+		double passStart = GetSeconds();
+		const UINT blocks = (width + ColumnBlock - 1) / ColumnBlock;
+		std::atomic<UINT> nextBlock{ 0 };
+		m_pWorkers->ParallelFor((std::min)(jobLimit, blocks), [&](UINT)
+		{
+			int32_t lastInside[ColumnBlock], lastOutside[ColumnBlock];
+			for (;;)
+			{
+				UINT block = nextBlock.fetch_add(1, std::memory_order_relaxed);
+				if (block >= blocks) break;
+
+				const UINT x0 = block * ColumnBlock;
+				const UINT columns = (std::min)(ColumnBlock, width - x0);
+
+				std::fill_n(lastInside, columns, -1);
+				std::fill_n(lastOutside, columns, -1);
+				for (UINT y = 0; y < height; y++)
+				{
+					const uint8_t* row = mask + ((size_t)y * width + x0) * channels;
+					uint16_t* out = g + (size_t)y * width + x0;
+					for (UINT i = 0; i < columns; i++)
+					{
+						bool bInside = IsInside(row[i * channels]);
+						int32_t other = bInside ? lastOutside[i] : lastInside[i];
+						(bInside ? lastInside[i] : lastOutside[i]) = (int32_t)y;
+						out[i] = (other < 0) ? NoEdge : (uint16_t)(y - other);
+					}
+				}
+
+				std::fill_n(lastInside, columns, -1);
+				std::fill_n(lastOutside, columns, -1);
+				for (UINT y = height; y-- > 0;)
+				{
+					const uint8_t* row = mask + ((size_t)y * width + x0) * channels;
+					uint16_t* out = g + (size_t)y * width + x0;
+					for (UINT i = 0; i < columns; i++)
+					{
+						bool bInside = IsInside(row[i * channels]);
+						int32_t other = bInside ? lastOutside[i] : lastInside[i];
+						(bInside ? lastInside[i] : lastOutside[i]) = (int32_t)y;
+						if (other >= 0) out[i] = (std::min)(out[i], (uint16_t)(other - y));
+					}
+				}
+			}
+		});
+		double passEnd = GetSeconds();
+		m_Stats.ColumnMs += (float)((passEnd - passStart) * 1000.0);
+
+		// --- Pass 2: rows, the envelope once toward the inside pixels and once toward the outside ones ---
+		std::atomic<UINT> nextRow{ 0 };
+		m_pWorkers->ParallelFor((std::min)(jobLimit, height), [&](UINT)
+		{
+			std::vector<int32_t> toInside(width), toOutside(width), sites(width);
+			std::vector<double> boundaries(width + 1);
+			std::vector<int64_t> insideDistance(width), outsideDistance(width);
+
+			for (;;)
+			{
+				UINT y = nextRow.fetch_add(1, std::memory_order_relaxed);
+				if (y >= height) break;
+
+				const uint8_t* row = mask + (size_t)y * width * channels;
+				const uint16_t* column = g + (size_t)y * width;
+				for (UINT x = 0; x < width; x++)
+				{
+					int32_t squared = (column[x] == NoEdge) ? NoSite : (int32_t)column[x] * column[x];
+					bool bInside = IsInside(row[x * channels]);
+					toInside[x] = bInside ? 0 : squared;
+					toOutside[x] = bInside ? squared : 0;
+				}
+
+				Transform1D(toInside.data(), width, sites.data(), boundaries.data(), insideDistance.data());
+				Transform1D(toOutside.data(), width, sites.data(), boundaries.data(), outsideDistance.data());
+
+				size_t first = (size_t)y * width * channels + channel;
+				for (UINT x = 0; x < width; x++)
+				{
+					bool bInside = IsInside(row[x * channels]);
+					float d = ToSigned(bInside, bInside ? outsideDistance[x] : insideDistance[x], far);
+
+					size_t index = first + (size_t)x * channels;
+					if (bFloat)
+						field.Distances[index] = d;
+					else
+						field.Encoded[index] = (uint8_t)((std::min)((std::max)(0.5f - d / (2.0f * spread), 0.0f), 1.0f) * 255.0f + 0.5f);
+				}
+			}
+		});
+		m_Stats.RowMs += (float)((GetSeconds() - passEnd) * 1000.0);
+	}
+
+	double seconds = GetSeconds() - start;
+	m_Stats.Ms = (float)(seconds * 1000.0);
+	m_Stats.PixelsPerSec = seconds > 0.0 ? (double)pixels * channels / seconds : 0.0;
+	return true;
+}
+
+float DistanceTransform::MeasureError(const Bitmap& bitmap, const Field& field, UINT samples, uint32_t seed)
+{
+	if (field.Distances.empty() || field.Width != bitmap.Width || field.Height != bitmap.Height) return -1.0f;
+
+	const int width = (int)bitmap.Width, height = (int)bitmap.Height, channels = (int)bitmap.Channels;
+	const float far = (float)(width + height);
+	std::mt19937 rng(seed);
+
+	float maxError = 0.0f;
+	for (UINT sample = 0; sample < samples; sample++)
+	{
+		int x = (int)(rng() % (uint32_t)width), y = (int)(rng() % (uint32_t)height), channel = (int)(rng() % (uint32_t)channels);
+		auto isInside = [&](int px, int py) { return IsInside(bitmap.Values[((size_t)py * width + px) * channels + channel]); };
+		bool bInside = isInside(x, y);
+
+		// Square rings outward until no closer pixel can remain
+		int64_t best = NoDistance;
+		auto visit = [&](int px, int py)
+		{
+			if (px < 0 || py < 0 || px >= width || py >= height || isInside(px, py) == bInside) return;
+			int64_t dx = px - x, dy = py - y;
+			best = (std::min)(best, dx * dx + dy * dy);
+		};
+		for (int r = 1; r < width + height && (int64_t)r * r < best; r++)
+		{
+			for (int i = -r; i <= r; i++)
+			{
+				visit(x + i, y - r);
+				visit(x + i, y + r);
+			}
+			for (int i = -r + 1; i < r; i++)
+			{
+				visit(x - r, y + i);
+				visit(x + r, y + i);
+			}
+		}
+
+		float expected = ToSigned(bInside, best, far);
+		float actual = field.Distances[((size_t)y * width + x) * channels + channel];
+		maxError = (std::max)(maxError, fabsf(actual - expected));
+	}
+	return maxError;
+}
+
+DistanceTransform::Bitmap DistanceTransform::MakeTestBitmap(UINT width, UINT height, UINT channels, uint32_t seed)
+{
+	Bitmap bitmap;
+	bitmap.Width = width;
+	bitmap.Height = height;
+	bitmap.Channels = channels;
+	bitmap.Values.assign((size_t)width * height * channels, 0);
+
+	// About one shape per 128 x 128 pixels, the overlay rasterizer's scatter, drawn with the SIMD shape kernels
+	UINT count = (std::max)(16u, (UINT)((UINT64)width * height / (128 * 128)));
+	std::vector<float> xs(width), ys(width), d(width);
+	const uint32_t index = 0;
+
+	for (UINT channel = 0; channel < channels; channel++)
+	{
+		std::vector<SdfKernels::Shape2D> shapes = SdfRasterizer::MakeOverlayScene(count, width, height, seed + channel);
+		for (const SdfKernels::Shape2D& shape : shapes)
+		{
+			SdfRasterizer::Rect bounds = SdfRasterizer::GetBounds(shape);
+			int x0 = (std::max)((int)floorf(bounds.MinX - 1.0f), 0), x1 = (std::min)((int)ceilf(bounds.MaxX + 1.0f), (int)width);
+			int y0 = (std::max)((int)floorf(bounds.MinY - 1.0f), 0), y1 = (std::min)((int)ceilf(bounds.MaxY + 1.0f), (int)height);
+			if (x0 >= x1 || y0 >= y1) continue;
+
+			UINT n = (UINT)(x1 - x0);
+			for (UINT i = 0; i < n; i++)
+				xs[i] = x0 + i + 0.5f;
+			for (int y = y0; y < y1; y++)
+			{
+				std::fill_n(ys.data(), n, y + 0.5f);
+				SdfKernels::Points points = { xs.data(), ys.data(), ys.data(), n };
+				SdfKernels::EvaluateShapes2D(&shape, &index, 1, points, d.data());
+
+				uint8_t* row = bitmap.Values.data() + ((size_t)y * width + x0) * channels + channel;
+				for (UINT i = 0; i < n; i++)
+				{
+					float coverage = (std::min)((std::max)(0.5f - d[i], 0.0f), 1.0f);
+					row[i * channels] = (std::max)(row[i * channels], (uint8_t)(coverage * 255.0f + 0.5f));
+				}
+			}
+		}
+	}
+	return bitmap;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "ThreadPool.h"
+
+// Exact Euclidean distance transform of 8-bit masks (coverage maps, glyphs) into signed distance fields that
+// Distance2DPS-style shading can sample, in linear time (Felzenszwalb & Huttenlocher, separable):
+//   1. Columns, in blocks of adjacent columns so every row is read contiguously: the vertical distance from each
+//      pixel to the nearest pixel of the other class, one 16-bit value per pixel for both signs at once.
+//   2. Rows: the lower envelope of the parabolas those distances define gives the exact squared distance to the
+//      nearest other-class pixel, solved once per sign and combined into the signed result.
+// Both passes run on the workers. Channels of a multi-channel mask are independent masks, transformed one after
+// the other into the matching channel of the output.
+class DistanceTransform
+{
+public:
+	// Interleaved 8-bit channels; a pixel is inside where its value is 128 or more
+	struct Bitmap
+	{
+		UINT Width = 0;
+		UINT Height = 0;
+		UINT Channels = 1;
+		std::vector<uint8_t> Values;
+	};
+
+	enum class Encoding
+	{
+		Float = 0,      // Signed distance in pixels, negative inside
+		Unorm8 = 1,     // 0.5 - d / (2 Spread): the edge at 0.5, inside above, clamped Spread pixels either side
+	};
+
+	struct Settings
+	{
+		Encoding Output = Encoding::Float;
+		float    Spread = 8.0f;
+	};
+
+	// Same size and channels as the bitmap; only the array of the chosen encoding is filled
+	struct Field
+	{
+		UINT Width = 0;
+		UINT Height = 0;
+		UINT Channels = 1;
+		std::vector<float> Distances;
+		std::vector<uint8_t> Encoded;
+	};
+
+	struct Stats
+	{
+		UINT   Width = 0;
+		UINT   Height = 0;
+		UINT   Channels = 0;
+		float  ColumnMs = 0.0f;
+		float  RowMs = 0.0f;
+		float  Ms = 0.0f;
+		double PixelsPerSec = 0.0;        // Per channel
+		UINT64 PeakBytes = 0;             // Input, column distances and output
+	};
+
+	static constexpr UINT MaxSize = 16384;    // Column distances must fit 16 bits
+
+public:
+	DistanceTransform() {}
+	~DistanceTransform() {}
+
+	// [Rule] System classes should NOT be copied.
+	DistanceTransform(const DistanceTransform&) = delete;
+	DistanceTransform& operator=(const DistanceTransform&) = delete;
+
+	void Initialize(ThreadPool& workers);
+
+	// False if the bitmap is empty, larger than MaxSize or has no 1-4 channels. A channel with no edge at all
+	// reads Width + Height pixels away from it everywhere.
+	bool Transform(const Bitmap& bitmap, const Settings& settings, Field& field);
+
+	const Stats& GetStats() const { return m_Stats; }
+
+	// Largest difference in pixels between field (Float) and a brute-force search at samples random pixels
+	static float MeasureError(const Bitmap& bitmap, const Field& field, UINT samples, uint32_t seed);
+
+	// Scattered discs, rounded panels and strokes with antialiased edges, a different scatter per channel
+	static Bitmap MakeTestBitmap(UINT width, UINT height, UINT channels, uint32_t seed);
+
+private:
+	ThreadPool* m_pWorkers = nullptr;
+	Stats m_Stats;
+};
@@ -0,0 +1,165 @@
+#include <fstream>
+
+#include "Camera.h"
+
+#include "FlightBenchmark.h"
+
+namespace
+{
+	// Ignore the first frames of a run: they include the mode switch and the first tile requests
+	constexpr int WarmupFrames = 5;
+	constexpr uint32_t PathFileMagic = 0x48544150; // "PATH"
+}
+
+void FlightBenchmark::StartRecording()
+{
+	m_Path.clear();
+	m_FrameTimesMs.clear();
+	m_Time = 0.0f;
+	m_State = State::Recording;
+}
+
+void FlightBenchmark::StartPlayback()
+{
+	if (m_Path.size() < 2) return;
+
+	m_FrameTimesMs.clear();
+	m_Report = {};
+	m_Time = 0.0f;
+	m_State = State::Playing;
+}
+
+void FlightBenchmark::Stop()
+{
+	if (m_State == State::Playing)
+	{
+		BuildReport();
+	}
+	m_State = State::Idle;
+}
+
+void FlightBenchmark::GenerateLongPath(float length, float duration, float altitude)
+{
+	m_Path.clear();
+
+	const float keyInterval = 0.25f;
+	const float speed = length / duration;
+
+	Vector3 pos(0.0f, altitude, 0.0f);
+	float yaw = 0.0f;
+
+	for (float t = 0.0f; t <= duration; t += keyInterval)
+	{
+		// Slow weaving turns so the view sweeps over new tiles on both sides of the path
+		float targetYaw = 0.6f * sinf(t * 0.07f) + 0.25f * sinf(t * 0.23f);
+		float pitch = 0.05f * sinf(t * 0.11f);
+
+		m_Path.push_back({ t, pos, yaw, pitch });
+
+		yaw = targetYaw;
+		Vector3 forward(sinf(yaw), 0.0f, cosf(yaw));
+		pos += forward * speed * keyInterval;
+		pos.y = altitude + 6.0f * sinf(t * 0.05f);
+	}
+}
+
+bool FlightBenchmark::SavePath(const std::string& path) const
+{
+	std::ofstream file(path, std::ios::binary);
+	if (!file) return false;
+
+	uint32_t count = (uint32_t)m_Path.size();
+	file.write((const char*)&PathFileMagic, sizeof(PathFileMagic));
+	file.write((const char*)&count, sizeof(count));
+	file.write((const char*)m_Path.data(), sizeof(PathKey) * count);
+	return (bool)file;
+}
+
+bool FlightBenchmark::LoadPath(const std::string& path)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file) return false;
+
+	uint32_t magic = 0, count = 0;
+	file.read((char*)&magic, sizeof(magic));
+	file.read((char*)&count, sizeof(count));
+	if (!file || magic != PathFileMagic) return false;
+
+	std::vector<PathKey> keys(count);
+	file.read((char*)keys.data(), sizeof(PathKey) * count);
+	if (!file) return false;
+
+	m_Path = std::move(keys);
+	return true;
+}
+
+void FlightBenchmark::Update(Camera& camera, float dt)
+{
+	if (m_State == State::Recording)
+	{
+		m_Time += dt;
+		m_Path.push_back({ m_Time, camera.m_Pos, camera.GetYaw(), camera.GetPitch() });
+		return;
+	}
+
+	if (m_State != State::Playing) return;
+
+	m_FrameTimesMs.push_back(dt * 1000.0f);
+	m_Time += dt;
+
+	if (m_Time >= m_Path.back().Time)
+	{
+		const PathKey& last = m_Path.back();
+		camera.SetPose(last.Pos, last.Yaw, last.Pitch);
+		Stop();
+		return;
+	}
+
+	auto next = std::upper_bound(m_Path.begin(), m_Path.end(), m_Time,
+		[](float time, const PathKey& key) { return time < key.Time; });
+	auto prev = (next == m_Path.begin()) ? next : next - 1;
+
+	float span = next->Time - prev->Time;
+	float alpha = (span > 0.0f) ? (m_Time - prev->Time) / span : 0.0f;
+
+	Vector3 pos = Vector3::Lerp(prev->Pos, next->Pos, alpha);
+	float yaw = prev->Yaw + (next->Yaw - prev->Yaw) * alpha;
+	float pitch = prev->Pitch + (next->Pitch - prev->Pitch) * alpha;
+	camera.SetPose(pos, yaw, pitch);
+}
+
+void FlightBenchmark::BuildReport()
+{
+	m_Report = {};
+
+	for (size_t i = 1; i < m_Path.size(); i++)
+	{
+		m_Report.Distance += Vector3::Distance(m_Path[i - 1].Pos, m_Path[i].Pos);
+	}
+
+	if ((int)m_FrameTimesMs.size() <= WarmupFrames) return;
+
+	std::vector<float> times(m_FrameTimesMs.begin() + WarmupFrames, m_FrameTimesMs.end());
+	std::vector<float> sorted = times;
+	std::sort(sorted.begin(), sorted.end());
+
+	float sum = 0.0f;
+	for (float t : times) sum += t;
+
+	m_Report.Frames = (int)times.size();
+	m_Report.AvgMs = sum / times.size();
+	m_Report.MedianMs = sorted[sorted.size() / 2];
+	m_Report.P99Ms = sorted[std::min(sorted.size() - 1, (size_t)(sorted.size() * 0.99f))];
+	m_Report.MaxMs = sorted.back();
+
+	float hitchMs = std::max(2.0f * m_Report.MedianMs, m_Report.MedianMs + HitchThresholdMs);
+	for (float t : times)
+	{
+		if (t > hitchMs) m_Report.HitchFrames++;
+	}
+
+	char buffer[256];
+	sprintf_s(buffer, "[FlightBenchmark] frames %d, avg %.2f ms, median %.2f ms, p99 %.2f ms, max %.2f ms, hitches %d, distance %.0f\n",
+		m_Report.Frames, m_Report.AvgMs, m_Report.MedianMs, m_Report.P99Ms, m_Report.MaxMs, m_Report.HitchFrames, m_Report.Distance);
+	OutputDebugStringA(buffer);
+}
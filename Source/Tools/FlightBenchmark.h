@@ -0,0 +1,70 @@
+#pragma once
+
+class Camera;
+
+// Records a camera flight, replays it with a fixed timeline and reports frame-time hitches.
+class FlightBenchmark
+{
+public:
+	using Vector3 = DirectX::SimpleMath::Vector3;
+
+	struct PathKey
+	{
+		float   Time;
+		Vector3 Pos;
+		float   Yaw;
+		float   Pitch;
+	};
+
+	struct Report
+	{
+		int   Frames = 0;
+		float AvgMs = 0.0f;
+		float MedianMs = 0.0f;
+		float P99Ms = 0.0f;
+		float MaxMs = 0.0f;
+		int   HitchFrames = 0;   // Frames slower than max(2 x median, median + HitchThresholdMs)
+		float Distance = 0.0f;   // World units flown
+	};
+
+	enum class State { Idle, Recording, Playing };
+
+public:
+	FlightBenchmark() {}
+	~FlightBenchmark() {}
+
+	// [Rule] System classes should NOT be copied.
+	FlightBenchmark(const FlightBenchmark&) = delete;
+	FlightBenchmark& operator=(const FlightBenchmark&) = delete;
+
+	void StartRecording();
+	void StartPlayback();
+	void Stop();
+
+	// Long straight-ish flight through the weather layer, for runs without a recorded path
+	void GenerateLongPath(float length, float duration, float altitude);
+
+	bool SavePath(const std::string& path) const;
+	bool LoadPath(const std::string& path);
+
+	// Records the current pose, or drives the camera while playing (the caller skips Camera::Update then)
+	void Update(Camera& camera, float dt);
+
+	State GetState() const { return m_State; }
+	const Report& GetReport() const { return m_Report; }
+	const std::vector<PathKey>& GetPath() const { return m_Path; }
+	const std::vector<float>& GetFrameTimes() const { return m_FrameTimesMs; }
+
+	float HitchThresholdMs = 8.0f;
+
+private:
+	void BuildReport();
+
+private:
+	State m_State = State::Idle;
+	float m_Time = 0.0f;
+
+	std::vector<PathKey> m_Path;
+	std::vector<float> m_FrameTimesMs;
+	Report m_Report;
+};
@@ -44,6 +44,25 @@ public:
 		mTotalTime += (float)mDeltaTime;
 	}
 
+	// Freezes the total time; Tick reports a zero delta until Start
+	void Stop()
+	{
+		mStopped = true;
+	}
+
+	void Start()
+	{
+		if (!mStopped) return;
+
+		// Resume from now so the paused span does not show up as one long frame
+		__int64 startTime;
+		QueryPerformanceCounter((LARGE_INTEGER*)&startTime);
+		mPrevTime = startTime;
+		mStopped = false;
+	}
+
+	bool IsStopped() const { return mStopped; }
+
 	float GetTotalTime() const { return mTotalTime; }
 	float GetDeltaTime() const { return (float)mDeltaTime; }
 
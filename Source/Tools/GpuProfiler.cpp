@@ -0,0 +1,140 @@
+#include "GpuProfiler.h"
+
+namespace
+{
+	constexpr float SmoothingFactor = 0.1f;
+}
+
+void GpuProfiler::Initialize(ID3D11Device* device, ID3D11DeviceContext* context)
+{
+	m_pDevice = device;
+	m_pContext = context;
+
+	D3D11_QUERY_DESC disjointDesc = {};
+	disjointDesc.Query = D3D11_QUERY_TIMESTAMP_DISJOINT;
+
+	D3D11_QUERY_DESC timestampDesc = {};
+	timestampDesc.Query = D3D11_QUERY_TIMESTAMP;
+
+	for (Frame& frame : m_Frames)
+	{
+		ThrowIfFailed(m_pDevice->CreateQuery(&disjointDesc, &frame.Disjoint));
+		for (Query& query : frame.Queries)
+		{
+			ThrowIfFailed(m_pDevice->CreateQuery(&timestampDesc, &query.Begin));
+			ThrowIfFailed(m_pDevice->CreateQuery(&timestampDesc, &query.End));
+		}
+	}
+}
+
+void GpuProfiler::BeginFrame()
+{
+	if (!m_pContext || m_bInFrame) return;
+
+	Frame& frame = m_Frames[m_FrameIndex % FrameLatency];
+
+	// The slot is reused; if its queries never came back, drop that frame rather than stall
+	frame.QueryCount = 0;
+	frame.bPending = false;
+
+	m_pContext->Begin(frame.Disjoint.Get());
+	m_bInFrame = true;
+}
+
+bool GpuProfiler::EndFrame()
+{
+	if (!m_bInFrame) return false;
+
+	Frame& frame = m_Frames[m_FrameIndex % FrameLatency];
+	m_pContext->End(frame.Disjoint.Get());
+	frame.bPending = true;
+	m_bInFrame = false;
+
+	m_FrameIndex++;
+
+	// Oldest frame in the ring, FrameLatency - 1 frames behind the one just ended
+	if (m_FrameIndex < FrameLatency) return false;
+	Frame& oldest = m_Frames[m_FrameIndex % FrameLatency];
+	return oldest.bPending && ResolveFrame(oldest);
+}
+
+void GpuProfiler::BeginScope(const char* name)
+{
+	if (!m_bInFrame) return;
+
+	Frame& frame = m_Frames[m_FrameIndex % FrameLatency];
+	if (frame.QueryCount >= MaxScopes) return;
+
+	Query& query = frame.Queries[frame.QueryCount++];
+	query.Name = name;
+	query.bEnded = false;
+	m_pContext->End(query.Begin.Get());
+}
+
+void GpuProfiler::EndScope(const char* name)
+{
+	if (!m_bInFrame) return;
+
+	Frame& frame = m_Frames[m_FrameIndex % FrameLatency];
+	for (UINT i = frame.QueryCount; i-- > 0;)
+	{
+		Query& query = frame.Queries[i];
+		if (!query.bEnded && strcmp(query.Name, name) == 0)
+		{
+			m_pContext->End(query.End.Get());
+			query.bEnded = true;
+			return;
+		}
+	}
+}
+
+float GpuProfiler::GetLastTime(const char* name) const
+{
+	for (const ScopeTime& scope : m_Scopes)
+	{
+		if (scope.Name == name) return scope.Ms;
+	}
+	return -1.0f;
+}
+
+bool GpuProfiler::ResolveFrame(Frame& frame)
+{
+	D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disjoint;
+	if (m_pContext->GetData(frame.Disjoint.Get(), &disjoint, sizeof(disjoint), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK)
+		return false;
+
+	frame.bPending = false;
+	if (disjoint.Disjoint) return false;
+
+	// Scopes that did not run in this frame report a negative time but keep their average
+	for (ScopeTime& scope : m_Scopes)
+	{
+		scope.Ms = -1.0f;
+	}
+
+	for (UINT i = 0; i < frame.QueryCount; i++)
+	{
+		Query& query = frame.Queries[i];
+		if (!query.bEnded) continue;
+
+		UINT64 begin = 0, end = 0;
+		if (m_pContext->GetData(query.Begin.Get(), &begin, sizeof(begin), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK ||
+			m_pContext->GetData(query.End.Get(), &end, sizeof(end), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK)
+			continue;
+
+		float ms = (float)((double)(end - begin) * 1000.0 / (double)disjoint.Frequency);
+
+		auto it = std::find_if(m_Scopes.begin(), m_Scopes.end(),
+			[&](const ScopeTime& scope) { return scope.Name == query.Name; });
+		if (it == m_Scopes.end())
+		{
+			m_Scopes.push_back({ query.Name, ms, ms });
+			continue;
+		}
+
+		// Repeated scopes within one frame add up
+		it->Ms = (it->Ms < 0.0f) ? ms : it->Ms + ms;
+		it->SmoothedMs += (it->Ms - it->SmoothedMs) * SmoothingFactor;
+	}
+	return true;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+// GPU timestamp scopes, resolved a few frames later so the CPU never waits on the queries.
+class GpuProfiler
+{
+public:
+	struct ScopeTime
+	{
+		std::string Name;
+		float       Ms = 0.0f;         // Last resolved frame
+		float       SmoothedMs = 0.0f; // Exponential average for display
+	};
+
+public:
+	GpuProfiler() {}
+	~GpuProfiler() {}
+
+	// [Rule] System classes should NOT be copied.
+	GpuProfiler(const GpuProfiler&) = delete;
+	GpuProfiler& operator=(const GpuProfiler&) = delete;
+
+	void Initialize(ID3D11Device* device, ID3D11DeviceContext* context);
+
+	void BeginFrame();
+	// Returns true when an older frame was resolved during this call
+	bool EndFrame();
+
+	// [Important] Scope names must be string literals: they are stored by pointer until the frame resolves
+	void BeginScope(const char* name);
+	void EndScope(const char* name);
+
+	// Time of the scope in the last resolved frame, or a negative value if it did not run in that frame
+	float GetLastTime(const char* name) const;
+	const std::vector<ScopeTime>& GetScopes() const { return m_Scopes; }
+
+	static constexpr UINT FrameLatency = 4;
+	static constexpr UINT MaxScopes = 16;
+
+private:
+	struct Query
+	{
+		const char* Name = nullptr;
+		ComPtr<ID3D11Query> Begin;
+		ComPtr<ID3D11Query> End;
+		bool bEnded = false;
+	};
+
+	struct Frame
+	{
+		ComPtr<ID3D11Query> Disjoint;
+		Query Queries[MaxScopes];
+		UINT QueryCount = 0;
+		bool bPending = false;
+	};
+
+	bool ResolveFrame(Frame& frame);
+
+private:
+	ID3D11Device* m_pDevice = nullptr;
+	ID3D11DeviceContext* m_pContext = nullptr;
+
+	Frame m_Frames[FrameLatency];
+	UINT64 m_FrameIndex = 0;
+	bool m_bInFrame = false;
+
+	std::vector<ScopeTime> m_Scopes;
+};
@@ -2,6 +2,11 @@
 #include "Camera.h"
 #include "Renderer.h"
 #include "ResourceManager.h"
+#include "WeatherMap.h"
+#include "FlightBenchmark.h"
+#include "IdleScheduler.h"
+#include "ResolutionGovernor.h"
+#include "InteractivePreview.h"
 
 #include "imgui.h"
 #include "imgui_internal.h"
@@ -10,9 +15,12 @@
 
 #include "Gui.h"
 
-bool Gui::Update(float totalTime, Constant & constant, Camera & camera, Renderer & renderer, ResourceManager& resMgr)
+bool Gui::Update(float totalTime, Constant & constant, Camera & camera, Renderer & renderer, ResourceManager& resMgr,
+    WeatherMap& weatherMap, FlightBenchmark& benchmark, IdleScheduler& idle,
+    ResolutionGovernor& governor, InteractivePreview& preview)
 {
     bool bCloudParamsChanged = false;
+    bool bSettingsChanged = false;
 
     ImGui_ImplDX11_NewFrame();
     ImGui_ImplWin32_NewFrame();
@@ -27,9 +35,251 @@ bool Gui::Update(float totalTime, Constant & constant, Camera & camera, Renderer
         // --- Scene Control ---
         if (ImGui::CollapsingHeader("Scene Control"))
         {
-            ImGui::Checkbox("Distance2D", &renderer.m_Scene.bDistance2D);
-            ImGui::Checkbox("Distance3D", &renderer.m_Scene.bDistance3D);
-            ImGui::Checkbox("Volumetric Cloud", &renderer.m_Scene.bCloud);
+            bSettingsChanged |= ImGui::Checkbox("Distance2D", &renderer.m_Scene.bDistance2D);
+            bSettingsChanged |= ImGui::Checkbox("Distance3D", &renderer.m_Scene.bDistance3D);
+            bSettingsChanged |= ImGui::Checkbox("Volumetric Cloud", &renderer.m_Scene.bCloud);
+            if (renderer.m_Scene.bDistance3D && renderer.m_Scene.bCloud)
+                ImGui::Text("Combined: clouds clipped by the SDF scene depth");
+        }
+
+        // --- SDF Scene Graph ---
+        if (ImGui::CollapsingHeader("SDF Scene"))
+        {
+            auto& sdf = renderer.m_SdfScene;
+            auto& settings = sdf.m_Settings;
+            bool bRebuild = false;
+
+            const char* presets[] = { "Demo", "Field" };
+            int preset = (int)settings.ScenePreset;
+            if (ImGui::Combo("Preset", &preset, presets, IM_ARRAYSIZE(presets)))
+            {
+                settings.ScenePreset = (SdfScene::Preset)preset;
+                bRebuild = true;
+            }
+            if (settings.ScenePreset == SdfScene::Preset::Field)
+            {
+                ImGui::SliderInt("Primitives", &settings.FieldPrimitives, 1, 16384);
+                bRebuild |= ImGui::IsItemDeactivatedAfterEdit();
+                ImGui::SliderInt("Group Size", &settings.FieldGroupSize, 1, 8);
+                bRebuild |= ImGui::IsItemDeactivatedAfterEdit();
+            }
+            bCloudParamsChanged |= ImGui::Checkbox("BVH Culling", &settings.bBvhEnabled);
+            bCloudParamsChanged |= ImGui::Checkbox("Ground Plane", &settings.bGroundEnabled);
+            bCloudParamsChanged |= ImGui::Checkbox("Tile Lists", &settings.bTileLists);
+            if (ImGui::IsItemHovered())
+                ImGui::SetTooltip("Prune the scene per screen tile and depth segment on the CPU; the trace only evaluates the groups left");
+
+            ImGui::TextColored(ImVec4(0, 0, 0, 1), "[ March ]");
+            bCloudParamsChanged |= ImGui::SliderFloat("Relaxation", &settings.Relaxation, 1.0f, 2.0f);
+            bCloudParamsChanged |= ImGui::SliderFloat("Pixel Footprint", &settings.PixelFootprint, 0.0f, 4.0f);
+            if (ImGui::IsItemHovered())
+                ImGui::SetTooltip("Hit epsilon in pixel radii at the hit distance; 0 keeps the fixed relative epsilon");
+            bCloudParamsChanged |= ImGui::Checkbox("Cone Pre-pass", &settings.bConePrepass);
+            ImGui::Checkbox("Iteration Stats", &settings.bTraceStats);
+            if (settings.bTraceStats)
+            {
+                const auto& trace = sdf.GetTraceStats();
+                ImGui::Text("Steps avg %.1f, p99 %d, max %d, %.0f%% hit", trace.AvgSteps, trace.P99Steps, trace.MaxSteps, trace.HitRate * 100.0f);
+                ImGui::Text("Shading %.1f group evaluations per hit", trace.ShadeGroups);
+            }
+
+            ImGui::TextColored(ImVec4(0, 0, 0, 1), "[ Shading ]");
+            const char* shadingModes[] = { "Normal Only", "Naive Shadow + AO", "Shared Shadow + AO" };
+            int shading = (int)settings.Shading;
+            if (ImGui::Combo("Shading", &shading, shadingModes, IM_ARRAYSIZE(shadingModes)))
+            {
+                settings.Shading = (SdfScene::ShadingMode)shading;
+                bCloudParamsChanged = true;
+            }
+            if (ImGui::IsItemHovered())
+                ImGui::SetTooltip("Shared: one BVH gather around the hit feeds the tetrahedral normal, the AO taps and the near shadow steps");
+            if (settings.Shading != SdfScene::ShadingMode::Basic)
+                bCloudParamsChanged |= ImGui::SliderFloat("Shadow Sharpness", &settings.ShadowSharpness, 1.0f, 32.0f);
+
+            ImGui::TextColored(ImVec4(0, 0, 0, 1), "[ Baked Field ]");
+            bCloudParamsChanged |= ImGui::Checkbox("Baked Bricks", &settings.bBricks);
+            if (ImGui::IsItemHovered())
+                ImGui::SetTooltip("March through a sparse narrow-band bake of the groups; the analytic scene only refines hits");
+            if (settings.bBricks)
+            {
+                // Rebaking is too slow to follow the slider, so it waits for the release
+                ImGui::SliderFloat("Voxel Size", &settings.BrickVoxelSize, 0.05f, 1.0f);
+                bool bRebake = ImGui::IsItemDeactivatedAfterEdit();
+                ImGui::SliderFloat("Band (voxels)", &settings.BrickBandVoxels, 1.0f, 8.0f);
+                bRebake |= ImGui::IsItemDeactivatedAfterEdit();
+                if (bRebake && !sdf.IsBenchmarkRunning())
+                {
+                    sdf.BakeBricks();
+                    bCloudParamsChanged = true;
+                }
+
+                const auto& bricks = sdf.GetBricks().GetStats();
+                if (sdf.GetBricks().IsBaking())
+                    ImGui::Text("Baking in the background...");
+                ImGui::Text("Bake %.1f ms on the workers, upload %.1f ms", bricks.BakeMs, bricks.UploadMs);
+                ImGui::Text("%d bricks in %d cells, voxel %.3f", bricks.Bricks, bricks.Cells, bricks.VoxelSize);
+                ImGui::Text("%.1f MB (dense %.1f MB)", bricks.Bytes / (1024.0f * 1024.0f), bricks.DenseBytes / (1024.0f * 1024.0f));
+            }
+
+            if (bRebuild && !sdf.IsBenchmarkRunning())
+            {
+                sdf.Rebuild();
+                bCloudParamsChanged = true;
+            }
+
+            const auto& stats = sdf.GetStats();
+            ImGui::Text("%d primitives, %d groups, %d nodes (depth %d)", stats.Primitives, stats.Groups, stats.Nodes, stats.Depth);
+            ImGui::Text("Build %.2f ms", stats.BuildMs);
+            if (settings.bTileLists)
+            {
+                ImGui::Text("Tiles %.2f ms, %.1f groups per segment (max %d), %.0f%% skipped",
+                    stats.TileMs, stats.AvgEntries, stats.MaxEntries, stats.EmptySegments * 100.0f);
+            }
+
+            // Rays per second of the standalone pass from the current camera
+            if (sdf.IsBenchmarkRunning())
+                ImGui::Text("Benchmark running...");
+            else if (ImGui::Button("Benchmark Primitive Scaling"))
+                sdf.StartBenchmark();
+
+            if (!sdf.IsBenchmarkRunning() && ImGui::Button("Benchmark March"))
+                sdf.StartTraceBenchmark();
+            if (!sdf.IsBenchmarkRunning())
+            {
+                ImGui::SameLine();
+                if (ImGui::Button("Benchmark Shading"))
+                    sdf.StartShadingBenchmark();
+            }
+
+            const auto& traceResults = sdf.GetTraceResults();
+            if (!traceResults.empty() && ImGui::BeginTable("SdfTraceBenchmark", 5, ImGuiTableFlags_Borders))
+            {
+                ImGui::TableSetupColumn("March");
+                ImGui::TableSetupColumn("ms");
+                ImGui::TableSetupColumn("Speedup");
+                ImGui::TableSetupColumn("Avg Steps");
+                ImGui::TableSetupColumn("p99 Steps");
+                ImGui::TableHeadersRow();
+
+                for (const auto& result : traceResults)
+                {
+                    ImGui::TableNextRow();
+                    ImGui::TableNextColumn(); ImGui::Text("%s", result.Name);
+                    ImGui::TableNextColumn(); ImGui::Text("%.2f", result.Ms);
+                    ImGui::TableNextColumn(); ImGui::Text("%.2fx", result.Speedup);
+                    ImGui::TableNextColumn(); ImGui::Text("%.1f", result.Stats.AvgSteps);
+                    ImGui::TableNextColumn(); ImGui::Text("%d", result.Stats.P99Steps);
+                }
+                ImGui::EndTable();
+            }
+
+            const auto& shadingResults = sdf.GetShadingResults();
+            if (!shadingResults.empty() && ImGui::BeginTable("SdfShadingBenchmark", 4, ImGuiTableFlags_Borders))
+            {
+                ImGui::TableSetupColumn("Shading");
+                ImGui::TableSetupColumn("ms");
+                ImGui::TableSetupColumn("vs Naive");
+                ImGui::TableSetupColumn("Groups/hit");
+                ImGui::TableHeadersRow();
+
+                for (const auto& result : shadingResults)
+                {
+                    ImGui::TableNextRow();
+                    ImGui::TableNextColumn(); ImGui::Text("%s", result.Name);
+                    ImGui::TableNextColumn(); ImGui::Text("%.2f", result.Ms);
+                    ImGui::TableNextColumn(); ImGui::Text("%.2fx", result.Speedup);
+                    ImGui::TableNextColumn(); ImGui::Text("%.1f", result.Stats.ShadeGroups);
+                }
+                ImGui::EndTable();
+            }
+
+            const auto& results = sdf.GetBenchmarkResults();
+            if (!results.empty() && ImGui::BeginTable("SdfBenchmark", 5, ImGuiTableFlags_Borders))
+            {
+                ImGui::TableSetupColumn("Primitives");
+                ImGui::TableSetupColumn("BVH Mrays/s");
+                ImGui::TableSetupColumn("Tiled Mrays/s (CPU)");
+                ImGui::TableSetupColumn("Brute Mrays/s");
+                ImGui::TableSetupColumn("Speedup");
+                ImGui::TableHeadersRow();
+
+                for (const auto& result : results)
+                {
+                    ImGui::TableNextRow();
+                    ImGui::TableNextColumn(); ImGui::Text("%d", result.Primitives);
+                    ImGui::TableNextColumn(); ImGui::Text("%.1f (%.2f ms)", result.BvhRaysPerSec * 1e-6, result.BvhMs);
+                    ImGui::TableNextColumn(); ImGui::Text("%.1f (%.2f ms, %.2f ms)", result.TiledRaysPerSec * 1e-6, result.TiledMs, result.TiledCpuMs);
+                    ImGui::TableNextColumn();
+                    if (result.BruteMs >= 0.0f) ImGui::Text("%.1f (%.2f ms)", result.BruteRaysPerSec * 1e-6, result.BruteMs);
+                    else ImGui::Text("skipped");
+                    ImGui::TableNextColumn();
+                    if (result.BruteMs > 0.0f) ImGui::Text("%.1fx", result.BruteMs / (std::max)(result.BvhMs, 1e-3f));
+                }
+                ImGui::EndTable();
+            }
+
+            // CPU batch kernels behind the bake (and later CPU-side sampling)
+            ImGui::TextColored(ImVec4(0, 0, 0, 1), "[ CPU Kernels ]");
+            const char* isaNames[] = { "Scalar", "AVX2", "AVX-512" };
+            int isa = (int)SdfKernels::GetIsa();
+            if (ImGui::Combo("SIMD Build", &isa, isaNames, IM_ARRAYSIZE(isaNames)))
+                SdfKernels::SetIsa((SdfKernels::Isa)isa);
+            for (const auto& check : sdf.GetKernelChecks())
+            {
+                ImGui::Text("%s: %s (max error %.1e)", SdfKernels::GetIsaName(check.Build), check.bPassed ? "matches reference" : "FAILED", check.MaxError);
+            }
+
+            if (ImGui::Button("Benchmark SIMD Kernels"))
+                sdf.BenchmarkKernels();
+
+            const auto& kernelResults = sdf.GetKernelResults();
+            if (!kernelResults.empty() && ImGui::BeginTable("SdfKernelBenchmark", 5, ImGuiTableFlags_Borders))
+            {
+                ImGui::TableSetupColumn("Kernel");
+                ImGui::TableSetupColumn("Batch");
+                ImGui::TableSetupColumn("Scalar ns/pt");
+                ImGui::TableSetupColumn("AVX2 ns/pt");
+                ImGui::TableSetupColumn("AVX-512 ns/pt");
+                ImGui::TableHeadersRow();
+
+                for (const auto& result : kernelResults)
+                {
+                    ImGui::TableNextRow();
+                    ImGui::TableNextColumn(); ImGui::Text("%s", result.Kernel);
+                    ImGui::TableNextColumn(); ImGui::Text("%u", result.Batch);
+                    for (int i = 0; i < (int)SdfKernels::Isa::Count; i++)
+                    {
+                        ImGui::TableNextColumn();
+                        if (result.NsPerPoint[i] >= 0.0f) ImGui::Text("%.2f (%.1fx)", result.NsPerPoint[i], result.NsPerPoint[0] / (std::max)(result.NsPerPoint[i], 1e-3f));
+                        else ImGui::Text("n/a");
+                    }
+                }
+                ImGui::EndTable();
+            }
+
+            // Same scene fused from templates, interpreted from bytecode and walked as a node tree
+            const auto& expressionResults = sdf.GetExpressionResults();
+            if (!expressionResults.empty() && ImGui::BeginTable("SdfExpressionBenchmark", 4, ImGuiTableFlags_Borders))
+            {
+                ImGui::TableSetupColumn("Scene");
+                ImGui::TableSetupColumn("Scalar ns/pt");
+                ImGui::TableSetupColumn("AVX2 ns/pt");
+                ImGui::TableSetupColumn("AVX-512 ns/pt");
+                ImGui::TableHeadersRow();
+
+                for (const auto& result : expressionResults)
+                {
+                    ImGui::TableNextRow();
+                    ImGui::TableNextColumn(); ImGui::Text("%s", result.Kernel);
+                    for (int i = 0; i < (int)SdfKernels::Isa::Count; i++)
+                    {
+                        ImGui::TableNextColumn();
+                        if (result.NsPerPoint[i] >= 0.0f) ImGui::Text("%.2f", result.NsPerPoint[i]);
+                        else ImGui::Text("n/a");
+                    }
+                }
+                ImGui::EndTable();
+            }
         }
 
         // --- Cloud Physics & Visuals ---
@@ -51,6 +301,553 @@ bool Gui::Update(float totalTime, Constant & constant, Camera & camera, Renderer
             bCloudParamsChanged |= ImGui::SliderFloat("ShapeStrength", &cloudParams.ShapeStrength, 0.0f, 1.0f);
             bCloudParamsChanged |= ImGui::SliderFloat("DetailStrength", &cloudParams.DetailStrength, 0.0f, 1.0f);
             bCloudParamsChanged |= ImGui::SliderFloat("Density Multiplier", &cloudParams.DensityMult, 0.0f, 5.0f);
+
+            ImGui::TextColored(ImVec4(0, 0, 0, 1), "[ Layer & LOD ]");
+
+            const char* layerModes[] = { "Box", "Infinite Slab", "Spherical Shell" };
+            int layerMode = (int)cloudParams.LayerMode;
+            if (ImGui::Combo("Layer Mode", &layerMode, layerModes, IM_ARRAYSIZE(layerModes)))
+            {
+                cloudParams.LayerMode = (uint32_t)layerMode;
+                bCloudParamsChanged = true;
+            }
+
+            if (cloudParams.LayerMode != Constant::LayerBox)
+            {
+                if (cloudParams.LayerMode == Constant::LayerShell)
+                    bCloudParamsChanged |= ImGui::SliderFloat("Planet Radius", &cloudParams.PlanetRadius, 500.0f, 50000.0f, "%.0f");
+                bCloudParamsChanged |= ImGui::SliderFloat("Layer Bottom", &cloudParams.ShellBottom, 0.0f, 500.0f);
+                bCloudParamsChanged |= ImGui::SliderFloat("Layer Top", &cloudParams.ShellTop, cloudParams.ShellBottom + 1.0f, 1000.0f);
+                bCloudParamsChanged |= ImGui::SliderFloat("Coverage Scale", &cloudParams.CoverageScale, 0.001f, 0.1f, "%.3f");
+                bCloudParamsChanged |= ImGui::SliderFloat("Max Distance", &cloudParams.LayerMaxDistance, 500.0f, 50000.0f, "%.0f");
+            }
+
+            bCloudParamsChanged |= ImGui::SliderFloat("LOD Distance", &cloudParams.LodDistance, 50.0f, 5000.0f, "%.0f");
+
+            int primarySteps = (int)cloudParams.PrimarySteps;
+            if (ImGui::SliderInt("Primary Steps", &primarySteps, 4, 128))
+            {
+                cloudParams.PrimarySteps = (uint32_t)primarySteps;
+                bCloudParamsChanged = true;
+            }
+
+            ImGui::TextColored(ImVec4(0, 0, 0, 1), "[ Sampling ]");
+
+            const char* marchModes[] = { "Uniform", "Importance" };
+            int marchMode = (int)cloudParams.MarchMode;
+            if (ImGui::Combo("March Mode", &marchMode, marchModes, IM_ARRAYSIZE(marchModes)))
+            {
+                cloudParams.MarchMode = (uint32_t)marchMode;
+                bCloudParamsChanged = true;
+            }
+
+            if (cloudParams.MarchMode == Constant::MarchImportance)
+            {
+                int coarseSteps = (int)cloudParams.CoarseSteps;
+                if (ImGui::SliderInt("Coarse Steps", &coarseSteps, 2, 16))
+                {
+                    cloudParams.CoarseSteps = (uint32_t)coarseSteps;
+                    bCloudParamsChanged = true;
+                }
+                bCloudParamsChanged |= ImGui::SliderFloat("Importance Floor", &cloudParams.ImportanceFloor, 0.0f, 1.0f);
+            }
+
+            bool bLightCache = cloudParams.LightCacheEnabled != 0;
+            if (ImGui::Checkbox("Light March Cache", &bLightCache))
+            {
+                cloudParams.LightCacheEnabled = bLightCache ? 1 : 0;
+                bCloudParamsChanged = true;
+            }
+            if (bLightCache)
+            {
+                int refresh = (int)cloudParams.LightRefreshPerStep;
+                if (ImGui::SliderInt("Light Refresh / Step", &refresh, 1, 5))
+                {
+                    cloudParams.LightRefreshPerStep = (uint32_t)refresh;
+                    bCloudParamsChanged = true;
+                }
+                bCloudParamsChanged |= ImGui::SliderFloat("Light Cache Max Lag", &cloudParams.LightCacheMaxLag, 0.1f, 4.0f);
+                if (ImGui::IsItemHovered())
+                    ImGui::SetTooltip("Light samples per primary step in the default box (5 uncached): 3.0 at lag 1, 1.9 at 2, 1.5 at 3, 1.3 at 4; "
+                        "higher lags reuse density from farther along the view ray");
+            }
+
+            if (ImGui::Button("Measure vs 256-step Reference"))
+            {
+                renderer.m_bMeasureMarchError = true;
+            }
+            if (renderer.m_MarchError.bValid)
+            {
+                const auto& error = renderer.m_MarchError;
+                ImGui::Text("Importance: RMSE %.5f, %u density calls", error.ImportanceRmse, error.ImportanceDensityCalls);
+                ImGui::Text("Uniform:    RMSE %.5f, %u density calls", error.UniformRmse, error.UniformDensityCalls);
+                ImGui::Text("Reference:  %u density calls", error.ReferenceDensityCalls);
+            }
+
+            ImGui::Checkbox("LOD Stats", &renderer.m_bCollectCloudStats);
+            if (renderer.m_bCollectCloudStats)
+            {
+                const auto& stats = renderer.m_CloudStats;
+                uint32_t lodTotal = stats.LodSamples[0] + stats.LodSamples[1] + stats.LodSamples[2] + stats.LodSamples[3];
+                for (int i = 0; i < 4; i++)
+                {
+                    float percent = lodTotal > 0 ? 100.0f * stats.LodSamples[i] / lodTotal : 0.0f;
+                    ImGui::Text("LOD %d: %u samples (%.1f%%)", i, stats.LodSamples[i], percent);
+                }
+
+                float pixels = (float)std::max(stats.Pixels, 1u);
+                ImGui::Text("Primary density: %u (%.1f / px)", stats.PrimaryDensity, stats.PrimaryDensity / pixels);
+                ImGui::Text("Light density: %u (%.1f / px)", stats.LightDensity, stats.LightDensity / pixels);
+                if (renderer.m_Tiles.m_Settings.bEnabled)
+                    ImGui::TextDisabled("Refined tiles only");
+            }
+        }
+
+        // --- Weather Streaming ---
+        if (ImGui::CollapsingHeader("Weather Tiles"))
+        {
+            auto& settings = weatherMap.m_Settings;
+            const auto& stats = weatherMap.m_Stats;
+
+            bSettingsChanged |= ImGui::Checkbox("Streamed Weather Tiles", &settings.bEnabled);
+            bSettingsChanged |= ImGui::SliderFloat("Tile Size", &settings.TileSize, 50.0f, 1000.0f);
+            bSettingsChanged |= ImGui::SliderInt("Load Radius", &settings.LoadRadius, 1, 6);
+            bSettingsChanged |= ImGui::SliderInt("Evict Radius", &settings.EvictRadius, settings.LoadRadius + 1, 7);
+            bSettingsChanged |= ImGui::SliderInt("Uploads / Frame", &settings.MaxUploadsPerFrame, 1, 16);
+
+            ImGui::Text("Resident %d / %d slots, pending %d", stats.ResidentTiles, stats.SlotCount, stats.PendingTiles);
+            ImGui::Text("Memory %.2f MB (budget %.2f MB)", stats.ResidentBytes / (1024.0f * 1024.0f),
+                settings.MemoryBudgetBytes / (1024.0f * 1024.0f));
+            ImGui::Text("Uploads %d, evictions %d", stats.UploadsLastFrame, stats.EvictionsTotal);
+        }
+
+        // --- Denoiser ---
+        if (ImGui::CollapsingHeader("Denoiser"))
+        {
+            auto& denoise = renderer.m_Denoise;
+
+            bSettingsChanged |= ImGui::Checkbox("Denoise", &denoise.bEnabled);
+            bSettingsChanged |= ImGui::Checkbox("Temporal Accumulation", &denoise.bTemporal);
+            bSettingsChanged |= ImGui::SliderFloat("History Weight", &denoise.HistoryWeight, 0.0f, 0.98f);
+            bSettingsChanged |= ImGui::SliderFloat("Clip Gamma", &denoise.ClipGamma, 0.5f, 4.0f);
+            bSettingsChanged |= ImGui::SliderFloat("Transmittance Reject", &denoise.TransmittanceReject, 0.0f, 20.0f);
+
+            bSettingsChanged |= ImGui::SliderInt("A-Trous Iterations", &denoise.AtrousIterations, 0, 5);
+            bSettingsChanged |= ImGui::SliderFloat("Color Sigma", &denoise.ColorSigma, 0.05f, 4.0f);
+            bSettingsChanged |= ImGui::SliderFloat("Transmittance Sigma", &denoise.TransmittanceSigma, 0.01f, 1.0f);
+            bSettingsChanged |= ImGui::SliderFloat("Step Sigma", &denoise.StepSigma, 0.01f, 1.0f);
+
+            // Low step budget that the denoiser is meant to make usable
+            if (ImGui::Button("Use 8 Primary Steps"))
+            {
+                cloudParams.PrimarySteps = 8;
+                bCloudParamsChanged = true;
+            }
+        }
+
+        // --- Progressive Accumulation ---
+        if (ImGui::CollapsingHeader("Progressive"))
+        {
+            auto& progressive = renderer.m_Progressive;
+
+            ImGui::Checkbox("Progressive Refinement", &progressive.bEnabled);
+            if (ImGui::IsItemHovered())
+                ImGui::SetTooltip("Averages jittered frames while the camera, the settings and the cloud clock hold still; any change restarts it");
+            ImGui::SliderInt("Max Samples", &progressive.MaxSamples, 1, 4096);
+            if (progressive.bEnabled)
+            {
+                // The running clock restarts the average every frame; same setting as in the Idle section
+                ImGui::Checkbox("Pause Cloud Animation##Progressive", &idle.m_Settings.bPauseAnimation);
+                int samples = renderer.GetAccumulatedSamples();
+                ImGui::Text("Accumulated %d / %d%s", samples, progressive.MaxSamples,
+                    samples >= progressive.MaxSamples ? " (converged)" : "");
+            }
+        }
+
+        // --- Froxel Grid ---
+        if (ImGui::CollapsingHeader("Froxel Grid"))
+        {
+            auto& froxel = renderer.m_Froxel;
+
+            bSettingsChanged |= ImGui::Checkbox("Froxel Lighting", &froxel.bEnabled);
+            bSettingsChanged |= ImGui::SliderInt("Froxels X", &froxel.Width, 32, 320);
+            bSettingsChanged |= ImGui::SliderInt("Froxels Y", &froxel.Height, 18, 180);
+            bSettingsChanged |= ImGui::SliderInt("Froxel Slices", &froxel.Depth, 16, 128);
+            ImGui::Text("%d froxels", froxel.Width * froxel.Height * froxel.Depth);
+
+            if (renderer.IsFroxelBenchmarkRunning())
+                ImGui::Text("Benchmark running...");
+            else if (ImGui::Button("Benchmark vs Per-Pixel"))
+                renderer.StartFroxelBenchmark();
+
+            const auto& report = renderer.m_FroxelBenchmark;
+            if (report.bValid)
+            {
+                ImGui::Text("Per-pixel %.3f ms, froxel %.3f ms (%d frames)", report.PerPixelMs, report.FroxelMs, report.Frames);
+            }
+        }
+
+        // --- Cloud Shadow Map ---
+        if (ImGui::CollapsingHeader("Cloud Shadow"))
+        {
+            auto& shadow = renderer.m_CloudShadow;
+
+            bSettingsChanged |= ImGui::Checkbox("Cloud Shadow Map", &shadow.bEnabled);
+            bSettingsChanged |= ImGui::Checkbox("Light Clouds From Map (skips light march)", &shadow.bUseInMarch);
+            bSettingsChanged |= ImGui::SliderInt("Map Resolution", &shadow.Resolution, 64, 1024);
+            bSettingsChanged |= ImGui::SliderInt("Rows Per Frame", &shadow.RowsPerFrame, 1, shadow.Resolution);
+            bSettingsChanged |= ImGui::SliderFloat("Open Layer Extent", &shadow.OpenLayerExtent, 1000.0f, 40000.0f);
+
+            if (shadow.bEnabled)
+            {
+                float bakeMs = renderer.m_Profiler.GetLastTime("Cloud Shadow");
+                if (bakeMs >= 0.0f)
+                {
+                    ImGui::Text("Bake %.3f ms per frame, full refresh every %d frames", bakeMs,
+                        (shadow.Resolution + shadow.RowsPerFrame - 1) / shadow.RowsPerFrame);
+                }
+
+                // Density toward the sun at the layer base (r), quarter (g) and half height (b)
+                if (ID3D11ShaderResourceView* srv = renderer.GetCloudShadowSRV())
+                    ImGui::Image((void*)srv, ImVec2(204, 204));
+            }
+        }
+
+        // --- Screen-Space Light Shafts ---
+        if (ImGui::CollapsingHeader("Light Shafts"))
+        {
+            auto& shafts = renderer.m_LightShafts;
+
+            ImGui::Checkbox("Light Shafts", &shafts.bEnabled);
+            ImGui::SliderInt("Shaft Samples", &shafts.Samples, 8, 128);
+            ImGui::SliderFloat("Shaft Length", &shafts.Density, 0.1f, 1.0f);
+            ImGui::SliderFloat("Shaft Decay", &shafts.Decay, 0.9f, 1.0f, "%.3f");
+            ImGui::SliderFloat("Shaft Exposure", &shafts.Exposure, 0.0f, 4.0f);
+            ImGui::SliderFloat("Source Radius", &shafts.SourceRadius, 0.05f, 1.5f);
+
+            if (shafts.bEnabled)
+            {
+                float shaftMs = renderer.m_Profiler.GetLastTime("Light Shafts");
+                if (shaftMs >= 0.0f)
+                    ImGui::Text("Blur %.3f ms (skipped while the sun is out of view)", shaftMs);
+            }
+        }
+
+        // --- Mesh Export ---
+        if (ImGui::CollapsingHeader("Mesh Export"))
+        {
+            auto& meshExport = renderer.m_MeshExport;
+
+            const char* meshSources[] = { "SDF Scene", "Cloud Density" };
+            ImGui::Combo("Mesh Source", &meshExport.Source, meshSources, IM_ARRAYSIZE(meshSources));
+            bool bDensity = meshExport.Source == 1;
+            ImGui::SliderInt("Mesh Resolution", &meshExport.Resolution, 16,
+                bDensity ? Renderer::MaxDensityResolution : (int)MeshExtractor::MaxResolution);
+            if (bDensity)
+            {
+                ImGui::SliderFloat("Surface Density", &meshExport.DensityIso, 0.005f, 1.0f, "%.3f");
+                ImGui::SliderFloat("Open Layer Region", &meshExport.DensityExtent, 100.0f, 8000.0f, "%.0f");
+            }
+
+            if (ImGui::Button("Export Mesh"))
+                renderer.m_bExportMesh = true;
+            ImGui::SameLine();
+            if (ImGui::Button("Benchmark Resolutions"))
+                renderer.m_bBenchmarkMesh = true;
+
+            if (renderer.m_MeshReport.bValid)
+            {
+                const auto& report = renderer.m_MeshReport;
+                ImGui::Text("%s: %s", report.Path.c_str(), report.bSaved ? "saved" : "could not be written");
+                ImGui::Text("%d vertices, %d triangles, %d of %d blocks sampled", report.Stats.Vertices, report.Stats.Triangles,
+                    report.Stats.SampledBlocks, report.Stats.Blocks);
+                ImGui::Text("Extract %.1f ms (%.2f M tris/s), peak %.1f MB, file %.2f MB", report.Stats.Ms,
+                    report.Stats.TrianglesPerSec * 1e-6, report.Stats.PeakBytes / (1024.0 * 1024.0), report.Stats.FileBytes / (1024.0 * 1024.0));
+                if (report.SampleMs > 0.0f)
+                    ImGui::Text("GPU density grid %.1f ms", report.SampleMs);
+            }
+
+            if (!renderer.m_MeshBenchmark.empty() && ImGui::BeginTable("MeshBenchmark", 6, ImGuiTableFlags_Borders))
+            {
+                ImGui::TableSetupColumn("Cells");
+                ImGui::TableSetupColumn("Triangles");
+                ImGui::TableSetupColumn("ms");
+                ImGui::TableSetupColumn("M tris/s");
+                ImGui::TableSetupColumn("Peak MB");
+                ImGui::TableSetupColumn("File MB");
+                ImGui::TableHeadersRow();
+
+                for (const auto& stats : renderer.m_MeshBenchmark)
+                {
+                    ImGui::TableNextRow();
+                    ImGui::TableNextColumn(); ImGui::Text("%u", stats.Resolution);
+                    ImGui::TableNextColumn(); ImGui::Text("%d", stats.Triangles);
+                    ImGui::TableNextColumn(); ImGui::Text("%.1f", stats.Ms);
+                    ImGui::TableNextColumn(); ImGui::Text("%.2f", stats.TrianglesPerSec * 1e-6);
+                    ImGui::TableNextColumn(); ImGui::Text("%.1f", stats.PeakBytes / (1024.0 * 1024.0));
+                    ImGui::TableNextColumn(); ImGui::Text("%.2f", stats.FileBytes / (1024.0 * 1024.0));
+                }
+                ImGui::EndTable();
+            }
+        }
+
+        // --- CPU 2D SDF Overlay ---
+        if (ImGui::CollapsingHeader("2D Overlay Rasterizer"))
+        {
+            auto& raster = renderer.m_Raster2D;
+
+            ImGui::SliderInt("Overlay Width", &raster.Width, 256, (int)SdfRasterizer::MaxSize);
+            ImGui::SliderInt("Overlay Height", &raster.Height, 256, (int)SdfRasterizer::MaxSize);
+            ImGui::SliderInt("Shapes", &raster.ShapeCount, 1, 65536, "%d", ImGuiSliderFlags_Logarithmic);
+            const char* shadingNames[] = { "Coverage", "Distance Bands" };
+            ImGui::Combo("Overlay Shading", &raster.Shading, shadingNames, IM_ARRAYSIZE(shadingNames));
+            if (raster.Shading == (int)SdfRasterizer::Shading::Bands)
+                ImGui::SliderFloat("Band Reach (px)", &raster.BandPixels, 4.0f, 256.0f, "%.0f");
+
+            if (ImGui::Button("Rasterize Overlay"))
+                renderer.m_bRasterize2D = true;
+            ImGui::SameLine();
+            if (ImGui::Button("Benchmark Shape Counts"))
+                renderer.m_bBenchmarkRaster2D = true;
+
+            const auto& stats = renderer.m_Raster2DStats;
+            if (stats.Width > 0)
+            {
+                ImGui::Text("%d shapes at %ux%u: %.1f ms (bin %.2f ms), %.0f Mpixel/s", stats.Shapes, stats.Width, stats.Height,
+                    stats.Ms, stats.BinMs, stats.PixelsPerSec * 1e-6);
+                ImGui::Text("Tiles: %d edge, %d interior, %d empty of %d; %.2f shapes per edge pixel", stats.EdgeTiles, stats.InteriorTiles,
+                    stats.EmptyTiles, stats.Tiles, stats.EdgeTiles > 0 ?
+                    (double)stats.ShapeEvaluations / ((double)stats.EdgeTiles * SdfRasterizer::TileSize * SdfRasterizer::TileSize) : 0.0);
+                if (ID3D11ShaderResourceView* srv = renderer.GetRaster2DSRV())
+                    ImGui::Image((void*)srv, ImVec2(256.0f, 256.0f * stats.Height / stats.Width));
+            }
+
+            if (!renderer.m_Raster2DBenchmark.empty() && ImGui::BeginTable("Raster2DBenchmark", 5, ImGuiTableFlags_Borders))
+            {
+                ImGui::TableSetupColumn("Shapes");
+                ImGui::TableSetupColumn("Tiled ms");
+                ImGui::TableSetupColumn("Edge tiles");
+                ImGui::TableSetupColumn("Brute ms");
+                ImGui::TableSetupColumn("Speedup");
+                ImGui::TableHeadersRow();
+
+                for (const auto& result : renderer.m_Raster2DBenchmark)
+                {
+                    ImGui::TableNextRow();
+                    ImGui::TableNextColumn(); ImGui::Text("%d", result.Shapes);
+                    ImGui::TableNextColumn(); ImGui::Text("%.1f", result.Tiled.Ms);
+                    ImGui::TableNextColumn(); ImGui::Text("%d", result.Tiled.EdgeTiles);
+                    if (result.BruteMs >= 0.0f)
+                    {
+                        ImGui::TableNextColumn(); ImGui::Text("%.1f", result.BruteMs);
+                        ImGui::TableNextColumn(); ImGui::Text("%.1fx", result.BruteMs / (std::max)(result.Tiled.Ms, 1e-3f));
+                    }
+                    else
+                    {
+                        ImGui::TableNextColumn(); ImGui::Text("n/a");
+                        ImGui::TableNextColumn(); ImGui::Text("n/a");
+                    }
+                }
+                ImGui::EndTable();
+            }
+        }
+
+        // --- Distance Transform ---
+        if (ImGui::CollapsingHeader("Distance Field Generator"))
+        {
+            auto& distanceField = renderer.m_DistanceField;
+
+            ImGui::SliderInt("Mask Size", &distanceField.Size, 256, Renderer::MaxDistanceFieldSize);
+            ImGui::SliderInt("Mask Channels", &distanceField.Channels, 1, 4);
+            ImGui::SliderFloat("8-bit Spread (px)", &distanceField.Spread, 1.0f, 64.0f, "%.0f");
+            ImGui::Checkbox("Show in Distance2D", &distanceField.bShowOnScreen);
+
+            if (ImGui::Button("Generate Distance Field"))
+                renderer.m_bGenerateDistanceField = true;
+            ImGui::SameLine();
+            if (ImGui::Button("Benchmark 4K-16K"))
+                renderer.m_bBenchmarkDistanceField = true;
+
+            const auto& stats = renderer.m_DistanceFieldStats;
+            if (stats.Width > 0)
+            {
+                ImGui::Text("%u x %u x %u: %.1f ms (columns %.1f, rows %.1f), %.1f Mpixel/s", stats.Width, stats.Height, stats.Channels,
+                    stats.Ms, stats.ColumnMs, stats.RowMs, stats.PixelsPerSec * 1e-6);
+                ImGui::Text("Max error %.3g px against brute force, peak %.1f MB", renderer.m_DistanceFieldError,
+                    stats.PeakBytes / (1024.0 * 1024.0));
+            }
+
+            if (!renderer.m_DistanceFieldBenchmark.empty() && ImGui::BeginTable("DistanceFieldBenchmark", 5, ImGuiTableFlags_Borders))
+            {
+                ImGui::TableSetupColumn("Size");
+                ImGui::TableSetupColumn("ms");
+                ImGui::TableSetupColumn("Columns / Rows ms");
+                ImGui::TableSetupColumn("Mpixel/s");
+                ImGui::TableSetupColumn("Peak MB");
+                ImGui::TableHeadersRow();
+
+                for (const auto& result : renderer.m_DistanceFieldBenchmark)
+                {
+                    ImGui::TableNextRow();
+                    ImGui::TableNextColumn(); ImGui::Text("%u x %u", result.Width, result.Height);
+                    ImGui::TableNextColumn(); ImGui::Text("%.1f", result.Ms);
+                    ImGui::TableNextColumn(); ImGui::Text("%.1f / %.1f", result.ColumnMs, result.RowMs);
+                    ImGui::TableNextColumn(); ImGui::Text("%.1f", result.PixelsPerSec * 1e-6);
+                    ImGui::TableNextColumn(); ImGui::Text("%.0f", result.PeakBytes / (1024.0 * 1024.0));
+                }
+                ImGui::EndTable();
+            }
+        }
+
+        // --- Deadline-Aware Tile Refinement ---
+        if (ImGui::CollapsingHeader("Tile Refinement"))
+        {
+            auto& settings = renderer.m_Tiles.m_Settings;
+            const auto& stats = renderer.m_Tiles.GetStats();
+
+            bSettingsChanged |= ImGui::Checkbox("Coarse Pass + Refinement Tiles", &settings.bEnabled);
+            bSettingsChanged |= ImGui::SliderFloat("Cloud Deadline (ms)", &settings.DeadlineMs, 1.0f, 40.0f);
+            bSettingsChanged |= ImGui::SliderFloat("Coarse Step Scale", &settings.CoarseStepScale, 0.1f, 1.0f);
+
+            ImGui::TextColored(ImVec4(0, 0, 0, 1), "[ Priority ]");
+            bSettingsChanged |= ImGui::SliderFloat("Centre", &settings.CentreWeight, 0.0f, 4.0f);
+            bSettingsChanged |= ImGui::SliderFloat("Variance", &settings.VarianceWeight, 0.0f, 4.0f);
+            bSettingsChanged |= ImGui::SliderFloat("Coverage", &settings.CoverageWeight, 0.0f, 4.0f);
+
+            if (settings.bEnabled)
+            {
+                ImGui::Text("Refined %d / %d tiles", stats.TilesRefined, stats.TilesTotal);
+                ImGui::Text("Coarse %.2f ms, refine %.2f ms, %.3f ms per tile", stats.CoarseMs, stats.RefineMs, stats.TileCostMs);
+            }
+        }
+
+        // --- GPU Timings ---
+        if (ImGui::CollapsingHeader("GPU Timings"))
+        {
+            for (const auto& scope : renderer.m_Profiler.GetScopes())
+            {
+                ImGui::Text("%-18s %.3f ms", scope.Name.c_str(), scope.SmoothedMs);
+            }
+        }
+
+        // --- Dynamic Resolution ---
+        if (ImGui::CollapsingHeader("Dynamic Resolution"))
+        {
+            auto& settings = governor.m_Settings;
+
+            ImGui::Checkbox("Hold Frame Budget", &settings.bEnabled);
+            if (ImGui::Button("16.6 ms")) settings.BudgetMs = 16.6f;
+            ImGui::SameLine();
+            if (ImGui::Button("33.3 ms")) settings.BudgetMs = 33.3f;
+            ImGui::SliderFloat("Budget (ms)", &settings.BudgetMs, 4.0f, 50.0f);
+            ImGui::SliderFloat("Hysteresis", &settings.Hysteresis, 0.0f, 0.5f);
+            ImGui::SliderInt("Down Frames", &settings.DownFrames, 1, 30);
+            ImGui::SliderInt("Up Frames", &settings.UpFrames, 1, 240);
+
+            const auto& quality = governor.GetQuality();
+            ImGui::Text("Level %d / %d: scale %.3f, steps x%.2f, light x%.2f", governor.GetLevel(), governor.GetLevelCount() - 1,
+                quality.RenderScale, quality.PrimaryStepScale, quality.LightStepScale);
+            ImGui::Text("Smoothed %.2f ms", governor.GetSmoothedMs());
+            if (renderer.m_Progressive.bEnabled)
+                ImGui::TextColored(ImVec4(1, 1, 0, 1), "Held at full quality while progressive refinement is on");
+
+            // Actual frame time with the budget and its dead band drawn over the plot
+            float plotMax = settings.BudgetMs * 2.0f;
+            ImGui::PlotLines("Frame ms", governor.GetFrameHistory(), ResolutionGovernor::HistorySize, 0, nullptr, 0.0f, plotMax, ImVec2(0, 80));
+
+            ImVec2 plotMin = ImGui::GetItemRectMin();
+            ImVec2 plotMaxPos = ImGui::GetItemRectMax();
+            float plotWidth = ImGui::CalcItemWidth();
+            auto budgetY = [&](float ms) { return plotMaxPos.y - (plotMaxPos.y - plotMin.y) * (ms / plotMax); };
+
+            ImDrawList* drawList = ImGui::GetWindowDrawList();
+            drawList->AddLine(ImVec2(plotMin.x, budgetY(settings.BudgetMs)), ImVec2(plotMin.x + plotWidth, budgetY(settings.BudgetMs)),
+                IM_COL32(255, 80, 80, 255), 1.5f);
+            for (float band : { 1.0f - settings.Hysteresis, 1.0f + settings.Hysteresis })
+            {
+                float y = budgetY(settings.BudgetMs * band);
+                drawList->AddLine(ImVec2(plotMin.x, y), ImVec2(plotMin.x + plotWidth, y), IM_COL32(255, 80, 80, 90));
+            }
+
+            ImGui::PlotLines("Render Scale", governor.GetScaleHistory(), ResolutionGovernor::HistorySize, 0, nullptr, 0.0f, 1.0f, ImVec2(0, 40));
+        }
+
+        // --- Interactive Preview ---
+        if (ImGui::CollapsingHeader("Interactive Preview"))
+        {
+            auto& settings = preview.m_Settings;
+            const auto& stats = preview.GetStats();
+
+            ImGui::Checkbox("Preview LOD While Dragging", &settings.bEnabled);
+            ImGui::SliderFloat("Preview Scale", &settings.RenderScale, 0.25f, 1.0f);
+            ImGui::SliderFloat("Preview Steps", &settings.StepScale, 0.1f, 1.0f);
+            ImGui::SliderFloat("Settle (ms)", &settings.SettleMs, 0.0f, 500.0f);
+
+            ImGui::Text("Input to photon: last %.2f ms", stats.LastMs);
+            ImGui::Text("Preview avg %.2f ms (%d), full avg %.2f ms (%d)",
+                stats.PreviewAvgMs, stats.PreviewSamples, stats.FullAvgMs, stats.FullSamples);
+            if (stats.DroppedSamples > 0)
+                ImGui::Text("Dropped samples: %d", stats.DroppedSamples);
+            ImGui::PlotLines("Latency ms", preview.GetHistory(), InteractivePreview::HistorySize, 0, nullptr, 0.0f, 100.0f, ImVec2(0, 60));
+            if (ImGui::Button("Reset Latency Stats")) preview.ResetStats();
+        }
+
+        // --- Idle ---
+        if (ImGui::CollapsingHeader("Idle"))
+        {
+            auto& settings = idle.m_Settings;
+            const auto& stats = idle.GetStats();
+
+            ImGui::Checkbox("Skip Unchanged Frames", &settings.bEnabled);
+            ImGui::Checkbox("Pause Cloud Animation", &settings.bPauseAnimation);
+            ImGui::SliderInt("Settle Frames", &settings.SettleFrames, 1, 8);
+            ImGui::SliderInt("Max Sleep (ms)", &settings.MaxSleepMs, 10, 2000);
+
+            ImGui::Text("Last second: %d rendered, %d skipped", stats.FramesRendered, stats.FramesSkipped);
+            ImGui::Text("CPU %.1f %%, GPU %.1f %%", stats.CpuPercent, stats.GpuPercent);
+            ImGui::Text("Last idle: %.1f s, CPU %.2f %%, %d wakeups", stats.IdleSeconds, stats.IdleCpuPercent, stats.IdleWakeups);
+            ImGui::Text("Wake to present: last %.2f ms, avg %.2f ms, max %.2f ms (%d)",
+                stats.WakeLatencyMs, stats.WakeLatencyAvgMs, stats.WakeLatencyMaxMs, stats.WakeSamples);
+            if (ImGui::Button("Reset Latency")) idle.ResetWakeLatency();
+        }
+
+        // --- Flight Benchmark ---
+        if (ImGui::CollapsingHeader("Benchmark"))
+        {
+            auto state = benchmark.GetState();
+
+            if (state == FlightBenchmark::State::Idle)
+            {
+                if (ImGui::Button("Record Path")) benchmark.StartRecording();
+                ImGui::SameLine();
+                if (ImGui::Button("Generate Long Path")) benchmark.GenerateLongPath(20000.0f, 120.0f, 20.0f);
+
+                if (ImGui::Button("Play")) benchmark.StartPlayback();
+                ImGui::SameLine();
+                if (ImGui::Button("Save")) benchmark.SavePath("flight_path.bin");
+                ImGui::SameLine();
+                if (ImGui::Button("Load")) benchmark.LoadPath("flight_path.bin");
+            }
+            else if (ImGui::Button("Stop"))
+            {
+                benchmark.Stop();
+            }
+
+            ImGui::Text("Path keys: %d", (int)benchmark.GetPath().size());
+
+            const auto& frameTimes = benchmark.GetFrameTimes();
+            if (!frameTimes.empty())
+            {
+                ImGui::PlotLines("Frame ms", frameTimes.data(), (int)frameTimes.size(), 0, nullptr, 0.0f, 50.0f, ImVec2(0, 60));
+            }
+
+            const auto& report = benchmark.GetReport();
+            if (report.Frames > 0)
+            {
+                ImGui::Text("Frames %d, avg %.2f ms, median %.2f ms", report.Frames, report.AvgMs, report.MedianMs);
+                ImGui::Text("p99 %.2f ms, max %.2f ms", report.P99Ms, report.MaxMs);
+                ImGui::Text("Hitch frames: %d", report.HitchFrames);
+            }
         }
 
         // --- Debug Views ---
@@ -70,6 +867,7 @@ bool Gui::Update(float totalTime, Constant & constant, Camera & camera, Renderer
 
     ImGui::End();
 
+    m_bRendererSettingsChanged = bSettingsChanged;
     return bCloudParamsChanged;
 }
 
@@ -79,6 +877,16 @@ void Gui::Render()
     ImGui_ImplDX11_RenderDrawData(ImGui::GetDrawData());
 }
 
+void Gui::SkipRender()
+{
+    ImGui::EndFrame();
+}
+
+bool Gui::IsInteracting() const
+{
+    return ImGui::IsAnyItemActive() || ImGui::GetIO().WantTextInput;
+}
+
 Gui::~Gui()
 {
 	// Cleanup
@@ -4,6 +4,11 @@ class Constant;
 class Camera;
 class Renderer;
 class ResourceManager;
+class WeatherMap;
+class FlightBenchmark;
+class IdleScheduler;
+class ResolutionGovernor;
+class InteractivePreview;
 
 class Gui
 {
@@ -18,10 +23,25 @@ public:
 
     void Initialize(HWND hWnd, ID3D11Device* device, ID3D11DeviceContext* context);
 
-    bool Update(float totalTime, Constant& constant, Camera& camera, Renderer& renderer, ResourceManager& resMgr);
+    bool Update(float totalTime, Constant& constant, Camera& camera, Renderer& renderer, ResourceManager& resMgr,
+        WeatherMap& weatherMap, FlightBenchmark& benchmark, IdleScheduler& idle,
+        ResolutionGovernor& governor, InteractivePreview& preview);
 
     void Render();
 
+    // Ends the ImGui frame without drawing, for frames the idle scheduler skips
+    void SkipRender();
+
+    // A widget is held or being typed into; its look can change without any input message
+    bool IsInteracting() const;
+
+    // The last Update changed a renderer setting outside the cloud constants (scene mode, weather tiles,
+    // denoiser, froxel grid, cloud shadow, tile refinement), so an accumulated image is out of date
+    bool HasRendererSettingsChanged() const { return m_bRendererSettingsChanged; }
+
 private:
     void SetStyle();
+
+private:
+    bool m_bRendererSettingsChanged = false;
 };
\ No newline at end of file
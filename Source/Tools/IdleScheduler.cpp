@@ -0,0 +1,148 @@
+#include "IdleScheduler.h"
+
+namespace
+{
+	constexpr double WindowSeconds = 1.0;
+
+	double FileTimeToSeconds(const FILETIME& time)
+	{
+		ULARGE_INTEGER value;
+		value.LowPart = time.dwLowDateTime;
+		value.HighPart = time.dwHighDateTime;
+		return (double)value.QuadPart * 1e-7; // 100 ns units
+	}
+}
+
+IdleScheduler::IdleScheduler()
+{
+	__int64 countsPerSec;
+	QueryPerformanceFrequency((LARGE_INTEGER*)&countsPerSec);
+	m_SecondsPerCount = 1.0 / (double)countsPerSec;
+
+	m_WindowStart = Now();
+	m_WindowCpuStart = ProcessCpuSeconds();
+}
+
+double IdleScheduler::Now() const
+{
+	__int64 counter;
+	QueryPerformanceCounter((LARGE_INTEGER*)&counter);
+	return (double)counter * m_SecondsPerCount;
+}
+
+double IdleScheduler::ProcessCpuSeconds() const
+{
+	FILETIME creation, exit, kernel, user;
+	if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user))
+		return 0.0;
+
+	return FileTimeToSeconds(kernel) + FileTimeToSeconds(user);
+}
+
+bool IdleScheduler::BeginFrame(bool bDirty)
+{
+	double now = Now();
+
+	if (bDirty || !m_Settings.bEnabled)
+	{
+		m_SettleFramesLeft = m_Settings.SettleFrames;
+	}
+
+	bool bRender = m_SettleFramesLeft > 0;
+
+	if (bRender)
+	{
+		m_SettleFramesLeft--;
+
+		if (m_Stats.bIdle)
+		{
+			// Idle span ended: report what the sleeping loop cost
+			double span = now - m_IdleStart;
+			m_Stats.bIdle = false;
+			m_Stats.IdleSeconds = (float)span;
+			m_Stats.IdleWakeups = m_Wakeups;
+			m_Stats.IdleCpuPercent = span > 0.0 ? (float)((ProcessCpuSeconds() - m_IdleCpuStart) / span * 100.0) : 0.0f;
+		}
+	}
+	else
+	{
+		if (!m_Stats.bIdle)
+		{
+			m_Stats.bIdle = true;
+			m_IdleStart = now;
+			m_IdleCpuStart = ProcessCpuSeconds();
+			m_Wakeups = 0;
+		}
+
+		// Woke up but nothing to draw, so this wake has no photon to measure
+		m_bWakePending = false;
+		m_WindowSkipped++;
+	}
+
+	UpdateWindow(now);
+	return bRender;
+}
+
+void IdleScheduler::Wait()
+{
+	// MWMO_INPUTAVAILABLE also wakes for input already queued but not yet removed
+	DWORD result = MsgWaitForMultipleObjectsEx(0, nullptr, (DWORD)m_Settings.MaxSleepMs, QS_ALLINPUT, MWMO_INPUTAVAILABLE);
+
+	m_Wakeups++;
+	if (result == WAIT_OBJECT_0)
+	{
+		m_bWakePending = true;
+		m_WakeTime = Now();
+	}
+}
+
+void IdleScheduler::EndFrame(float gpuFrameMs)
+{
+	double now = Now();
+
+	if (m_bWakePending)
+	{
+		m_bWakePending = false;
+
+		float latencyMs = (float)((now - m_WakeTime) * 1000.0);
+		m_Stats.WakeLatencyMs = latencyMs;
+		m_Stats.WakeLatencyMaxMs = (std::max)(m_Stats.WakeLatencyMaxMs, latencyMs);
+		m_WakeLatencySum += latencyMs;
+		m_Stats.WakeSamples++;
+		m_Stats.WakeLatencyAvgMs = (float)(m_WakeLatencySum / m_Stats.WakeSamples);
+	}
+
+	// The profiler resolves a few frames late; its last value stands in for this frame's GPU time
+	if (gpuFrameMs > 0.0f) m_WindowGpuMs += gpuFrameMs;
+	m_WindowRendered++;
+
+	UpdateWindow(now);
+}
+
+void IdleScheduler::ResetWakeLatency()
+{
+	m_Stats.WakeLatencyMs = 0.0f;
+	m_Stats.WakeLatencyMaxMs = 0.0f;
+	m_Stats.WakeLatencyAvgMs = 0.0f;
+	m_Stats.WakeSamples = 0;
+	m_WakeLatencySum = 0.0;
+}
+
+void IdleScheduler::UpdateWindow(double now)
+{
+	double elapsed = now - m_WindowStart;
+	if (elapsed < WindowSeconds) return;
+
+	double cpu = ProcessCpuSeconds();
+
+	m_Stats.CpuPercent = (float)((cpu - m_WindowCpuStart) / elapsed * 100.0);
+	m_Stats.GpuPercent = (float)((m_WindowGpuMs * 0.001) / elapsed * 100.0);
+	m_Stats.FramesRendered = m_WindowRendered;
+	m_Stats.FramesSkipped = m_WindowSkipped;
+
+	m_WindowStart = now;
+	m_WindowCpuStart = cpu;
+	m_WindowGpuMs = 0.0;
+	m_WindowRendered = 0;
+	m_WindowSkipped = 0;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+// Skips rendering and presenting while the image would not change, and sleeps the message loop until input arrives.
+class IdleScheduler
+{
+public:
+	struct Settings
+	{
+		bool bEnabled = true;
+		bool bPauseAnimation = false; // Freezes the cloud clock so a static view can go idle
+		int  SettleFrames = 2;        // Frames rendered after the last change (ImGui hover/active state lags one frame)
+		int  MaxSleepMs = 500;        // Upper bound of one wait; the loop re-checks for changes afterwards
+	};
+
+	struct Stats
+	{
+		bool  bIdle = false;
+		float CpuPercent = 0.0f;      // Process CPU time over wall time in the last window (100 = one core)
+		float GpuPercent = 0.0f;      // GPU frame time over wall time in the last window
+		int   FramesRendered = 0;     // In the last window
+		int   FramesSkipped = 0;
+		float IdleCpuPercent = 0.0f;  // Over the last completed idle span
+		float IdleSeconds = 0.0f;
+		int   IdleWakeups = 0;        // Waits that ended in the last idle span
+		float WakeLatencyMs = 0.0f;   // Input wake to Present returning, last wake
+		float WakeLatencyMaxMs = 0.0f;
+		float WakeLatencyAvgMs = 0.0f;
+		int   WakeSamples = 0;
+	};
+
+public:
+	IdleScheduler();
+	~IdleScheduler() {}
+
+	// [Rule] System classes should NOT be copied.
+	IdleScheduler(const IdleScheduler&) = delete;
+	IdleScheduler& operator=(const IdleScheduler&) = delete;
+
+	// bDirty: anything that changes the image happened this iteration. Returns false if the frame can be skipped.
+	bool BeginFrame(bool bDirty);
+
+	// Blocks until a message arrives or MaxSleepMs passes; only call after BeginFrame returned false
+	void Wait();
+
+	// After Present; gpuFrameMs is the latest resolved GPU frame time (negative if unknown)
+	void EndFrame(float gpuFrameMs);
+
+	void ResetWakeLatency();
+
+	Settings m_Settings;
+
+	const Stats& GetStats() const { return m_Stats; }
+
+private:
+	double Now() const;
+	double ProcessCpuSeconds() const;
+	void UpdateWindow(double now);
+
+private:
+	double m_SecondsPerCount = 0.0;
+
+	int m_SettleFramesLeft = 0;
+
+	// Idle span
+	double m_IdleStart = 0.0;
+	double m_IdleCpuStart = 0.0;
+	int m_Wakeups = 0;
+
+	// A wake caused by a message, waiting for the next Present
+	bool m_bWakePending = false;
+	double m_WakeTime = 0.0;
+	double m_WakeLatencySum = 0.0;
+
+	// Rolling one-second window
+	double m_WindowStart = 0.0;
+	double m_WindowCpuStart = 0.0;
+	double m_WindowGpuMs = 0.0;
+	int m_WindowRendered = 0;
+	int m_WindowSkipped = 0;
+
+	Stats m_Stats;
+};
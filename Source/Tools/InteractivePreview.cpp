@@ -0,0 +1,132 @@
+#include "InteractivePreview.h"
+
+InteractivePreview::InteractivePreview()
+{
+	__int64 countsPerSec;
+	QueryPerformanceFrequency((LARGE_INTEGER*)&countsPerSec);
+	m_SecondsPerCount = 1.0 / (double)countsPerSec;
+}
+
+void InteractivePreview::Initialize(ID3D11Device* device, ID3D11DeviceContext* context)
+{
+	m_pContext = context;
+
+	D3D11_QUERY_DESC queryDesc = {};
+	queryDesc.Query = D3D11_QUERY_EVENT;
+
+	for (Pending& pending : m_Queries)
+	{
+		ThrowIfFailed(device->CreateQuery(&queryDesc, &pending.Query));
+	}
+}
+
+double InteractivePreview::Now() const
+{
+	__int64 counter;
+	QueryPerformanceCounter((LARGE_INTEGER*)&counter);
+	return (double)counter * m_SecondsPerCount;
+}
+
+void InteractivePreview::OnInput()
+{
+	if (m_bHasInput) return;
+
+	// Not MSG::time: it follows GetTickCount, whose resolution is the ~16 ms system tick
+	m_InputTime = Now();
+	m_bHasInput = true;
+}
+
+bool InteractivePreview::Update(bool bItemActive, bool bChanged)
+{
+	Poll();
+
+	double now = Now();
+	if (bChanged)
+	{
+		m_LastChange = now;
+
+		// Without a message this frame (e.g. a held key repeating through ImGui), time from the frame start
+		m_bMeasureFrame = true;
+		m_FrameInputTime = m_bHasInput ? m_InputTime : now;
+	}
+	m_bHasInput = false;
+
+	bool bRecent = m_LastChange >= 0.0 && (now - m_LastChange) * 1000.0 < m_Settings.SettleMs;
+	m_bPreviewing = m_Settings.bEnabled && bItemActive && bRecent;
+	return m_bPreviewing;
+}
+
+void InteractivePreview::EndFrame()
+{
+	if (!m_bMeasureFrame || !m_pContext) return;
+	m_bMeasureFrame = false;
+
+	Pending& pending = m_Queries[m_NextQuery];
+	m_NextQuery = (m_NextQuery + 1) % QueryCount;
+
+	// Slot still in flight: the GPU is more than QueryCount changes behind, give that sample up
+	if (pending.bBusy) m_Stats.DroppedSamples++;
+
+	pending.InputTime = m_FrameInputTime;
+	pending.bPreview = m_bPreviewing;
+	pending.bBusy = true;
+	m_pContext->End(pending.Query.Get());
+
+	// Issued after Present, the query would otherwise wait for the next frame's work to reach the GPU
+	m_pContext->Flush();
+	Poll();
+}
+
+bool InteractivePreview::IsMeasuring() const
+{
+	for (const Pending& pending : m_Queries)
+	{
+		if (pending.bBusy) return true;
+	}
+	return false;
+}
+
+void InteractivePreview::Poll()
+{
+	if (!m_pContext) return;
+
+	for (Pending& pending : m_Queries)
+	{
+		if (!pending.bBusy) continue;
+
+		BOOL bDone = FALSE;
+		if (m_pContext->GetData(pending.Query.Get(), &bDone, sizeof(BOOL), D3D11_ASYNC_GETDATA_DONOTFLUSH) == S_OK && bDone)
+		{
+			pending.bBusy = false;
+			AddSample((float)((Now() - pending.InputTime) * 1000.0), pending.bPreview);
+		}
+	}
+}
+
+void InteractivePreview::AddSample(float ms, bool bPreview)
+{
+	m_Stats.LastMs = ms;
+	if (bPreview)
+	{
+		m_PreviewSumMs += ms;
+		m_Stats.PreviewSamples++;
+		m_Stats.PreviewAvgMs = (float)(m_PreviewSumMs / m_Stats.PreviewSamples);
+	}
+	else
+	{
+		m_FullSumMs += ms;
+		m_Stats.FullSamples++;
+		m_Stats.FullAvgMs = (float)(m_FullSumMs / m_Stats.FullSamples);
+	}
+
+	memmove(m_History, m_History + 1, (HistorySize - 1) * sizeof(float));
+	m_History[HistorySize - 1] = ms;
+}
+
+void InteractivePreview::ResetStats()
+{
+	m_Stats = {};
+	m_PreviewSumMs = 0.0;
+	m_FullSumMs = 0.0;
+	memset(m_History, 0, sizeof(m_History));
+}
@@ -0,0 +1,525 @@
+#include <fstream>
+#include <cfloat>
+
+#include "MeshExtractor.h"
+
+namespace
+{
+	constexpr uint32_t MeshFileMagic = 0x534D4654;  // "TFMS"
+	constexpr uint32_t MeshFileVersion = 1;
+	constexpr uint32_t MaxProbes = 64;              // Longer chains mean the table is too full: grow it and restart
+	constexpr uint64_t MaxTableSlots = 1ull << 28;
+
+	// [Important] On-disk layout of TFMS; followed by VertexCount x 3 uint16 positions, then TriangleCount x 3 indices
+	struct MeshFileHeader
+	{
+		uint32_t Magic;
+		uint32_t Version;
+		uint32_t VertexCount;
+		uint32_t TriangleCount;
+		float    BoundsMin[3];     // Positions decode as BoundsMin + q / 65535 * (BoundsMax - BoundsMin)
+		float    BoundsMax[3];
+		uint32_t IndexBytes;       // 2 when every index fits, else 4
+		uint32_t Padding;
+	};
+	static_assert(sizeof(MeshFileHeader) == 48, "TFMS header size mismatch");
+
+	float GetAxis(const DirectX::SimpleMath::Vector3& v, int axis)
+	{
+		return axis == 0 ? v.x : (axis == 1 ? v.y : v.z);
+	}
+}
+
+void MeshExtractor::Initialize(ThreadPool& workers)
+{
+	m_pWorkers = &workers;
+}
+
+bool MeshExtractor::Extract(const Field& field, UINT resolution, Mesh& mesh)
+{
+	double start = GetSeconds();
+	m_Stats = Stats();
+
+	mesh.Positions.clear();
+	mesh.Indices.clear();
+
+	Vector3 extent = field.Max - field.Min;
+	float longest = (std::max)(extent.x, (std::max)(extent.y, extent.z));
+	if (!field.Sample || !(longest > 0.0f)) return false;
+
+	resolution = (std::min)((std::max)(resolution, 2u), MaxResolution);
+
+	Grid grid = {};
+	grid.Source = &field;
+	grid.Origin = field.Min;
+	grid.CellSize = longest / resolution;
+
+	UINT blocks[3];
+	for (int axis = 0; axis < 3; axis++)
+	{
+		grid.Cells[axis] = (std::max)((UINT)ceilf(GetAxis(extent, axis) / grid.CellSize), 1u);
+		blocks[axis] = (grid.Cells[axis] + BlockCells - 1) / BlockCells;
+	}
+
+	// Octree over the blocks, from a power-of-two root
+	UINT rootSize = 1;
+	while (rootSize < (std::max)(blocks[0], (std::max)(blocks[1], blocks[2])))
+		rootSize *= 2;
+
+	std::vector<Block> active;
+	CollectBlocks(grid, blocks, 0, 0, 0, rootSize, active);
+
+	m_Stats.Resolution = resolution;
+	m_Stats.Blocks = (int)(blocks[0] * blocks[1] * blocks[2]);
+	m_Stats.SampledBlocks = (int)active.size();
+
+	// A surface crosses a block in about a plane's worth of cells; the table grows if that guess is short
+	uint64_t capacity = 4096;
+	while (capacity < (uint64_t)active.size() * BlockCells * BlockCells * 4)
+		capacity *= 2;
+
+	const UINT samples = (BlockCells + 2) * (BlockCells + 2) * (BlockCells + 2);
+	const UINT jobCount = (UINT)(std::min)(active.size(), (size_t)(std::max)(m_pWorkers->GetThreadCount(), 1u));
+
+	// Per block, so the output does not depend on which worker took which block
+	std::vector<std::vector<uint32_t>> blockIndices;
+	std::unique_ptr<std::atomic<uint64_t>[]> keys;
+	std::vector<Vector3> positions;
+	for (;;)
+	{
+		keys.reset(new std::atomic<uint64_t>[capacity]);
+		for (uint64_t i = 0; i < capacity; i++)
+			keys[i].store(0, std::memory_order_relaxed);
+		positions.assign((size_t)capacity, Vector3());
+
+		std::atomic<bool> bOverflow{ false };
+		grid.Keys = keys.get();
+		grid.Positions = positions.data();
+		grid.Mask = (uint32_t)(capacity - 1);
+		grid.bOverflow = &bOverflow;
+
+		blockIndices.assign(active.size(), std::vector<uint32_t>());
+		std::atomic<UINT> nextBlock{ 0 };
+		m_pWorkers->ParallelFor(jobCount, [this, &grid, &active, &blockIndices, &nextBlock, &bOverflow, samples](UINT)
+		{
+			std::vector<float> scratch(samples * 4);
+			for (;;)
+			{
+				UINT b = nextBlock.fetch_add(1, std::memory_order_relaxed);
+				if (b >= active.size() || bOverflow.load(std::memory_order_relaxed)) break;
+				MeshBlock(grid, active[b], scratch, blockIndices[b]);
+			}
+		});
+
+		if (!bOverflow.load()) break;
+
+		capacity *= 2;
+		m_Stats.Retries++;
+		if (capacity > MaxTableSlots) return false;
+	}
+
+	// Vertices in cell order rather than hash order: deterministic, and neighbouring cells stay close in memory
+	std::vector<std::pair<uint64_t, uint32_t>> claimed;
+	for (uint64_t slot = 0; slot < capacity; slot++)
+	{
+		uint64_t key = keys[slot].load(std::memory_order_relaxed);
+		if (key != 0) claimed.push_back({ key, (uint32_t)slot });
+	}
+	std::sort(claimed.begin(), claimed.end());
+
+	std::vector<uint32_t> remap((size_t)capacity, 0);
+	mesh.Positions.reserve(claimed.size());
+	for (const auto& entry : claimed)
+	{
+		remap[entry.second] = (uint32_t)mesh.Positions.size();
+		mesh.Positions.push_back(positions[entry.second]);
+	}
+
+	size_t indexCount = 0;
+	for (const auto& indices : blockIndices)
+		indexCount += indices.size();
+
+	mesh.Indices.reserve(indexCount);
+	for (const auto& indices : blockIndices)
+	{
+		for (uint32_t slot : indices)
+			mesh.Indices.push_back(remap[slot]);
+	}
+
+	mesh.Min = Vector3(FLT_MAX, FLT_MAX, FLT_MAX);
+	mesh.Max = Vector3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	for (const Vector3& position : mesh.Positions)
+	{
+		mesh.Min = Vector3::Min(mesh.Min, position);
+		mesh.Max = Vector3::Max(mesh.Max, position);
+	}
+	if (mesh.Positions.empty())
+	{
+		mesh.Min = field.Min;
+		mesh.Max = field.Min;
+	}
+
+	m_Stats.Vertices = (int)mesh.Positions.size();
+	m_Stats.Triangles = (int)(mesh.Indices.size() / 3);
+	m_Stats.Ms = (float)((GetSeconds() - start) * 1000.0);
+	m_Stats.TrianglesPerSec = m_Stats.Triangles / (std::max)((double)m_Stats.Ms * 1e-3, 1e-9);
+	m_Stats.FileBytes = GetFileBytes(mesh);
+
+	// Table, positions and remap at the compaction, plus the block lists, the merged mesh and the scratch
+	m_Stats.PeakBytes = capacity * (sizeof(uint64_t) + sizeof(Vector3) + sizeof(uint32_t))
+		+ claimed.size() * sizeof(claimed[0])
+		+ indexCount * sizeof(uint32_t) * 2
+		+ mesh.Positions.size() * sizeof(Vector3)
+		+ (UINT64)jobCount * samples * 4 * sizeof(float);
+	return true;
+}
+
+void MeshExtractor::CollectBlocks(const Grid& grid, const UINT blocks[3], UINT x, UINT y, UINT z, UINT size, std::vector<Block>& active)
+{
+	if (x >= blocks[0] || y >= blocks[1] || z >= blocks[2]) return;
+
+	// Every cell the node's blocks make vertices for, the one-cell apron included
+	if (grid.Source->MayCross)
+	{
+		float span = (float)(size * BlockCells + 1) * grid.CellSize;
+		Vector3 boxMin = grid.Origin + (Vector3((float)x, (float)y, (float)z) * (float)BlockCells - Vector3(1.0f, 1.0f, 1.0f)) * grid.CellSize;
+		Vector3 boxMax = boxMin + Vector3(span, span, span);
+		if (!grid.Source->MayCross(boxMin, boxMax)) return;
+	}
+
+	if (size == 1)
+	{
+		active.push_back({ x * BlockCells, y * BlockCells, z * BlockCells });
+		return;
+	}
+
+	UINT half = size / 2;
+	for (UINT child = 0; child < 8; child++)
+	{
+		CollectBlocks(grid, blocks, x + ((child & 1) ? half : 0), y + ((child & 2) ? half : 0), z + ((child & 4) ? half : 0), half, active);
+	}
+}
+
+void MeshExtractor::MeshBlock(const Grid& grid, const Block& block, std::vector<float>& scratch, std::vector<uint32_t>& indices)
+{
+	// Corners from one before the block to its far face: the vertices of the cells on both sides of every
+	// edge the block owns
+	const UINT stride = BlockCells + 2;
+	const UINT count = stride * stride * stride;
+	const int first[3] = { (int)block.X - 1, (int)block.Y - 1, (int)block.Z - 1 };
+
+	float* xs = scratch.data();
+	float* ys = xs + count;
+	float* zs = ys + count;
+	float* values = zs + count;
+
+	UINT sample = 0;
+	for (UINT k = 0; k < stride; k++)
+	{
+		for (UINT j = 0; j < stride; j++)
+		{
+			for (UINT i = 0; i < stride; i++, sample++)
+			{
+				xs[sample] = grid.Origin.x + (first[0] + (int)i) * grid.CellSize;
+				ys[sample] = grid.Origin.y + (first[1] + (int)j) * grid.CellSize;
+				zs[sample] = grid.Origin.z + (first[2] + (int)k) * grid.CellSize;
+			}
+		}
+	}
+
+	SdfKernels::Points points = { xs, ys, zs, count };
+	grid.Source->Sample(points, values);
+
+	const float iso = grid.Source->IsoLevel;
+	const UINT axisStride[3] = { 1, stride, stride * stride };
+	const UINT blockStart[3] = { block.X, block.Y, block.Z };
+
+	// Owned edges start at a corner inside the block and run along +axis
+	UINT end[3];
+	for (int axis = 0; axis < 3; axis++)
+		end[axis] = (std::min)(blockStart[axis] + BlockCells, grid.Cells[axis] + 1);
+
+	for (UINT z = block.Z; z < end[2]; z++)
+	{
+		for (UINT y = block.Y; y < end[1]; y++)
+		{
+			for (UINT x = block.X; x < end[0]; x++)
+			{
+				const UINT corner[3] = { x, y, z };
+				const UINT local[3] = { x - first[0], y - first[1], z - first[2] };
+				const UINT index = local[0] + local[1] * stride + local[2] * stride * stride;
+				const bool bInside = values[index] < iso;
+
+				for (int axis = 0; axis < 3; axis++)
+				{
+					int u = (axis + 1) % 3;
+					int v = (axis + 2) % 3;
+
+					// The four cells around the edge must all be in the grid
+					if (corner[axis] >= grid.Cells[axis]) continue;
+					if (corner[u] == 0 || corner[u] >= grid.Cells[u]) continue;
+					if (corner[v] == 0 || corner[v] >= grid.Cells[v]) continue;
+
+					if ((values[index + axisStride[axis]] < iso) == bInside) continue;
+
+					// Cells (u - 1, v - 1), (u, v - 1), (u, v), (u - 1, v): counter-clockwise around +axis
+					uint32_t quad[4];
+					bool bValid = true;
+					for (int c = 0; c < 4 && bValid; c++)
+					{
+						UINT cell[3] = { corner[0], corner[1], corner[2] };
+						if (c == 0 || c == 3) cell[u]--;
+						if (c == 0 || c == 1) cell[v]--;
+
+						UINT cellLocal[3] = { cell[0] - first[0], cell[1] - first[1], cell[2] - first[2] };
+						uint64_t cellIndex = ((uint64_t)cell[2] * grid.Cells[1] + cell[1]) * grid.Cells[0] + cell[0];
+						Vector3 cellOrigin = grid.Origin + Vector3((float)cell[0], (float)cell[1], (float)cell[2]) * grid.CellSize;
+
+						quad[c] = GetVertex(grid, cellIndex, values, cellLocal, stride, cellOrigin);
+						bValid = quad[c] != ~0u;
+					}
+					if (!bValid) return;
+
+					// Inside below the edge: the surface faces +axis
+					if (bInside)
+						indices.insert(indices.end(), { quad[0], quad[1], quad[2], quad[0], quad[2], quad[3] });
+					else
+						indices.insert(indices.end(), { quad[0], quad[2], quad[1], quad[0], quad[3], quad[2] });
+				}
+			}
+		}
+	}
+}
+
+uint32_t MeshExtractor::GetVertex(const Grid& grid, uint64_t cell, const float* samples, const UINT local[3], UINT stride,
+	const Vector3& cellOrigin)
+{
+	const uint64_t key = cell + 1;
+	uint32_t slot = (uint32_t)((key * 0x9E3779B97F4A7C15ull) >> 32) & grid.Mask;
+
+	for (uint32_t probe = 0; probe < MaxProbes; probe++, slot = (slot + 1) & grid.Mask)
+	{
+		uint64_t current = grid.Keys[slot].load(std::memory_order_relaxed);
+		if (current == key) return slot;
+		if (current != 0) continue;
+
+		if (!grid.Keys[slot].compare_exchange_strong(current, key, std::memory_order_relaxed))
+		{
+			// Lost the race: either to the same cell or to another one, then keep probing
+			if (current == key) return slot;
+			continue;
+		}
+
+		// Claimed: the vertex sits at the mean of the crossings on the cell's twelve edges. Positions are
+		// only read after every job finished, so nobody waits for this write.
+		const float iso = grid.Source->IsoLevel;
+		const UINT base = local[0] + local[1] * stride + local[2] * stride * stride;
+		const UINT offsets[3] = { 1, stride, stride * stride };
+
+		float corners[8];
+		for (int c = 0; c < 8; c++)
+			corners[c] = samples[base + ((c & 1) ? offsets[0] : 0) + ((c & 2) ? offsets[1] : 0) + ((c & 4) ? offsets[2] : 0)];
+
+		Vector3 sum(0.0f, 0.0f, 0.0f);
+		int crossings = 0;
+		for (int c = 0; c < 8; c++)
+		{
+			for (int axis = 0; axis < 3; axis++)
+			{
+				int bit = 1 << axis;
+				if (c & bit) continue;
+
+				float a = corners[c];
+				float b = corners[c | bit];
+				if ((a < iso) == (b < iso)) continue;
+
+				float t = (iso - a) / (b - a);
+				Vector3 p((float)(c & 1), (float)((c >> 1) & 1), (float)((c >> 2) & 1));
+				if (axis == 0) p.x = t;
+				else if (axis == 1) p.y = t;
+				else p.z = t;
+
+				sum += p;
+				crossings++;
+			}
+		}
+
+		Vector3 centre = crossings > 0 ? sum * (1.0f / crossings) : Vector3(0.5f, 0.5f, 0.5f);
+		grid.Positions[slot] = cellOrigin + centre * grid.CellSize;
+		return slot;
+	}
+
+	grid.bOverflow->store(true, std::memory_order_relaxed);
+	return ~0u;
+}
+
+UINT64 MeshExtractor::GetFileBytes(const Mesh& mesh)
+{
+	UINT64 indexBytes = mesh.Positions.size() <= 0xFFFF ? 2 : 4;
+	return sizeof(MeshFileHeader) + mesh.Positions.size() * 3 * sizeof(uint16_t) + mesh.Indices.size() * indexBytes;
+}
+
+bool MeshExtractor::SaveMesh(const Mesh& mesh, const std::string& path)
+{
+	std::ofstream file(path, std::ios::binary);
+	if (!file) return false;
+
+	MeshFileHeader header = {};
+	header.Magic = MeshFileMagic;
+	header.Version = MeshFileVersion;
+	header.VertexCount = (uint32_t)mesh.Positions.size();
+	header.TriangleCount = (uint32_t)(mesh.Indices.size() / 3);
+	header.BoundsMin[0] = mesh.Min.x;
+	header.BoundsMin[1] = mesh.Min.y;
+	header.BoundsMin[2] = mesh.Min.z;
+	header.BoundsMax[0] = mesh.Max.x;
+	header.BoundsMax[1] = mesh.Max.y;
+	header.BoundsMax[2] = mesh.Max.z;
+	header.IndexBytes = mesh.Positions.size() <= 0xFFFF ? 2 : 4;
+	file.write((const char*)&header, sizeof(header));
+
+	Vector3 extent = mesh.Max - mesh.Min;
+	Vector3 scale(extent.x > 0.0f ? 65535.0f / extent.x : 0.0f, extent.y > 0.0f ? 65535.0f / extent.y : 0.0f,
+		extent.z > 0.0f ? 65535.0f / extent.z : 0.0f);
+
+	std::vector<uint16_t> quantised(mesh.Positions.size() * 3);
+	for (size_t i = 0; i < mesh.Positions.size(); i++)
+	{
+		Vector3 q = (mesh.Positions[i] - mesh.Min) * scale;
+		quantised[i * 3 + 0] = (uint16_t)(std::min)(q.x + 0.5f, 65535.0f);
+		quantised[i * 3 + 1] = (uint16_t)(std::min)(q.y + 0.5f, 65535.0f);
+		quantised[i * 3 + 2] = (uint16_t)(std::min)(q.z + 0.5f, 65535.0f);
+	}
+	file.write((const char*)quantised.data(), quantised.size() * sizeof(uint16_t));
+
+	if (header.IndexBytes == 2)
+	{
+		std::vector<uint16_t> narrow(mesh.Indices.begin(), mesh.Indices.end());
+		file.write((const char*)narrow.data(), narrow.size() * sizeof(uint16_t));
+	}
+	else
+	{
+		file.write((const char*)mesh.Indices.data(), mesh.Indices.size() * sizeof(uint32_t));
+	}
+	return (bool)file;
+}
+
+MeshExtractor::Field MeshExtractor::MakeField(GridField& grid, float isoLevel)
+{
+	// Value range of every RangeCells^3 group of cells, shared samples included on both sides
+	const UINT cells[3] = { (std::max)(grid.Size[0], 2u) - 1, (std::max)(grid.Size[1], 2u) - 1, (std::max)(grid.Size[2], 2u) - 1 };
+	for (int axis = 0; axis < 3; axis++)
+		grid.RangeSize[axis] = (cells[axis] + GridField::RangeCells - 1) / GridField::RangeCells;
+
+	size_t rangeCount = (size_t)grid.RangeSize[0] * grid.RangeSize[1] * grid.RangeSize[2];
+	grid.RangeMin.assign(rangeCount, FLT_MAX);
+	grid.RangeMax.assign(rangeCount, -FLT_MAX);
+	for (UINT z = 0; z < grid.Size[2]; z++)
+	{
+		for (UINT y = 0; y < grid.Size[1]; y++)
+		{
+			for (UINT x = 0; x < grid.Size[0]; x++)
+			{
+				float value = grid.Values[((size_t)z * grid.Size[1] + y) * grid.Size[0] + x];
+				const UINT sample[3] = { x, y, z };
+
+				// A sample on a range boundary belongs to the ranges on both sides
+				UINT lo[3], hi[3];
+				for (int axis = 0; axis < 3; axis++)
+				{
+					UINT r = sample[axis] / GridField::RangeCells;
+					hi[axis] = (std::min)(r, grid.RangeSize[axis] - 1);
+					lo[axis] = (sample[axis] % GridField::RangeCells == 0 && r > 0) ? r - 1 : hi[axis];
+				}
+
+				for (UINT rz = lo[2]; rz <= hi[2]; rz++)
+				{
+					for (UINT ry = lo[1]; ry <= hi[1]; ry++)
+					{
+						for (UINT rx = lo[0]; rx <= hi[0]; rx++)
+						{
+							size_t r = ((size_t)rz * grid.RangeSize[1] + ry) * grid.RangeSize[0] + rx;
+							grid.RangeMin[r] = (std::min)(grid.RangeMin[r], value);
+							grid.RangeMax[r] = (std::max)(grid.RangeMax[r], value);
+						}
+					}
+				}
+			}
+		}
+	}
+
+	Field field;
+	field.Min = grid.Origin;
+	field.Max = grid.Origin + Vector3((float)cells[0], (float)cells[1], (float)cells[2]) * grid.Spacing;
+	field.IsoLevel = isoLevel;
+
+	const GridField* source = &grid;
+	field.Sample = [source](const SdfKernels::Points& points, float* out)
+	{
+		const GridField& g = *source;
+		for (UINT i = 0; i < points.Count; i++)
+		{
+			// Clamped to the grid: the edge samples extend outwards
+			float u[3] = {
+				(points.X[i] - g.Origin.x) / g.Spacing,
+				(points.Y[i] - g.Origin.y) / g.Spacing,
+				(points.Z[i] - g.Origin.z) / g.Spacing };
+
+			UINT i0[3];
+			float f[3];
+			for (int axis = 0; axis < 3; axis++)
+			{
+				float maxU = (float)(g.Size[axis] - 1);
+				float c = (std::min)((std::max)(u[axis], 0.0f), maxU);
+				i0[axis] = (std::min)((UINT)c, g.Size[axis] >= 2 ? g.Size[axis] - 2 : 0u);
+				f[axis] = c - (float)i0[axis];
+			}
+
+			auto at = [&g](UINT x, UINT y, UINT z)
+			{
+				x = (std::min)(x, g.Size[0] - 1);
+				y = (std::min)(y, g.Size[1] - 1);
+				z = (std::min)(z, g.Size[2] - 1);
+				return g.Values[((size_t)z * g.Size[1] + y) * g.Size[0] + x];
+			};
+
+			float c00 = at(i0[0], i0[1], i0[2]) + (at(i0[0] + 1, i0[1], i0[2]) - at(i0[0], i0[1], i0[2])) * f[0];
+			float c10 = at(i0[0], i0[1] + 1, i0[2]) + (at(i0[0] + 1, i0[1] + 1, i0[2]) - at(i0[0], i0[1] + 1, i0[2])) * f[0];
+			float c01 = at(i0[0], i0[1], i0[2] + 1) + (at(i0[0] + 1, i0[1], i0[2] + 1) - at(i0[0], i0[1], i0[2] + 1)) * f[0];
+			float c11 = at(i0[0], i0[1] + 1, i0[2] + 1) + (at(i0[0] + 1, i0[1] + 1, i0[2] + 1) - at(i0[0], i0[1] + 1, i0[2] + 1)) * f[0];
+			float c0 = c00 + (c10 - c00) * f[1];
+			float c1 = c01 + (c11 - c01) * f[1];
+			out[i] = c0 + (c1 - c0) * f[2];
+		}
+	};
+
+	field.MayCross = [source, isoLevel](const Vector3& boxMin, const Vector3& boxMax)
+	{
+		const GridField& g = *source;
+
+		// Ranges of the cells the box overlaps, clamped like the samples
+		UINT r0[3], r1[3];
+		for (int axis = 0; axis < 3; axis++)
+		{
+			float maxCell = (float)(g.Size[axis] - 1);
+			float lo = (std::min)((std::max)((GetAxis(boxMin, axis) - GetAxis(g.Origin, axis)) / g.Spacing, 0.0f), maxCell);
+			float hi = (std::min)((std::max)((GetAxis(boxMax, axis) - GetAxis(g.Origin, axis)) / g.Spacing, 0.0f), maxCell);
+			r0[axis] = (std::min)((UINT)lo / GridField::RangeCells, g.RangeSize[axis] - 1);
+			r1[axis] = (std::min)((UINT)ceilf(hi) / GridField::RangeCells, g.RangeSize[axis] - 1);
+		}
+
+		for (UINT rz = r0[2]; rz <= r1[2]; rz++)
+		{
+			for (UINT ry = r0[1]; ry <= r1[1]; ry++)
+			{
+				for (UINT rx = r0[0]; rx <= r1[0]; rx++)
+				{
+					size_t r = ((size_t)rz * g.RangeSize[1] + ry) * g.RangeSize[0] + rx;
+					if (g.RangeMin[r] < isoLevel && g.RangeMax[r] >= isoLevel) return true;
+				}
+			}
+		}
+		return false;
+	};
+	return field;
+}
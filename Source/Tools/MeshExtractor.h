@@ -0,0 +1,131 @@
+#pragma once
+
+#include <atomic>
+
+#include "ThreadPool.h"
+#include "SdfKernels.h"
+
+// Polygonises the iso-surface of a scalar field on a regular grid with surface nets (dual contouring with the
+// vertex at the mean of its cell's edge crossings instead of a QEF): one vertex per cell the surface passes
+// through, one quad per grid edge it crosses. The grid is cut into blocks that the workers mesh independently;
+// an octree over the blocks drops every subtree the field proves empty before any block is sampled.
+// Blocks share the vertices of the cells along their seams through a lock-free hash table keyed by cell: the
+// first block to reach a cell claims its slot with a compare-exchange, every other one reuses the slot.
+class MeshExtractor
+{
+public:
+	using Vector3 = DirectX::SimpleMath::Vector3;
+
+	// Any field the project can evaluate on the CPU; values below IsoLevel are inside
+	struct Field
+	{
+		Vector3 Min;
+		Vector3 Max;
+		float   IsoLevel = 0.0f;
+
+		// Values at a batch of points; called from the workers
+		std::function<void(const SdfKernels::Points& points, float* out)> Sample;
+
+		// False when the field provably stays on one side of IsoLevel throughout the box; empty = always true
+		std::function<bool(const Vector3& boxMin, const Vector3& boxMax)> MayCross;
+	};
+
+	// Triangles are counter-clockwise seen from outside (right-handed)
+	struct Mesh
+	{
+		std::vector<Vector3> Positions;
+		std::vector<uint32_t> Indices;
+		Vector3 Min;
+		Vector3 Max;
+	};
+
+	struct Stats
+	{
+		UINT   Resolution = 0;        // Cells along the longest axis
+		int    Blocks = 0;
+		int    SampledBlocks = 0;     // Blocks left after the octree skip
+		int    Vertices = 0;
+		int    Triangles = 0;
+		float  Ms = 0.0f;
+		double TrianglesPerSec = 0.0;
+		UINT64 PeakBytes = 0;         // Vertex table, sample scratch and output at their largest
+		UINT64 FileBytes = 0;         // The mesh written as TFMS
+		int    Retries = 0;           // Restarts with a larger vertex table
+	};
+
+	static constexpr UINT BlockCells = 16;          // Cells per block edge
+	static constexpr UINT MaxResolution = 1024;
+
+public:
+	MeshExtractor() {}
+	~MeshExtractor() {}
+
+	// [Rule] System classes should NOT be copied.
+	MeshExtractor(const MeshExtractor&) = delete;
+	MeshExtractor& operator=(const MeshExtractor&) = delete;
+
+	void Initialize(ThreadPool& workers);
+
+	// Meshes field on a grid with resolution cells along the longest side of its box; false if field is unusable
+	bool Extract(const Field& field, UINT resolution, Mesh& mesh);
+
+	const Stats& GetStats() const { return m_Stats; }
+
+	// TFMS: positions quantised to 16 bits over the mesh bounds, 16- or 32-bit indices
+	static bool SaveMesh(const Mesh& mesh, const std::string& path);
+	static UINT64 GetFileBytes(const Mesh& mesh);
+
+	// Field over samples on a regular grid, values at sample (x, y, z) in Values[(z * Size[1] + y) * Size[0] + x].
+	// Trilinear between samples; MayCross looks at the min/max of the samples the box touches.
+	struct GridField
+	{
+		Vector3 Origin;
+		float   Spacing = 1.0f;
+		UINT    Size[3] = {};
+		std::vector<float> Values;
+
+		// Value ranges per RangeCells^3 cells, built by MakeField
+		static constexpr UINT RangeCells = 8;
+		UINT RangeSize[3] = {};
+		std::vector<float> RangeMin;
+		std::vector<float> RangeMax;
+	};
+
+	// The field keeps a pointer to grid, which must outlive it
+	static Field MakeField(GridField& grid, float isoLevel);
+
+private:
+	struct Block
+	{
+		UINT X, Y, Z;          // First cell
+	};
+
+	// Everything the block jobs share
+	struct Grid
+	{
+		const Field* Source;
+		Vector3 Origin;
+		float   CellSize;
+		UINT    Cells[3];
+
+		// Vertex table: a slot per cell claimed, Keys hold cell index + 1 (0 = free)
+		std::atomic<uint64_t>* Keys;
+		Vector3* Positions;
+		uint32_t Mask;                 // Capacity - 1
+		std::atomic<bool>* bOverflow;
+	};
+
+	// Blocks of the octree node at (x, y, z) spanning size blocks, skipping those the field proves empty
+	void CollectBlocks(const Grid& grid, const UINT blocks[3], UINT x, UINT y, UINT z, UINT size, std::vector<Block>& active);
+
+	// Samples the block with a one-cell apron and emits the quads of the edges it owns
+	void MeshBlock(const Grid& grid, const Block& block, std::vector<float>& scratch, std::vector<uint32_t>& indices);
+
+	// Slot of the cell's vertex, computed from samples when this call claims it; ~0u when the table is full
+	static uint32_t GetVertex(const Grid& grid, uint64_t cell, const float* samples, const UINT local[3], UINT stride,
+		const Vector3& cellOrigin);
+
+private:
+	ThreadPool* m_pWorkers = nullptr;
+	Stats m_Stats;
+};
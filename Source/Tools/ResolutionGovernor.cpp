@@ -0,0 +1,91 @@
+#include "ResolutionGovernor.h"
+
+namespace
+{
+	constexpr float SmoothingFactor = 0.2f;
+
+	// Cheapest steps first: a little of each, resolution in 1/8 increments so target reallocation stays rare
+	const ResolutionGovernor::QualityLevel QualityLadder[] =
+	{
+		{ 1.000f, 1.00f, 1.00f },
+		{ 1.000f, 0.85f, 0.85f },
+		{ 0.875f, 0.85f, 0.85f },
+		{ 0.875f, 0.70f, 0.70f },
+		{ 0.750f, 0.70f, 0.70f },
+		{ 0.750f, 0.55f, 0.60f },
+		{ 0.625f, 0.55f, 0.60f },
+		{ 0.625f, 0.45f, 0.50f },
+		{ 0.500f, 0.45f, 0.50f },
+		{ 0.500f, 0.35f, 0.35f },
+	};
+
+	constexpr int LevelCount = (int)(sizeof(QualityLadder) / sizeof(QualityLadder[0]));
+}
+
+ResolutionGovernor::ResolutionGovernor()
+{
+	for (float& scale : m_ScaleHistory) scale = 1.0f;
+}
+
+bool ResolutionGovernor::Update(float dt)
+{
+	float ms = dt * 1000.0f;
+
+	memmove(m_FrameHistory, m_FrameHistory + 1, (HistorySize - 1) * sizeof(float));
+	memmove(m_ScaleHistory, m_ScaleHistory + 1, (HistorySize - 1) * sizeof(float));
+	m_FrameHistory[HistorySize - 1] = ms;
+	m_ScaleHistory[HistorySize - 1] = GetQuality().RenderScale;
+
+	if (!m_Settings.bEnabled) return Reset();
+
+	m_SmoothedMs = (m_SmoothedMs <= 0.0f) ? ms : m_SmoothedMs + (ms - m_SmoothedMs) * SmoothingFactor;
+
+	if (m_SettleLeft > 0)
+	{
+		m_SettleLeft--;
+		return false;
+	}
+
+	float budget = m_Settings.BudgetMs;
+	bool bOver = m_SmoothedMs > budget * (1.0f + m_Settings.Hysteresis);
+	bool bUnder = m_SmoothedMs < budget * (1.0f - m_Settings.Hysteresis);
+
+	m_OverFrames = bOver ? m_OverFrames + 1 : 0;
+	m_UnderFrames = bUnder ? m_UnderFrames + 1 : 0;
+
+	// Drop quickly to protect the budget, climb slowly since the higher level may not fit
+	if (m_OverFrames >= m_Settings.DownFrames) return SetLevel(m_Level + 1);
+	if (m_UnderFrames >= m_Settings.UpFrames) return SetLevel(m_Level - 1);
+
+	return false;
+}
+
+bool ResolutionGovernor::Reset()
+{
+	m_SmoothedMs = 0.0f;
+	return SetLevel(0);
+}
+
+bool ResolutionGovernor::SetLevel(int level)
+{
+	level = std::clamp(level, 0, LevelCount - 1);
+
+	m_OverFrames = 0;
+	m_UnderFrames = 0;
+
+	if (level == m_Level) return false;
+
+	m_Level = level;
+	m_SettleLeft = m_Settings.SettleFrames;
+	return true;
+}
+
+const ResolutionGovernor::QualityLevel& ResolutionGovernor::GetQuality() const
+{
+	return QualityLadder[m_Level];
+}
+
+int ResolutionGovernor::GetLevelCount() const
+{
+	return LevelCount;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+// Feedback controller that trades cloud render resolution and step counts for a frame-time budget.
+// Quality moves along a fixed ladder; a dead band around the budget and separate down/up delays keep it from oscillating.
+class ResolutionGovernor
+{
+public:
+	struct QualityLevel
+	{
+		float RenderScale;     // Cloud target size relative to the back buffer
+		float PrimaryStepScale;
+		float LightStepScale;
+	};
+
+	struct Settings
+	{
+		bool  bEnabled = false;
+		float BudgetMs = 16.6f;
+		float Hysteresis = 0.1f;   // Dead band around the budget, as a fraction of it
+		int   DownFrames = 5;      // Consecutive frames over budget before dropping a level
+		int   UpFrames = 60;       // Consecutive frames with headroom before raising a level
+		int   SettleFrames = 10;   // Frames ignored after a change while the new cost shows up
+	};
+
+	static constexpr int HistorySize = 240;
+
+public:
+	ResolutionGovernor();
+	~ResolutionGovernor() {}
+
+	// [Rule] System classes should NOT be copied.
+	ResolutionGovernor(const ResolutionGovernor&) = delete;
+	ResolutionGovernor& operator=(const ResolutionGovernor&) = delete;
+
+	// Feed the GameTimer delta of the last rendered frame; returns true when the quality level changed
+	bool Update(float dt);
+
+	// Back to full quality (e.g. when disabled or while progressive refinement owns the image)
+	bool Reset();
+
+	const QualityLevel& GetQuality() const;
+	int GetLevel() const { return m_Level; }
+	int GetLevelCount() const;
+	float GetSmoothedMs() const { return m_SmoothedMs; }
+
+	// Oldest first, for ImGui::PlotLines
+	const float* GetFrameHistory() const { return m_FrameHistory; }
+	const float* GetScaleHistory() const { return m_ScaleHistory; }
+
+	Settings m_Settings;
+
+private:
+	bool SetLevel(int level);
+
+private:
+	int m_Level = 0;
+	float m_SmoothedMs = 0.0f;
+
+	int m_OverFrames = 0;
+	int m_UnderFrames = 0;
+	int m_SettleLeft = 0;
+
+	float m_FrameHistory[HistorySize] = {};
+	float m_ScaleHistory[HistorySize] = {};
+};
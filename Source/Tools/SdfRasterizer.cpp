@@ -0,0 +1,315 @@
+#include <random>
+#include <atomic>
+#include <cfloat>
+
+#include "SdfRasterizer.h"
+
+namespace
+{
+	constexpr UINT TilePixels = SdfRasterizer::TileSize * SdfRasterizer::TileSize;
+
+	// Distance2DPS.hlsl's outside and inside colours
+	constexpr float OutsideColor[3] = { 1.0f, 0.45f, 0.26f };
+	constexpr float InsideColor[3] = { 1.0f, 0.97f, 0.87f };
+
+	float Saturate(float v)
+	{
+		return (std::min)((std::max)(v, 0.0f), 1.0f);
+	}
+
+	uint32_t PackColor(const float color[3], float alpha)
+	{
+		uint32_t r = (uint32_t)(Saturate(color[0]) * 255.0f + 0.5f);
+		uint32_t g = (uint32_t)(Saturate(color[1]) * 255.0f + 0.5f);
+		uint32_t b = (uint32_t)(Saturate(color[2]) * 255.0f + 0.5f);
+		uint32_t a = (uint32_t)(Saturate(alpha) * 255.0f + 0.5f);
+		return r | (g << 8) | (b << 16) | (a << 24);
+	}
+}
+
+void SdfRasterizer::Initialize(ThreadPool& workers)
+{
+	m_pWorkers = &workers;
+}
+
+SdfRasterizer::Rect SdfRasterizer::GetBounds(const SdfKernels::Shape2D& shape)
+{
+	switch (shape.Type)
+	{
+	case SdfKernels::Box2D:
+	{
+		float cosine = fabsf(shape.Axis.x), sine = fabsf(shape.Axis.y);
+		float ex = cosine * shape.B.x + sine * shape.B.y;
+		float ey = sine * shape.B.x + cosine * shape.B.y;
+		return { shape.A.x - ex, shape.A.y - ey, shape.A.x + ex, shape.A.y + ey };
+	}
+	case SdfKernels::Segment2D:
+		return { (std::min)(shape.A.x, shape.B.x) - shape.Radius, (std::min)(shape.A.y, shape.B.y) - shape.Radius,
+			(std::max)(shape.A.x, shape.B.x) + shape.Radius, (std::max)(shape.A.y, shape.B.y) + shape.Radius };
+	default:
+		return { shape.A.x - shape.Radius, shape.A.y - shape.Radius, shape.A.x + shape.Radius, shape.A.y + shape.Radius };
+	}
+}
+
+SdfRasterizer::Rect SdfRasterizer::GetInterior(const SdfKernels::Shape2D& shape)
+{
+	// Every point of the rectangle at least half a pixel inside, so it is fully covered
+	const Rect none = { 0.0f, 0.0f, -1.0f, -1.0f };
+	switch (shape.Type)
+	{
+	case SdfKernels::Box2D:
+	{
+		// Axis-aligned panels only; sdBox is at most -max(radius, 0.5) within the half extents less that
+		if (fabsf(shape.Axis.y) > 1e-4f) return none;
+		float inset = (std::max)(shape.Radius, 0.5f);
+		float hx = shape.B.x - inset, hy = shape.B.y - inset;
+		if (hx <= 0.0f || hy <= 0.0f) return none;
+		return { shape.A.x - hx, shape.A.y - hy, shape.A.x + hx, shape.A.y + hy };
+	}
+	case SdfKernels::Circle2D:
+	{
+		// The square inscribed in the circle shrunk by half a pixel
+		float h = (shape.Radius - 0.5f) * 0.70710678f;
+		if (h <= 0.0f) return none;
+		return { shape.A.x - h, shape.A.y - h, shape.A.x + h, shape.A.y + h };
+	}
+	default:
+		return none;
+	}
+}
+
+uint32_t SdfRasterizer::Shade(float d, float height, const Settings& settings)
+{
+	float coverage = Saturate(0.5f - d);
+	if (settings.Mode == Shading::Coverage)
+		return PackColor(InsideColor, coverage);
+
+	// Distance2DPS measures in units of half the image height; flat past the band
+	float dn = (std::min)(d, settings.BandPixels) * 2.0f / height;
+	const float* base = (dn > 0.0f) ? OutsideColor : InsideColor;
+	float bands = (1.0f - expf(-5.0f * fabsf(dn))) * (0.8f + 0.2f * cosf(180.0f * dn));
+
+	// smoothstep(0.0, 0.01, abs(d)), at least a pixel wide
+	float width = (std::max)(0.01f, 2.0f / height);
+	float t = Saturate(fabsf(dn) / width);
+	float outline = 1.0f - t * t * (3.0f - 2.0f * t);
+
+	float color[3];
+	for (int c = 0; c < 3; c++)
+		color[c] = base[c] * bands + (1.0f - base[c] * bands) * outline;
+	return PackColor(color, 1.0f);
+}
+
+bool SdfRasterizer::Rasterize(const std::vector<SdfKernels::Shape2D>& shapes, UINT width, UINT height, const Settings& settings,
+	Image& image)
+{
+	if (width == 0 || height == 0 || width > MaxSize || height > MaxSize) return false;
+
+	double start = GetSeconds();
+	m_Stats = Stats();
+	m_Stats.Width = width;
+	m_Stats.Height = height;
+	m_Stats.Shapes = (int)shapes.size();
+
+	image.Width = width;
+	image.Height = height;
+	image.Pixels.resize((size_t)width * height);
+
+	const UINT tilesX = (width + TileSize - 1) / TileSize;
+	const UINT tilesY = (height + TileSize - 1) / TileSize;
+	const UINT tileCount = tilesX * tilesY;
+	m_Stats.Tiles = (int)tileCount;
+
+	// A shape further than this from a pixel no longer changes its colour
+	const float reach = (settings.Mode == Shading::Bands) ? (std::max)(settings.BandPixels, 1.0f) : 1.0f;
+
+	// Shape lists per tile, counting sort by tile; the brute-force path shares one list of every shape
+	double binStart = GetSeconds();
+	std::vector<uint32_t> tileOffsets(tileCount + 1, 0);
+	std::vector<uint32_t> tileShapes;
+	std::vector<Rect> interiors;
+	if (settings.bTiled)
+	{
+		auto getTileRange = [&](const SdfKernels::Shape2D& shape, UINT range[4])
+		{
+			Rect bounds = GetBounds(shape);
+			if (bounds.MaxX + reach < 0.0f || bounds.MaxY + reach < 0.0f ||
+				bounds.MinX - reach >= (float)width || bounds.MinY - reach >= (float)height) return false;
+
+			range[0] = (UINT)(std::max)((bounds.MinX - reach) / TileSize, 0.0f);
+			range[1] = (UINT)(std::max)((bounds.MinY - reach) / TileSize, 0.0f);
+			range[2] = (UINT)(std::min)((bounds.MaxX + reach) / TileSize, (float)(tilesX - 1));
+			range[3] = (UINT)(std::min)((bounds.MaxY + reach) / TileSize, (float)(tilesY - 1));
+			return true;
+		};
+
+		UINT range[4];
+		for (const SdfKernels::Shape2D& shape : shapes)
+		{
+			if (!getTileRange(shape, range)) continue;
+			for (UINT ty = range[1]; ty <= range[3]; ty++)
+				for (UINT tx = range[0]; tx <= range[2]; tx++)
+					tileOffsets[ty * tilesX + tx + 1]++;
+		}
+		for (UINT t = 0; t < tileCount; t++)
+			tileOffsets[t + 1] += tileOffsets[t];
+
+		tileShapes.resize(tileOffsets[tileCount]);
+		std::vector<uint32_t> cursor(tileOffsets.begin(), tileOffsets.end() - 1);
+		for (uint32_t s = 0; s < (uint32_t)shapes.size(); s++)
+		{
+			if (!getTileRange(shapes[s], range)) continue;
+			for (UINT ty = range[1]; ty <= range[3]; ty++)
+				for (UINT tx = range[0]; tx <= range[2]; tx++)
+					tileShapes[cursor[ty * tilesX + tx]++] = s;
+		}
+
+		if (settings.Mode == Shading::Coverage)
+		{
+			interiors.resize(shapes.size());
+			for (size_t s = 0; s < shapes.size(); s++)
+				interiors[s] = GetInterior(shapes[s]);
+		}
+	}
+	else
+	{
+		tileShapes.resize(shapes.size());
+		for (uint32_t s = 0; s < (uint32_t)shapes.size(); s++)
+			tileShapes[s] = s;
+	}
+	m_Stats.BinMs = (float)((GetSeconds() - binStart) * 1000.0);
+
+	const uint32_t background = Shade(reach, (float)height, settings);
+	const uint32_t fill = Shade(-FLT_MAX, (float)height, settings);
+
+	// Rows of tiles handed out one at a time
+	std::atomic<UINT> nextRow{ 0 };
+	std::atomic<int> emptyTiles{ 0 }, interiorTiles{ 0 }, edgeTiles{ 0 };
+	std::atomic<UINT64> evaluations{ 0 };
+
+	UINT jobCount = (std::max)(1u, (std::min)(m_pWorkers->GetThreadCount(), tilesY));
+	m_pWorkers->ParallelFor(jobCount, [&](UINT)
+	{
+		float x[TilePixels], y[TilePixels], d[TilePixels];
+		int empty = 0, interior = 0, edge = 0;
+		UINT64 shapeEvaluations = 0;
+
+		for (;;)
+		{
+			UINT ty = nextRow.fetch_add(1, std::memory_order_relaxed);
+			if (ty >= tilesY) break;
+
+			for (UINT tx = 0; tx < tilesX; tx++)
+			{
+				const UINT x0 = tx * TileSize, y0 = ty * TileSize;
+				const UINT w = (std::min)(TileSize, width - x0), h = (std::min)(TileSize, height - y0);
+
+				const uint32_t* list = settings.bTiled ? tileShapes.data() + tileOffsets[ty * tilesX + tx] : tileShapes.data();
+				UINT count = settings.bTiled ? tileOffsets[ty * tilesX + tx + 1] - tileOffsets[ty * tilesX + tx] : (UINT)shapes.size();
+
+				// Whole tile in one colour: nothing in reach, or every pixel centre inside one shape
+				bool bInterior = false;
+				for (UINT s = 0; s < count && !interiors.empty() && !bInterior; s++)
+				{
+					const Rect& inner = interiors[list[s]];
+					bInterior = inner.MinX <= x0 + 0.5f && inner.MinY <= y0 + 0.5f &&
+						inner.MaxX >= x0 + w - 0.5f && inner.MaxY >= y0 + h - 0.5f;
+				}
+				if (count == 0 || bInterior)
+				{
+					uint32_t color = bInterior ? fill : background;
+					for (UINT row = 0; row < h; row++)
+						std::fill_n(image.Pixels.data() + (size_t)(y0 + row) * width + x0, w, color);
+					(bInterior ? interior : empty)++;
+					continue;
+				}
+
+				// Pixel centres of the tile, row by row
+				UINT n = 0;
+				for (UINT row = 0; row < h; row++)
+				{
+					for (UINT column = 0; column < w; column++, n++)
+					{
+						x[n] = x0 + column + 0.5f;
+						y[n] = y0 + row + 0.5f;
+					}
+				}
+
+				SdfKernels::Points points = { x, y, y, n };
+				SdfKernels::EvaluateShapes2D(shapes.data(), list, count, points, d);
+				shapeEvaluations += (UINT64)count * n;
+				edge++;
+
+				n = 0;
+				for (UINT row = 0; row < h; row++)
+				{
+					uint32_t* dst = image.Pixels.data() + (size_t)(y0 + row) * width + x0;
+					for (UINT column = 0; column < w; column++, n++)
+						dst[column] = Shade(d[n], (float)height, settings);
+				}
+			}
+		}
+
+		emptyTiles += empty;
+		interiorTiles += interior;
+		edgeTiles += edge;
+		evaluations += shapeEvaluations;
+	});
+
+	m_Stats.EmptyTiles = emptyTiles.load();
+	m_Stats.InteriorTiles = interiorTiles.load();
+	m_Stats.EdgeTiles = edgeTiles.load();
+	m_Stats.ShapeEvaluations = evaluations.load();
+
+	double seconds = GetSeconds() - start;
+	m_Stats.Ms = (float)(seconds * 1000.0);
+	m_Stats.PixelsPerSec = seconds > 0.0 ? (double)width * height / seconds : 0.0;
+	return true;
+}
+
+std::vector<SdfKernels::Shape2D> SdfRasterizer::MakeOverlayScene(UINT count, UINT width, UINT height, uint32_t seed)
+{
+	std::mt19937 rng(seed);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+	// Spacing of count shapes spread evenly over the image
+	float spacing = sqrtf((float)width * height / (std::max)(count, 1u));
+
+	std::vector<SdfKernels::Shape2D> shapes(count);
+	for (UINT i = 0; i < count; i++)
+	{
+		SdfKernels::Shape2D& shape = shapes[i];
+		shape = {};
+		shape.A = { unit(rng) * width, unit(rng) * height };
+
+		switch (i % 3)
+		{
+		case 0:
+		{
+			// Panel, every fourth one tilted
+			shape.Type = SdfKernels::Box2D;
+			shape.B = { (0.2f + unit(rng) * 0.25f) * spacing, (0.1f + unit(rng) * 0.15f) * spacing };
+			shape.Radius = (std::min)(shape.B.x, shape.B.y) * 0.3f;
+			float angle = (i % 12 == 0) ? unit(rng) * 3.14159265f : 0.0f;
+			shape.Axis = { cosf(angle), sinf(angle) };
+			break;
+		}
+		case 1:
+			// Marker
+			shape.Type = SdfKernels::Circle2D;
+			shape.Radius = (0.08f + unit(rng) * 0.15f) * spacing;
+			break;
+		default:
+		{
+			// Stroke, at least a pixel and a half thick
+			shape.Type = SdfKernels::Segment2D;
+			float angle = unit(rng) * 6.2831853f;
+			float length = (0.4f + unit(rng) * 0.8f) * spacing;
+			shape.B = { shape.A.x + cosf(angle) * length, shape.A.y + sinf(angle) * length };
+			shape.Radius = (std::max)(0.75f, spacing * 0.02f);
+			break;
+		}
+		}
+	}
+	return shapes;
+}
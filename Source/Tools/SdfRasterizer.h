@@ -0,0 +1,90 @@
+#pragma once
+
+#include "ThreadPool.h"
+#include "SdfKernels.h"
+
+// Renders 2D scenes of SdfKernels::Shape2D (UI panels, markers, map strokes) on the CPU as the union of their
+// distance fields. Shapes are binned into screen tiles by their bounds widened by the shading band, so a tile
+// only evaluates the few shapes that can reach it. Tiles with no shape are filled with the background, tiles
+// inside a shape's inscribed rectangle with the fill, and only the rest are evaluated, a vector of pixels at a
+// time, by the SIMD kernels: the cost follows the outline length rather than shapes x pixels.
+class SdfRasterizer
+{
+public:
+	enum class Shading
+	{
+		Coverage = 0,   // Fill over background, antialiased over one pixel
+		Bands = 1,      // Distance2DPS.hlsl: tinted inside and outside, distance bands and an outline
+	};
+
+	struct Settings
+	{
+		Shading Mode = Shading::Coverage;
+		float   BandPixels = 48.0f;       // Bands: how far the field is shaded from the shapes, flat beyond
+		bool    bTiled = true;            // False evaluates every shape at every pixel, for the benchmark
+	};
+
+	// RGBA8 with R in the low byte; alpha is the coverage in Coverage mode, opaque in Bands
+	struct Image
+	{
+		UINT Width = 0;
+		UINT Height = 0;
+		std::vector<uint32_t> Pixels;
+	};
+
+	struct Stats
+	{
+		UINT   Width = 0;
+		UINT   Height = 0;
+		int    Shapes = 0;
+		int    Tiles = 0;
+		int    EmptyTiles = 0;            // No shape in reach: background
+		int    InteriorTiles = 0;         // Inside one shape: fill
+		int    EdgeTiles = 0;             // Evaluated
+		UINT64 ShapeEvaluations = 0;      // Shape-pixel distance evaluations
+		float  BinMs = 0.0f;
+		float  Ms = 0.0f;                 // Binning included
+		double PixelsPerSec = 0.0;
+	};
+
+	static constexpr UINT TileSize = 16;
+	static constexpr UINT MaxSize = 16384;
+
+public:
+	SdfRasterizer() {}
+	~SdfRasterizer() {}
+
+	// [Rule] System classes should NOT be copied.
+	SdfRasterizer(const SdfRasterizer&) = delete;
+	SdfRasterizer& operator=(const SdfRasterizer&) = delete;
+
+	void Initialize(ThreadPool& workers);
+
+	// Renders shapes (pixel coordinates, y down) into a width x height image; false if the size is out of range
+	bool Rasterize(const std::vector<SdfKernels::Shape2D>& shapes, UINT width, UINT height, const Settings& settings, Image& image);
+
+	const Stats& GetStats() const { return m_Stats; }
+
+	// count panels, markers and strokes scattered over the image, smaller as there are more of them so the
+	// covered area stays about the same
+	static std::vector<SdfKernels::Shape2D> MakeOverlayScene(UINT count, UINT width, UINT height, uint32_t seed);
+
+	// Axis-aligned pixel rectangle
+	struct Rect
+	{
+		float MinX, MinY, MaxX, MaxY;
+	};
+
+	// Bounds of the shape, and the rectangle it fully covers (empty when there is none worth testing)
+	static Rect GetBounds(const SdfKernels::Shape2D& shape);
+	static Rect GetInterior(const SdfKernels::Shape2D& shape);
+
+private:
+
+	// Distance2DPS's colour for signed distance d in pixels on an image height pixels tall
+	static uint32_t Shade(float d, float height, const Settings& settings);
+
+private:
+	ThreadPool* m_pWorkers = nullptr;
+	Stats m_Stats;
+};
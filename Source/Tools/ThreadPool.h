@@ -0,0 +1,126 @@
+#pragma once
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <queue>
+
+class ThreadPool
+{
+public:
+	ThreadPool() {}
+	~ThreadPool() { Shutdown(); }
+
+	// [Rule] System classes should NOT be copied.
+	// Copying a core system creates ambiguity in resource ownership.
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	// numThreads == 0 picks (hardware threads - 1), leaving one core for the render loop
+	void Initialize(unsigned int numThreads = 0)
+	{
+		if (!m_Workers.empty()) return;
+
+		if (numThreads == 0)
+		{
+			unsigned int hw = std::thread::hardware_concurrency();
+			numThreads = (hw > 1) ? hw - 1 : 1;
+		}
+
+		m_bStop = false;
+		for (unsigned int i = 0; i < numThreads; i++)
+		{
+			m_Workers.emplace_back([this]() { WorkerLoop(); });
+		}
+	}
+
+	void Shutdown()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_bStop = true;
+		}
+		m_Condition.notify_all();
+
+		for (auto& worker : m_Workers)
+		{
+			if (worker.joinable()) worker.join();
+		}
+		m_Workers.clear();
+	}
+
+	void Submit(std::function<void()> job)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Jobs.push(std::move(job));
+		}
+		m_Condition.notify_one();
+	}
+
+	// Long work that must not hold up Submit and ParallelFor callers: a worker only takes it when no job from
+	// Submit is waiting
+	void SubmitBackground(std::function<void()> job)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_BackgroundJobs.push(std::move(job));
+		}
+		m_Condition.notify_one();
+	}
+
+	// Runs job(0 .. count - 1) on the workers and returns once every call has finished.
+	// [Important] Call it from outside the pool: a worker waiting here holds a thread the jobs may need.
+	void ParallelFor(unsigned int count, const std::function<void(unsigned int)>& job)
+	{
+		std::mutex mutex;
+		std::condition_variable done;
+		unsigned int finished = 0;
+
+		for (unsigned int i = 0; i < count; i++)
+		{
+			Submit([&job, &mutex, &done, &finished, i]()
+			{
+				job(i);
+
+				// Notified under the lock, so the caller cannot return and destroy done in between
+				std::lock_guard<std::mutex> lock(mutex);
+				finished++;
+				done.notify_one();
+			});
+		}
+
+		std::unique_lock<std::mutex> lock(mutex);
+		done.wait(lock, [&finished, count]() { return finished == count; });
+	}
+
+	unsigned int GetThreadCount() const { return (unsigned int)m_Workers.size(); }
+
+private:
+	void WorkerLoop()
+	{
+		while (true)
+		{
+			std::function<void()> job;
+			{
+				std::unique_lock<std::mutex> lock(m_Mutex);
+				m_Condition.wait(lock, [this]() { return m_bStop || !m_Jobs.empty() || !m_BackgroundJobs.empty(); });
+				if (m_bStop && m_Jobs.empty() && m_BackgroundJobs.empty()) return;
+
+				std::queue<std::function<void()>>& queue = m_Jobs.empty() ? m_BackgroundJobs : m_Jobs;
+				job = std::move(queue.front());
+				queue.pop();
+			}
+			job();
+		}
+	}
+
+private:
+	std::vector<std::thread> m_Workers;
+	std::queue<std::function<void()>> m_Jobs;
+	std::queue<std::function<void()>> m_BackgroundJobs;
+	std::mutex m_Mutex;
+	std::condition_variable m_Condition;
+	bool m_bStop = false;
+};
@@ -0,0 +1,101 @@
+#include "TileScheduler.h"
+
+namespace
+{
+	constexpr float SmoothingFactor = 0.1f;
+}
+
+bool TileScheduler::Resize(UINT width, UINT height)
+{
+	if (width == m_Width && height == m_Height) return false;
+
+	m_Width = width;
+	m_Height = height;
+	m_TilesX = (width + TileSize - 1) / TileSize;
+	m_TilesY = (height + TileSize - 1) / TileSize;
+
+	// Unknown content: centre-first until the first metrics arrive
+	m_Metrics.assign(GetTileCount() * 2, 0.0f);
+	return true;
+}
+
+void TileScheduler::SetMetrics(const float* metrics, UINT tileCount)
+{
+	// A readback from before a resize describes a different grid
+	if (tileCount != GetTileCount()) return;
+
+	m_Metrics.assign(metrics, metrics + tileCount * 2);
+}
+
+const std::vector<TileScheduler::Tile>& TileScheduler::Schedule()
+{
+	m_Order.clear();
+
+	float maxVariance = 1e-6f;
+	for (UINT i = 0; i < GetTileCount(); i++)
+		maxVariance = (std::max)(maxVariance, m_Metrics[i * 2 + 1]);
+
+	float centreX = m_Width * 0.5f;
+	float centreY = m_Height * 0.5f;
+	float maxDistance = sqrtf(centreX * centreX + centreY * centreY);
+
+	for (UINT y = 0; y < m_TilesY; y++)
+	{
+		for (UINT x = 0; x < m_TilesX; x++)
+		{
+			Tile tile;
+			tile.Rect.left = (LONG)(x * TileSize);
+			tile.Rect.top = (LONG)(y * TileSize);
+			tile.Rect.right = (LONG)(std::min)((x + 1) * TileSize, m_Width);
+			tile.Rect.bottom = (LONG)(std::min)((y + 1) * TileSize, m_Height);
+
+			float dx = (tile.Rect.left + tile.Rect.right) * 0.5f - centreX;
+			float dy = (tile.Rect.top + tile.Rect.bottom) * 0.5f - centreY;
+			float centre = 1.0f - sqrtf(dx * dx + dy * dy) / maxDistance;
+
+			UINT index = y * m_TilesX + x;
+			float coverage = m_Metrics[index * 2];
+			float variance = m_Metrics[index * 2 + 1] / maxVariance;
+
+			tile.Priority = m_Settings.CentreWeight * centre + m_Settings.VarianceWeight * variance
+				+ m_Settings.CoverageWeight * coverage;
+			m_Order.push_back(tile);
+		}
+	}
+
+	std::sort(m_Order.begin(), m_Order.end(), [](const Tile& a, const Tile& b) { return a.Priority > b.Priority; });
+
+	// Without a cost estimate yet, refine everything once to measure it
+	size_t count = m_Order.size();
+	if (m_Stats.TileCostMs > 0.0f)
+	{
+		float remaining = m_Settings.DeadlineMs - (std::max)(m_SmoothedCoarseMs, 0.0f);
+		count = (std::min)(count, (size_t)(std::max)(remaining / m_Stats.TileCostMs, 0.0f));
+	}
+
+	m_Scheduled.assign(m_Order.begin(), m_Order.begin() + count);
+
+	m_SmoothedTiles += ((float)count - m_SmoothedTiles) * SmoothingFactor;
+	m_Stats.TilesTotal = (int)m_Order.size();
+	m_Stats.TilesRefined = (int)count;
+	return m_Scheduled;
+}
+
+void TileScheduler::ReportTimes(float coarseMs, float refineMs)
+{
+	if (coarseMs >= 0.0f)
+	{
+		m_SmoothedCoarseMs = (m_SmoothedCoarseMs < 0.0f) ? coarseMs : m_SmoothedCoarseMs + (coarseMs - m_SmoothedCoarseMs) * SmoothingFactor;
+		m_Stats.CoarseMs = m_SmoothedCoarseMs;
+	}
+
+	if (refineMs >= 0.0f)
+	{
+		m_SmoothedRefineMs = (m_SmoothedRefineMs < 0.0f) ? refineMs : m_SmoothedRefineMs + (refineMs - m_SmoothedRefineMs) * SmoothingFactor;
+		m_Stats.RefineMs = m_SmoothedRefineMs;
+
+		// Keep the last estimate while nothing is refined, otherwise the budget could never grow again
+		if (m_SmoothedTiles >= 1.0f)
+			m_Stats.TileCostMs = m_SmoothedRefineMs / m_SmoothedTiles;
+	}
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+// Orders the cloud refinement tiles and decides how many fit before the GPU deadline.
+// Every frame gets a complete coarse image first; refinement then spends whatever budget is left on the tiles that matter most.
+class TileScheduler
+{
+public:
+	struct Settings
+	{
+		bool  bEnabled = false;
+		float DeadlineMs = 12.0f;      // GPU budget of the whole cloud pass (coarse + metrics + refinement)
+		float CoarseStepScale = 0.3f;  // Primary steps of the coarse pass; light steps stay put to avoid seams
+		float CentreWeight = 1.0f;
+		float VarianceWeight = 1.0f;
+		float CoverageWeight = 1.0f;
+	};
+
+	struct Tile
+	{
+		D3D11_RECT Rect;
+		float      Priority;
+	};
+
+	struct Stats
+	{
+		int   TilesTotal = 0;
+		int   TilesRefined = 0;
+		float CoarseMs = 0.0f;    // Coarse march + tile metrics, smoothed
+		float RefineMs = 0.0f;    // All refinement tiles, smoothed
+		float TileCostMs = 0.0f;  // Estimated GPU time of one refinement tile
+	};
+
+	static constexpr UINT TileSize = 64;   // [Important] Must match TILE_SIZE in Shaders/TileMetricsCS.hlsl
+
+public:
+	TileScheduler() {}
+	~TileScheduler() {}
+
+	// [Rule] System classes should NOT be copied.
+	TileScheduler(const TileScheduler&) = delete;
+	TileScheduler& operator=(const TileScheduler&) = delete;
+
+	// Rebuilds the tile grid when the cloud target size changes; returns true if it did
+	bool Resize(UINT width, UINT height);
+
+	UINT GetTilesX() const { return m_TilesX; }
+	UINT GetTilesY() const { return m_TilesY; }
+	UINT GetTileCount() const { return m_TilesX * m_TilesY; }
+
+	// Coverage/variance pairs from TileMetricsCS, a few frames old
+	void SetMetrics(const float* metrics, UINT tileCount);
+
+	// Tiles sorted by priority, cut to the number that fits in the remaining budget
+	const std::vector<Tile>& Schedule();
+
+	// GPU times resolved by the profiler (negative if the scope did not run in that frame)
+	void ReportTimes(float coarseMs, float refineMs);
+
+	const Stats& GetStats() const { return m_Stats; }
+
+	Settings m_Settings;
+
+private:
+	UINT m_TilesX = 0;
+	UINT m_TilesY = 0;
+	UINT m_Width = 0;
+	UINT m_Height = 0;
+
+	std::vector<float> m_Metrics;      // Two floats per tile
+	std::vector<Tile> m_Order;
+	std::vector<Tile> m_Scheduled;
+
+	// Smoothed refinement cost; the tile count of the profiled frame is not known, so both sides are averaged
+	float m_SmoothedCoarseMs = -1.0f;
+	float m_SmoothedRefineMs = -1.0f;
+	float m_SmoothedTiles = 0.0f;
+
+	Stats m_Stats;
+};
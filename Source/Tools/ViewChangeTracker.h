@@ -0,0 +1,48 @@
+#pragma once
+
+#include "Camera.h"
+#include "Constant.h"
+
+// Detects whether anything that affects the rendered image changed since the previous frame.
+class ViewChangeTracker
+{
+public:
+	using Vector3 = DirectX::SimpleMath::Vector3;
+
+public:
+	ViewChangeTracker() {}
+	~ViewChangeTracker() {}
+
+	// [Rule] System classes should NOT be copied.
+	ViewChangeTracker(const ViewChangeTracker&) = delete;
+	ViewChangeTracker& operator=(const ViewChangeTracker&) = delete;
+
+	// bContentChanged covers sources the tracker cannot see itself (e.g. streamed weather tiles, renderer settings)
+	bool Update(const Camera& camera, const Constant::CloudConstants& cloud, float time, bool bContentChanged)
+	{
+		bool bChanged = !m_bValid || bContentChanged
+			|| camera.m_Pos != m_Pos || camera.GetYaw() != m_Yaw || camera.GetPitch() != m_Pitch
+			|| memcmp(&cloud, &m_Cloud, sizeof(Constant::CloudConstants)) != 0
+			|| time != m_Time;
+
+		m_Pos = camera.m_Pos;
+		m_Yaw = camera.GetYaw();
+		m_Pitch = camera.GetPitch();
+		m_Cloud = cloud;
+		m_Time = time;
+		m_bValid = true;
+
+		return bChanged;
+	}
+
+	void Invalidate() { m_bValid = false; }
+
+private:
+	bool m_bValid = false;
+
+	Vector3 m_Pos;
+	float m_Yaw = 0.0f;
+	float m_Pitch = 0.0f;
+	Constant::CloudConstants m_Cloud = {};
+	float m_Time = 0.0f;
+};